@@ -383,14 +383,31 @@ setup(
                  'src/python/utils.cpp',
                  'src/core/audio_decoders.cpp',
                  'src/core/utils.cpp',
+                 'src/core/cpu_dispatch.cpp',
+                 'src/core/simd_kernels.cpp',
+                 'src/core/pipeline_stats.cpp',
+                 'src/core/trace_events.cpp',
+                 'src/core/backend.cpp',
+                 'src/core/reference_backend.cpp',
                  'src/core/key.cpp',
+                 'src/core/key_profile_plan.cpp',
+                 'src/core/key_tracker.cpp',
+                 'src/core/chromagram.cpp',
+                 'src/core/constant_q.cpp',
+                 'src/core/key_changes.cpp',
+                 'src/core/key_detector.cpp',
+                 'src/core/key_files.cpp',
                  'src/core/hpcp.cpp',
                  'src/core/framecutter.cpp',
                  'src/core/windowing.cpp',
                  'src/core/peak_detect.cpp',
                  'src/core/spectral_peaks.cpp',
                  'src/core/spectrum.cpp',
-                 'src/core/mono_mixer.cpp'
+                 'src/core/mono_mixer.cpp',
+                 'src/core/resampler.cpp',
+                 'src/core/fft_convolve.cpp',
+                 'src/core/wavelet.cpp',
+                 'src/core/bpm.cpp'
              ],
              depends=[
                  'src/python/module.h',
@@ -398,14 +415,32 @@ setup(
                  'src/python/utils.h',
                  'src/core/audio_decoders.h',
                  'src/core/utils.h',
-                 'src/core/key.h'
+                 'src/core/cpu_dispatch.h',
+                 'src/core/simd_kernels.h',
+                 'src/core/pipeline_stats.h',
+                 'src/core/trace_events.h',
+                 'src/core/backend.h',
+                 'src/core/reference_backend.h',
+                 'src/core/key.h',
+                 'src/core/key_profile_plan.h',
+                 'src/core/key_profiles.h',
+                 'src/core/key_tracker.h',
+                 'src/core/chromagram.h',
+                 'src/core/constant_q.h',
+                 'src/core/key_changes.h',
+                 'src/core/key_detector.h',
+                 'src/core/key_files.h',
                  'src/core/hpcp.h',
                  'src/core/framecutter.h',
                  'src/core/windowing.h',
                  'src/core/peak_detect.h',
                  'src/core/spectral_peaks.h',
                  'src/core/spectrum.h',
-                 'src/core/mono_mixer.h'
+                 'src/core/mono_mixer.h',
+                 'src/core/resampler.h',
+                 'src/core/fft_convolve.h',
+                 'src/core/wavelet.h',
+                 'src/core/bpm.h'
              ],
              extra_compile_args=extra_compile_args(),
              extra_link_args=extra_link_args(),
@@ -1,21 +1,33 @@
 #include "src/core/audio_decoders.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #define MINIMP3_IMPLEMENTATION
 #include <minimp3/minimp3_ex.h>
 
+#include "src/core/pipeline_stats.h"
+#include "src/core/simd_kernels.h"
+#include "src/core/trace_events.h"
 #include "src/core/utils.h"
 
 namespace musher {
 namespace core {
 
 std::vector<uint8_t> LoadAudioFile(const std::string& file_path) {
+  StageTimer stage_timer(&PipelineStats::decode_seconds);
+  TraceSpan trace_span("LoadAudioFile", "decode,io");
+  trace_span.SetArg("file_path", file_path);
   // std::error_code e;
   // fs::path audioFileAbsPath = fs::canonical(filePath, e);
   if (file_path.empty()) {
@@ -23,6 +35,13 @@ std::vector<uint8_t> LoadAudioFile(const std::string& file_path) {
   }
   std::ifstream audio_file(file_path, std::ios::binary);
 
+  // Reserve the whole file, growing the buffer while reading would hold up to twice its size.
+  std::vector<uint8_t> file_data;
+  audio_file.seekg(0, std::ios::end);
+  std::streamoff file_size = audio_file.tellg();
+  audio_file.seekg(0, std::ios::beg);
+  if (file_size > 0) file_data.reserve(static_cast<size_t>(file_size));
+
   // skip white space
   audio_file.unsetf(std::ios::skipws);
   std::istream_iterator<uint8_t> begin(audio_file), end;
@@ -32,17 +51,62 @@ std::vector<uint8_t> LoadAudioFile(const std::string& file_path) {
     throw std::runtime_error(ss.str().c_str());
   }
 
-  std::vector<uint8_t> file_data(begin, end);
+  file_data.assign(begin, end);
+  RecordPeakBytes(&PipelineStats::peak_file_bytes, VectorBytes(file_data));
   return file_data;
 }
 
-WavDecoded DecodeWav(const std::vector<uint8_t>& file_data) {
-  std::vector<std::vector<double>> samples;
+namespace {
+
+/**
+ * @brief Format of a wav file and position of its samples, read from the header chunks.
+ */
+struct WavHeader {
+  int num_channels;
+  uint32_t sample_rate;
+  int bit_depth;
+  int num_bytes_per_sample;
+  int num_bytes_per_block;
+  size_t samples_start_index;  //!< Index of the first sample in the file data.
+  int64_t num_samples;         //!< Number of samples per channel, given by the size of the data chunk.
+};
+
+/**
+ * @brief Index of the first occurrence of a chunk id in the file data.
+ *
+ * @return int64_t Index of the chunk, -1 if it was not found.
+ */
+int64_t FindWavChunk(const std::vector<uint8_t>& file_data, const std::string& chunk_key) {
+  auto chunk_it = std::search(file_data.begin(), file_data.end(), chunk_key.begin(), chunk_key.end());
+  if (chunk_it == file_data.end()) return -1;
+  return static_cast<int64_t>(std::distance(file_data.begin(), chunk_it));
+}
 
-  if (!samples.empty()) {
-    std::string err_message = "Audio Buffer must be empty";
+/**
+ * @brief Whether the beginning of a wav file holds the complete format chunk and the header of the data chunk.
+ */
+bool HasWavHeader(const std::vector<uint8_t>& file_data) {
+  int64_t data_chunk_index = FindWavChunk(file_data, "data");
+  int64_t format_chunk_index = FindWavChunk(file_data, "fmt");
+  return data_chunk_index != -1 && format_chunk_index != -1 &&
+         static_cast<size_t>(data_chunk_index) + 8 <= file_data.size() &&
+         static_cast<size_t>(format_chunk_index) + 24 <= file_data.size();
+}
+
+/**
+ * @brief Read and check the header chunks of a wav file.
+ *
+ * @param file_data WAV file data, or only its beginning as long as it holds the header (see HasWavHeader).
+ * @return WavHeader Format of the file.
+ */
+WavHeader ParseWavHeader(const std::vector<uint8_t>& file_data) {
+  // if we can't find the data or format chunks, or the IDs/formats don't seem to be as expected
+  // then it is unlikely we'll able to read this file, so abort
+  if (file_data.size() < 12 || !HasWavHeader(file_data)) {
+    std::string err_message = "This doesn't seem to be a valid .WAV file";
     throw std::runtime_error(err_message);
   }
+
   // -----------------------------------------------------------
   // HEADER CHUNK
   std::string header_chunk_id(file_data.begin(), file_data.begin() + 4);
@@ -51,32 +115,19 @@ WavDecoded DecodeWav(const std::vector<uint8_t>& file_data) {
   // -----------------------------------------------------------
 
   // find data chunk in file_data
-  const std::string data_chunk_key = "data";
-  int data_chunk_index = -1;
-  auto data_chunk_it = std::search(file_data.begin(), file_data.end(), data_chunk_key.begin(), data_chunk_key.end());
-  if (data_chunk_it != file_data.end()) {
-    data_chunk_index = static_cast<int>(std::distance(file_data.begin(), data_chunk_it));
-  }
+  size_t data_chunk_index = static_cast<size_t>(FindWavChunk(file_data, "data"));
 
   // find format chunk in file_data
-  std::string format_chunk_key = "fmt";
-  int format_chunk_index = -1;
-  auto formatChunkIt =
-      std::search(file_data.begin(), file_data.end(), format_chunk_key.begin(), format_chunk_key.end());
-  if (formatChunkIt != file_data.end()) {
-    format_chunk_index = static_cast<int>(std::distance(file_data.begin(), formatChunkIt));
-  }
+  size_t format_chunk_index = static_cast<size_t>(FindWavChunk(file_data, "fmt"));
 
-  // if we can't find the data or format chunks, or the IDs/formats don't seem to be as expected
-  // then it is unlikely we'll able to read this file, so abort
-  if (data_chunk_index == -1 || format_chunk_index == -1 || header_chunk_id != "RIFF" || format != "WAVE") {
+  if (header_chunk_id != "RIFF" || format != "WAVE") {
     std::string err_message = "This doesn't seem to be a valid .WAV file";
     throw std::runtime_error(err_message);
   }
 
   // -----------------------------------------------------------
   // FORMAT CHUNK
-  int f = format_chunk_index;
+  size_t f = format_chunk_index;
   std::string format_chunk_id(file_data.begin() + f, file_data.begin() + f + 4);
   // int32_t formatChunkSize = FourBytesToInt (file_data, f + 4);
   int16_t audio_format = TwoBytesToInt(file_data, f + 8);
@@ -116,78 +167,429 @@ WavDecoded DecodeWav(const std::vector<uint8_t>& file_data) {
 
   // -----------------------------------------------------------
   // DATA CHUNK
-  int d = data_chunk_index;
+  size_t d = data_chunk_index;
   std::string data_chunk_id(file_data.begin() + d, file_data.begin() + d + 4);
-  int32_t data_chunk_size = FourBytesToInt(file_data, d + 4);
-
-  int num_samples = data_chunk_size / (num_channels * bit_depth / 8);
-  int samples_start_index = data_chunk_index + 8;
-
-  samples.resize(num_channels);
-
-  for (int i = 0; i < num_samples; i++) {
-    for (int channel = 0; channel < num_channels; channel++) {
-      int sample_index = samples_start_index + (num_bytes_per_block * i) + channel * num_bytes_per_sample;
+  // The size is unsigned, data chunks can hold up to 4 GB.
+  uint32_t data_chunk_size = static_cast<uint32_t>(FourBytesToInt(file_data, d + 4));
+
+  WavHeader header;
+  header.num_channels = static_cast<int>(num_channels);
+  header.sample_rate = sample_rate;
+  header.bit_depth = bit_depth;
+  header.num_bytes_per_sample = num_bytes_per_sample;
+  header.num_bytes_per_block = static_cast<int>(num_bytes_per_block);
+  header.samples_start_index = data_chunk_index + 8;
+  header.num_samples = static_cast<int64_t>(data_chunk_size) / (num_channels * bit_depth / 8);
+  return header;
+}
 
-      if (bit_depth == 8) {
-        // Normalize samples to between -1 and 1
-        double sample = NormalizeInt8_t(file_data[sample_index]);
-        samples[channel].push_back(sample);
-      } else if (bit_depth == 16) {
-        int16_t sample_as_int = TwoBytesToInt(file_data, sample_index);
+/**
+ * @brief Convert interleaved samples of a wav file to normalized channels.
+ *
+ * @param file_data Data holding the samples.
+ * @param start_index Index of the first sample in file_data.
+ * @param num_samples Number of samples per channel to convert, file_data must hold all of them.
+ * @param header Format of the samples.
+ * @param samples One vector per channel, resized to num_samples.
+ */
+void ConvertWavSamples(const std::vector<uint8_t>& file_data,
+                       size_t start_index,
+                       size_t num_samples,
+                       const WavHeader& header,
+                       std::vector<std::vector<double>>& samples) {
+  samples.resize(static_cast<size_t>(header.num_channels));
+  for (std::vector<double>& channel : samples) channel.resize(num_samples);
+  size_t num_bytes_per_block = static_cast<size_t>(header.num_bytes_per_block);
+  size_t num_bytes_per_sample = static_cast<size_t>(header.num_bytes_per_sample);
+
+  // One pass per channel with the bit depth decided once, multi-hour files have billions of samples.
+  for (size_t channel = 0; channel < samples.size(); channel++) {
+    const uint8_t* data = file_data.data() + start_index + channel * num_bytes_per_sample;
+    double* channel_samples = samples[channel].data();
+
+    if (header.bit_depth == 8) {
+      // Normalize samples to between -1 and 1, through a table of the 256 values.
+      double normalized_values[256];
+      for (int value = 0; value < 256; value++) normalized_values[value] = NormalizeInt8_t(static_cast<uint8_t>(value));
+      for (size_t i = 0; i < num_samples; i++) channel_samples[i] = normalized_values[data[num_bytes_per_block * i]];
+    } else if (header.bit_depth == 16) {
+      for (size_t i = 0; i < num_samples; i++) {
+        const uint8_t* sample_data = data + num_bytes_per_block * i;
+        int16_t sample_as_int = static_cast<int16_t>((sample_data[1] << 8) | sample_data[0]);
         // Normalize samples to between -1 and 1
-        double sample = NormalizeInt16_t(sample_as_int);
-        samples[channel].push_back(sample);
-      } else if (bit_depth == 24) {
-        int32_t sample_as_int = 0;
-        sample_as_int =
-            (file_data[sample_index + 2] << 16) | (file_data[sample_index + 1] << 8) | file_data[sample_index];
+        channel_samples[i] = NormalizeInt16_t(sample_as_int);
+      }
+    } else if (header.bit_depth == 24) {
+      for (size_t i = 0; i < num_samples; i++) {
+        const uint8_t* sample_data = data + num_bytes_per_block * i;
+        int32_t sample_as_int = (sample_data[2] << 16) | (sample_data[1] << 8) | sample_data[0];
 
         if (sample_as_int & 0x800000)  // if the 24th bit is set, this is a negative number in 24-bit world
           sample_as_int = sample_as_int | ~0xFFFFFF;  // so make sure sign is extended to the 32 bit float
 
         // Normalize samples to between -1 and 1
         // double sample = NormalizeInt32_t(sample_as_int);
-        double sample = static_cast<double>(sample_as_int);
-        samples[channel].push_back(sample);
-      } else {
-        std::string err_message =
-            "This file has a bit depth that is not 8, 16 or 24 bits, not sure how you got past the first error check.";
-        throw std::runtime_error(err_message);
+        channel_samples[i] = static_cast<double>(sample_as_int);
       }
+    } else {
+      std::string err_message =
+          "This file has a bit depth that is not 8, 16 or 24 bits, not sure how you got past the first error "
+          "check.";
+      throw std::runtime_error(err_message);
     }
   }
+}
 
-  int num_channels_int = static_cast<int>(num_channels);
-  bool mono = num_channels == 1;
-  bool stereo = num_channels == 2;
-  int num_samples_per_channel = 0;
-  if (samples.size() > 0) num_samples_per_channel = static_cast<int>(samples[0].size());
-  double length_in_seconds = static_cast<double>(num_samples_per_channel) / static_cast<double>(sample_rate);
-  std::string file_type = "wav";
-  int avg_bitrate_kbps = (sample_rate * bit_depth * num_channels_int) / 1000;
-
+/**
+ * @brief Fill the information of a decoded wav file, without its samples.
+ */
+WavDecoded MakeWavDecoded(const WavHeader& header, int64_t samples_per_channel) {
   WavDecoded wav_decoded;
-  wav_decoded.sample_rate = sample_rate;
-  wav_decoded.bit_depth = bit_depth;
-  wav_decoded.channels = num_channels_int;
-  wav_decoded.mono = mono;
-  wav_decoded.stereo = stereo;
-  wav_decoded.samples_per_channel = num_samples_per_channel;
-  wav_decoded.length_in_seconds = length_in_seconds;
-  wav_decoded.file_type = file_type;
-  wav_decoded.avg_bitrate_kbps = avg_bitrate_kbps;
-  wav_decoded.normalized_samples = samples;
+  wav_decoded.sample_rate = header.sample_rate;
+  wav_decoded.bit_depth = header.bit_depth;
+  wav_decoded.channels = header.num_channels;
+  wav_decoded.mono = header.num_channels == 1;
+  wav_decoded.stereo = header.num_channels == 2;
+  wav_decoded.samples_per_channel = samples_per_channel;
+  wav_decoded.length_in_seconds = static_cast<double>(samples_per_channel) / static_cast<double>(header.sample_rate);
+  wav_decoded.file_type = "wav";
+  wav_decoded.avg_bitrate_kbps = static_cast<int>((header.sample_rate * header.bit_depth * header.num_channels) / 1000);
+  return wav_decoded;
+}
+
+/**
+ * @brief Read the beginning of a wav file until it holds the header chunks (see HasWavHeader) or the file ends.
+ */
+std::vector<uint8_t> ReadWavHeaderData(std::ifstream& wav_file) {
+  std::vector<uint8_t> header_data;
+  while (!HasWavHeader(header_data) && wav_file) {
+    // Doubling the reads keeps the searches linear when the data chunk comes after large metadata chunks.
+    size_t size = header_data.size();
+    size_t read_size = std::max<size_t>(4096, size);
+    header_data.resize(size + read_size);
+    wav_file.read(reinterpret_cast<char*>(header_data.data() + size), static_cast<std::streamsize>(read_size));
+    header_data.resize(size + static_cast<size_t>(wav_file.gcount()));
+  }
+  return header_data;
+}
+
+std::ifstream OpenAudioFile(const std::string& file_path) {
+  if (file_path.empty()) {
+    throw std::runtime_error("No file provided");
+  }
+  std::ifstream audio_file(file_path, std::ios::binary);
+  if (!audio_file) {
+    std::stringstream ss;
+    ss << "Failed to load file '" << file_path << "'";
+    throw std::runtime_error(ss.str().c_str());
+  }
+  return audio_file;
+}
+
+int64_t AudioFileSize(std::ifstream& audio_file) {
+  std::streampos position = audio_file.tellg();
+  audio_file.seekg(0, std::ios::end);
+  int64_t file_size = static_cast<int64_t>(audio_file.tellg());
+  audio_file.seekg(position);
+  return file_size;
+}
+
+
+}  // namespace
+
+WavDecoded DecodeWav(const std::vector<uint8_t>& file_data) {
+  StageTimer stage_timer(&PipelineStats::decode_seconds);
+  TraceSpan trace_span("DecodeWavData", "decode");
+  trace_span.SetArg("bytes", static_cast<int64_t>(file_data.size()));
+  CountStat(&PipelineStats::bytes_decoded, static_cast<int64_t>(file_data.size()));
+  WavHeader header = ParseWavHeader(file_data);
+  int num_channels = header.num_channels;
+  int64_t num_samples = header.num_samples;
+  size_t samples_start_index = header.samples_start_index;
+
+  std::vector<std::vector<double>> samples(num_channels);
+
+  // Little endian hosts can convert the interleaved 16 bit samples in one pass.
+  size_t num_values = static_cast<size_t>(num_samples) * static_cast<size_t>(num_channels);
+  bool contiguous_int16 = header.bit_depth == 16 && !IsBigEndian() && header.num_bytes_per_block == num_channels * 2 &&
+                          samples_start_index + num_values * sizeof(int16_t) <= file_data.size();
+  if (contiguous_int16) {
+    std::vector<double> interleaved(num_values);
+    {
+      std::vector<int16_t> pcm(num_values);
+      std::memcpy(pcm.data(), file_data.data() + samples_start_index, num_values * sizeof(int16_t));
+      // Dividing by 32768 like NormalizeInt16_t, a power of two, so the product is exact.
+      ConvertInt16ToDouble(pcm.data(), num_values, 1. / 32768., interleaved.data());
+      RecordPeakBytes(&PipelineStats::peak_decoded_bytes, VectorBytes(pcm) + VectorBytes(interleaved));
+    }
+    if (num_channels == 1) {
+      samples[0] = std::move(interleaved);
+    } else {
+      samples = Deinterweave(interleaved);
+      RecordPeakBytes(&PipelineStats::peak_decoded_bytes,
+                      VectorBytes(interleaved) + VectorBytes(samples[0]) + VectorBytes(samples[1]));
+    }
+  } else {
+    // A truncated data chunk only yields the samples that are in the file.
+    size_t available_samples =
+        (file_data.size() - samples_start_index) / static_cast<size_t>(header.num_bytes_per_block);
+    ConvertWavSamples(file_data, samples_start_index, std::min(static_cast<size_t>(num_samples), available_samples),
+                      header, samples);
+    int64_t decoded_bytes = 0;
+    for (const std::vector<double>& channel : samples) decoded_bytes += VectorBytes(channel);
+    RecordPeakBytes(&PipelineStats::peak_decoded_bytes, decoded_bytes);
+  }
+
+  WavDecoded wav_decoded = MakeWavDecoded(header, static_cast<int64_t>(samples[0].size()));
+  wav_decoded.normalized_samples = std::move(samples);
 
   return wav_decoded;
 }
 
 WavDecoded DecodeWav(const std::string& file_path) {
+  StageTimer stage_timer(&PipelineStats::decode_seconds);
+  TraceSpan trace_span("DecodeWav", "decode");
+  trace_span.SetArg("file_path", file_path);
   std::vector<uint8_t> file_data = LoadAudioFile(file_path);
   return DecodeWav(file_data);
 }
 
+WavDecoded ReadWavInfo(const std::string& file_path) {
+  std::ifstream wav_file = OpenAudioFile(file_path);
+  int64_t file_size = AudioFileSize(wav_file);
+  WavHeader header = ParseWavHeader(ReadWavHeaderData(wav_file));
+
+  // Like DecodeWav, a truncated data chunk only holds the samples that are in the file.
+  int64_t available_samples =
+      (file_size - static_cast<int64_t>(header.samples_start_index)) / header.num_bytes_per_block;
+  int64_t num_samples = std::max<int64_t>(std::min(header.num_samples, available_samples), 0);
+  return MakeWavDecoded(header, num_samples);
+}
+
+WavDecoded StreamWav(const std::string& file_path, size_t block_size, const AudioBlockCallback& callback) {
+  TraceSpan trace_span("StreamWav", "decode");
+  trace_span.SetArg("file_path", file_path);
+  if (block_size == 0) throw std::runtime_error("StreamWav: block size should be larger than 0");
+
+  std::ifstream wav_file = OpenAudioFile(file_path);
+  WavHeader header;
+  {
+    StageTimer stage_timer(&PipelineStats::decode_seconds);
+    std::vector<uint8_t> header_data = ReadWavHeaderData(wav_file);
+    header = ParseWavHeader(header_data);
+    CountStat(&PipelineStats::bytes_decoded, static_cast<int64_t>(header.samples_start_index));
+    RecordPeakBytes(&PipelineStats::peak_file_bytes, VectorBytes(header_data));
+  }
+  wav_file.clear();
+  wav_file.seekg(static_cast<std::streamoff>(header.samples_start_index));
+
+  std::vector<uint8_t> block_data(block_size * static_cast<size_t>(header.num_bytes_per_block));
+  std::vector<std::vector<double>> block;
+  int64_t num_samples = 0;
+  while (num_samples < header.num_samples && wav_file) {
+    // The analysis in the callback is timed by its own stages.
+    {
+      StageTimer stage_timer(&PipelineStats::decode_seconds);
+      size_t block_samples = std::min(block_size, static_cast<size_t>(header.num_samples - num_samples));
+      wav_file.read(reinterpret_cast<char*>(block_data.data()),
+                    static_cast<std::streamsize>(block_samples * static_cast<size_t>(header.num_bytes_per_block)));
+      size_t read_samples = static_cast<size_t>(wav_file.gcount() / header.num_bytes_per_block);
+      ConvertWavSamples(block_data, 0, read_samples, header, block);
+      CountStat(&PipelineStats::bytes_decoded, static_cast<int64_t>(wav_file.gcount()));
+      RecordPeakBytes(&PipelineStats::peak_file_bytes, VectorBytes(block_data));
+      RecordPeakBytes(&PipelineStats::peak_decoded_bytes, VectorBytes(block[0]) * header.num_channels);
+    }
+    if (block[0].empty()) break;
+    callback(block);
+    num_samples += static_cast<int64_t>(block[0].size());
+  }
+
+  return MakeWavDecoded(header, num_samples);
+}
+
+struct WavReader::Format {
+  WavHeader header;
+};
+
+WavReader::WavReader(const std::string& file_path) : wav_file_(OpenAudioFile(file_path)) {
+  StageTimer stage_timer(&PipelineStats::decode_seconds);
+  int64_t file_size = AudioFileSize(wav_file_);
+  std::vector<uint8_t> header_data = ReadWavHeaderData(wav_file_);
+  std::shared_ptr<Format> format = std::make_shared<Format>();
+  format->header = ParseWavHeader(header_data);
+  CountStat(&PipelineStats::bytes_decoded, static_cast<int64_t>(format->header.samples_start_index));
+  RecordPeakBytes(&PipelineStats::peak_file_bytes, VectorBytes(header_data));
+
+  // Like DecodeWav, a truncated data chunk only holds the samples that are in the file.
+  int64_t available_samples =
+      (file_size - static_cast<int64_t>(format->header.samples_start_index)) / format->header.num_bytes_per_block;
+  int64_t num_samples = std::max<int64_t>(std::min(format->header.num_samples, available_samples), 0);
+  format->header.num_samples = num_samples;
+  info_ = MakeWavDecoded(format->header, num_samples);
+  format_ = format;
+}
+
+void WavReader::Read(int64_t start_index, size_t num_samples, std::vector<std::vector<double>>& samples) {
+  StageTimer stage_timer(&PipelineStats::decode_seconds);
+  const WavHeader& header = format_->header;
+  samples.resize(static_cast<size_t>(header.num_channels));
+  for (std::vector<double>& channel : samples) channel.assign(num_samples, 0.);
+
+  int64_t begin = std::min(std::max<int64_t>(start_index, 0), header.num_samples);
+  int64_t end = std::max(begin, std::min<int64_t>(start_index + static_cast<int64_t>(num_samples), header.num_samples));
+  if (begin == end) return;
+
+  size_t num_bytes_per_block = static_cast<size_t>(header.num_bytes_per_block);
+  data_.resize(static_cast<size_t>(end - begin) * num_bytes_per_block);
+  wav_file_.clear();
+  size_t begin_index = header.samples_start_index + static_cast<size_t>(begin) * num_bytes_per_block;
+  wav_file_.seekg(static_cast<std::streamoff>(begin_index));
+  wav_file_.read(reinterpret_cast<char*>(data_.data()), static_cast<std::streamsize>(data_.size()));
+  size_t read_samples = static_cast<size_t>(wav_file_.gcount()) / num_bytes_per_block;
+  ConvertWavSamples(data_, 0, read_samples, header, converted_);
+  CountStat(&PipelineStats::bytes_decoded, static_cast<int64_t>(wav_file_.gcount()));
+  RecordPeakBytes(&PipelineStats::peak_file_bytes, VectorBytes(data_));
+  RecordPeakBytes(&PipelineStats::peak_decoded_bytes, VectorBytes(samples[0]) * header.num_channels);
+
+  for (size_t channel = 0; channel < samples.size(); channel++) {
+    std::copy(converted_[channel].begin(), converted_[channel].end(),
+              samples[channel].begin() + (begin - start_index));
+  }
+}
+
+namespace {
+
+const size_t kMp3WindowBytes = 1 << 18;
+const size_t kMp3LookaheadBytes = 1 << 16;
+
+/**
+ * @brief Decodes an mp3 file frame by frame through a window of the file, like mp3dec_load does on the whole file.
+ *
+ * The window keeps at least kMp3LookaheadBytes after the next frame until the end of the file. minimp3 only looks a
+ * few frames ahead to match a frame header, so the frames are found at the same positions as in the whole file.
+ */
+class Mp3Stream {
+ public:
+  explicit Mp3Stream(const std::string& file_path)
+      : file_(OpenAudioFile(file_path)), window_(kMp3WindowBytes), begin_(0), end_(0), position_(0), eof_(false) {
+    file_size_ = AudioFileSize(file_);
+    Fill();
+
+    // Same as mp3dec_skip_id3, the size of an ID3v2 tag is stored in 4 bytes of 7 bits.
+    if (file_size_ > 10 && end_ > 10 && std::strncmp(reinterpret_cast<const char*>(window_.data()), "ID3", 3) == 0) {
+      int64_t id3v2_size = (((window_[6] & 0x7f) << 21) | ((window_[7] & 0x7f) << 14) | ((window_[8] & 0x7f) << 7) |
+                            (window_[9] & 0x7f)) +
+                           10;
+      Skip(std::min(id3v2_size, file_size_));
+    }
+    mp3dec_init(&decoder_);
+  }
+
+  /**
+   * @brief Decode the next frame, see mp3dec_decode_frame.
+   *
+   * @param pcm Interleaved samples of the frame, MINIMP3_MAX_SAMPLES_PER_FRAME at most.
+   * @param info Information of the frame. The stream ends when frame_bytes is 0.
+   * @return int Number of samples per channel, 0 if the bytes that were skipped hold no frame.
+   */
+  int DecodeFrame(mp3d_sample_t* pcm, mp3dec_frame_info_t* info) {
+    Fill();
+    int samples = mp3dec_decode_frame(&decoder_, window_.data() + begin_, static_cast<int>(end_ - begin_), pcm, info);
+    begin_ += static_cast<size_t>(info->frame_bytes);
+    position_ += info->frame_bytes;
+    return samples;
+  }
+
+  int64_t FileSize() const { return file_size_; }
+
+  int64_t Position() const { return position_; }  //!< Bytes of the file before the next frame.
+
+  int64_t WindowBytes() const { return static_cast<int64_t>(window_.capacity()); }
+
+ private:
+  void Fill() {
+    if (eof_ || end_ - begin_ >= kMp3LookaheadBytes) return;
+    std::memmove(window_.data(), window_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+    file_.read(reinterpret_cast<char*>(window_.data() + end_), static_cast<std::streamsize>(window_.size() - end_));
+    end_ += static_cast<size_t>(file_.gcount());
+    if (end_ < window_.size()) eof_ = true;
+  }
+
+  void Skip(int64_t num_bytes) {
+    position_ += num_bytes;
+    if (static_cast<size_t>(num_bytes) <= end_ - begin_) {
+      begin_ += static_cast<size_t>(num_bytes);
+    } else {
+      file_.clear();
+      file_.seekg(num_bytes - static_cast<int64_t>(end_ - begin_), std::ios::cur);
+      begin_ = end_ = 0;
+      eof_ = false;
+    }
+    Fill();
+  }
+
+  std::ifstream file_;
+  std::vector<uint8_t> window_;
+  size_t begin_;  //!< Start of the next frame in window_.
+  size_t end_;    //!< End of the bytes read in window_.
+  int64_t file_size_;
+  int64_t position_;
+  bool eof_;
+  mp3dec_t decoder_;
+};
+
+/**
+ * @brief Decode the frames of a stream up to the first one that holds samples, like mp3dec_load.
+ *
+ * @return int Number of samples per channel of the frame.
+ */
+int DecodeFirstMp3Frame(Mp3Stream& mp3_stream, mp3d_sample_t* pcm, mp3dec_frame_info_t* frame_info) {
+  int samples;
+  do {
+    samples = mp3_stream.DecodeFrame(pcm, frame_info);
+    if (samples) break;
+  } while (frame_info->frame_bytes);
+
+  if (!samples) {
+    // error
+    throw std::runtime_error("Unable to decode MP3.");
+  }
+  return samples;
+}
+
+/**
+ * @brief Fill the information of a decoded mp3 file, without its samples.
+ */
+Mp3Decoded MakeMp3Decoded(int channels, int sample_rate, int64_t samples_per_channel, int avg_bitrate_kbps) {
+  Mp3Decoded mp3_decoded;
+  mp3_decoded.sample_rate = static_cast<uint32_t>(sample_rate);
+  mp3_decoded.channels = channels;
+  mp3_decoded.mono = channels == 1;
+  mp3_decoded.stereo = channels == 2;
+  mp3_decoded.samples_per_channel = samples_per_channel;
+  mp3_decoded.length_in_seconds = static_cast<double>(samples_per_channel) / static_cast<double>(sample_rate);
+  mp3_decoded.file_type = "mp3";
+  mp3_decoded.avg_bitrate_kbps = avg_bitrate_kbps;
+  return mp3_decoded;
+}
+
+}  // namespace
+
 Mp3Decoded DecodeMp3(const std::string file_path) {
+  StageTimer stage_timer(&PipelineStats::decode_seconds);
+  TraceSpan trace_span("DecodeMp3", "decode");
+  trace_span.SetArg("file_path", file_path);
+  if (StatsEnabled()) {
+    // mp3dec_load reads the whole file in memory.
+    std::ifstream mp3_file(file_path, std::ios::binary | std::ios::ate);
+    if (mp3_file) {
+      CountStat(&PipelineStats::bytes_decoded, static_cast<int64_t>(mp3_file.tellg()));
+      RecordPeakBytes(&PipelineStats::peak_file_bytes, static_cast<int64_t>(mp3_file.tellg()));
+    }
+  }
+
   mp3dec_t mp3d;
   mp3dec_file_info_t info;
   if (mp3dec_load(&mp3d, file_path.c_str(), &info, NULL, NULL)) {
@@ -195,38 +597,122 @@ Mp3Decoded DecodeMp3(const std::string file_path) {
     throw std::runtime_error("Unable to decode MP3.");
   }
 
-  std::vector<int32_t> interleaved_samples(info.buffer, info.buffer + info.samples);
+  // Samples are converted without normalization, like the 32 bit conversion this replaced.
+  static_assert(std::is_same<mp3d_sample_t, int16_t>::value, "minimp3 must be built with 16 bit output");
+  std::vector<double> interleaved_normalized_samples(info.samples);
+  ConvertInt16ToDouble(info.buffer, info.samples, 1., interleaved_normalized_samples.data());
+  int64_t pcm_bytes = static_cast<int64_t>(info.samples * sizeof(mp3d_sample_t));
+  RecordPeakBytes(&PipelineStats::peak_decoded_bytes, pcm_bytes + VectorBytes(interleaved_normalized_samples));
   free(info.buffer);
-  int num_samples = static_cast<int>(info.samples);
-  bool mono = info.channels == 1;
+  int64_t num_samples = static_cast<int64_t>(info.samples);
   bool stereo = info.channels == 2;
-  int samples_per_channel;
+  int64_t samples_per_channel;
   if (stereo) {
     samples_per_channel = num_samples / 2;
   } else {
-    samples_per_channel = static_cast<int>(info.samples);
+    samples_per_channel = num_samples;
   }
 
-  uint32_t sample_rate = info.hz;
-  double length_in_seconds = static_cast<double>(samples_per_channel) / static_cast<double>(sample_rate);
-  std::string file_type = "mp3";
+  Mp3Decoded mp3_decoded = MakeMp3Decoded(info.channels, info.hz, samples_per_channel, info.avg_bitrate_kbps);
+  if (stereo) {
+    mp3_decoded.normalized_samples = Deinterweave(interleaved_normalized_samples);
+    RecordPeakBytes(&PipelineStats::peak_decoded_bytes, VectorBytes(interleaved_normalized_samples) +
+                                                            VectorBytes(mp3_decoded.normalized_samples[0]) +
+                                                            VectorBytes(mp3_decoded.normalized_samples[1]));
+  } else {
+    // The samples of a mono file are not interleaved.
+    mp3_decoded.normalized_samples.push_back(std::move(interleaved_normalized_samples));
+  }
 
-  std::vector<double> interleaved_normalized_samples(interleaved_samples.size());
-  std::transform(interleaved_samples.begin(), interleaved_samples.end(), interleaved_normalized_samples.begin(),
-                 [](const int32_t x) { return static_cast<double>(x); });
+  return mp3_decoded;
+}
 
-  Mp3Decoded mp3_decoded;
-  mp3_decoded.sample_rate = sample_rate;
-  mp3_decoded.channels = info.channels;
-  mp3_decoded.mono = mono;
-  mp3_decoded.stereo = stereo;
-  mp3_decoded.samples_per_channel = samples_per_channel;
-  mp3_decoded.length_in_seconds = length_in_seconds;
-  mp3_decoded.file_type = file_type;
-  mp3_decoded.avg_bitrate_kbps = info.avg_bitrate_kbps;
-  mp3_decoded.normalized_samples = Deinterweave(interleaved_normalized_samples);
+bool HasFileExtension(const std::string& file_path, const std::string& extension) {
+  if (file_path.size() < extension.size()) return false;
+  std::string file_extension = file_path.substr(file_path.size() - extension.size());
+  std::transform(file_extension.begin(), file_extension.end(), file_extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return file_extension == extension;
+}
 
-  return mp3_decoded;
+AudioDecoded DecodeAudioFile(const std::string& file_path) {
+  if (HasFileExtension(file_path, ".wav")) return DecodeWav(file_path);
+  if (HasFileExtension(file_path, ".mp3")) return DecodeMp3(file_path);
+  throw std::runtime_error("Only .wav and .mp3 files are supported.");
+}
+
+Mp3Decoded ReadMp3Info(const std::string& file_path) {
+  Mp3Stream mp3_stream(file_path);
+  mp3d_sample_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+  mp3dec_frame_info_t frame_info;
+  int samples = DecodeFirstMp3Frame(mp3_stream, pcm, &frame_info);
+
+  // The remaining frames are assumed to be as large as the first one.
+  int64_t remaining_frames = (mp3_stream.FileSize() - mp3_stream.Position()) / frame_info.frame_bytes;
+  int64_t samples_per_channel = samples * (1 + remaining_frames);
+  return MakeMp3Decoded(frame_info.channels, frame_info.hz, samples_per_channel, frame_info.bitrate_kbps);
+}
+
+Mp3Decoded StreamMp3(const std::string& file_path, size_t block_size, const AudioBlockCallback& callback) {
+  TraceSpan trace_span("StreamMp3", "decode");
+  trace_span.SetArg("file_path", file_path);
+  if (block_size == 0) throw std::runtime_error("StreamMp3: block size should be larger than 0");
+
+  Mp3Stream mp3_stream(file_path);
+  mp3d_sample_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+  mp3dec_frame_info_t frame_info;
+  int samples;
+  {
+    StageTimer stage_timer(&PipelineStats::decode_seconds);
+    samples = DecodeFirstMp3Frame(mp3_stream, pcm, &frame_info);
+  }
+  const int channels = frame_info.channels;
+  const int hz = frame_info.hz;
+  const int layer = frame_info.layer;
+  int64_t bitrate_sum_kbps = frame_info.bitrate_kbps;
+  int64_t num_frames = 1;
+
+  std::vector<std::vector<double>> block(static_cast<size_t>(channels));
+  for (std::vector<double>& channel : block) channel.reserve(block_size + MINIMP3_MAX_SAMPLES_PER_FRAME);
+  int64_t samples_per_channel = 0;
+  auto append_frame = [&]() {
+    for (int i = 0; i < samples; i++) {
+      for (int channel = 0; channel < channels; channel++) block[channel].push_back(pcm[i * channels + channel]);
+    }
+    samples_per_channel += samples;
+  };
+  append_frame();
+
+  // Same stop conditions as mp3dec_load: the end of the file, or a frame with another format.
+  bool end_of_stream = false;
+  while (!end_of_stream) {
+    {
+      StageTimer stage_timer(&PipelineStats::decode_seconds);
+      while (block[0].size() < block_size) {
+        samples = mp3_stream.DecodeFrame(pcm, &frame_info);
+        if (samples) {
+          if (frame_info.hz != hz || frame_info.layer != layer || frame_info.channels != channels) {
+            end_of_stream = true;
+            break;
+          }
+          append_frame();
+          bitrate_sum_kbps += frame_info.bitrate_kbps;
+          num_frames++;
+        }
+        if (!frame_info.frame_bytes) {
+          end_of_stream = true;
+          break;
+        }
+      }
+      RecordPeakBytes(&PipelineStats::peak_file_bytes, mp3_stream.WindowBytes());
+      RecordPeakBytes(&PipelineStats::peak_decoded_bytes, VectorBytes(block[0]) * channels);
+    }
+    if (!block[0].empty()) callback(block);
+    for (std::vector<double>& channel : block) channel.clear();
+  }
+  CountStat(&PipelineStats::bytes_decoded, mp3_stream.FileSize());
+
+  return MakeMp3Decoded(channels, hz, samples_per_channel, static_cast<int>(bitrate_sum_kbps / num_frames));
 }
 
 }  // namespace core
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -11,15 +16,15 @@ namespace core {
  * 
  */
 struct AudioDecoded {
-  uint32_t sample_rate;     //!< Sampling rate of the audio signal \[Hz\].
-  int channels;             //!< Number of audio channels in the buffer.
-  bool mono;                //!< True is audio is mono.
-  bool stereo;              //!< True if audio is stereo.
-  int samples_per_channel;  //!< Number of samples per channel.
-  double length_in_seconds; /*!< Detailed description after the member.
-                                Based on the number of samples and the sample rate.*/
-  std::string file_type;    //!< Type of the file decoded.
-  int avg_bitrate_kbps;     //!< Average bitrate of the buffer \[kbps\]
+  uint32_t sample_rate;         //!< Sampling rate of the audio signal \[Hz\].
+  int channels;                 //!< Number of audio channels in the buffer.
+  bool mono;                    //!< True is audio is mono.
+  bool stereo;                  //!< True if audio is stereo.
+  int64_t samples_per_channel;  //!< Number of samples per channel.
+  double length_in_seconds;     /*!< Detailed description after the member.
+                                    Based on the number of samples and the sample rate.*/
+  std::string file_type;        //!< Type of the file decoded.
+  int avg_bitrate_kbps;         //!< Average bitrate of the buffer \[kbps\]
   std::vector<std::vector<double>>
       normalized_samples; /*!< Normalized samples of the audio file.
 
@@ -79,5 +84,124 @@ WavDecoded DecodeWav(const std::string& file_path);
  */
 Mp3Decoded DecodeMp3(const std::string file_path);
 
+/**
+ * @brief Whether a file path ends with an extension, ignoring the case of the path.
+ *
+ * @param file_path File path.
+ * @param extension Lowercase extension, with its dot (e.g. ".wav").
+ * @return bool True if the path ends with the extension.
+ */
+bool HasFileExtension(const std::string& file_path, const std::string& extension);
+
+/**
+ * @brief Decode a .wav or .mp3 file, the decoder is chosen from the extension of the file.
+ *
+ * @param file_path File path to a .wav or .mp3 file.
+ * @return AudioDecoded Audio file information, see DecodeWav and DecodeMp3.
+ */
+AudioDecoded DecodeAudioFile(const std::string& file_path);
+
+/**
+ * @brief Receives the blocks of samples of a streamed audio file, see StreamWav and StreamMp3.
+ *
+ * A block holds one vector of samples per channel, like AudioDecoded::normalized_samples. Its buffers are reused for
+ * the next block once the callback returns.
+ */
+using AudioBlockCallback = std::function<void(const std::vector<std::vector<double>>&)>;
+
+/**
+ * @brief Read the format of a wav file from its header, without decoding the samples.
+ *
+ * @param file_path File path to a .wav file.
+ * @return WavDecoded .wav file information, normalized_samples is empty.
+ */
+WavDecoded ReadWavInfo(const std::string& file_path);
+
+/**
+ * @brief Decode a wav file block by block, only one block of samples is held in memory at a time.
+ *
+ * The samples are the same as the ones of DecodeWav.
+ *
+ * @param file_path File path to a .wav file.
+ * @param block_size Number of samples per channel of each block, the last block can be shorter.
+ * @param callback Called with each block, in order.
+ * @return WavDecoded .wav file information, normalized_samples is empty.
+ */
+WavDecoded StreamWav(const std::string& file_path, size_t block_size, const AudioBlockCallback& callback);
+
+/**
+ * @brief Random access to the samples of a wav file.
+ *
+ * The header is read once when the reader is constructed, then any range of samples can be read by seeking to it, so
+ * the rest of the file is never read nor decoded. The samples are the same as the ones of DecodeWav.
+ *
+ * @code
+ *   WavReader wav_reader(file_path);
+ *   std::vector<std::vector<double>> samples;
+ *   wav_reader.Read(wav_reader.Info().sample_rate * 60, 4096, samples);
+ * @endcode
+ */
+class WavReader {
+ private:
+  struct Format;  //!< Format and position of the samples in the file, see the header chunks of a wav file.
+
+  std::ifstream wav_file_;
+  std::shared_ptr<const Format> format_;
+  WavDecoded info_;
+
+  // Raw bytes and converted samples of the last read, reused by the next one.
+  std::vector<uint8_t> data_;
+  std::vector<std::vector<double>> converted_;
+
+ public:
+  /**
+   * @brief Open a wav file and read its header.
+   *
+   * @param file_path File path to a .wav file.
+   */
+  explicit WavReader(const std::string& file_path);
+
+  ~WavReader() {}
+
+  /**
+   * @brief Format of the file.
+   *
+   * @return const WavDecoded& .wav file information, normalized_samples is empty.
+   */
+  const WavDecoded& Info() const { return info_; }
+
+  /**
+   * @brief Read the samples [start_index, start_index + num_samples) of every channel.
+   *
+   * @param start_index Position of the first sample, may be negative. Samples outside of the file are zeros.
+   * @param num_samples Number of samples per channel.
+   * @param samples One vector per channel, resized to num_samples.
+   */
+  void Read(int64_t start_index, size_t num_samples, std::vector<std::vector<double>>& samples);
+};
+
+/**
+ * @brief Read the format of an mp3 file from its first frame, without decoding the rest of the file.
+ *
+ * @param file_path File path to a .mp3 file.
+ * @return Mp3Decoded .mp3 file information, normalized_samples is empty. samples_per_channel is an estimate that
+ * assumes every frame is as large as the first one.
+ */
+Mp3Decoded ReadMp3Info(const std::string& file_path);
+
+/**
+ * @brief Decode an mp3 file block by block, only a window of the file and one block of samples are held in memory at
+ * a time.
+ *
+ * The samples are the same as the ones of DecodeMp3.
+ *
+ * @param file_path File path to a .mp3 file.
+ * @param block_size Minimum number of samples per channel of each block, a block ends with the first frame that
+ * reaches it. The last block can be shorter.
+ * @param callback Called with each block, in order.
+ * @return Mp3Decoded .mp3 file information, normalized_samples is empty.
+ */
+Mp3Decoded StreamMp3(const std::string& file_path, size_t block_size, const AudioBlockCallback& callback);
+
 }  // namespace core
 }  // namespace musher
@@ -0,0 +1,145 @@
+#include "src/core/backend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace musher {
+namespace core {
+
+namespace {
+
+Backend DefaultBackend() {
+  const char *env_backend = std::getenv("MUSHER_BACKEND");
+  if (env_backend != nullptr && env_backend[0] != '\0') {
+    // An invalid name is ignored, it would otherwise make an unrelated analysis throw.
+    try {
+      return ParseBackend(env_backend);
+    } catch (const std::runtime_error &) {
+    }
+  }
+  return Backend::kOptimized;
+}
+
+// -1 until the default backend has been set.
+std::atomic<int> active_backend(-1);
+
+std::mutex report_mutex;
+CrossCheckReport report = {0, 0, 0., 0., 0., 0., 0.};
+
+double MaxAbs(const std::vector<double> &values) {
+  double max_abs = 0.;
+  for (double value : values) max_abs = std::max(max_abs, std::abs(value));
+  return max_abs;
+}
+
+// max|optimized - reference| relative to the largest reference value, infinite if the sizes differ.
+double Deviation(const std::vector<double> &optimized, const std::vector<double> &reference) {
+  if (optimized.size() != reference.size()) return std::numeric_limits<double>::infinity();
+
+  double max_difference = 0.;
+  for (size_t i = 0; i < reference.size(); i++)
+    max_difference = std::max(max_difference, std::abs(optimized[i] - reference[i]));
+  return max_difference / std::max(MaxAbs(reference), DBL_MIN);
+}
+
+double PeaksDeviation(const std::vector<std::tuple<double, double>> &optimized,
+                      const std::vector<std::tuple<double, double>> &reference) {
+  if (optimized.size() != reference.size()) return std::numeric_limits<double>::infinity();
+
+  std::vector<double> optimized_frequencies(optimized.size()), optimized_magnitudes(optimized.size());
+  std::vector<double> reference_frequencies(reference.size()), reference_magnitudes(reference.size());
+  for (size_t i = 0; i < reference.size(); i++) {
+    std::tie(optimized_frequencies[i], optimized_magnitudes[i]) = optimized[i];
+    std::tie(reference_frequencies[i], reference_magnitudes[i]) = reference[i];
+  }
+  return std::max(Deviation(optimized_frequencies, reference_frequencies),
+                  Deviation(optimized_magnitudes, reference_magnitudes));
+}
+
+}  // namespace
+
+Backend ActiveBackend() {
+  int backend = active_backend.load(std::memory_order_relaxed);
+  if (backend < 0) {
+    int default_backend = static_cast<int>(DefaultBackend());
+    // Keep a backend that another thread has set in the meantime.
+    if (active_backend.compare_exchange_strong(backend, default_backend)) backend = default_backend;
+  }
+  return static_cast<Backend>(backend);
+}
+
+void SetBackend(Backend backend) { active_backend.store(static_cast<int>(backend)); }
+
+void ResetBackend() { active_backend.store(static_cast<int>(DefaultBackend())); }
+
+std::string BackendName(Backend backend) {
+  switch (backend) {
+    case Backend::kOptimized:
+      return "optimized";
+    case Backend::kReference:
+      return "reference";
+    case Backend::kCrossCheck:
+      return "cross_check";
+  }
+  throw std::runtime_error("BackendName: invalid backend");
+}
+
+Backend ParseBackend(const std::string &name) {
+  std::string lower_name = name;
+  std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  if (lower_name == "optimized") return Backend::kOptimized;
+  if (lower_name == "reference") return Backend::kReference;
+  if (lower_name == "cross_check") return Backend::kCrossCheck;
+
+  std::string err_msg = "Backend '" + name + "' is not supported. Use optimized, reference or cross_check.";
+  throw std::runtime_error(err_msg);
+}
+
+CrossCheckReport GetCrossCheckReport() {
+  std::lock_guard<std::mutex> lock(report_mutex);
+  return report;
+}
+
+void ResetCrossCheckReport() {
+  std::lock_guard<std::mutex> lock(report_mutex);
+  report = CrossCheckReport{0, 0, 0., 0., 0., 0., 0.};
+}
+
+void RecordFrameDeviations(const FrameStages &optimized, const FrameStages &reference) {
+  double windowing_deviation = Deviation(optimized.windowed_frame, reference.windowed_frame);
+  double spectrum_deviation = Deviation(optimized.spectrum, reference.spectrum);
+  double spectral_peaks_deviation = PeaksDeviation(optimized.spectral_peaks, reference.spectral_peaks);
+  double hpcp_deviation = Deviation(optimized.hpcp, reference.hpcp);
+
+  std::lock_guard<std::mutex> lock(report_mutex);
+  report.frames_checked += 1;
+  report.windowing_deviation = std::max(report.windowing_deviation, windowing_deviation);
+  report.spectrum_deviation = std::max(report.spectrum_deviation, spectrum_deviation);
+  report.spectral_peaks_deviation = std::max(report.spectral_peaks_deviation, spectral_peaks_deviation);
+  report.hpcp_deviation = std::max(report.hpcp_deviation, hpcp_deviation);
+}
+
+void RecordKeyCorrelationDeviations(const KeyCorrelations &optimized, const KeyCorrelations &reference) {
+  double key_correlation_deviation = std::max({Deviation(optimized.major, reference.major),
+                                               Deviation(optimized.minor, reference.minor),
+                                               Deviation(optimized.other, reference.other)});
+
+  std::lock_guard<std::mutex> lock(report_mutex);
+  report.estimates_checked += 1;
+  report.key_correlation_deviation = std::max(report.key_correlation_deviation, key_correlation_deviation);
+}
+
+}  // namespace core
+}  // namespace musher
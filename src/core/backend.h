@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/key_profile_plan.h"
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Implementations the frame analysis stages (windowing, spectrum, spectral peaks, HPCP) and the key profile
+ * correlation can run with.
+ */
+enum class Backend : int {
+  kOptimized = 0,   //!< Plans, work buffers and SIMD kernels (default).
+  kReference = 1,   //!< Straightforward scalar implementations of every stage, see reference_backend.h.
+  kCrossCheck = 2,  //!< Runs both, returns the optimized results and records their deviation, see CrossCheckReport.
+};
+
+/**
+ * @brief Largest deviations between the optimized and the reference backend recorded in cross-check mode.
+ *
+ * The deviation of a stage is max|optimized - reference| / max|reference| over the values of its output, the maximum
+ * over all the checked frames is kept. Spectral peaks that do not match in number give an infinite deviation.
+ */
+struct CrossCheckReport {
+  int frames_checked;                //!< Number of frames analyzed by both backends.
+  int estimates_checked;             //!< Number of key estimates computed by both backends.
+  double windowing_deviation;        //!< Windowed frames.
+  double spectrum_deviation;         //!< Magnitude spectra.
+  double spectral_peaks_deviation;   //!< Frequencies and magnitudes of the spectral peaks.
+  double hpcp_deviation;             //!< HPCPs of the frames.
+  double key_correlation_deviation;  //!< Correlations with the key profiles.
+};
+
+/**
+ * @brief Outputs of every stage of the analysis of a frame.
+ */
+struct FrameStages {
+  std::vector<double> windowed_frame;
+  std::vector<double> spectrum;
+  std::vector<std::tuple<double, double>> spectral_peaks;
+  std::vector<double> hpcp;
+};
+
+/**
+ * @brief Backend the analysis currently runs with.
+ *
+ * Defaults to Backend::kOptimized. The environment variable MUSHER_BACKEND ("optimized", "reference" or
+ * "cross_check") changes the default when it is read at the first analysis, an invalid name is ignored.
+ *
+ * @return Backend Active backend.
+ */
+Backend ActiveBackend();
+
+/**
+ * @brief Run the analysis with a specific backend. Applies to all the threads.
+ *
+ * @param backend Backend to use.
+ */
+void SetBackend(Backend backend);
+
+/**
+ * @brief Go back to the default backend (see ActiveBackend).
+ */
+void ResetBackend();
+
+/**
+ * @brief Name of a backend, as accepted by ParseBackend and MUSHER_BACKEND.
+ *
+ * @param backend Backend.
+ * @return std::string Lowercase name, for example "cross_check".
+ */
+std::string BackendName(Backend backend);
+
+/**
+ * @brief Convert the name of a backend to the backend.
+ *
+ * @param name "optimized", "reference" or "cross_check", case insensitive.
+ * @return Backend Backend.
+ */
+Backend ParseBackend(const std::string &name);
+
+/**
+ * @brief Deviations recorded since the last ResetCrossCheckReport.
+ *
+ * @return CrossCheckReport Copy of the report.
+ */
+CrossCheckReport GetCrossCheckReport();
+
+/**
+ * @brief Clear the recorded deviations.
+ */
+void ResetCrossCheckReport();
+
+/**
+ * @brief Record the deviations of the stages of a frame analyzed by both backends.
+ *
+ * @param optimized Stages computed by the optimized backend.
+ * @param reference Stages computed by the reference backend.
+ */
+void RecordFrameDeviations(const FrameStages &optimized, const FrameStages &reference);
+
+/**
+ * @brief Record the deviation of the key profile correlations computed by both backends.
+ *
+ * @param optimized Correlations computed by the optimized backend.
+ * @param reference Correlations computed by the reference backend.
+ */
+void RecordKeyCorrelationDeviations(const KeyCorrelations &optimized, const KeyCorrelations &reference);
+
+}  // namespace core
+}  // namespace musher
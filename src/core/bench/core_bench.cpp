@@ -0,0 +1,363 @@
+/**
+ * @brief Google Benchmark microbenchmarks of every core stage, and end-to-end DetectKey runs on the test data.
+ *
+ * Usage: musher-core-bench [--benchmark_filter=<regex>] [google benchmark flags]
+ *
+ * The stages are parameterized by frame size, PCP size and peak count. The DetectKey runs report the real-time factor
+ * (seconds of audio analyzed per second of wall time) of every file of the test data directory, at the sample rate of
+ * the file and at the analysis rates 22050 and 11025 (see DetectKey analysis_sample_rate). The DetectKeyConstantQ runs
+ * analyze the same files with the constant-Q front end, their label is the key they find next to the key of DetectKey.
+ * The BPMOverWindow runs report the real-time factor of the tempo of every file, their label is the BPM they find.
+ * The PeakMemory runs decode and analyze each file with the stats enabled and report the peak bytes of every stage (see
+ * PipelineStats).
+ */
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/audio_decoders.h"
+#include "src/core/bpm.h"
+#include "src/core/chromagram.h"
+#include "src/core/constant_q.h"
+#include "src/core/fft_convolve.h"
+#include "src/core/framecutter.h"
+#include "src/core/hpcp.h"
+#include "src/core/key.h"
+#include "src/core/mono_mixer.h"
+#include "src/core/peak_detect.h"
+#include "src/core/pipeline_stats.h"
+#include "src/core/resampler.h"
+#include "src/core/spectral_peaks.h"
+#include "src/core/spectrum.h"
+#include "src/core/wavelet.h"
+#include "src/core/windowing.h"
+
+using namespace musher::core;
+
+namespace {
+
+const std::string kDataDir = std::string(SOURCE_DIR) + "/data/audio_files/";
+const double kSampleRate = 44100.;
+
+// A few partials with some noise, so the spectra have realistic peaks.
+std::vector<double> SyntheticSignal(size_t size, unsigned int seed = 0) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> noise(0., 0.01);
+  std::vector<double> signal(size);
+  for (size_t i = 0; i < size; i++) {
+    double t = static_cast<double>(i) / kSampleRate;
+    signal[i] = 0.5 * std::sin(2. * M_PI * 261.63 * t) + 0.3 * std::sin(2. * M_PI * 329.63 * t) +
+                0.2 * std::sin(2. * M_PI * 392.00 * t) + noise(rng);
+  }
+  return signal;
+}
+
+std::vector<double> SyntheticSpectrum(int frame_size) {
+  return ConvertToFrequencySpectrum(Windowing(SyntheticSignal(static_cast<size_t>(frame_size)), BlackmanHarris62dB));
+}
+
+void FrameSizes(benchmark::internal::Benchmark *benchmark) {
+  benchmark->ArgName("frame_size");
+  for (int frame_size : {1024, 2048, 4096, 8192, 16384}) benchmark->Arg(frame_size);
+}
+
+// Decoding
+
+void BM_LoadAudioFile(benchmark::State &state, const std::string &file_name) {
+  const std::string file_path = kDataDir + file_name;
+  for (auto _ : state) benchmark::DoNotOptimize(LoadAudioFile(file_path));
+}
+BENCHMARK_CAPTURE(BM_LoadAudioFile, wav, std::string("700kb.wav"));
+BENCHMARK_CAPTURE(BM_LoadAudioFile, mp3, std::string("700kb.mp3"));
+
+void BM_DecodeWav(benchmark::State &state) {
+  const std::vector<uint8_t> file_data = LoadAudioFile(kDataDir + "700kb.wav");
+  for (auto _ : state) benchmark::DoNotOptimize(DecodeWav(file_data));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(file_data.size()));
+}
+BENCHMARK(BM_DecodeWav)->Unit(benchmark::kMillisecond);
+
+void BM_DecodeMp3(benchmark::State &state) {
+  const std::string file_path = kDataDir + "700kb.mp3";
+  for (auto _ : state) benchmark::DoNotOptimize(DecodeMp3(file_path));
+}
+BENCHMARK(BM_DecodeMp3)->Unit(benchmark::kMillisecond);
+
+// Framing
+
+void BM_MonoMixer(benchmark::State &state) {
+  const size_t num_samples = static_cast<size_t>(state.range(0));
+  const std::vector<std::vector<double>> stereo = {SyntheticSignal(num_samples, 1), SyntheticSignal(num_samples, 2)};
+  for (auto _ : state) benchmark::DoNotOptimize(MonoMixer(stereo));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(num_samples));
+}
+BENCHMARK(BM_MonoMixer)->ArgName("num_samples")->RangeMultiplier(8)->Range(1 << 12, 1 << 21);
+
+void BM_Framecutter(benchmark::State &state) {
+  const int frame_size = static_cast<int>(state.range(0));
+  const std::vector<double> signal = SyntheticSignal(static_cast<size_t>(10. * kSampleRate));
+  for (auto _ : state) {
+    Framecutter framecutter(signal, frame_size, frame_size / 8);
+    for (const std::vector<double> &frame : framecutter) benchmark::DoNotOptimize(frame.data());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(signal.size()));
+}
+BENCHMARK(BM_Framecutter)->Apply(FrameSizes)->Unit(benchmark::kMillisecond);
+
+void BM_Resample(benchmark::State &state, const std::string &quality) {
+  const double output_sample_rate = static_cast<double>(state.range(0));
+  const std::vector<double> signal = SyntheticSignal(static_cast<size_t>(10. * kSampleRate));
+  Resampler resampler(kSampleRate, output_sample_rate, quality);
+  for (auto _ : state) benchmark::DoNotOptimize(resampler.Resample(signal));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(signal.size()));
+}
+// 48000 is an upsampling by 160 / 147, the longest table of phases.
+void ResampleRates(benchmark::internal::Benchmark *benchmark) {
+  benchmark->ArgName("output_sample_rate")->Arg(48000)->Arg(22050)->Arg(11025)->Unit(benchmark::kMillisecond);
+}
+BENCHMARK_CAPTURE(BM_Resample, low, std::string("low"))->Apply(ResampleRates);
+BENCHMARK_CAPTURE(BM_Resample, medium, std::string("medium"))->Apply(ResampleRates);
+BENCHMARK_CAPTURE(BM_Resample, high, std::string("high"))->Apply(ResampleRates);
+
+// Spectral analysis
+
+void BM_Windowing(benchmark::State &state) {
+  const std::vector<double> frame = SyntheticSignal(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) benchmark::DoNotOptimize(Windowing(frame, BlackmanHarris62dB));
+}
+BENCHMARK(BM_Windowing)->Apply(FrameSizes);
+
+void BM_ConvertToFrequencySpectrum(benchmark::State &state) {
+  const std::vector<double> frame = Windowing(SyntheticSignal(static_cast<size_t>(state.range(0))), BlackmanHarris62dB);
+  for (auto _ : state) benchmark::DoNotOptimize(ConvertToFrequencySpectrum(frame));
+}
+BENCHMARK(BM_ConvertToFrequencySpectrum)->Apply(FrameSizes);
+
+void BM_PeakDetect(benchmark::State &state) {
+  const std::vector<double> spectrum = SyntheticSpectrum(static_cast<int>(state.range(0)));
+  const int max_num_peaks = static_cast<int>(state.range(1));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(PeakDetect(spectrum, -1000.0, true, "height", max_num_peaks, kSampleRate / 2., 0,
+                                        static_cast<int>(kSampleRate / 2.)));
+}
+BENCHMARK(BM_PeakDetect)
+    ->ArgNames({"frame_size", "max_num_peaks"})
+    ->ArgsProduct({{1024, 4096, 16384}, {0, 20, 100}});
+
+// Pitch classes and key
+
+void BM_HPCP(benchmark::State &state) {
+  const unsigned int pcp_size = static_cast<unsigned int>(state.range(0));
+  const unsigned int num_peaks = static_cast<unsigned int>(state.range(1));
+  const std::vector<std::tuple<double, double>> peaks =
+      SpectralPeaks(SyntheticSpectrum(16384), -1000.0, "height", num_peaks, kSampleRate, 0,
+                    static_cast<int>(kSampleRate / 2.));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(HPCP(peaks, pcp_size, 440.0, 3, true, 500.0, 40.0, 5000.0, "squared cosine", .5));
+  state.counters["peaks"] = static_cast<double>(peaks.size());
+}
+// A window of .5 semitones needs at least 24 bins.
+BENCHMARK(BM_HPCP)->ArgNames({"pcp_size", "num_peaks"})->ArgsProduct({{36, 120, 360}, {20, 100, 500}});
+
+void BM_EstimateKey(benchmark::State &state) {
+  const unsigned int pcp_size = static_cast<unsigned int>(state.range(0));
+  const std::vector<std::tuple<double, double>> peaks =
+      SpectralPeaks(SyntheticSpectrum(4096), -1000.0, "height", 100, kSampleRate, 0, static_cast<int>(kSampleRate / 2));
+  const std::vector<double> pcp = HPCP(peaks, pcp_size, 440.0, 3, true, 500.0, 40.0, 5000.0, "squared cosine", .5);
+  for (auto _ : state) benchmark::DoNotOptimize(EstimateKey(pcp, true, true, 4, .6, "Temperley", false));
+}
+BENCHMARK(BM_EstimateKey)->ArgName("pcp_size")->Arg(36)->Arg(120)->Arg(360);
+
+// Constant-Q front end, one frame of every stage against FrameHPCP.
+
+void BM_FrameHPCP(benchmark::State &state) {
+  const std::vector<double> frame = SyntheticSignal(4096);
+  for (auto _ : state) benchmark::DoNotOptimize(FrameHPCP(frame, kSampleRate, 36, 3));
+}
+BENCHMARK(BM_FrameHPCP);
+
+void BM_ConstantQFrame(benchmark::State &state) {
+  const unsigned int num_octaves = static_cast<unsigned int>(state.range(0));
+  ConstantQPlan plan(kSampleRate, 36, 55., num_octaves);
+  const std::vector<std::vector<double>> octaves = DecimateOctaves(SyntheticSignal(1 << 16), num_octaves);
+  std::vector<std::vector<double>> frames;
+  for (const std::vector<double> &octave : octaves)
+    frames.emplace_back(octave.begin(), octave.begin() + static_cast<std::ptrdiff_t>(plan.FrameSize()));
+  std::vector<double> chroma(36);
+  for (auto _ : state) {
+    std::fill(chroma.begin(), chroma.end(), 0.);
+    for (const std::vector<double> &frame : frames) plan.AddChroma(frame, chroma);
+    benchmark::DoNotOptimize(chroma.data());
+  }
+  state.counters["kernel_size"] = static_cast<double>(plan.KernelSize());
+  state.counters["frame_size"] = static_cast<double>(plan.FrameSize());
+}
+BENCHMARK(BM_ConstantQFrame)->ArgName("num_octaves")->Arg(4)->Arg(6);
+
+void BM_DecimateOctaves(benchmark::State &state) {
+  const std::vector<double> signal = SyntheticSignal(static_cast<size_t>(10. * kSampleRate));
+  for (auto _ : state) benchmark::DoNotOptimize(DecimateOctaves(signal, 6));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(signal.size()));
+}
+BENCHMARK(BM_DecimateOctaves)->Unit(benchmark::kMillisecond);
+
+// Tempo
+
+void BM_FFTConvolve(benchmark::State &state) {
+  const std::vector<double> signal = SyntheticSignal(static_cast<size_t>(state.range(0)));
+  const std::vector<double> kernel = SyntheticSignal(static_cast<size_t>(state.range(1)), 1);
+  for (auto _ : state) benchmark::DoNotOptimize(FFTConvolve(signal, kernel));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_FFTConvolve)
+    ->ArgNames({"signal_size", "kernel_size"})
+    ->ArgsProduct({{1 << 12, 1 << 16, 1 << 20}, {16, 1 << 10, 1 << 16}})
+    ->Unit(benchmark::kMicrosecond);
+
+// A plan reused for every signal, the label is the method it picks.
+void BM_ConvolverPlan(benchmark::State &state) {
+  const std::vector<double> signal = SyntheticSignal(static_cast<size_t>(state.range(0)));
+  ConvolverPlan plan(SyntheticSignal(static_cast<size_t>(state.range(1)), 1), true, static_cast<int>(state.range(2)));
+  for (auto _ : state) benchmark::DoNotOptimize(plan.Convolve(signal, "same"));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+  state.SetLabel(plan.Method(signal.size()));
+}
+BENCHMARK(BM_ConvolverPlan)
+    ->ArgNames({"signal_size", "kernel_size", "num_threads"})
+    ->ArgsProduct({{1 << 16, 1 << 20}, {8, 64, 1 << 10, 1 << 16}, {1, 0}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+void BM_DiscreteWaveletTransform(benchmark::State &state) {
+  const std::vector<double> signal = SyntheticSignal(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) benchmark::DoNotOptimize(DiscreteWaveletTransform(signal));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(BM_DiscreteWaveletTransform)->ArgName("num_samples")->RangeMultiplier(8)->Range(1 << 12, 1 << 18);
+
+void BM_BPMDetection(benchmark::State &state) {
+  const std::vector<double> window = SyntheticSignal(static_cast<size_t>(3. * kSampleRate));
+  for (auto _ : state) benchmark::DoNotOptimize(BPMDetection(window, kSampleRate));
+}
+BENCHMARK(BM_BPMDetection)->Unit(benchmark::kMillisecond);
+
+// End to end
+
+void BM_DetectKey(benchmark::State &state, const AudioDecoded &audio_file, double analysis_sample_rate) {
+  double audio_seconds = audio_file.length_in_seconds;
+  DetectKeyOptions options;
+  options.profile_type = "Temperley";
+  options.analysis_sample_rate = analysis_sample_rate;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(DetectKey(audio_file.normalized_samples, audio_file.sample_rate, options));
+
+  // Seconds of audio per second of wall time (UseRealTime).
+  state.counters["real_time_factor"] =
+      benchmark::Counter(audio_seconds * static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+  state.counters["audio_seconds"] = audio_seconds;
+}
+
+void BM_DetectKeyConstantQ(benchmark::State &state, const AudioDecoded &audio_file) {
+  double audio_seconds = audio_file.length_in_seconds;
+  DetectKeyOutput key_output;
+  for (auto _ : state) {
+    key_output = DetectKeyConstantQ(audio_file.normalized_samples, audio_file.sample_rate, "Temperley");
+    benchmark::DoNotOptimize(key_output.strength);
+  }
+
+  const DetectKeyOutput hpcp_key_output = DetectKey(audio_file.normalized_samples, audio_file.sample_rate, "Temperley");
+  state.SetLabel(key_output.key + " " + key_output.scale + " (HPCP: " + hpcp_key_output.key + " " +
+                 hpcp_key_output.scale + ")");
+  state.counters["real_time_factor"] =
+      benchmark::Counter(audio_seconds * static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+  state.counters["audio_seconds"] = audio_seconds;
+}
+
+void BM_BPMOverWindow(benchmark::State &state, const AudioDecoded &audio_file) {
+  double audio_seconds = audio_file.length_in_seconds;
+  double bpm = 0.;
+  for (auto _ : state) {
+    bpm = BPMOverWindow(audio_file.normalized_samples, audio_file.sample_rate, 3., static_cast<int>(state.range(0)));
+    benchmark::DoNotOptimize(bpm);
+  }
+
+  state.SetLabel(std::to_string(static_cast<int>(bpm)) + " BPM");
+  state.counters["real_time_factor"] =
+      benchmark::Counter(audio_seconds * static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+  state.counters["audio_seconds"] = audio_seconds;
+}
+
+void BM_PeakMemory(benchmark::State &state, const std::string &file_path) {
+  PipelineStats stats;
+  SetStatsEnabled(true);
+  for (auto _ : state) {
+    const PipelineStats start_stats = BeginCallStats();
+    AudioDecoded audio_file = DecodeAudioFile(file_path);
+    benchmark::DoNotOptimize(DetectKey(audio_file.normalized_samples, audio_file.sample_rate, "Temperley"));
+    stats = EndCallStats(start_stats);
+  }
+  SetStatsEnabled(false);
+
+  auto bytes = [](int64_t value) {
+    return benchmark::Counter(static_cast<double>(value), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+  };
+  state.counters["file"] = bytes(stats.peak_file_bytes);
+  state.counters["decoded"] = bytes(stats.peak_decoded_bytes);
+  state.counters["mono"] = bytes(stats.peak_mono_bytes);
+  state.counters["frames"] = bytes(stats.peak_frame_bytes);
+  state.counters["spectra"] = bytes(stats.peak_spectrum_bytes);
+  state.counters["total"] = bytes(stats.peak_file_bytes + stats.peak_decoded_bytes + stats.peak_mono_bytes +
+                                  stats.peak_frame_bytes + stats.peak_spectrum_bytes);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+  // Decoded once, the decoding has its own benchmarks.
+  std::vector<std::string> file_names = {"mozart_c_major_30sec.mp3", "EDM_Eb_major_2min.mp3", "126bpm.mp3",
+                                         "700kb.mp3",                "700kb.wav",             "CantinaBand3sec.wav"};
+  std::vector<AudioDecoded> audio_files;
+  audio_files.reserve(file_names.size());
+  for (const std::string &file_name : file_names) {
+    try {
+      audio_files.push_back(DecodeAudioFile(kDataDir + file_name));
+    } catch (const std::exception &e) {
+      std::cerr << "Skipping " << file_name << ": " << e.what() << std::endl;
+      continue;
+    }
+    benchmark::RegisterBenchmark(("BM_DetectKey/" + file_name).c_str(), BM_DetectKey, audio_files.back(), 0.)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    for (int analysis_sample_rate : {22050, 11025}) {
+      benchmark::RegisterBenchmark(("BM_DetectKey/" + file_name + "/" + std::to_string(analysis_sample_rate)).c_str(),
+                                   BM_DetectKey, audio_files.back(), static_cast<double>(analysis_sample_rate))
+          ->Unit(benchmark::kMillisecond)
+          ->UseRealTime();
+    }
+    benchmark::RegisterBenchmark(("BM_DetectKeyConstantQ/" + file_name).c_str(), BM_DetectKeyConstantQ,
+                                 audio_files.back())
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(("BM_BPMOverWindow/" + file_name).c_str(), BM_BPMOverWindow, audio_files.back())
+        ->ArgName("num_threads")
+        ->Arg(1)
+        ->Arg(0)
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+    benchmark::RegisterBenchmark(("BM_PeakMemory/" + file_name).c_str(), BM_PeakMemory, kDataDir + file_name)
+        ->Unit(benchmark::kMillisecond)
+        ->Iterations(1);
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @brief Reports how often strided frame sampling agrees with the full key analysis, and how much time it saves.
+ *
+ * Usage: musher-key-sampling-bench [profile_type] [audio_file ...]
+ *
+ * Without audio files, the mp3 files of the test data directory are used. Each row of the output is one stride, with
+ * the number of files whose key and scale agree with the full analysis, the mean ratio of analyzed frames and the
+ * speedup of DetectKey compared to stride 1.
+ */
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "src/core/audio_decoders.h"
+#include "src/core/key.h"
+
+using namespace musher::core;
+
+namespace {
+
+struct AudioFile {
+  std::string name;
+  std::vector<std::vector<double>> normalized_samples;
+  double sample_rate;
+};
+
+AudioFile LoadNormalizedSamples(const std::string &file_path) {
+  AudioFile audio_file;
+  audio_file.name = file_path.substr(file_path.find_last_of("/\\") + 1);
+  AudioDecoded audio_decoded = DecodeAudioFile(file_path);
+  audio_file.normalized_samples = audio_decoded.normalized_samples;
+  audio_file.sample_rate = audio_decoded.sample_rate;
+  return audio_file;
+}
+
+double DetectKeyTimed(const AudioFile &audio_file,
+                      const std::string &profile_type,
+                      unsigned int frame_stride,
+                      DetectKeyOutput &detect_key_output) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.frame_sampling = "stride";
+  options.frame_stride = frame_stride;
+  auto start = std::chrono::steady_clock::now();
+  detect_key_output = DetectKey(audio_file.normalized_samples, audio_file.sample_rate, options);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string profile_type = argc > 1 ? argv[1] : "Bgate";
+
+  std::vector<std::string> file_paths;
+  for (int i = 2; i < argc; i++) file_paths.push_back(argv[i]);
+  if (file_paths.empty()) {
+    const std::string data_dir = std::string(SOURCE_DIR) + "/data/audio_files/";
+    file_paths = { data_dir + "mozart_c_major_30sec.mp3", data_dir + "EDM_Eb_major_2min.mp3",
+                   data_dir + "126bpm.mp3", data_dir + "700kb.mp3" };
+  }
+
+  std::vector<AudioFile> audio_files;
+  for (const std::string &file_path : file_paths) {
+    try {
+      audio_files.push_back(LoadNormalizedSamples(file_path));
+    } catch (const std::exception &e) {
+      std::cerr << "Skipping " << file_path << ": " << e.what() << std::endl;
+    }
+  }
+  if (audio_files.empty()) {
+    std::cerr << "No audio files could be decoded." << std::endl;
+    return 1;
+  }
+
+  std::vector<DetectKeyOutput> full_key_outputs(audio_files.size());
+  std::vector<double> full_seconds(audio_files.size());
+  for (size_t i = 0; i < audio_files.size(); i++) {
+    full_seconds[i] = DetectKeyTimed(audio_files[i], profile_type, 1, full_key_outputs[i]);
+    std::printf("%-28s %2s %-5s (%.3f s)\n", audio_files[i].name.c_str(), full_key_outputs[i].key.c_str(),
+                full_key_outputs[i].scale.c_str(), full_seconds[i]);
+  }
+
+  std::printf("\nprofile: %s\n", profile_type.c_str());
+  std::printf("%8s %10s %14s %9s\n", "stride", "agreement", "analyzed_ratio", "speedup");
+  for (unsigned int frame_stride : { 1u, 2u, 4u, 8u, 16u, 32u, 64u, 128u, 256u }) {
+    int num_agreeing = 0;
+    double analyzed_ratio_sum = 0.;
+    double seconds_sum = 0.;
+    double full_seconds_sum = 0.;
+
+    for (size_t i = 0; i < audio_files.size(); i++) {
+      DetectKeyOutput detect_key_output;
+      seconds_sum += DetectKeyTimed(audio_files[i], profile_type, frame_stride, detect_key_output);
+      full_seconds_sum += full_seconds[i];
+      analyzed_ratio_sum += detect_key_output.analyzed_ratio;
+      if (detect_key_output.key == full_key_outputs[i].key && detect_key_output.scale == full_key_outputs[i].scale)
+        num_agreeing++;
+    }
+
+    std::printf("%8u %6d/%-3d %14.4f %8.1fx\n", frame_stride, num_agreeing, static_cast<int>(audio_files.size()),
+                analyzed_ratio_sum / audio_files.size(), full_seconds_sum / seconds_sum);
+  }
+  return 0;
+}
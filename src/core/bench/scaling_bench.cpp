@@ -0,0 +1,347 @@
+/**
+ * @brief Measures how the key analysis scales with the number of threads, the batch size and the signal length.
+ *
+ * Usage: musher-scaling-bench [--signal=tones|chords|noise|files] [--seconds=10,60,600] [--channels=2]
+ *                             [--threads=1,2,4] [--batch=1,8] [--repeats=3] [--seed=0] [--format=csv|json]
+ *                             [--output=path] [--trace=path]
+ *
+ * For every combination of signal length, thread count and batch size, the signal is analyzed batch size times by a
+ * pool of threads, each thread with its own KeyDetector taking the next job of the batch. The signals are synthesized from
+ * the seed (or tiled from the mp3 files of the test data), so a run with the same options gives the same signals and
+ * keys on every machine and release. Each row reports the wall time, the CPU time of the process, the real-time factor
+ * (seconds of audio analyzed per second of wall time) and the peak resident set size of the run (of the process so far
+ * outside of Linux). With --trace, the spans of every run are written to a Chrome trace-event JSON file (see
+ * StartTrace).
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "src/core/audio_decoders.h"
+#include "src/core/cpu_dispatch.h"
+#include "src/core/key_detector.h"
+#include "src/core/trace_events.h"
+#include "src/core/utils.h"
+
+using namespace musher::core;
+
+namespace {
+
+const double kSampleRate = 44100.;
+
+struct Options {
+  std::string signal = "chords";
+  std::vector<double> seconds = {10., 60., 600.};
+  int channels = 2;
+  std::vector<int> threads;
+  std::vector<int> batch_sizes = {1, 8};
+  int repeats = 3;
+  unsigned int seed = 0;
+  std::string format = "csv";
+  std::string output;
+  std::string trace;
+};
+
+struct Result {
+  double seconds;
+  int threads;
+  int batch_size;
+  int repeat;
+  double wall_seconds;
+  double cpu_seconds;
+  double real_time_factor;
+  long long peak_rss_bytes;
+  std::string key;
+  std::string scale;
+};
+
+template <typename T>
+std::vector<T> ParseList(const std::string &value) {
+  std::vector<T> list;
+  std::stringstream stream(value);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    std::stringstream item_stream(item);
+    T parsed;
+    if (!(item_stream >> parsed)) throw std::runtime_error("Invalid list value '" + value + "'");
+    list.push_back(parsed);
+  }
+  if (list.empty()) throw std::runtime_error("Empty list value");
+  return list;
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options options;
+  int max_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  for (int threads = 1; threads < max_threads; threads *= 2) options.threads.push_back(threads);
+  options.threads.push_back(max_threads);
+
+  for (int i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+    size_t equal = argument.find('=');
+    if (argument.compare(0, 2, "--") != 0 || equal == std::string::npos)
+      throw std::runtime_error("Invalid argument '" + argument + "', use --name=value");
+    std::string name = argument.substr(2, equal - 2);
+    std::string value = argument.substr(equal + 1);
+
+    if (name == "signal")
+      options.signal = value;
+    else if (name == "seconds")
+      options.seconds = ParseList<double>(value);
+    else if (name == "channels")
+      options.channels = ParseList<int>(value)[0];
+    else if (name == "threads")
+      options.threads = ParseList<int>(value);
+    else if (name == "batch")
+      options.batch_sizes = ParseList<int>(value);
+    else if (name == "repeats")
+      options.repeats = ParseList<int>(value)[0];
+    else if (name == "seed")
+      options.seed = ParseList<unsigned int>(value)[0];
+    else if (name == "format")
+      options.format = value;
+    else if (name == "output")
+      options.output = value;
+    else if (name == "trace")
+      options.trace = value;
+    else
+      throw std::runtime_error("Unknown option '" + name + "'");
+  }
+
+  if (options.signal != "tones" && options.signal != "chords" && options.signal != "noise" && options.signal != "files")
+    throw std::runtime_error("Signal '" + options.signal + "' is not supported. Use tones, chords, noise or files.");
+  if (options.format != "csv" && options.format != "json")
+    throw std::runtime_error("Format '" + options.format + "' is not supported. Use csv or json.");
+  if (options.channels != 1 && options.channels != 2) throw std::runtime_error("Channels must be 1 or 2");
+  return options;
+}
+
+/**
+ * @brief Deterministic signal of the given length. Tones hold a single note for a few seconds, chords hold a triad of
+ * the same random key, noise is white noise. The channels differ by a small amount of noise.
+ */
+std::vector<std::vector<double>> SynthesizeSignal(const std::string &signal,
+                                                  double seconds,
+                                                  int channels,
+                                                  unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> noise(0., 1.);
+  size_t num_samples = static_cast<size_t>(seconds * kSampleRate);
+  std::vector<std::vector<double>> normalized_samples(static_cast<size_t>(channels), std::vector<double>(num_samples));
+
+  // A major triad (root, third, fifth) on a random tonic, moving over the I, IV and V chords every 2 seconds.
+  const int tonic = static_cast<int>(rng() % 12);
+  const int progression[] = {0, 5, 7, 0};
+  const size_t hold = static_cast<size_t>(2. * kSampleRate);
+  for (size_t start = 0; start < num_samples; start += hold) {
+    int root = tonic + progression[(start / hold) % 4];
+    std::vector<double> frequencies;
+    if (signal == "tones") {
+      frequencies = {261.63 * std::pow(2., (root + static_cast<int>(rng() % 3) * 2) / 12.)};
+    } else if (signal == "chords") {
+      for (int interval : {0, 4, 7}) frequencies.push_back(261.63 * std::pow(2., (root + interval) / 12.));
+    }
+
+    size_t end = std::min(start + hold, num_samples);
+    for (size_t i = start; i < end; i++) {
+      double t = static_cast<double>(i) / kSampleRate;
+      double value = 0.;
+      for (double frequency : frequencies) value += 0.3 * std::sin(2. * M_PI * frequency * t);
+      double noise_level = frequencies.empty() ? 0.3 : 0.01;
+      for (std::vector<double> &channel : normalized_samples) channel[i] = value + noise_level * noise(rng);
+    }
+  }
+  return normalized_samples;
+}
+
+/**
+ * @brief The mp3 files of the test data, one after the other, repeated until the signal has the given length.
+ */
+std::vector<std::vector<double>> TileFiles(double seconds, int channels) {
+  const std::string data_dir = std::string(SOURCE_DIR) + "/data/audio_files/";
+  std::vector<std::vector<double>> tiles;
+  for (const char *file_name : {"mozart_c_major_30sec.mp3", "EDM_Eb_major_2min.mp3", "126bpm.mp3"}) {
+    Mp3Decoded mp3_decoded = DecodeMp3(data_dir + file_name);
+    if (mp3_decoded.sample_rate != kSampleRate) continue;
+    std::vector<double> &samples = mp3_decoded.normalized_samples[0];
+    // Same scale as the WAV decoder.
+    for (double &sample : samples) sample /= 32768.;
+    tiles.push_back(samples);
+  }
+  if (tiles.empty()) throw std::runtime_error("No audio file of the test data could be decoded");
+
+  size_t num_samples = static_cast<size_t>(seconds * kSampleRate);
+  std::vector<std::vector<double>> normalized_samples(static_cast<size_t>(channels));
+  for (std::vector<double> &channel : normalized_samples) {
+    channel.reserve(num_samples);
+    for (size_t tile = 0; channel.size() < num_samples; tile = (tile + 1) % tiles.size()) {
+      size_t count = std::min(tiles[tile].size(), num_samples - channel.size());
+      channel.insert(channel.end(), tiles[tile].begin(), tiles[tile].begin() + count);
+    }
+  }
+  return normalized_samples;
+}
+
+double CpuSeconds() {
+#if defined(__unix__) || defined(__APPLE__)
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#else
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+/**
+ * @brief Resets the peak resident set size of the process, so each run reports its own peak. Only Linux can do this,
+ * elsewhere the peak is the one of the whole process so far.
+ */
+void ResetPeakRss() {
+#if defined(__linux__)
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs) clear_refs << "5";
+#endif
+}
+
+long long PeakRssBytes() {
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) return std::stoll(line.substr(6)) * 1024;
+  }
+#endif
+#if defined(__APPLE__)
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;  // Bytes on macOS.
+#elif defined(__unix__)
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<long long>(usage.ru_maxrss) * 1024;
+#else
+  return -1;
+#endif
+}
+
+/**
+ * @brief Analyzes batch_size copies of the signal with a pool of threads, each one with its own KeyDetector.
+ */
+Result RunBatch(const std::vector<std::vector<double>> &normalized_samples, int threads, int batch_size) {
+  std::vector<KeyDetector> key_detectors;
+  key_detectors.reserve(static_cast<size_t>(threads));
+  for (int i = 0; i < threads; i++) key_detectors.emplace_back(kSampleRate, "Temperley");
+  std::vector<DetectKeyOutput> key_outputs(static_cast<size_t>(batch_size));
+
+  ResetPeakRss();
+  double cpu_start = CpuSeconds();
+  auto wall_start = std::chrono::steady_clock::now();
+
+  auto detect_job = [&](size_t job, int thread) {
+    key_outputs[job] = key_detectors[static_cast<size_t>(thread)].Detect(normalized_samples);
+  };
+  ParallelFor(static_cast<size_t>(batch_size), threads, detect_job, "WaitForJob");
+
+  Result result;
+  result.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  result.cpu_seconds = CpuSeconds() - cpu_start;
+  result.peak_rss_bytes = PeakRssBytes();
+  result.threads = threads;
+  result.batch_size = batch_size;
+  result.seconds = normalized_samples[0].size() / kSampleRate;
+  result.real_time_factor = batch_size * result.seconds / result.wall_seconds;
+  result.key = key_outputs[0].key;
+  result.scale = key_outputs[0].scale;
+  return result;
+}
+
+void WriteCsv(std::ostream &out, const Options &options, const std::vector<Result> &results) {
+  out << "signal,channels,seconds,threads,batch_size,repeat,wall_seconds,cpu_seconds,real_time_factor,"
+         "peak_rss_bytes,key,scale\n";
+  for (const Result &result : results) {
+    out << options.signal << ',' << options.channels << ',' << result.seconds << ',' << result.threads << ','
+        << result.batch_size << ',' << result.repeat << ',' << result.wall_seconds << ',' << result.cpu_seconds << ','
+        << result.real_time_factor << ',' << result.peak_rss_bytes << ',' << result.key << ',' << result.scale << '\n';
+  }
+}
+
+void WriteJson(std::ostream &out, const Options &options, const std::vector<Result> &results) {
+  out << "{\n  \"machine\": {\"hardware_concurrency\": " << std::thread::hardware_concurrency()
+      << ", \"simd_level\": \"" << SimdLevelName(ActiveSimdLevel()) << "\"},\n";
+  out << "  \"options\": {\"signal\": \"" << options.signal << "\", \"channels\": " << options.channels
+      << ", \"seed\": " << options.seed << "},\n";
+  out << "  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &result = results[i];
+    out << "    {\"seconds\": " << result.seconds << ", \"threads\": " << result.threads
+        << ", \"batch_size\": " << result.batch_size << ", \"repeat\": " << result.repeat
+        << ", \"wall_seconds\": " << result.wall_seconds << ", \"cpu_seconds\": " << result.cpu_seconds
+        << ", \"real_time_factor\": " << result.real_time_factor << ", \"peak_rss_bytes\": " << result.peak_rss_bytes
+        << ", \"key\": \"" << result.key << "\", \"scale\": \"" << result.scale << "\"}"
+        << (i + 1 < results.size() ? "," : "") << '\n';
+  }
+  out << "  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+    if (!options.trace.empty()) StartTrace(options.trace);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  std::vector<Result> results;
+  for (double seconds : options.seconds) {
+    std::vector<std::vector<double>> normalized_samples =
+        options.signal == "files" ? TileFiles(seconds, options.channels)
+                                  : SynthesizeSignal(options.signal, seconds, options.channels, options.seed);
+
+    for (int threads : options.threads) {
+      for (int batch_size : options.batch_sizes) {
+        for (int repeat = 0; repeat < options.repeats; repeat++) {
+          Result result = RunBatch(normalized_samples, threads, batch_size);
+          result.repeat = repeat;
+          results.push_back(result);
+          std::fprintf(stderr, "%8.0f s  %3d threads  batch %3d  %8.3f s  %7.1fx real time\n", seconds, threads,
+                       batch_size, result.wall_seconds, result.real_time_factor);
+        }
+      }
+    }
+  }
+  StopTrace();
+
+  std::ofstream output_file;
+  if (!options.output.empty()) {
+    output_file.open(options.output);
+    if (!output_file) {
+      std::cerr << "Could not open " << options.output << std::endl;
+      return 1;
+    }
+  }
+  std::ostream &out = options.output.empty() ? std::cout : output_file;
+  out.precision(6);
+  if (options.format == "json")
+    WriteJson(out, options, results);
+  else
+    WriteCsv(out, options, results);
+  return 0;
+}
@@ -1,183 +1,128 @@
+#include "src/core/bpm.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/fft_convolve.h"
+#include "src/core/mono_mixer.h"
+#include "src/core/peak_detect.h"
+#include "src/core/trace_events.h"
+#include "src/core/utils.h"
+#include "src/core/wavelet.h"
 
 namespace musher {
 namespace core {
 
-// double BPMDetection(std::vector<double>& samples, uint32_t sample_rate) {
-//   wave_object obj;
-//   wt_object wt;
-//   int J = 1;
-
-//   const int total_levels = 4;
-//   const int max_decimation = std::pow(2, (total_levels - 1));
-
-//   double min_index = 60. / 220 * (sample_rate / max_decimation);
-//   double max_index = 60. / 40 * (sample_rate / max_decimation);
-
-//   const char* name = "db4";
-//   obj = wave_init(name);  // Initialize the wavelet
-
-//   size_t cD_min_len;
-//   double decimated_signal_sum, decimated_signal_mean;
-//   std::vector<double> cD, cD_sum, cD_filtered, cD_decimated_signal, cD_mean_removed_signal,
-//       cD_mean_removed_signal_partial;
-//   std::vector<double> cA, cA_filtered, cA_mean_removed_signal_partial;
-//   for (int level = 0; level < total_levels; level++) {
-//     // Discrete Wavelet Transform
-//     if (level == 0) {
-//       // Initialize the wavelet transform object on input
-//       wt = wt_init(obj, (char*)"dwt", samples.size(), J);
-//       setDWTExtension(wt, (char*)"sym");
-//       setWTConv(wt, (char*)"direct");
-
-//       // Perform DWT
-//       dwt(wt, samples.data());
-
-//       cD_min_len = wt->length[1] / max_decimation + 1;
-//       cD_sum.resize(cD_min_len, 0.0);
-//       cD_mean_removed_signal_partial.resize(cD_min_len);
-//     } else {
-//       // Initialize the wavelet transform object
-//       wt = wt_init(obj, (char*)"dwt", cA.size(), J);
-//       setDWTExtension(wt, (char*)"sym");
-//       setWTConv(wt, (char*)"direct");
-
-//       // Perform remaining DWT's on cA
-//       dwt(wt, cA.data());
-//     }
-
-//     // Fill cA
-//     cA.clear();
-//     for (int i = 0; i < wt->length[0]; ++i) {
-//       cA.push_back(wt->output[i]);
-//     }
-
-//     // Fill cD
-//     for (int i = wt->length[1]; i < wt->outlength; ++i) {
-//       cD.push_back(wt->output[i]);
-//     }
-
-//     // Perform One Pole filter on cD
-//     cD_filtered = OnePoleFilter(cD);
-
-//     // Decimate
-//     int dc = std::pow(2, (total_levels - level - 1));
-//     for (int ax = 0; ax < cD_filtered.size(); ax += dc) {
-//       cD_decimated_signal.push_back(std::abs(cD_filtered[ax]));
-//     }
-
-//     decimated_signal_sum = std::accumulate(cD_decimated_signal.begin(), cD_decimated_signal.end(), 0.0);
-//     decimated_signal_mean = decimated_signal_sum / static_cast<double>(cD_decimated_signal.size());
-
-//     // Remove the mean
-//     cD_mean_removed_signal.resize(cD_decimated_signal.size());
-//     auto remove_mean = [decimated_signal_mean](const double x) { return x - decimated_signal_mean; };
-//     std::transform(cD_decimated_signal.begin(), cD_decimated_signal.end(), cD_mean_removed_signal.begin(),
-//     remove_mean);
-
-//     // Reconstruct
-//     std::copy_n(cD_mean_removed_signal.begin(), cD_min_len, cD_mean_removed_signal_partial.begin());
-//     // Perform element-wise sum of 2 vectors and store into cD_sum
-//     std::transform(cD_sum.begin(), cD_sum.end(), cD_mean_removed_signal_partial.begin(), cD_sum.begin(),
-//                    std::plus<double>());
-
-//     // Clear variables
-//     wt_free(wt);
-//     cD.clear();
-//     cD_filtered.clear();
-//     cD_decimated_signal.clear();
-//     cD_mean_removed_signal.clear();
-//     // cD_mean_removed_signal_partial.clear();
-//   }
-//   wave_free(obj);
-
-//   // Check if cA has any useful data
-//   bool zeros = std::all_of(cA.begin(), cA.end(), [](const double d) { return d == 0.0; });
-//   if (zeros) return 0.0;
-
-//   // Filter cA
-//   cA_filtered = OnePoleFilter(cA);
-
-//   // Make cA_filtered absolute
-//   std::vector<double> cA_absolute(cA_filtered.size());
-//   auto absolute_val = [](const double x) { return std::abs(x); };
-//   std::transform(cA_filtered.begin(), cA_filtered.end(), cA_absolute.begin(), absolute_val);
-
-//   // Get mean
-//   double cA_absolute_sum = std::accumulate(cA_absolute.begin(), cA_absolute.end(), 0.0);
-//   double cA_absolute_mean = cA_absolute_sum / static_cast<double>(cA_absolute.size());
-
-//   std::vector<double> cA_mean_removed_signal(cA_absolute.size());
-//   auto remove_mean = [cA_absolute_mean](const double x) { return x - cA_absolute_mean; };
-//   std::transform(cA_absolute.begin(), cA_absolute.end(), cA_mean_removed_signal.begin(), remove_mean);
-
-//   cA_mean_removed_signal_partial.resize(cD_min_len);
-//   std::copy_n(cA_mean_removed_signal.begin(), cD_min_len, cA_mean_removed_signal_partial.begin());
-//   // Add elements of cD_sum and cD_mean_removed_signal_partial together and store into cD_sum
-//   std::transform(cD_sum.begin(), cD_sum.end(), cA_mean_removed_signal_partial.begin(), cD_sum.begin(),
-//                  std::plus<double>());
-
-//   size_t data_len = cD_sum.size();
-//   std::vector<double> b(data_len * 2);
-
-//   // Fill a section of b with cD_sum data
-//   int k = 0;
-//   for (int i = data_len / 2; i < (data_len / 2) + data_len; ++i) {
-//     b[i] = cD_sum[k];
-//     k += 1;
-//   }
-
-//   // Reverse cD_sum
-//   std::vector<double> reverse_cD(cD_sum);
-//   std::reverse(reverse_cD.begin(), reverse_cD.end());
-
-//   // Perform an array flipped convolution, which is the same as a cross-correlation on the samples.
-//   std::vector<double> correl = FFTConvolve(b, reverse_cD);
-//   correl.pop_back();  // We don't need the last element
-//   size_t midpoint = correl.size() / 2;
-//   std::vector<double> correl_midpoint_tmp(correl.begin() + midpoint, correl.end());
-//   std::vector<double> sliced_correl_midpoint_tmp(correl_midpoint_tmp.begin() + std::floor(min_index),
-//                                                  correl_midpoint_tmp.begin() + std::floor(max_index));
-
-//   // Peak Detection
-//   std::vector<double> sliced_correl_midpoint_tmp_abs(sliced_correl_midpoint_tmp.size());
-//   std::transform(sliced_correl_midpoint_tmp.begin(), sliced_correl_midpoint_tmp.end(),
-//                  sliced_correl_midpoint_tmp_abs.begin(), [](const double x) { return std::abs(x); });
-//   std::vector<std::tuple<double, double>> peaks;
-//   double threshold = -1000.0;
-//   bool interpolate = true;
-//   std::string sort_by = "height";
-//   peaks = PeakDetect(sliced_correl_midpoint_tmp_abs, threshold, interpolate, sort_by);
-
-//   // Get the first item from peaks because we want the highest peak
-//   const double peak_index = std::get<0>(peaks[0]);
-
-//   if (peak_index == 0.0) return 0.0;
-//   double peak_index_adjusted = peak_index + min_index;
-//   double bpm = 60. / peak_index_adjusted * (sample_rate / max_decimation);
-
-//   return bpm;
-// }
-
-// double BPMOverWindow(std::vector<double>& samples, uint32_t sample_rate, unsigned int window_seconds) {
-//   int num_samples = samples.size();
-//   int window_samples = window_seconds * sample_rate;
-//   int sample_index = 0;
-//   int max_windows_index = num_samples / window_samples;
-//   std::vector<double> bpms(max_windows_index, 0.0);
-//   std::vector<double> seconds_mid(max_windows_index, 0.0);
-
-//   for (int window_index = 0; window_index < max_windows_index; window_index++) {
-//     typename std::vector<double>::iterator samp_it = samples.begin() + sample_index;
-//     std::vector<double> sliced_samples(samp_it, samp_it + window_samples);
-
-//     double bpm = BPMDetection(sliced_samples, sample_rate);
-//     bpms[window_index] = bpm;
-
-//     sample_index += window_samples;
-//   }
-
-//   return std::round(Median(bpms));
-// }
+namespace {
+
+// Envelope of a band: one pole filter, every decimation-th sample rectified, mean removed.
+std::vector<double> BandEnvelope(const std::vector<double> &band, size_t decimation) {
+  std::vector<double> filtered = OnePoleFilter(band);
+  std::vector<double> envelope;
+  envelope.reserve(filtered.size() / decimation + 1);
+  for (size_t i = 0; i < filtered.size(); i += decimation) envelope.push_back(std::abs(filtered[i]));
+
+  const double mean = std::accumulate(envelope.begin(), envelope.end(), 0.) / static_cast<double>(envelope.size());
+  for (double &value : envelope) value -= mean;
+  return envelope;
+}
+
+}  // namespace
+
+std::vector<double> Autocorrelation(const std::vector<double> &signal) {
+  if (signal.empty()) return std::vector<double>();
+
+  // The full correlation holds the lag l at index size - 1 + l.
+  ConvolverPlan plan(signal, true);
+  std::vector<double> correlation = plan.Convolve(signal, "full");
+  return std::vector<double>(correlation.begin() + static_cast<std::ptrdiff_t>(signal.size() - 1), correlation.end());
+}
+
+double BPMDetection(const std::vector<double> &samples, double sample_rate) {
+  const size_t total_levels = 4;
+  const size_t max_decimation = 1 << (total_levels - 1);
+  // Every level halves the rate, the first detail band is already at sample_rate / 2 before its decimation.
+  const double envelope_rate = sample_rate / (2 * max_decimation);
+
+  // Beat periods of 220 to 40 BPM, in samples of the envelope.
+  const double min_index = 60. / 220. * envelope_rate;
+  const double max_index = 60. / 40. * envelope_rate;
+
+  // The detail band of level l is decimated by 2^(total_levels - l - 1) to the rate of the last level. The bands
+  // differ by a few samples in length, they are summed over the shortest one.
+  std::vector<std::vector<double>> envelopes;
+  WaveletCoefficients coefficients;
+  coefficients.approximation = samples;
+  for (size_t level = 0; level < total_levels; level++) {
+    coefficients = DiscreteWaveletTransform(coefficients.approximation);
+    if (coefficients.detail.empty()) return 0.;
+    envelopes.push_back(BandEnvelope(coefficients.detail, size_t(1) << (total_levels - level - 1)));
+  }
+
+  const std::vector<double> &approximation = coefficients.approximation;
+  if (std::all_of(approximation.begin(), approximation.end(), [](double x) { return x == 0.; })) return 0.;
+  envelopes.push_back(BandEnvelope(approximation, 1));
+
+  size_t envelope_size = envelopes[0].size();
+  for (const std::vector<double> &envelope : envelopes) envelope_size = std::min(envelope_size, envelope.size());
+  std::vector<double> envelope_sum(envelope_size, 0.);
+  for (const std::vector<double> &envelope : envelopes)
+    std::transform(envelope_sum.begin(), envelope_sum.end(), envelope.begin(), envelope_sum.begin(),
+                   std::plus<double>());
+
+  // Highest peak of the autocorrelation between the shortest and the longest beat period.
+  std::vector<double> correlation = Autocorrelation(envelope_sum);
+  const size_t begin = static_cast<size_t>(std::floor(min_index));
+  const size_t end = std::min(correlation.size(), static_cast<size_t>(std::floor(max_index)));
+  if (end < begin + 2) return 0.;
+  std::vector<double> correlation_abs(end - begin);
+  std::transform(correlation.begin() + begin, correlation.begin() + end, correlation_abs.begin(),
+                 [](double x) { return std::abs(x); });
+
+  std::vector<std::tuple<double, double>> peaks = PeakDetect(correlation_abs, -1000., true, "height");
+  if (peaks.empty()) return 0.;
+  const double peak_index = std::get<0>(peaks[0]);
+  // A peak on the edge of the range is not a beat period.
+  if (peak_index == 0.) return 0.;
+  return 60. / (peak_index + static_cast<double>(begin)) * envelope_rate;
+}
+
+double BPMOverWindow(const std::vector<std::vector<double>> &normalized_samples,
+                     double sample_rate,
+                     double window_seconds,
+                     int num_threads) {
+  if (!(sample_rate > 0.)) throw std::runtime_error("BPMOverWindow: sample rate should be larger than 0");
+  if (!(window_seconds > 0.)) throw std::runtime_error("BPMOverWindow: window should be longer than 0 seconds");
+
+  const std::vector<double> samples = MonoMixer(normalized_samples);
+  const size_t window_samples = static_cast<size_t>(std::lround(window_seconds * sample_rate));
+  const size_t num_windows = window_samples == 0 ? 0 : samples.size() / window_samples;
+  if (num_windows == 0) return 0.;
+
+  std::vector<double> bpms(num_windows, 0.);
+  auto detect_window = [&](size_t window_index, int) {
+    TraceSpan trace_span("BPMWindow", "bpm");
+    try {
+      const auto window_begin = samples.begin() + static_cast<std::ptrdiff_t>(window_index * window_samples);
+      std::vector<double> window(window_begin, window_begin + static_cast<std::ptrdiff_t>(window_samples));
+      bpms[window_index] = BPMDetection(window, sample_rate);
+    } catch (const std::exception &e) {
+      throw std::runtime_error("BPMOverWindow: " + std::string(e.what()));
+    }
+  };
+  ParallelFor(num_windows, num_threads, detect_window);
+
+  // Silent windows have no tempo.
+  bpms.erase(std::remove(bpms.begin(), bpms.end(), 0.), bpms.end());
+  if (bpms.empty()) return 0.;
+  return std::round(Median(bpms));
+}
 
 }  // namespace core
 }  // namespace musher
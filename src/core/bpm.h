@@ -1,29 +1,52 @@
 #pragma once
 
+#include <vector>
+
 namespace musher {
 namespace core {
 
-// /**
-//  * @brief Calculate the BPM (Beats per minute) of audio samples.
-//  *
-//  * @param samples Input audio signal.
-//  * @param sample_rate Sampling rate of the audio signal \[Hz\].
-//  * @return double BPM
-//  */
-// double BPMDetection(std::vector<double>& samples, uint32_t sample_rate);
+/**
+ * @brief Autocorrelation of a signal for the lags 0 to size - 1, sum(x[j] * x[j + lag]).
+ *
+ * Computed with a ConvolverPlan of the signal in correlation mode.
+ *
+ * @param signal Input signal.
+ * @return std::vector<double> signal.size() values, the lag 0 first.
+ */
+std::vector<double> Autocorrelation(const std::vector<double> &signal);
+
+/**
+ * @brief Calculate the BPM (Beats per minute) of audio samples.
+ *
+ * The onsets are tracked with 4 levels of discrete wavelet transform (see DiscreteWaveletTransform): the envelope of
+ * every detail band and of the last approximation band is decimated to the rate of the last level and summed, then
+ * the highest peak of the autocorrelation of the sum between 40 and 220 BPM gives the beat period.
+ *
+ * @param samples Mono audio signal.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @return double BPM, 0 for silence or when no beat period is found.
+ */
+double BPMDetection(const std::vector<double> &samples, double sample_rate);
 
-// /**
-//  * @brief Calculate the average BPM (Beats per minute) of samples.
-//  * This function will slice the samples into windows and calculate the BPM over each
-//  * window and then average them to achieve a final BPM over all samples.
-//  *
-//  * @param samples Input audio samples.
-//  * @param sample_rate Sampling rate of the audio signal \[Hz\].
-//  * @param window_seconds Size of the the window [Seconds] that will be scanned to determine the bpm,
-//  * typically less than 10 seconds.
-//  * @return double Average BPM over windows.
-//  */
-// double BPMOverWindow(std::vector<double>& samples, uint32_t sample_rate, unsigned int window_seconds = 3);
+/**
+ * @brief Calculate the BPM (Beats per minute) of samples over windows.
+ * This function will slice the samples into windows and calculate the BPM over each
+ * window and then take their median to achieve a final BPM over all samples.
+ *
+ * The windows are independent, they are spread over num_threads threads. The windows without silence are kept and
+ * their median is rounded to the nearest integer.
+ *
+ * @param normalized_samples Normalized samples, either stereo or mono.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param window_seconds Size of the the window [Seconds] that will be scanned to determine the bpm,
+ * typically less than 10 seconds.
+ * @param num_threads Number of threads, 0 uses one per hardware thread.
+ * @return double Median BPM over windows, 0 if the signal is shorter than a window or silent.
+ */
+double BPMOverWindow(const std::vector<std::vector<double>> &normalized_samples,
+                     double sample_rate,
+                     double window_seconds = 3.,
+                     int num_threads = 0);
 
 }  // namespace core
 }  // namespace musher
@@ -0,0 +1,117 @@
+#include "src/core/chromagram.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/backend.h"
+#include "src/core/framecutter.h"
+#include "src/core/hpcp.h"
+#include "src/core/mono_mixer.h"
+#include "src/core/pipeline_stats.h"
+#include "src/core/reference_backend.h"
+#include "src/core/spectral_peaks.h"
+#include "src/core/spectrum.h"
+#include "src/core/windowing.h"
+
+namespace musher {
+namespace core {
+
+std::vector<double> FrameHPCP(const std::vector<double> &frame,
+                              double sample_rate,
+                              unsigned int pcp_size,
+                              unsigned int harmonics,
+                              const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func,
+                              unsigned int max_num_peaks,
+                              double window_size) {
+  CountStat(&PipelineStats::frames_processed, 1);
+  Backend backend = ActiveBackend();
+  if (backend == Backend::kReference) {
+    if (frame.size() <= 1) throw std::runtime_error("Windowing: frame (signal) size should be larger than 1");
+    std::vector<double> window = Normalize(window_type_func(std::vector<double>(frame.size())));
+    return reference::AnalyzeFrame(frame, window, sample_rate, pcp_size, harmonics, max_num_peaks, window_size).hpcp;
+  }
+
+  std::vector<double> windowed_frame = Windowing(frame, window_type_func);
+  std::vector<double> spectrum = ConvertToFrequencySpectrum(windowed_frame);
+  std::vector<std::tuple<double, double>> spectral_peaks =
+      SpectralPeaks(spectrum, -1000.0, "height", max_num_peaks, sample_rate, 0, sample_rate / 2);
+  std::vector<double> hpcp =
+      HPCP(spectral_peaks, pcp_size, 440.0, harmonics, true, 500.0, 40.0, 5000.0, "squared cosine", window_size);
+  RecordPeakBytes(&PipelineStats::peak_spectrum_bytes, VectorBytes(windowed_frame) + VectorBytes(spectrum) +
+                                                           VectorBytes(spectral_peaks) + VectorBytes(hpcp));
+
+  if (backend == Backend::kCrossCheck) {
+    std::vector<double> window = Normalize(window_type_func(std::vector<double>(frame.size())));
+    RecordFrameDeviations(FrameStages{windowed_frame, spectrum, spectral_peaks, hpcp},
+                          reference::AnalyzeFrame(frame, window, sample_rate, pcp_size, harmonics, max_num_peaks,
+                                                  window_size));
+  }
+  return hpcp;
+}
+
+Chromagram ComputeChromagram(const std::vector<std::vector<double>> &normalized_samples,
+                             double sample_rate,
+                             unsigned int pcp_size,
+                             unsigned int harmonics,
+                             const int frame_size,
+                             const int hop_size,
+                             const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func,
+                             unsigned int max_num_peaks,
+                             double window_size,
+                             unsigned int aggregation_frames,
+                             const std::string aggregation_type) {
+  if (aggregation_frames == 0) throw std::runtime_error("Chromagram: aggregation_frames should be larger than 0");
+  if (aggregation_type != "mean" && aggregation_type != "max")
+    throw std::runtime_error("Chromagram: aggregation type '" + aggregation_type + "' is not supported");
+
+  size_t num_samples = normalized_samples.empty() ? 0 : normalized_samples[0].size();
+  int num_frames = CountFrames(num_samples, frame_size, hop_size);
+  int num_rows = (num_frames + static_cast<int>(aggregation_frames) - 1) / static_cast<int>(aggregation_frames);
+
+  Chromagram chromagram;
+  chromagram.num_frames = num_rows;
+  chromagram.pcp_size = static_cast<int>(pcp_size);
+  chromagram.hpcps.assign(static_cast<size_t>(num_rows) * pcp_size, 0.);
+  chromagram.timestamps.resize(static_cast<size_t>(num_rows));
+
+  std::vector<std::vector<double>> channel_frames(normalized_samples.size());
+  RecordPeakBytes(&PipelineStats::peak_frame_bytes,
+                  static_cast<int64_t>((normalized_samples.size() + 1) * frame_size * sizeof(double)));
+  for (int row = 0; row < num_rows; row++) {
+    int first_frame = row * static_cast<int>(aggregation_frames);
+    int last_frame = std::min(first_frame + static_cast<int>(aggregation_frames), num_frames) - 1;
+    double *row_data = chromagram.hpcps.data() + static_cast<size_t>(row) * pcp_size;
+
+    for (int frame_index = first_frame; frame_index <= last_frame; frame_index++) {
+      int64_t start_index = FrameStartIndex(frame_index, frame_size, hop_size);
+      for (size_t channel = 0; channel < normalized_samples.size(); channel++) {
+        channel_frames[channel] = CutFrame(normalized_samples[channel], start_index, frame_size);
+      }
+      std::vector<double> hpcp = FrameHPCP(MonoMixer(channel_frames), sample_rate, pcp_size, harmonics,
+                                           window_type_func, max_num_peaks, window_size);
+
+      for (unsigned int i = 0; i < pcp_size; i++) {
+        if (aggregation_type == "max")
+          row_data[i] = std::max(row_data[i], hpcp[i]);
+        else
+          row_data[i] += hpcp[i];
+      }
+    }
+
+    int row_size = last_frame - first_frame + 1;
+    if (aggregation_type == "mean" && row_size > 1) {
+      for (unsigned int i = 0; i < pcp_size; i++) row_data[i] /= row_size;
+    }
+
+    // Frames are centered at frame_index * hop_size, a row is centered between its first and last frame.
+    chromagram.timestamps[row] = 0.5 * (first_frame + last_frame) * hop_size / sample_rate;
+  }
+  return chromagram;
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "src/core/windowing.h"
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Time-resolved harmonic pitch class profiles of a signal.
+ *
+ * The HPCPs are stored in a single contiguous buffer in row-major order, one row per frame (or per group of
+ * aggregated frames), so it can be handed to other libraries without copying.
+ */
+struct Chromagram {
+  std::vector<double> hpcps;       //!< num_frames x pcp_size matrix in row-major order.
+  std::vector<double> timestamps;  //!< Time of the center of each row \[Seconds\].
+  int num_frames;                  //!< Number of rows.
+  int pcp_size;                    //!< Number of columns.
+};
+
+/**
+ * @brief Computes the HPCP of a single frame, with the same spectral analysis as DetectKey.
+ *
+ * The frame is windowed, converted to a magnitude spectrum, reduced to its spectral peaks, and the peaks are mapped to
+ * pitch classes.
+ *
+ * @param frame Audio frame of any size larger than 1.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param pcp_size Size of the HPCP (must be a positive nonzero multiple of 12).
+ * @param harmonics Number of harmonics for frequency contribution, 0 indicates exclusive fundamental frequency
+ * contribution.
+ * @param window_type_func The window type function. Examples: BlackmanHarris92dB, BlackmanHarris62dB...
+ * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
+ * @param window_size Size, in semitones, of the window used for the weighting.
+ * @return std::vector<double> Harmonic pitch class profile of the frame.
+ */
+std::vector<double> FrameHPCP(
+    const std::vector<double> &frame,
+    double sample_rate = 44100.,
+    unsigned int pcp_size = 36,
+    unsigned int harmonics = 3,
+    const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func = BlackmanHarris62dB,
+    unsigned int max_num_peaks = 100,
+    double window_size = .5);
+
+/**
+ * @brief Computes the HPCP of every frame of a signal.
+ *
+ * Frames are cut like in DetectKey, the first frame is centered at the beginning of the signal. Averaging all the rows
+ * of a chromagram with aggregation_frames = 1 gives the averaged HPCP that DetectKey estimates the key from.
+ *
+ * @param normalized_samples Normalized samples, either stereo or mono.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param pcp_size Size of the HPCPs (must be a positive nonzero multiple of 12).
+ * @param harmonics Number of harmonics for frequency contribution, 0 indicates exclusive fundamental frequency
+ * contribution.
+ * @param frame_size Output frame size.
+ * @param hop_size Hop size between frames.
+ * @param window_type_func The window type function. Examples: BlackmanHarris92dB, BlackmanHarris62dB...
+ * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
+ * @param window_size Size, in semitones, of the window used for the weighting.
+ * @param aggregation_frames Number of consecutive frames combined into one row (1 keeps every frame). The last row can
+ * combine fewer frames.
+ * @param aggregation_type How the frames of a row are combined, either "mean" or "max".
+ * @return Chromagram HPCPs of the frames and their timestamps.
+ */
+Chromagram ComputeChromagram(
+    const std::vector<std::vector<double>> &normalized_samples,
+    double sample_rate = 44100.,
+    unsigned int pcp_size = 36,
+    unsigned int harmonics = 3,
+    const int frame_size = 4096,
+    const int hop_size = 512,
+    const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func = BlackmanHarris62dB,
+    unsigned int max_num_peaks = 100,
+    double window_size = .5,
+    unsigned int aggregation_frames = 1,
+    const std::string aggregation_type = "mean");
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,236 @@
+#include "src/core/constant_q.h"
+
+#include <pocketfft/pocketfft.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/core/framecutter.h"
+#include "src/core/hpcp.h"
+#include "src/core/mono_mixer.h"
+#include "src/core/pipeline_stats.h"
+#include "src/core/resampler.h"
+#include "src/core/spectrum.h"
+
+namespace musher {
+namespace core {
+
+struct ConstantQPlan::FFTPlan {
+  explicit FFTPlan(size_t frame_size) : plan(frame_size) {}
+
+  pocketfft::detail::pocketfft_r<double> plan;
+};
+
+ConstantQPlan::ConstantQPlan(double sample_rate,
+                             unsigned int bins_per_octave,
+                             double min_frequency,
+                             unsigned int num_octaves,
+                             double reference_frequency,
+                             double sparsity_threshold)
+    : sample_rate_(sample_rate),
+      bins_per_octave_(bins_per_octave),
+      min_frequency_(min_frequency),
+      num_octaves_(num_octaves) {
+  if (bins_per_octave_ == 0 || bins_per_octave_ % 12 != 0)
+    throw std::runtime_error("ConstantQPlan: bins per octave should be a positive nonzero multiple of 12");
+  if (num_octaves_ == 0 || num_octaves_ > 16)
+    throw std::runtime_error("ConstantQPlan: number of octaves should be between 1 and 16");
+  if (!(min_frequency_ > 0.) || !(reference_frequency > 0.))
+    throw std::runtime_error("ConstantQPlan: frequencies should be larger than 0");
+  const double top_octave_frequency = min_frequency_ * std::pow(2., num_octaves_ - 1);
+  if (2. * top_octave_frequency > 0.4 * sample_rate_)
+    throw std::runtime_error("ConstantQPlan: the highest octave should end below 0.4 * sample rate");
+  if (sparsity_threshold < 0. || sparsity_threshold >= 1.)
+    throw std::runtime_error("ConstantQPlan: sparsity threshold should be between 0 and 1");
+
+  // The lowest bin of the octave has the longest window.
+  const double q = 1. / (std::pow(2., 1. / bins_per_octave_) - 1.);
+  frame_size_ = NextFastLen(static_cast<size_t>(std::ceil(q * sample_rate_ / top_octave_frequency)));
+  fft_plan_ = std::make_shared<const FFTPlan>(frame_size_);
+  buffer_.resize(frame_size_);
+  scratch_.resize(frame_size_);
+
+  const size_t spectrum_size = frame_size_ / 2 + 1;
+  std::vector<std::complex<double>> temporal_kernel(frame_size_);
+  std::vector<std::complex<double>> spectral_kernel(frame_size_);
+  const pocketfft::shape_t shape{ frame_size_ };
+  const pocketfft::stride_t stride{ sizeof(std::complex<double>) };
+  const pocketfft::shape_t axes{ 0 };
+
+  kernel_offsets_.push_back(0);
+  for (unsigned int bin = 0; bin < bins_per_octave_; bin++) {
+    const double frequency = top_octave_frequency * std::pow(2., static_cast<double>(bin) / bins_per_octave_);
+    const size_t window_size = std::min(frame_size_, static_cast<size_t>(std::ceil(q * sample_rate_ / frequency)));
+
+    // Hann window of the bin centered in the frame, normalized so that a sine of amplitude a gives a / 2.
+    std::fill(temporal_kernel.begin(), temporal_kernel.end(), std::complex<double>(0., 0.));
+    const size_t start = (frame_size_ - window_size) / 2;
+    double window_sum = 0.;
+    for (size_t n = 0; n < window_size; n++)
+      window_sum += 0.5 - 0.5 * std::cos(2. * M_PI * (n + 0.5) / static_cast<double>(window_size));
+    for (size_t n = 0; n < window_size; n++) {
+      const double window = 0.5 - 0.5 * std::cos(2. * M_PI * (n + 0.5) / static_cast<double>(window_size));
+      const double time = (static_cast<double>(start + n) - static_cast<double>(frame_size_ / 2)) / sample_rate_;
+      temporal_kernel[start + n] = std::polar(window / window_sum, 2. * M_PI * frequency * time);
+    }
+    pocketfft::c2c(shape, stride, stride, axes, true, temporal_kernel.data(), spectral_kernel.data(), 1.);
+
+    // sum(x[n] * conj(t[n])) = sum(X[j] * conj(T[j])) / N, T only has positive frequencies once sparse.
+    double peak = 0.;
+    for (size_t j = 0; j < spectrum_size; j++) peak = std::max(peak, std::abs(spectral_kernel[j]));
+    for (size_t j = 0; j < spectrum_size; j++) {
+      if (std::abs(spectral_kernel[j]) < sparsity_threshold * peak) continue;
+      kernel_bins_.push_back(j);
+      kernel_values_.push_back(std::conj(spectral_kernel[j]) / static_cast<double>(frame_size_));
+    }
+    kernel_offsets_.push_back(kernel_values_.size());
+
+    const long pitch_class = std::lround(bins_per_octave_ * std::log2(frequency / reference_frequency));
+    const long size = static_cast<long>(bins_per_octave_);
+    pitch_classes_.push_back(static_cast<unsigned int>(((pitch_class % size) + size) % size));
+  }
+}
+
+void ConstantQPlan::Transform(const std::vector<double> &frame) {
+  StageTimer stage_timer(&PipelineStats::fft_seconds);
+  if (frame.size() != frame_size_) throw std::runtime_error("ConstantQPlan: frame size does not match the plan");
+  std::copy(frame.begin(), frame.end(), buffer_.begin());
+  fft_plan_->plan.forward(buffer_.data(), 1., scratch_.data());
+}
+
+std::complex<double> ConstantQPlan::Bin(unsigned int bin) const {
+  // Halfcomplex layout of pocketfft: r0, r1, i1, r2, i2, ..., [r(n/2)].
+  double real = 0.;
+  double imag = 0.;
+  for (size_t i = kernel_offsets_[bin]; i < kernel_offsets_[bin + 1]; i++) {
+    const size_t j = kernel_bins_[i];
+    const double x_real = buffer_[j == 0 ? 0 : 2 * j - 1];
+    const double x_imag = (j == 0 || 2 * j == frame_size_) ? 0. : buffer_[2 * j];
+    real += x_real * kernel_values_[i].real() - x_imag * kernel_values_[i].imag();
+    imag += x_real * kernel_values_[i].imag() + x_imag * kernel_values_[i].real();
+  }
+  return std::complex<double>(real, imag);
+}
+
+void ConstantQPlan::Compute(const std::vector<double> &frame, std::vector<std::complex<double>> &bins) {
+  Transform(frame);
+  StageTimer stage_timer(&PipelineStats::hpcp_seconds);
+  bins.resize(bins_per_octave_);
+  for (unsigned int bin = 0; bin < bins_per_octave_; bin++) bins[bin] = Bin(bin);
+}
+
+void ConstantQPlan::AddChroma(const std::vector<double> &frame, std::vector<double> &chroma) {
+  Transform(frame);
+  StageTimer stage_timer(&PipelineStats::hpcp_seconds);
+  for (unsigned int bin = 0; bin < bins_per_octave_; bin++) chroma[pitch_classes_[bin]] += std::norm(Bin(bin));
+}
+
+std::vector<std::vector<double>> DecimateOctaves(const std::vector<double> &signal, unsigned int num_octaves) {
+  std::vector<std::vector<double>> octaves;
+  if (num_octaves == 0) return octaves;
+  octaves.reserve(num_octaves);
+  octaves.push_back(signal);
+  // Only the ratio of the rates matters to the resampler.
+  Resampler half_rate(2., 1.);
+  for (unsigned int octave = 1; octave < num_octaves; octave++) octaves.push_back(half_rate.Resample(octaves.back()));
+  return octaves;
+}
+
+Chromagram ComputeConstantQChromagram(const std::vector<std::vector<double>> &normalized_samples,
+                                      double sample_rate,
+                                      unsigned int pcp_size,
+                                      const int hop_size,
+                                      double min_frequency,
+                                      unsigned int num_octaves) {
+  if (hop_size <= 0) throw std::runtime_error("ConstantQChromagram: hop size should be larger than 0");
+  ConstantQPlan plan(sample_rate, pcp_size, min_frequency, num_octaves);
+  const std::vector<std::vector<double>> octaves = DecimateOctaves(MonoMixer(normalized_samples), num_octaves);
+
+  const int64_t num_samples = static_cast<int64_t>(octaves[0].size());
+  const int num_frames = num_samples == 0 ? 0 : static_cast<int>((num_samples - 1) / hop_size + 1);
+  const int frame_size = static_cast<int>(plan.FrameSize());
+
+  Chromagram chromagram;
+  chromagram.num_frames = num_frames;
+  chromagram.pcp_size = static_cast<int>(pcp_size);
+  chromagram.hpcps.assign(static_cast<size_t>(num_frames) * pcp_size, 0.);
+  chromagram.timestamps.resize(static_cast<size_t>(num_frames));
+
+  std::vector<double> frame(plan.FrameSize());
+  std::vector<double> chroma(pcp_size);
+  RecordPeakBytes(&PipelineStats::peak_frame_bytes, VectorBytes(frame));
+  for (int frame_index = 0; frame_index < num_frames; frame_index++) {
+    const int64_t center = static_cast<int64_t>(frame_index) * hop_size;
+    std::fill(chroma.begin(), chroma.end(), 0.);
+    for (unsigned int octave = 0; octave < num_octaves; octave++) {
+      frame = CutFrame(octaves[octave], (center >> octave) - frame_size / 2, frame_size);
+      plan.AddChroma(frame, chroma);
+    }
+    NormalizeInPlace(chroma);
+    std::copy(chroma.begin(), chroma.end(), chromagram.hpcps.begin() + static_cast<size_t>(frame_index) * pcp_size);
+    chromagram.timestamps[static_cast<size_t>(frame_index)] = static_cast<double>(center) / sample_rate;
+  }
+  CountStat(&PipelineStats::frames_processed, num_frames);
+  return chromagram;
+}
+
+DetectKeyOutput DetectKeyConstantQ(const std::vector<std::vector<double>> &normalized_samples,
+                                   double sample_rate,
+                                   const DetectKeyOptions &options,
+                                   double min_frequency,
+                                   unsigned int num_octaves) {
+  const PipelineStats start_stats = BeginCallStats();
+  const unsigned int pcp_size = options.pcp_size;
+  Chromagram chromagram = ComputeConstantQChromagram(normalized_samples, sample_rate, pcp_size, options.hop_size,
+                                                     min_frequency, num_octaves);
+  if (chromagram.num_frames == 0) throw std::runtime_error("DetectKeyConstantQ: no frames have been analyzed");
+
+  std::vector<double> average(pcp_size, 0.);
+  for (int row = 0; row < chromagram.num_frames; row++) {
+    for (unsigned int i = 0; i < pcp_size; i++) average[i] += chromagram.hpcps[static_cast<size_t>(row) * pcp_size + i];
+  }
+  for (double &value : average) value /= chromagram.num_frames;
+
+  DetectKeyOutput key_output;
+  static_cast<KeyOutput &>(key_output) = EstimateKey(average, options.use_polphony, options.use_three_chords,
+                                                     options.num_harmonics, options.slope, options.profile_type,
+                                                     options.use_maj_min);
+  key_output.frames_analyzed = chromagram.num_frames;
+  key_output.frames_skipped = 0;
+  key_output.seconds_analyzed = static_cast<double>(normalized_samples[0].size()) / sample_rate;
+  key_output.analyzed_ratio = 1.;
+  key_output.stats = EndCallStats(start_stats);
+  return key_output;
+}
+
+DetectKeyOutput DetectKeyConstantQ(const std::vector<std::vector<double>> &normalized_samples,
+                                   double sample_rate,
+                                   const std::string profile_type,
+                                   const bool use_polphony,
+                                   const bool use_three_chords,
+                                   const unsigned int num_harmonics,
+                                   const double slope,
+                                   const bool use_maj_min,
+                                   const unsigned int pcp_size,
+                                   const int hop_size,
+                                   double min_frequency,
+                                   unsigned int num_octaves) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.hop_size = hop_size;
+  return DetectKeyConstantQ(normalized_samples, sample_rate, options, min_frequency, num_octaves);
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <complex>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/core/chromagram.h"
+#include "src/core/key.h"
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Sparse spectral kernel of a constant-Q transform (Brown and Puckette), with octave-wise decimation.
+ *
+ * The bins are spaced by 1 / bins_per_octave octave from min_frequency, over num_octaves octaves, and each bin
+ * analyzes Q = 1 / (2^(1 / bins_per_octave) - 1) periods of its frequency with a Hann window. Only the kernel of the
+ * highest octave is stored: it is the FFT of the windowed complex exponentials of the octave, with the values below
+ * sparsity_threshold times the peak of each bin dropped. A bin is then a short sum over the FFT of the frame.
+ *
+ * The lower octaves reuse the same kernel on the signal decimated by 2 once per octave (see DecimateOctaves): at half
+ * the sample rate, the frequencies of the kernel are one octave lower and its windows twice as long in seconds. Every
+ * octave costs one FFT of FrameSize() samples per hop, instead of one FFT long enough for the lowest bin.
+ *
+ * @code
+ *   ConstantQPlan plan(sample_rate);
+ *   std::vector<std::vector<double>> octaves = DecimateOctaves(MonoMixer(normalized_samples), plan.NumOctaves());
+ *   std::vector<double> chroma(plan.BinsPerOctave(), 0.);
+ *   for (unsigned int octave = 0; octave < plan.NumOctaves(); octave++)
+ *     plan.AddChroma(CutFrame(octaves[octave], (center >> octave) - plan.FrameSize() / 2, plan.FrameSize()), chroma);
+ * @endcode
+ */
+class ConstantQPlan {
+ private:
+  const double sample_rate_;
+  const unsigned int bins_per_octave_;
+  const double min_frequency_;
+  const unsigned int num_octaves_;
+  size_t frame_size_;
+  struct FFTPlan;  //!< Real FFT of FrameSize() samples, defined with pocketfft in constant_q.cpp.
+  std::shared_ptr<const FFTPlan> fft_plan_;
+
+  // Kernel of the highest octave in compressed sparse rows: the coefficients of bin k are the entries
+  // kernel_offsets_[k] to kernel_offsets_[k + 1] - 1, applied to the FFT bins kernel_bins_.
+  std::vector<size_t> kernel_offsets_;
+  std::vector<size_t> kernel_bins_;
+  std::vector<std::complex<double>> kernel_values_;
+  std::vector<unsigned int> pitch_classes_;  //!< Pitch class of each bin, 0 is the reference frequency.
+
+  std::vector<double> buffer_;
+  std::vector<double> scratch_;
+
+  void Transform(const std::vector<double> &frame);
+  std::complex<double> Bin(unsigned int bin) const;  //!< Bin of the last transformed frame.
+
+ public:
+  /**
+   * @brief Construct a new ConstantQPlan object, the kernel is computed once here.
+   *
+   * @param sample_rate Sampling rate of the audio signal \[Hz\].
+   * @param bins_per_octave Number of bins per octave, also the size of the pitch class profiles (must be a positive
+   * nonzero multiple of 12).
+   * @param min_frequency Frequency of the lowest bin \[Hz\].
+   * @param num_octaves Number of octaves. The highest octave must end below 0.4 * sample_rate, so that it stays in the
+   * passband of the decimation.
+   * @param reference_frequency Frequency of pitch class 0 \[Hz\], A4 = 440 Hz gives the pitch classes of HPCP.
+   * @param sparsity_threshold Kernel values smaller than this fraction of the largest value of their bin are dropped.
+   */
+  ConstantQPlan(double sample_rate = 44100.,
+                unsigned int bins_per_octave = 36,
+                double min_frequency = 55.,
+                unsigned int num_octaves = 6,
+                double reference_frequency = 440.,
+                double sparsity_threshold = 0.0054);
+
+  ~ConstantQPlan() {}
+
+  /**
+   * @brief Size of the frames of every octave, in samples of that octave.
+   *
+   * @return size_t FFT size of the kernel.
+   */
+  size_t FrameSize() const { return frame_size_; }
+
+  unsigned int BinsPerOctave() const { return bins_per_octave_; }
+  unsigned int NumOctaves() const { return num_octaves_; }
+
+  /**
+   * @brief Number of nonzero values of the sparse kernel.
+   *
+   * @return size_t Nonzero values, at most BinsPerOctave() * (FrameSize() / 2 + 1).
+   */
+  size_t KernelSize() const { return kernel_values_.size(); }
+
+  /**
+   * @brief Constant-Q transform of the highest octave of a frame.
+   *
+   * Applied to a frame of the signal decimated octave times, it gives the bins of that octave. A sine of amplitude a
+   * at the frequency of a bin gives a magnitude of a / 2 in that bin.
+   *
+   * @param frame Frame of FrameSize() samples, centered on the analyzed time.
+   * @param bins Output complex bins, resized to BinsPerOctave().
+   */
+  void Compute(const std::vector<double> &frame, std::vector<std::complex<double>> &bins);
+
+  /**
+   * @brief Adds the power of every bin of an octave to its pitch class, without allocating.
+   *
+   * @param frame Frame of FrameSize() samples, centered on the analyzed time.
+   * @param chroma Pitch class profile of BinsPerOctave() values to add to.
+   */
+  void AddChroma(const std::vector<double> &frame, std::vector<double> &chroma);
+};
+
+/**
+ * @brief A signal and its successive decimations by 2, for the octaves of a ConstantQPlan.
+ *
+ * Each decimation low-passes the previous one (see Resampler, "medium" quality) and keeps every other sample, so
+ * sample n of octave o lies at sample n * 2^o of the signal.
+ *
+ * @param signal Mono signal.
+ * @param num_octaves Number of octaves, the signal is the first one.
+ * @return std::vector<std::vector<double>> num_octaves signals.
+ */
+std::vector<std::vector<double>> DecimateOctaves(const std::vector<double> &signal, unsigned int num_octaves);
+
+/**
+ * @brief Computes the constant-Q pitch class profiles of every frame of a signal.
+ *
+ * Frame i is centered at sample i * hop_size like the frames of ComputeChromagram, the frames of the lower octaves at
+ * the nearest sample of their decimated signal. Each row is the power of the bins of every octave summed by pitch
+ * class, then normalized so that its maximum is 1 (rows without any signal stay all zeros).
+ *
+ * @param normalized_samples Normalized samples, either stereo or mono.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param pcp_size Number of bins per octave and size of the profiles (must be a positive nonzero multiple of 12).
+ * @param hop_size Hop size between frames.
+ * @param min_frequency Frequency of the lowest bin \[Hz\].
+ * @param num_octaves Number of octaves.
+ * @return Chromagram Profiles of the frames and their timestamps.
+ */
+Chromagram ComputeConstantQChromagram(const std::vector<std::vector<double>> &normalized_samples,
+                                      double sample_rate = 44100.,
+                                      unsigned int pcp_size = 36,
+                                      const int hop_size = 512,
+                                      double min_frequency = 55.,
+                                      unsigned int num_octaves = 6);
+
+/**
+ * @brief Computes key estimate given normalized samples, with the constant-Q profiles instead of the HPCPs.
+ *
+ * The rows of ComputeConstantQChromagram are averaged and the average is passed to EstimateKey. The constant-Q bins
+ * resolve neighbouring semitones down to min_frequency, where the spectral peaks of a 4096 samples frame do not.
+ * Only the key profile options, pcp_size (the number of bins per octave) and hop_size apply, the constant-Q bins
+ * replace the frames and their spectral peaks and every frame is analyzed.
+ *
+ * @param normalized_samples Normalized samples, either stereo or mono.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param options Key profile options, PCP size and hop size, see DetectKeyOptions.
+ * @param min_frequency Frequency of the lowest bin \[Hz\].
+ * @param num_octaves Number of octaves.
+ * @return DetectKeyOutput Key estimate, see DetectKey. Every frame is analyzed, none is skipped.
+ */
+DetectKeyOutput DetectKeyConstantQ(const std::vector<std::vector<double>> &normalized_samples,
+                                   double sample_rate,
+                                   const DetectKeyOptions &options,
+                                   double min_frequency = 55.,
+                                   unsigned int num_octaves = 6);
+
+/**
+ * @brief Overloaded function for DetectKeyConstantQ that takes the parameters positionally. See DetectKey for the key
+ * profile parameters.
+ *
+ * @param normalized_samples Normalized samples, either stereo or mono.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param profile_type The type of polyphic profile to use for correlation calculation.
+ * @param use_polphony Enables the use of polyphonic profiles to define key profiles.
+ * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic profiles.
+ * @param num_harmonics Number of harmonics that should contribute to the polyphonic profile.
+ * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+ * @param use_maj_min Use a third profile called 'majmin' for ambiguous tracks.
+ * @param pcp_size Number of bins per octave and size of the profiles (must be a positive nonzero multiple of 12).
+ * @param hop_size Hop size between frames.
+ * @param min_frequency Frequency of the lowest bin \[Hz\].
+ * @param num_octaves Number of octaves.
+ * @return DetectKeyOutput Key estimate, see DetectKey. Every frame is analyzed, none is skipped.
+ */
+DetectKeyOutput DetectKeyConstantQ(const std::vector<std::vector<double>> &normalized_samples,
+                                   double sample_rate = 44100.,
+                                   const std::string profile_type = "Bgate",
+                                   const bool use_polphony = true,
+                                   const bool use_three_chords = true,
+                                   const unsigned int num_harmonics = 4,
+                                   const double slope = 0.6,
+                                   const bool use_maj_min = false,
+                                   const unsigned int pcp_size = 36,
+                                   const int hop_size = 512,
+                                   double min_frequency = 55.,
+                                   unsigned int num_octaves = 6);
+
+}  // namespace core
+}  // namespace musher
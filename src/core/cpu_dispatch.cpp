@@ -0,0 +1,104 @@
+#include "src/core/cpu_dispatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace musher {
+namespace core {
+
+namespace {
+
+SimdLevel DetectSimdLevel() {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SimdLevel::kAvx512;
+  if (__builtin_cpu_supports("avx2")) return SimdLevel::kAvx2;
+#endif
+#if defined(__SSE2__)
+  return SimdLevel::kSse2;
+#else
+  return SimdLevel::kScalar;
+#endif
+}
+
+SimdLevel DefaultSimdLevel() {
+  SimdLevel level = DetectedSimdLevel();
+
+  const char *env_level = std::getenv("MUSHER_SIMD_LEVEL");
+  if (env_level != nullptr && env_level[0] != '\0') {
+    // The variable can only lower the level, an unsupported level would crash with an illegal instruction.
+    // An invalid name is ignored, it would otherwise make an unrelated kernel call throw.
+    try {
+      level = std::min(ParseSimdLevel(env_level), level);
+    } catch (const std::runtime_error &) {
+    }
+  }
+  return level;
+}
+
+// -1 until the default level has been set.
+std::atomic<int> active_level(-1);
+
+}  // namespace
+
+SimdLevel DetectedSimdLevel() {
+  static const SimdLevel detected_level = DetectSimdLevel();
+  return detected_level;
+}
+
+SimdLevel ActiveSimdLevel() {
+  int level = active_level.load(std::memory_order_relaxed);
+  if (level < 0) {
+    int default_level = static_cast<int>(DefaultSimdLevel());
+    // Keep a level that another thread has set in the meantime.
+    if (active_level.compare_exchange_strong(level, default_level)) level = default_level;
+  }
+  return static_cast<SimdLevel>(level);
+}
+
+void SetSimdLevel(SimdLevel level) {
+  if (level > DetectedSimdLevel()) {
+    std::string err_msg = "SetSimdLevel: '" + SimdLevelName(level) +
+                          "' is not supported by this CPU, the highest level is '" +
+                          SimdLevelName(DetectedSimdLevel()) + "'.";
+    throw std::runtime_error(err_msg);
+  }
+  active_level.store(static_cast<int>(level));
+}
+
+void ResetSimdLevel() { active_level.store(static_cast<int>(DefaultSimdLevel())); }
+
+std::string SimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::kScalar:
+      return "scalar";
+    case SimdLevel::kSse2:
+      return "sse2";
+    case SimdLevel::kAvx2:
+      return "avx2";
+    case SimdLevel::kAvx512:
+      return "avx512";
+  }
+  throw std::runtime_error("SimdLevelName: invalid level");
+}
+
+SimdLevel ParseSimdLevel(const std::string &name) {
+  std::string lower_name = name;
+  std::transform(lower_name.begin(), lower_name.end(), lower_name.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  if (lower_name == "scalar") return SimdLevel::kScalar;
+  if (lower_name == "sse2") return SimdLevel::kSse2;
+  if (lower_name == "avx2") return SimdLevel::kAvx2;
+  if (lower_name == "avx512") return SimdLevel::kAvx512;
+
+  std::string err_msg = "SIMD level '" + name + "' is not supported. Use scalar, sse2, avx2 or avx512.";
+  throw std::runtime_error(err_msg);
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Instruction set levels the hot kernels have implementations for, from the slowest to the fastest.
+ *
+ * The scalar level is the reference implementation of every kernel and is available on every CPU.
+ */
+enum class SimdLevel : int {
+  kScalar = 0,  //!< Portable C++, no intrinsics.
+  kSse2 = 1,    //!< 128 bit vectors, the baseline of every x86-64 CPU.
+  kAvx2 = 2,    //!< 256 bit vectors.
+  kAvx512 = 3,  //!< 512 bit vectors (AVX-512F).
+};
+
+/**
+ * @brief Highest level supported by the CPU (and the compiler) the library is running on.
+ *
+ * @return SimdLevel Supported level.
+ */
+SimdLevel DetectedSimdLevel();
+
+/**
+ * @brief Level the kernels are currently dispatched to.
+ *
+ * Defaults to DetectedSimdLevel(). The environment variable MUSHER_SIMD_LEVEL ("scalar", "sse2", "avx2" or "avx512")
+ * lowers the default when it is read at the first kernel call, a level above the detected one is clamped to it.
+ *
+ * @return SimdLevel Active level.
+ */
+SimdLevel ActiveSimdLevel();
+
+/**
+ * @brief Force the kernels to a specific level, for example to compare the results against the scalar reference.
+ *
+ * Applies to all the threads.
+ *
+ * @param level Level to use.
+ */
+void SetSimdLevel(SimdLevel level);
+
+/**
+ * @brief Go back to the default level (see ActiveSimdLevel).
+ */
+void ResetSimdLevel();
+
+/**
+ * @brief Name of a level, as accepted by ParseSimdLevel and MUSHER_SIMD_LEVEL.
+ *
+ * @param level Level.
+ * @return std::string Lowercase name, for example "avx2".
+ */
+std::string SimdLevelName(SimdLevel level);
+
+/**
+ * @brief Convert the name of a level to the level.
+ *
+ * @param name "scalar", "sse2", "avx2" or "avx512", case insensitive.
+ * @return SimdLevel Level.
+ */
+SimdLevel ParseSimdLevel(const std::string &name);
+
+}  // namespace core
+}  // namespace musher
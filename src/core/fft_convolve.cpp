@@ -3,15 +3,48 @@
 #include <pocketfft/pocketfft.h>
 
 #include <algorithm>
-#include <complex>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "src/core/simd_kernels.h"
 #include "src/core/spectrum.h"
+#include "src/core/utils.h"
 
 namespace musher {
 namespace core {
 
+namespace {
+
+// Up to about 16 taps a DotProduct per output beats overlap-save (measured on 2^18 samples).
+const size_t kDirectMaxKernelSize = 16;
+
+// Overlap-save blocks are at least kBlockRatio times the kernel, so that most of each block is output.
+const size_t kBlockRatio = 8;
+const size_t kMinBlockSize = 1024;
+
+// Overlap-save is used when it takes at least this many blocks, each thread gets at least as many.
+const int64_t kMinBlocks = 4;
+
+// Plans and spectra of the kernel kept by a plan, for the signals of varying sizes of the "fft" method.
+const size_t kMaxCachedTransforms = 16;
+
+// Product of two spectra in the halfcomplex layout of pocketfft: r0, r1, i1, r2, i2, ..., [r(n/2)].
+void MultiplyHalfcomplex(const double *spectrum, size_t size, double *out) {
+  out[0] *= spectrum[0];
+  for (size_t i = 1; i + 1 < size; i += 2) {
+    const double real = out[i] * spectrum[i] - out[i + 1] * spectrum[i + 1];
+    const double imag = out[i] * spectrum[i + 1] + out[i + 1] * spectrum[i];
+    out[i] = real;
+    out[i + 1] = imag;
+  }
+  if (size % 2 == 0) out[size - 1] *= spectrum[size - 1];
+}
+
+}  // namespace
+
 std::vector<double> CenterVector(const std::vector<double> &vec, size_t new_shape) {
   size_t curr_shape = vec.size();
   size_t start_index = (curr_shape - new_shape) / 2;
@@ -20,102 +53,158 @@ std::vector<double> CenterVector(const std::vector<double> &vec, size_t new_shap
   return sliced;
 }
 
+ConvolverPlan::ConvolverPlan(const std::vector<double> &kernel, bool correlate, int num_threads)
+    : kernel_(kernel), correlate_(correlate), num_threads_(num_threads) {
+  if (kernel_.empty()) throw std::runtime_error("ConvolverPlan: kernel should not be empty");
+  if (num_threads_ <= 0) num_threads_ = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+  // A correlation is the convolution with the time reversed kernel.
+  if (correlate_) std::reverse(kernel_.begin(), kernel_.end());
+  reversed_.assign(kernel_.rbegin(), kernel_.rend());
+  block_size_ = NextFastLen(std::max(kMinBlockSize, kBlockRatio * kernel_.size()));
+}
+
+size_t ConvolverPlan::DirectMaxKernelSize() { return kDirectMaxKernelSize; }
+
+std::string ConvolverPlan::Method(size_t signal_size) const {
+  if (std::min(signal_size, kernel_.size()) <= kDirectMaxKernelSize) return "direct";
+  const size_t full_size = signal_size + kernel_.size() - 1;
+  const size_t block_step = block_size_ - kernel_.size() + 1;
+  if (full_size >= kMinBlocks * block_step) return "overlap_save";
+  return "fft";
+}
+
+struct ConvolverPlan::Transform {
+  explicit Transform(size_t fft_size) : plan(fft_size) {}
+
+  pocketfft::detail::pocketfft_r<double> plan;
+  std::vector<double> kernel_spectrum;  //!< Halfcomplex spectrum of the kernel, scaled by 1 / fft size.
+};
+
+const ConvolverPlan::Transform &ConvolverPlan::GetTransform(size_t fft_size) {
+  auto found = transforms_.find(fft_size);
+  if (found != transforms_.end()) return *found->second;
+  if (transforms_.size() >= kMaxCachedTransforms) transforms_.clear();
+
+  std::shared_ptr<Transform> transform = std::make_shared<Transform>(fft_size);
+  transform->kernel_spectrum.assign(fft_size, 0.);
+  std::copy(kernel_.begin(), kernel_.end(), transform->kernel_spectrum.begin());
+  // The normalization of the inverse transform is folded into the kernel.
+  transform->plan.forward(transform->kernel_spectrum.data(), 1. / static_cast<double>(fft_size));
+  transforms_[fft_size] = transform;
+  return *transform;
+}
+
+void ConvolverPlan::ConvolveDirect(const std::vector<double> &signal, int64_t begin, int64_t end, double *out) const {
+  // Output j is sum(reversed_[m] * signal[j - (K - 1) + m]) over the taps m that fall inside the signal.
+  const int64_t kernel_size = static_cast<int64_t>(kernel_.size());
+  const int64_t signal_size = static_cast<int64_t>(signal.size());
+  for (int64_t j = begin; j < end; j++) {
+    const int64_t first_tap = std::max<int64_t>(0, kernel_size - 1 - j);
+    const int64_t last_tap = std::min(kernel_size, signal_size + kernel_size - 1 - j);
+    out[j - begin] = DotProduct(reversed_.data() + first_tap, signal.data() + j - (kernel_size - 1) + first_tap,
+                                static_cast<size_t>(last_tap - first_tap));
+  }
+}
+
+void ConvolverPlan::ConvolveFFT(const std::vector<double> &signal, int64_t begin, int64_t end, double *out) {
+  // The circular convolution wraps the outputs after fft_size onto the first ones, only the requested outputs have
+  // to be clear of them.
+  const int64_t full_size = static_cast<int64_t>(signal.size() + kernel_.size()) - 1;
+  const size_t min_size = std::max({ static_cast<size_t>(full_size - begin), signal.size(), kernel_.size() });
+  const size_t fft_size = NextFastLen(min_size);
+  const Transform &transform = GetTransform(fft_size);
+
+  std::vector<double> buffer(fft_size, 0.);
+  std::vector<double> scratch(fft_size);
+  std::copy(signal.begin(), signal.end(), buffer.begin());
+  transform.plan.forward(buffer.data(), 1., scratch.data());
+  MultiplyHalfcomplex(transform.kernel_spectrum.data(), fft_size, buffer.data());
+  transform.plan.backward(buffer.data(), 1., scratch.data());
+  std::copy(buffer.begin() + begin, buffer.begin() + end, out);
+}
+
+void ConvolverPlan::ConvolveOverlapSave(const std::vector<double> &signal, int64_t begin, int64_t end, double *out) {
+  // Block b holds the signal from b * step - (K - 1), its circular convolution is exact from sample K - 1 on: the
+  // full outputs b * step to (b + 1) * step - 1.
+  const Transform &transform = GetTransform(block_size_);
+  const int64_t kernel_size = static_cast<int64_t>(kernel_.size());
+  const int64_t signal_size = static_cast<int64_t>(signal.size());
+  const int64_t block_size = static_cast<int64_t>(block_size_);
+  const int64_t step = block_size - kernel_size + 1;
+  const int64_t first_block = begin / step;
+  const int64_t num_blocks = (end - 1) / step + 1 - first_block;
+
+  auto convolve_blocks = [&](int64_t block_begin, int64_t block_end) {
+    std::vector<double> buffer(block_size_);
+    std::vector<double> scratch(block_size_);
+    for (int64_t block = block_begin; block < block_end; block++) {
+      const int64_t start = block * step - (kernel_size - 1);
+      const int64_t copy_begin = std::max<int64_t>(0, start);
+      const int64_t copy_end = std::min(signal_size, start + block_size);
+      std::fill(buffer.begin(), buffer.end(), 0.);
+      if (copy_begin < copy_end)
+        std::copy(signal.begin() + copy_begin, signal.begin() + copy_end, buffer.begin() + (copy_begin - start));
+
+      transform.plan.forward(buffer.data(), 1., scratch.data());
+      MultiplyHalfcomplex(transform.kernel_spectrum.data(), block_size_, buffer.data());
+      transform.plan.backward(buffer.data(), 1., scratch.data());
+
+      const int64_t out_begin = std::max(begin, block * step);
+      const int64_t out_end = std::min(end, (block + 1) * step);
+      for (int64_t j = out_begin; j < out_end; j++) out[j - begin] = buffer[j - block * step + kernel_size - 1];
+    }
+  };
+
+  const int64_t num_ranges = std::max<int64_t>(1, std::min<int64_t>(num_threads_, num_blocks / kMinBlocks));
+
+  // Every thread convolves a contiguous range of blocks with its own buffers, the plan and the spectrum are shared.
+  auto convolve_range = [&](size_t range, int) {
+    const int64_t index = static_cast<int64_t>(range);
+    convolve_blocks(first_block + num_blocks * index / num_ranges, first_block + num_blocks * (index + 1) / num_ranges);
+  };
+  ParallelFor(static_cast<size_t>(num_ranges), static_cast<int>(num_ranges), convolve_range);
+}
+
+std::vector<double> ConvolverPlan::Convolve(const std::vector<double> &signal, const std::string &mode) {
+  std::vector<double> output;
+  if (signal.empty()) return output;
+
+  // Range [begin, end) of the full convolution to output.
+  const int64_t signal_size = static_cast<int64_t>(signal.size());
+  const int64_t kernel_size = static_cast<int64_t>(kernel_.size());
+  int64_t begin;
+  int64_t end;
+  if (mode == "full") {
+    begin = 0;
+    end = signal_size + kernel_size - 1;
+  } else if (mode == "same") {
+    begin = (kernel_size - 1) / 2;
+    end = begin + signal_size;
+  } else if (mode == "valid") {
+    if (signal_size < kernel_size) return output;
+    begin = kernel_size - 1;
+    end = signal_size;
+  } else {
+    throw std::runtime_error("ConvolverPlan: mode '" + mode + "' is not supported. Use full, same or valid.");
+  }
+
+  output.resize(static_cast<size_t>(end - begin));
+  const std::string method = Method(signal.size());
+  if (method == "direct")
+    ConvolveDirect(signal, begin, end, output.data());
+  else if (method == "overlap_save")
+    ConvolveOverlapSave(signal, begin, end, output.data());
+  else
+    ConvolveFFT(signal, begin, end, output.data());
+  return output;
+}
+
 std::vector<double> FFTConvolve(const std::vector<double> &vec1, const std::vector<double> &vec2) {
-  std::vector<double> v1(vec1);
-  std::vector<double> v2(vec2);
-  std::vector<double> ret;
-
-  if (v1.empty() || v2.empty()) return ret;
-
-  size_t s1 = v1.size();
-  size_t s2 = v2.size();
-  size_t shape = s1 + s2 - 1;
-
-  // Pad inputs to an efficient length
-  size_t good_size = NextFastLen(shape);
-  if (good_size < v1.size() || good_size < v2.size())
-    std::runtime_error("Something went wrong calculating efficient FFT size.");
-  v1.resize(good_size, 0.0);
-  v2.resize(good_size, 0.0);
-
-  // FFT common variables
-  bool forward = true;
-  int inorm = 0;
-  int nthreads = 1;
-  pocketfft::shape_t axes{ 1 };  // 1 axis on 1D array
-
-  // vec1 FFT
-  pocketfft::shape_t v1_dims_in{ 1, v1.size() };  // {width, height}
-  pocketfft::shape_t v1_dims_out(v1_dims_in);
-  v1_dims_out[axes.back()] = (v1_dims_out[axes.back()] >> 1) + 1;  // Get length of output vector
-  size_t v1OutSize = v1_dims_out[axes.back()];
-  std::vector<std::complex<double>> v1_out(v1OutSize);
-  long int s1_in_shape = v1.size() * sizeof(double);
-  pocketfft::stride_t s1_in{ s1_in_shape, sizeof(double) };  // {height * sizeof(type), sizeof(type)}
-  // NOTE: Putting the size of the wrong type will produce wrong results
-  long int s1_out_shape = v1.size() * sizeof(std::complex<double>);
-  pocketfft::stride_t s1_out{ s1_out_shape, sizeof(std::complex<double>) };
-  auto d1_in = reinterpret_cast<const double *>(v1.data());
-  auto d1_out = reinterpret_cast<std::complex<double> *>(v1_out.data());
-  double v1_fct = NormFct(inorm, v1_dims_in, axes);
-  pocketfft::r2c(v1_dims_in, s1_in, s1_out, axes, forward, d1_in, d1_out, v1_fct, nthreads);
-
-  // vec2 FFT
-  pocketfft::shape_t v2_dims_in{ 1, v2.size() };  // {width, height}
-  pocketfft::shape_t v2_dims_out(v2_dims_in);
-  v2_dims_out[axes.back()] = (v2_dims_out[axes.back()] >> 1) + 1;  // Get length of output vector
-  size_t v2OutSize = v2_dims_out[axes.back()];
-  std::vector<std::complex<double>> v2_out(v2OutSize);
-  long int s2_in_shape = v2.size() * sizeof(double);
-  pocketfft::stride_t s2_in{ s2_in_shape, sizeof(double) };  // {height * sizeof(type), sizeof(type)}
-  // NOTE: Putting the size of the wrong type will produce wrong results
-  long int s2_out_shape = v2.size() * sizeof(std::complex<double>);
-  pocketfft::stride_t s2_out{ s2_out_shape, sizeof(std::complex<double>) };
-  auto d2_in = reinterpret_cast<const double *>(v2.data());
-  auto d2_out = reinterpret_cast<std::complex<double> *>(v2_out.data());
-  double v2_fct = NormFct(inorm, v2_dims_in, axes);
-  pocketfft::r2c(v2_dims_in, s2_in, s2_out, axes, forward, d2_in, d2_out, v2_fct, nthreads);
-
-  // Element-wise multiplication of 2 complex vectors
-  std::vector<std::complex<double>> products(v1_out.size());
-  std::transform(v1_out.begin(), v1_out.end(), v2_out.begin(), products.begin(),
-                 std::multiplies<std::complex<double>>());
-
-  // Save size of products before padding
-  size_t product_size_pre_pad = products.size();
-
-  // Pad products to efficient size
-  products.resize(good_size, 0.0);
-
-  // Inverse FFT of complex to real
-  forward = false;
-  inorm = 2;
-  size_t axis = axes.back();
-  size_t lastsize = products.size();
-  pocketfft::shape_t conv_dims_in{ 1, product_size_pre_pad };  // {width, height}
-  pocketfft::shape_t conv_dims_out(conv_dims_in);
-  // if (lastsize==0) lastsize = 2 * conv_dims_in[axis] - 1;
-  if ((lastsize / 2) + 1 != conv_dims_in[axis]) throw std::runtime_error("bad lastsize");
-  conv_dims_out[axis] = lastsize;
-  size_t conv_out_size = conv_dims_out[axis];
-  std::vector<double> conv_out(conv_out_size);
-  long int conv_in_shape = products.size() * sizeof(std::complex<double>);
-  pocketfft::stride_t s_conv_in{ conv_in_shape,
-                                 sizeof(std::complex<double>) };  // {height * sizeof(type), sizeof(type)}
-  // NOTE: Putting the size of the wrong type will produce wrong results
-  long int conv_out_shape = conv_out_size * sizeof(double);
-  pocketfft::stride_t s_conv_out{ conv_out_shape, sizeof(double) };
-  auto d_conv_in = reinterpret_cast<const std::complex<double> *>(products.data());
-  auto d_conv_out = reinterpret_cast<double *>(conv_out.data());
-  double conv_fct = NormFct(inorm, conv_dims_out, axes);
-  pocketfft::c2r(conv_dims_out, s_conv_in, s_conv_out, axes, forward, d_conv_in, d_conv_out, conv_fct, nthreads);
-
-  std::vector<double> sliced_conv_out(conv_out.begin(), conv_out.begin() + shape);
-
-  // Perform 'same' part of the convolve
-  std::vector<double> centered_conv_out = CenterVector(sliced_conv_out, s1);
-  return centered_conv_out;
+  if (vec1.empty() || vec2.empty()) return std::vector<double>();
+  ConvolverPlan plan(vec2);
+  return plan.Convolve(vec1, "same");
 }
 
 }  // namespace core
-}  // namespace musher
\ No newline at end of file
+}  // namespace musher
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace musher {
@@ -14,13 +19,108 @@ namespace core {
  */
 std::vector<double> CenterVector(const std::vector<double> &vec, size_t new_shape);
 
+/**
+ * @brief Convolution or correlation of signals with a fixed kernel.
+ *
+ * Every signal is convolved with the method that suits its size, see Method:
+ *
+ * - "direct": one DotProduct per output sample, for kernels of at most DirectMaxKernelSize() taps.
+ * - "overlap_save": the signal is cut into blocks of BlockSize() samples overlapping by KernelSize() - 1, each block
+ *   is convolved by FFT with the spectrum of the kernel, for signals much longer than the kernel. The blocks are
+ *   spread over num_threads threads.
+ * - "fft": a single FFT of the whole signal, for kernels about as long as the signals.
+ *
+ * The FFT plans and the spectra of the kernel are computed once per FFT size and cached by the plan, and a
+ * transform runs in place in a single buffer (pocketfft halfcomplex layout). In correlation mode the kernel is time
+ * reversed once here, so correlating a signal costs the same as convolving it.
+ *
+ * A plan is not thread safe, use one plan per thread.
+ *
+ * @code
+ *   ConvolverPlan plan(kernel);
+ *   for (const std::vector<double> &signal : signals) outputs.push_back(plan.Convolve(signal, "same"));
+ * @endcode
+ */
+class ConvolverPlan {
+ private:
+  struct Transform;  //!< FFT plan of a size and spectrum of the kernel, defined with pocketfft in fft_convolve.cpp.
+
+  std::vector<double> kernel_;    //!< Convolution kernel, the time reverse of the kernel in correlation mode.
+  std::vector<double> reversed_;  //!< Time reverse of kernel_, the taps of the direct method.
+  const bool correlate_;
+  int num_threads_;
+  size_t block_size_;
+  std::map<size_t, std::shared_ptr<const Transform>> transforms_;
+
+  const Transform &GetTransform(size_t fft_size);
+  void ConvolveDirect(const std::vector<double> &signal, int64_t begin, int64_t end, double *out) const;
+  void ConvolveFFT(const std::vector<double> &signal, int64_t begin, int64_t end, double *out);
+  void ConvolveOverlapSave(const std::vector<double> &signal, int64_t begin, int64_t end, double *out);
+
+ public:
+  /**
+   * @brief Construct a new ConvolverPlan object.
+   *
+   * @param kernel Kernel, at least one sample.
+   * @param correlate Compute correlations, sum(signal[n + lag] * kernel[n]), instead of convolutions.
+   * @param num_threads Number of threads of the overlap-save method, 0 uses one per hardware thread.
+   */
+  ConvolverPlan(const std::vector<double> &kernel, bool correlate = false, int num_threads = 1);
+
+  ~ConvolverPlan() {}
+
+  /**
+   * @brief Convolution (or correlation) of a signal with the kernel.
+   *
+   * The modes are those of scipy.signal.convolve and scipy.signal.correlate. Index i of the "full" output is the lag
+   * i - (KernelSize() - 1) of a correlation.
+   *
+   * @param signal Input signal.
+   * @param mode "full" (signal.size() + KernelSize() - 1 samples), "same" (signal.size() samples, centered with
+   * respect to the full output) or "valid" (signal.size() - KernelSize() + 1 samples without any zero padding, none
+   * if the signal is shorter than the kernel).
+   * @return std::vector<double> Output samples, none for an empty signal.
+   */
+  std::vector<double> Convolve(const std::vector<double> &signal, const std::string &mode = "full");
+
+  /**
+   * @brief Method used for a signal size, see ConvolverPlan.
+   *
+   * @param signal_size Number of samples of the signal.
+   * @return std::string "direct", "overlap_save" or "fft".
+   */
+  std::string Method(size_t signal_size) const;
+
+  size_t KernelSize() const { return kernel_.size(); }
+  bool Correlate() const { return correlate_; }
+  int NumThreads() const { return num_threads_; }
+
+  /**
+   * @brief FFT size of the blocks of the overlap-save method, each block gives BlockSize() - KernelSize() + 1 output
+   * samples.
+   *
+   * @return size_t Block size.
+   */
+  size_t BlockSize() const { return block_size_; }
+
+  /**
+   * @brief Longest kernel convolved with the direct method.
+   *
+   * @return size_t Number of taps.
+   */
+  static size_t DirectMaxKernelSize();
+};
+
 /**
  * @brief Perform 'same' convolve of two 1-dimensional arrays using FFT.
- * 
+ *
  * Convolve `vec1` and `vec2` using the fast Fourier transform method.
  * The output is the same size as `vec1`, centered with respect to the
  * full discrete linear convolution of the inputs.
  *
+ * Builds a ConvolverPlan of `vec2` for a single signal, reuse a plan to convolve many signals with the same kernel.
+ * Like with the plan, kernels of at most ConvolverPlan::DirectMaxKernelSize() taps are convolved directly.
+ *
  * This function was heavily inspired by:
  *  https://github.com/scipy/scipy/blob/12fa74e97d3d18ca3a4e6991327663e88462f238/scipy/signal/signaltools.py#L551
  *  https://github.com/scipy/scipy/blob/master/scipy/fft/_pocketfft/pypocketfft.cxx
@@ -33,4 +133,4 @@ std::vector<double> CenterVector(const std::vector<double> &vec, size_t new_shap
 std::vector<double> FFTConvolve(const std::vector<double> &vec1, const std::vector<double> &vec2);
 
 }  // namespace core
-}  // namespace musher
\ No newline at end of file
+}  // namespace musher
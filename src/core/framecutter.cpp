@@ -3,13 +3,20 @@
 #include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
+#include "src/core/pipeline_stats.h"
+
 namespace musher {
 namespace core {
 
 std::vector<double> Framecutter::compute() {
+  StageTimer stage_timer(&PipelineStats::frame_seconds);
   if (valid_frame_threshold_ratio_ > 0.5 && start_from_center_) {
     throw std::runtime_error(
         "FrameCutter: valid_frame_threshold_ratio cannot be "
@@ -20,8 +27,8 @@ std::vector<double> Framecutter::compute() {
   }
 
   int valid_frame_threshold = static_cast<int>(std::round(valid_frame_threshold_ratio_ * frame_size_));
-  int start_index;
-  size_t buffer_size = buffer_.size();
+  int64_t start_index;
+  int64_t buffer_size = static_cast<int64_t>(buffer_.size());
 
   if (start_from_center_)
     start_index = -(frame_size_ + 1) / 2 + start_index_;
@@ -29,21 +36,22 @@ std::vector<double> Framecutter::compute() {
     start_index = start_index_;
 
   if (last_frame_ || buffer_.empty()) return std::vector<double>();
-  if (start_index >= static_cast<int>(buffer_size)) return std::vector<double>();
+  if (start_index >= buffer_size) return std::vector<double>();
 
   std::vector<double> frame(static_cast<size_t>(frame_size_));
+  RecordPeakBytes(&PipelineStats::peak_frame_bytes, VectorBytes(frame));
   int idx_in_frame = 0;
 
   // If we're before the beginning of the buffer, fill the frame with 0
   if (start_index < 0) {
-    int how_much = std::min(-start_index, frame_size_);
+    int how_much = static_cast<int>(std::min<int64_t>(-start_index, frame_size_));
     for (; idx_in_frame < how_much; idx_in_frame++) {
       frame[idx_in_frame] = static_cast<double>(0.0);
     }
   }
 
   // Now, just copy from the buffer to the frame
-  int how_much = std::min(frame_size_, static_cast<int>(buffer_size - start_index)) - idx_in_frame;
+  int how_much = static_cast<int>(std::min<int64_t>(frame_size_, buffer_size - start_index)) - idx_in_frame;
   std::memcpy(&frame[0] + idx_in_frame, &buffer_[0] + start_index + idx_in_frame, how_much * sizeof(double));
   idx_in_frame += how_much;
 
@@ -51,13 +59,13 @@ std::vector<double> Framecutter::compute() {
   // for the last frame in the stream)
   if (idx_in_frame < valid_frame_threshold) return std::vector<double>();
 
-  if (start_index + idx_in_frame >= static_cast<int>(buffer_size) && !start_from_center_ && !last_frame_to_end_of_file_)
+  if (start_index + idx_in_frame >= buffer_size && !start_from_center_ && !last_frame_to_end_of_file_)
     last_frame_ = true;
 
   if (idx_in_frame < frame_size_) {
     if (!start_from_center_) {
       if (last_frame_to_end_of_file_) {
-        if (start_index >= static_cast<int>(buffer_size)) last_frame_ = true;
+        if (start_index >= buffer_size) last_frame_ = true;
       }
       // if we're zero-padding with start_from_center=false, it means we're filling
       // in the last frame, so we'll have to stop after this one
@@ -66,7 +74,7 @@ std::vector<double> Framecutter::compute() {
     } else {
       // if we're zero-padding and the center of the frame is past the end of the
       // stream, then this is the last frame and we need to stop after this one
-      if (start_index + frame_size_ / 2 >= static_cast<int>(buffer_.size())) {
+      if (start_index + frame_size_ / 2 >= buffer_size) {
         last_frame_ = true;
       }
     }
@@ -79,5 +87,112 @@ std::vector<double> Framecutter::compute() {
   return frame;
 }
 
+int Framecutter::NumFrames() const {
+  return CountFrames(buffer_.size(), frame_size_, hop_size_, start_from_center_, last_frame_to_end_of_file_,
+                     valid_frame_threshold_ratio_);
+}
+
+namespace {
+
+// Index of the first frame starting at or after position, for frames starting at first_start + k * hop_size.
+int64_t FirstFrameStartingFrom(int64_t position, int64_t first_start, int64_t hop_size) {
+  if (position <= first_start) return 0;
+  return (position - first_start + hop_size - 1) / hop_size;
+}
+
+}  // namespace
+
+int CountFrames(size_t buffer_size,
+                int frame_size,
+                int hop_size,
+                bool start_from_center,
+                bool last_frame_to_end_of_file,
+                double valid_frame_threshold_ratio) {
+  if (hop_size <= 0) throw std::runtime_error("CountFrames: hop_size should be larger than 0");
+  int64_t valid_frame_threshold = static_cast<int64_t>(std::round(valid_frame_threshold_ratio * frame_size));
+  int64_t size = static_cast<int64_t>(buffer_size);
+  // A frame holds at most frame_size samples of the buffer, none of them can reach a larger threshold.
+  if (size == 0 || valid_frame_threshold > frame_size) return 0;
+
+  // Same conditions as Framecutter::compute(), solved for the frame index. Frame k starts at first_start + k * hop
+  // and holds min(frame_size, size - start) samples of the buffer.
+  int64_t first_start = start_from_center ? -(frame_size + 1) / 2 : 0;
+
+  // The iteration stops before the first frame that starts past the buffer or holds too few samples.
+  int64_t num_frames =
+      FirstFrameStartingFrom(size - std::max<int64_t>(valid_frame_threshold, 1) + 1, first_start, hop_size);
+
+  // It also stops after the frame that reaches the end of the buffer, unless the last frame has to start at the end of
+  // the file.
+  if (start_from_center) {
+    num_frames = std::min(num_frames, FirstFrameStartingFrom(size - frame_size / 2, first_start, hop_size) + 1);
+  } else if (!last_frame_to_end_of_file) {
+    num_frames = std::min(num_frames, FirstFrameStartingFrom(size - frame_size, first_start, hop_size) + 1);
+  }
+
+  if (num_frames > std::numeric_limits<int>::max())
+    throw std::runtime_error("CountFrames: the buffer has more frames than an int can count, increase hop_size");
+  return static_cast<int>(num_frames);
+}
+
+int64_t FrameStartIndex(int frame_index, int frame_size, int hop_size, bool start_from_center) {
+  int64_t position = static_cast<int64_t>(frame_index) * hop_size;
+  return start_from_center ? -(frame_size + 1) / 2 + position : position;
+}
+
+std::vector<double> CutFrame(const std::vector<double> &buffer, int64_t start_index, int frame_size) {
+  StageTimer stage_timer(&PipelineStats::frame_seconds);
+  std::vector<double> frame(static_cast<size_t>(frame_size), 0.);
+  int64_t buffer_size = static_cast<int64_t>(buffer.size());
+
+  int64_t begin = std::max<int64_t>(start_index, 0);
+  int64_t end = std::min<int64_t>(start_index + frame_size, buffer_size);
+  if (begin < end) std::copy(buffer.begin() + begin, buffer.begin() + end, frame.begin() + (begin - start_index));
+  return frame;
+}
+
+std::vector<int> SampleFrameIndices(int num_frames,
+                                    const std::string &sampling_type,
+                                    unsigned int frame_stride,
+                                    unsigned int num_sampled_frames,
+                                    unsigned int seed) {
+  std::vector<int> indices;
+  if (num_frames <= 0) return indices;
+
+  if (sampling_type == "all") {
+    indices.resize(static_cast<size_t>(num_frames));
+    std::iota(indices.begin(), indices.end(), 0);
+  } else if (sampling_type == "stride") {
+    if (frame_stride == 0) throw std::runtime_error("SampleFrameIndices: frame_stride should be larger than 0");
+    for (int64_t i = 0; i < num_frames; i += frame_stride) indices.push_back(static_cast<int>(i));
+  } else if (sampling_type == "even" || sampling_type == "random") {
+    if (num_sampled_frames == 0)
+      throw std::runtime_error("SampleFrameIndices: num_sampled_frames should be larger than 0");
+    int num_selected = static_cast<int>(std::min<unsigned int>(num_sampled_frames, num_frames));
+
+    if (sampling_type == "even") {
+      // Center of each of the num_selected equally long segments.
+      for (int k = 0; k < num_selected; k++) {
+        indices.push_back(static_cast<int>((2 * static_cast<int64_t>(k) + 1) * num_frames / (2 * num_selected)));
+      }
+    } else {
+      // Selection sampling (Knuth, Algorithm S). The raw generator output is scaled by hand because the standard
+      // distributions are implementation defined, this keeps the selection identical on every platform.
+      std::mt19937 generator(seed);
+      int needed = num_selected;
+      for (int i = 0; i < num_frames && needed > 0; i++) {
+        uint64_t remaining = static_cast<uint64_t>(num_frames - i);
+        if (((static_cast<uint64_t>(generator()) * remaining) >> 32) < static_cast<uint64_t>(needed)) {
+          indices.push_back(i);
+          needed--;
+        }
+      }
+    }
+  } else {
+    throw std::runtime_error("SampleFrameIndices: sampling type '" + sampling_type + "' is not supported");
+  }
+  return indices;
+}
+
 }  // namespace core
 }  // namespace musher
\ No newline at end of file
@@ -1,8 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace musher {
 namespace core {
 
+/**
+ * @brief Number of frames a buffer is cut into by Framecutter, computed from the size of the buffer only.
+ *
+ * See Framecutter for the description of the parameters. The count is computed in constant time, it throws a
+ * runtime_error if it does not fit in an int (a tiny hop_size over a very long buffer).
+ *
+ * @return int Number of frames.
+ */
+int CountFrames(size_t buffer_size,
+                int frame_size = 1024,
+                int hop_size = 512,
+                bool start_from_center = true,
+                bool last_frame_to_end_of_file = false,
+                double valid_frame_threshold_ratio = 0.);
+
+/**
+ * @brief Index of the first sample of a frame in the buffer. Negative when the frame starts before the buffer.
+ *
+ * @param frame_index Index of the frame.
+ * @param frame_size Frame size.
+ * @param hop_size Hop size between frames.
+ * @param start_from_center Whether the first frame is centered at the beginning of the buffer.
+ * @return int64_t Start of the frame.
+ */
+int64_t FrameStartIndex(int frame_index, int frame_size, int hop_size, bool start_from_center = true);
+
+/**
+ * @brief Copies frame_size samples starting at start_index, the samples outside of the buffer are zeros.
+ *
+ * @param buffer Buffer from which to read data.
+ * @param start_index Index of the first sample of the frame, can be negative.
+ * @param frame_size Output frame size.
+ * @return std::vector<double> Zero-padded frame.
+ */
+std::vector<double> CutFrame(const std::vector<double> &buffer, int64_t start_index, int frame_size);
+
+/**
+ * @brief Selects which frames to analyze when only a subset of the frames of a signal is needed.
+ *
+ * Sampling types:
+ * - **all** - Every frame.
+ * - **stride** - Every frame_stride-th frame, starting with the first one.
+ * - **even** - num_sampled_frames frames evenly spaced over the signal, each one at the center of its segment.
+ * - **random** - num_sampled_frames distinct frames drawn uniformly with the given seed. The same seed always gives the
+ *      same frames.
+ *
+ * @param num_frames Number of frames of the signal.
+ * @param sampling_type Either "all", "stride", "even" or "random".
+ * @param frame_stride Distance between two sampled frames, only used by "stride".
+ * @param num_sampled_frames Number of frames to select, only used by "even" and "random". If larger than num_frames all
+ * the frames are selected.
+ * @param seed Seed of the random generator, only used by "random".
+ * @return std::vector<int> Indices of the selected frames, in increasing order.
+ */
+std::vector<int> SampleFrameIndices(int num_frames,
+                                    const std::string &sampling_type = "all",
+                                    unsigned int frame_stride = 1,
+                                    unsigned int num_sampled_frames = 0,
+                                    unsigned int seed = 0);
+
 /**
  * @brief This class should be treated like an iterator.
  *
@@ -22,7 +86,7 @@ class Framecutter {
   const bool start_from_center_;
   const bool last_frame_to_end_of_file_;
   const double valid_frame_threshold_ratio_;
-  int start_index_;
+  int64_t start_index_;
   bool last_frame_;
   std::vector<double> frame_;
 
@@ -84,6 +148,15 @@ class Framecutter {
    * @return std::vector<double> Sliced frame.
    */
   std::vector<double> compute();
+
+  /**
+   * @brief Number of frames the whole buffer is cut into, independently of how far the iteration has gone.
+   *
+   * No frame is copied, only the positions of the frames are computed.
+   *
+   * @return int Number of frames.
+   */
+  int NumFrames() const;
 };
 
 }  // namespace core
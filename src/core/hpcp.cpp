@@ -8,6 +8,9 @@
 #include <string>
 #include <vector>
 
+#include "src/core/pipeline_stats.h"
+#include "src/core/simd_kernels.h"
+
 namespace musher {
 namespace core {
 
@@ -85,7 +88,7 @@ void AddContribution(double freq,
                      double reference_frequency,
                      double window_size,
                      WeightType weight_type,
-                     std::vector<HarmonicPeak> harmonic_peaks,
+                     const std::vector<HarmonicPeak> &harmonic_peaks,
                      std::vector<double> &hpcp) {
   // TODO Change function from editing vector reference.
   std::vector<HarmonicPeak>::const_iterator it;
@@ -136,20 +139,27 @@ std::vector<HarmonicPeak> InitHarmonicContributionTable(int harmonics) {
   return harmonic_peaks;
 }
 
-std::vector<double> HPCP(const std::vector<double> &frequencies,
-                         const std::vector<double> &magnitudes,
-                         unsigned int size,
-                         double reference_frequency,
-                         unsigned int harmonics,
-                         bool band_preset,
-                         double band_split_frequency,
-                         double min_frequency,
-                         double max_frequency,
-                         std::string _weight_type,
-                         double window_size,
-                         bool max_shifted,
-                         bool non_linear,
-                         std::string _normalized) {
+HPCPPlan::HPCPPlan(unsigned int size,
+                   double reference_frequency,
+                   unsigned int harmonics,
+                   bool band_preset,
+                   double band_split_frequency,
+                   double min_frequency,
+                   double max_frequency,
+                   std::string _weight_type,
+                   double window_size,
+                   bool max_shifted,
+                   bool non_linear,
+                   std::string _normalized)
+    : size_(size),
+      reference_frequency_(reference_frequency),
+      band_preset_(band_preset),
+      band_split_frequency_(band_split_frequency),
+      min_frequency_(min_frequency),
+      max_frequency_(max_frequency),
+      window_size_(window_size),
+      max_shifted_(max_shifted),
+      non_linear_(non_linear) {
   // Input validation
   if (size % 12 != 0) {
     throw std::runtime_error("HPCP: The size parameter is not a multiple of 12.");
@@ -168,100 +178,92 @@ std::vector<double> HPCP(const std::vector<double> &frequencies,
     }
   }
 
-  if (magnitudes.size() != frequencies.size()) {
-    throw std::runtime_error("HPCP: Frequency and magnitude input vectors are not of equal size");
-  }
-
   if (window_size * size / 12 < 1.0) {
     throw std::runtime_error("HPCP: Your window_size needs to span at least one hpcp bin (window_size >= 12/size)");
   }
 
-  WeightType weight_type;
   if (_weight_type == "none")
-    weight_type = NONE;
+    weight_type_ = NONE;
   else if (_weight_type == "cosine")
-    weight_type = COSINE;
+    weight_type_ = COSINE;
   else if (_weight_type == "squared cosine")
-    weight_type = SQUARED_COSINE;
+    weight_type_ = SQUARED_COSINE;
   else {
     std::string err_message = "HPCP: Invalid weight type of: ";
     err_message += _weight_type;
     throw std::runtime_error(err_message);
   }
 
-  NormalizeType Normalized;
   if (_normalized == "none")
-    Normalized = N_NONE;
+    normalized_ = N_NONE;
   else if (_normalized == "unit sum")
-    Normalized = N_UNIT_SUM;
+    normalized_ = N_UNIT_SUM;
   else if (_normalized == "unit max")
-    Normalized = N_UNIT_MAX;
+    normalized_ = N_UNIT_MAX;
   else {
     std::string err_message = "HPCP: Invalid Normalize type of: ";
     err_message += _normalized;
     throw std::runtime_error(err_message);
   }
 
-  if (non_linear && Normalized != N_UNIT_MAX) {
+  if (non_linear && normalized_ != N_UNIT_MAX) {
     throw std::runtime_error("HPCP: Cannot apply non-linear filter when HPCP vector is not Normalized to unit max.");
   }
   // ========
 
-  std::vector<HarmonicPeak> harmonic_peaks = InitHarmonicContributionTable(harmonics);
-  std::vector<double> hpcp(size);
-
-  std::vector<double> hpcp_LO;
-  std::vector<double> hpcp_HI;
+  harmonic_peaks_ = InitHarmonicContributionTable(harmonics);
 
   if (band_preset) {
-    hpcp_LO.resize(size);
-    std::fill(hpcp_LO.begin(), hpcp_LO.end(), static_cast<double>(0.0));
+    hpcp_LO_.resize(size);
+    hpcp_HI_.resize(size);
+  }
+  if (max_shifted) hpcp_bak_.resize(size);
+}
 
-    hpcp_HI.resize(size);
-    std::fill(hpcp_HI.begin(), hpcp_HI.end(), static_cast<double>(0.0));
+void HPCPPlan::Start(std::vector<double> &hpcp) {
+  hpcp.assign(size_, 0.);
+  if (band_preset_) {
+    std::fill(hpcp_LO_.begin(), hpcp_LO_.end(), static_cast<double>(0.0));
+    std::fill(hpcp_HI_.begin(), hpcp_HI_.end(), static_cast<double>(0.0));
   }
+}
 
-  // Add each contribution of the spectral frequencies to the HPCP
-  for (int i = 0; i < static_cast<int>(frequencies.size()); i++) {
-    double freq = frequencies[i];
-    double mag_lin = magnitudes[i];
-
-    // Filter out frequencies not between min and max
-    if (freq >= min_frequency && freq <= max_frequency) {
-      if (band_preset) {
-        AddContribution(freq, mag_lin, reference_frequency, window_size, weight_type, harmonic_peaks,
-                        (freq < band_split_frequency) ? hpcp_LO : hpcp_HI);
-      } else {
-        AddContribution(freq, mag_lin, reference_frequency, window_size, weight_type, harmonic_peaks, hpcp);
-      }
+void HPCPPlan::AddPeak(double freq, double mag_lin, std::vector<double> &hpcp) {
+  // Filter out frequencies not between min and max
+  if (freq >= min_frequency_ && freq <= max_frequency_) {
+    if (band_preset_) {
+      AddContribution(freq, mag_lin, reference_frequency_, window_size_, weight_type_, harmonic_peaks_,
+                      (freq < band_split_frequency_) ? hpcp_LO_ : hpcp_HI_);
+    } else {
+      AddContribution(freq, mag_lin, reference_frequency_, window_size_, weight_type_, harmonic_peaks_, hpcp);
     }
   }
+}
 
-  if (band_preset) {
-    if (Normalized == N_UNIT_MAX) {
-      NormalizeInPlace(hpcp_LO);
-      NormalizeInPlace(hpcp_HI);
-    } else if (Normalized == N_UNIT_SUM) {
+void HPCPPlan::Finish(std::vector<double> &hpcp) {
+  if (band_preset_) {
+    if (normalized_ == N_UNIT_MAX) {
+      NormalizeInPlace(hpcp_LO_);
+      NormalizeInPlace(hpcp_HI_);
+    } else if (normalized_ == N_UNIT_SUM) {
       // TODO does it makes sense to apply band preset together with unit sum normalization?
-      NormalizeSumInPlace(hpcp_LO);
-      NormalizeSumInPlace(hpcp_HI);
+      NormalizeSumInPlace(hpcp_LO_);
+      NormalizeSumInPlace(hpcp_HI_);
     }
 
-    for (int i = 0; i < static_cast<int>(hpcp.size()); i++) {
-      hpcp[i] = hpcp_LO[i] + hpcp_HI[i];
-    }
+    AddArrays(hpcp_LO_.data(), hpcp_HI_.data(), hpcp.size(), hpcp.data());
   }
 
-  if (Normalized == N_UNIT_MAX) {
+  if (normalized_ == N_UNIT_MAX) {
     NormalizeInPlace(hpcp);
-  } else if (Normalized == N_UNIT_SUM) {
+  } else if (normalized_ == N_UNIT_SUM) {
     NormalizeSumInPlace(hpcp);
   }
 
   /* Perform the Jordi non-linear post-processing step
    This makes small values (below 0.6) even smaller
    while boosting further values close to 1. */
-  if (non_linear) {
+  if (non_linear_) {
     for (int i = 0; i < static_cast<int>(hpcp.size()); i++) {
       hpcp[i] = std::sin(hpcp[i] * M_PI * 0.5);
       hpcp[i] *= hpcp[i];
@@ -273,17 +275,59 @@ std::vector<double> HPCP(const std::vector<double> &frequencies,
 
   /* Shift all of the elements so that the largest HPCP value is at index 0,
    only if this option is enabled. */
-  if (max_shifted) {
+  if (max_shifted_) {
     int idx_max = ArgMax(hpcp);
-    std::vector<double> hpcp_bak = hpcp;
+    std::copy(hpcp.begin(), hpcp.end(), hpcp_bak_.begin());
     for (int i = idx_max; i < static_cast<int>(hpcp.size()); i++) {
-      hpcp[i - idx_max] = hpcp_bak[i];
+      hpcp[i - idx_max] = hpcp_bak_[i];
     }
     int offset = hpcp.size() - idx_max;
     for (int i = 0; i < idx_max; i++) {
-      hpcp[i + offset] = hpcp_bak[i];
+      hpcp[i + offset] = hpcp_bak_[i];
     }
   }
+}
+
+void HPCPPlan::Compute(const std::vector<double> &frequencies,
+                       const std::vector<double> &magnitudes,
+                       std::vector<double> &hpcp) {
+  StageTimer stage_timer(&PipelineStats::hpcp_seconds);
+  if (magnitudes.size() != frequencies.size()) {
+    throw std::runtime_error("HPCP: Frequency and magnitude input vectors are not of equal size");
+  }
+
+  Start(hpcp);
+  // Add each contribution of the spectral frequencies to the HPCP
+  for (int i = 0; i < static_cast<int>(frequencies.size()); i++) AddPeak(frequencies[i], magnitudes[i], hpcp);
+  Finish(hpcp);
+}
+
+void HPCPPlan::Compute(const std::vector<std::tuple<double, double>> &peaks, std::vector<double> &hpcp) {
+  StageTimer stage_timer(&PipelineStats::hpcp_seconds);
+  Start(hpcp);
+  for (const std::tuple<double, double> &peak : peaks) AddPeak(std::get<0>(peak), std::get<1>(peak), hpcp);
+  Finish(hpcp);
+}
+
+std::vector<double> HPCP(const std::vector<double> &frequencies,
+                         const std::vector<double> &magnitudes,
+                         unsigned int size,
+                         double reference_frequency,
+                         unsigned int harmonics,
+                         bool band_preset,
+                         double band_split_frequency,
+                         double min_frequency,
+                         double max_frequency,
+                         std::string _weight_type,
+                         double window_size,
+                         bool max_shifted,
+                         bool non_linear,
+                         std::string _normalized) {
+  StageTimer stage_timer(&PipelineStats::hpcp_seconds);
+  HPCPPlan hpcp_plan(size, reference_frequency, harmonics, band_preset, band_split_frequency, min_frequency,
+                     max_frequency, _weight_type, window_size, max_shifted, non_linear, _normalized);
+  std::vector<double> hpcp;
+  hpcp_plan.Compute(frequencies, magnitudes, hpcp);
   return hpcp;
 }
 
@@ -300,15 +344,12 @@ std::vector<double> HPCP(const std::vector<std::tuple<double, double>> &peaks,
                          bool max_shifted,
                          bool non_linear,
                          std::string _normalized) {
-  std::vector<double> frequencies(peaks.size());
-  std::vector<double> magnitudes(peaks.size());
-
-  std::transform(peaks.begin(), peaks.end(), frequencies.begin(), [](auto const &pair) { return std::get<0>(pair); });
-
-  std::transform(peaks.begin(), peaks.end(), magnitudes.begin(), [](auto const &pair) { return std::get<1>(pair); });
-
-  return HPCP(frequencies, magnitudes, size, reference_frequency, harmonics, band_preset, band_split_frequency,
-              min_frequency, max_frequency, _weight_type, window_size, max_shifted, non_linear, _normalized);
+  StageTimer stage_timer(&PipelineStats::hpcp_seconds);
+  HPCPPlan hpcp_plan(size, reference_frequency, harmonics, band_preset, band_split_frequency, min_frequency,
+                     max_frequency, _weight_type, window_size, max_shifted, non_linear, _normalized);
+  std::vector<double> hpcp;
+  hpcp_plan.Compute(peaks, hpcp);
+  return hpcp;
 }
 
 }  // namespace core
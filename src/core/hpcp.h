@@ -3,6 +3,7 @@
 #define _USE_MATH_DEFINES
 #include <algorithm>
 #include <string>
+#include <tuple>
 #include <vector>
 
 namespace musher {
@@ -129,7 +130,7 @@ void AddContribution(double freq,
                      double reference_frequency,
                      double window_size,
                      WeightType weight_type,
-                     std::vector<HarmonicPeak> harmonic_peaks,
+                     const std::vector<HarmonicPeak> &harmonic_peaks,
                      std::vector<double> &hpcp);
 
 /**
@@ -222,5 +223,68 @@ std::vector<double> HPCP(const std::vector<std::tuple<double, double>> &peaks,
                          bool non_linear = false,
                          std::string _normalized = "unit max");
 
+/**
+ * @brief Validated HPCP parameters, harmonic contribution table and work buffers.
+ *
+ * Computes the same HPCPs as the HPCP function, without allocating once constructed. Useful to compute the HPCPs of
+ * many frames with the same parameters. See HPCP for the description of the parameters.
+ */
+class HPCPPlan {
+ private:
+  const unsigned int size_;
+  const double reference_frequency_;
+  const bool band_preset_;
+  const double band_split_frequency_;
+  const double min_frequency_;
+  const double max_frequency_;
+  WeightType weight_type_;
+  const double window_size_;
+  const bool max_shifted_;
+  const bool non_linear_;
+  NormalizeType normalized_;
+  std::vector<HarmonicPeak> harmonic_peaks_;
+
+  std::vector<double> hpcp_LO_;
+  std::vector<double> hpcp_HI_;
+  std::vector<double> hpcp_bak_;
+
+  void Start(std::vector<double> &hpcp);
+  void AddPeak(double freq, double mag_lin, std::vector<double> &hpcp);
+  void Finish(std::vector<double> &hpcp);
+
+ public:
+  HPCPPlan(unsigned int size = 12,
+           double reference_frequency = 440.0,
+           unsigned int harmonics = 0,
+           bool band_preset = true,
+           double band_split_frequency = 500.0,
+           double min_frequency = 40.0,
+           double max_frequency = 5000.0,
+           std::string _weight_type = "squared cosine",
+           double window_size = 1.0,
+           bool max_shifted = false,
+           bool non_linear = false,
+           std::string _normalized = "unit max");
+
+  /**
+   * @brief Computes the HPCP of a set of spectral peaks.
+   *
+   * @param frequencies Frequencies (positions) of the spectral peaks \[Hz\].
+   * @param magnitudes Magnitudes (heights) of the spectral peaks.
+   * @param hpcp Output harmonic pitch class profile, resized to the HPCP size.
+   */
+  void Compute(const std::vector<double> &frequencies,
+               const std::vector<double> &magnitudes,
+               std::vector<double> &hpcp);
+
+  /**
+   * @brief Overloaded function for Compute that accepts a vector of peaks.
+   *
+   * @param peaks Vector of spectral peaks, each peak being a tuple (frequency, magnitude).
+   * @param hpcp Output harmonic pitch class profile, resized to the HPCP size.
+   */
+  void Compute(const std::vector<std::tuple<double, double>> &peaks, std::vector<double> &hpcp);
+};
+
 }  // namespace core
 }  // namespace musher
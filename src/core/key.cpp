@@ -1,133 +1,46 @@
 #include "src/core/key.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fplus/fplus.hpp>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "src/core/framecutter.h"
 #include "src/core/hpcp.h"
+#include "src/core/key_profile_plan.h"
+#include "src/core/key_detector.h"
+#include "src/core/key_profiles.h"
 #include "src/core/mono_mixer.h"
-#include "src/core/spectral_peaks.h"
-#include "src/core/spectrum.h"
+#include "src/core/pipeline_stats.h"
+#include "src/core/resampler.h"
+#include "src/core/trace_events.h"
 #include "src/core/windowing.h"
 
 namespace musher {
 namespace core {
 
 std::vector<std::vector<double>> SelectKeyProfile(const std::string profile_type) {
-  const std::vector<std::vector<double>> diatonic{
-    { 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1 },
-    { 1, 0, 1, 1, 0, 1, 0, 1, 1, 0, 0, 1 },
-  };
-
-  const std::vector<std::vector<double>> krumhansl{
-    { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 },
-    { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 },
-  };
-
-  const std::vector<std::vector<double>> temperley{
-    { 5.0, 2.0, 3.5, 2.0, 4.5, 4.0, 2.0, 4.5, 2.0, 3.5, 1.5, 4.0 },
-    { 5.0, 2.0, 3.5, 4.5, 2.0, 4.0, 2.0, 4.5, 3.5, 2.0, 1.5, 4.0 },
-  };
-
-  const std::vector<std::vector<double>> weichai{
-    { 81302, 320, 65719, 1916, 77469, 40928, 2223, 83997, 1218, 39853, 1579, 28908 },
-    { 39853, 1579, 28908, 81302, 320, 65719, 1916, 77469, 40928, 2223, 83997, 1218 },
-  };
-
-  const std::vector<std::vector<double>> tonictriad{
-    { 1, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0 },
-    { 1, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0 },
-  };
-
-  const std::vector<std::vector<double>> temperley2005{
-    { 0.748, 0.060, 0.488, 0.082, 0.67, 0.46, 0.096, 0.715, 0.104, 0.366, 0.057, 0.4 },
-    { 0.712, 0.084, 0.474, 0.618, 0.049, 0.46, 0.105, 0.747, 0.404, 0.067, 0.133, 0.33 },
-  };
-
-  const std::vector<std::vector<double>> thpcp{
-    { 0.95162, 0.20742, 0.71758, 0.22007, 0.71341, 0.48841, 0.31431, 1.00000, 0.20957, 0.53657, 0.22585, 0.55363 },
-    { 0.94409, 0.21742, 0.64525, 0.63229, 0.27897, 0.57709, 0.26428, 1.0000, 0.26428, 0.30633, 0.45924, 0.35929 },
-  };
-
-  const std::vector<std::vector<double>> shaath{
-    { 6.6, 2.0, 3.5, 2.3, 4.6, 4.0, 2.5, 5.2, 2.4, 3.7, 2.3, 3.4 },
-    { 6.5, 2.7, 3.5, 5.4, 2.6, 3.5, 2.5, 5.2, 4.0, 2.7, 4.3, 3.2 },
-  };
-
-  const std::vector<std::vector<double>> gomez{
-    { 0.82, 0.00, 0.55, 0.00, 0.53, 0.30, 0.08, 1.00, 0.00, 0.38, 0.00, 0.47 },
-    { 0.81, 0.00, 0.53, 0.54, 0.00, 0.27, 0.07, 1.00, 0.27, 0.07, 0.10, 0.36 },
-  };
-
-  const std::vector<std::vector<double>> noland{
-    { 0.0629, 0.0146, 0.061, 0.0121, 0.0623, 0.0414, 0.0248, 0.0631, 0.015, 0.0521, 0.0142, 0.0478 },
-    { 0.0682, 0.0138, 0.0543, 0.0519, 0.0234, 0.0544, 0.0176, 0.067, 0.0349, 0.0297, 0.0401, 0.027 },
-  };
-
-  const std::vector<std::vector<double>> edmm{
-    { 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083 },
-    { 0.17235348, 0.04, 0.0761009, 0.12, 0.05621498, 0.08527853, 0.0497915, 0.13451001, 0.07458916, 0.05003023,
-      0.09187879, 0.05545106 },
-  };
-
-  // -- Profiles with other --
-
-  const std::vector<std::vector<double>> bgate{
-    { 1.00, 0.00, 0.42, 0.00, 0.53, 0.37, 0.00, 0.77, 0.00, 0.38, 0.21, 0.30 },
-    { 1.00, 0.00, 0.36, 0.39, 0.00, 0.38, 0.00, 0.74, 0.27, 0.00, 0.42, 0.23 },
-    { 1.00, 0.26, 0.35, 0.29, 0.44, 0.36, 0.21, 0.78, 0.26, 0.25, 0.32, 0.26 },
-  };
-
-  const std::vector<std::vector<double>> braw{
-    { 1.0000, 0.1573, 0.4200, 0.1570, 0.5296, 0.3669, 0.1632, 0.7711, 0.1676, 0.3827, 0.2113, 0.2965 },
-    { 1.0000, 0.2330, 0.3615, 0.3905, 0.2925, 0.3777, 0.1961, 0.7425, 0.2701, 0.2161, 0.4228, 0.2272 },
-    { 1.0000, 0.2608, 0.3528, 0.2935, 0.4393, 0.3580, 0.2137, 0.7809, 0.2578, 0.2539, 0.3233, 0.2615 },
-  };
-
-  const std::vector<std::vector<double>> edma{
-    { 1.00, 0.29, 0.50, 0.40, 0.60, 0.56, 0.32, 0.80, 0.31, 0.45, 0.42, 0.39 },
-    { 1.00, 0.31, 0.44, 0.58, 0.33, 0.49, 0.29, 0.78, 0.43, 0.29, 0.53, 0.32 },
-    { 1.00, 0.26, 0.35, 0.29, 0.44, 0.36, 0.21, 0.78, 0.26, 0.25, 0.32, 0.26 },
-  };
-
-  if (profile_type == "Diatonic")
-    return diatonic;
-  else if (profile_type == "Krumhansl")
-    return krumhansl;
-  else if (profile_type == "Temperley")
-    return temperley;
-  else if (profile_type == "Weichai")
-    return weichai;
-  else if (profile_type == "Tonic Triad")
-    return tonictriad;
-  else if (profile_type == "Temperley2005")
-    return temperley2005;
-  else if (profile_type == "Thpcp")
-    return thpcp;
-  else if (profile_type == "Shaath")
-    return shaath;
-  else if (profile_type == "Gomez")
-    return gomez;
-  else if (profile_type == "Noland")
-    return noland;
-  else if (profile_type == "Edmm")
-    return edmm;
-  else if (profile_type == "Bgate")
-    return bgate;
-  else if (profile_type == "Braw")
-    return braw;
-  else if (profile_type == "Edma")
-    return edma;
-  else {
+  const int table_index = FindKeyProfileTable(profile_type.c_str());
+  if (table_index < 0) {
     std::stringstream ss;
     ss << "SelectKeyProfile: "
        << "'" << profile_type << "'"
        << " is not a valid profile type.";
     throw std::runtime_error(ss.str().c_str());
   }
+
+  const KeyProfileTable& key_profile = kKeyProfileTables[table_index];
+  std::vector<std::vector<double>> profiles{
+    std::vector<double>(key_profile.major.begin(), key_profile.major.end()),
+    std::vector<double>(key_profile.minor.begin(), key_profile.minor.end()),
+  };
+  if (key_profile.has_other) profiles.emplace_back(key_profile.other.begin(), key_profile.other.end());
+  return profiles;
 }
 
 std::vector<double> AddContributionHarmonics(const std::vector<double>& chords,
@@ -277,171 +190,33 @@ KeyOutput EstimateKey(const std::vector<double>& pcp,
                       const std::string profile_type,
                       const bool use_maj_min) {
   unsigned int pcp_size = static_cast<unsigned int>(pcp.size());
-  unsigned int n = pcp_size / 12;
-
   if (pcp_size < 12 || pcp_size % 12 != 0)
     throw std::runtime_error("Key: input PCP size is not a positive multiple of 12");
 
-  std::vector<double> M;
-  std::vector<double> m;
-  std::vector<double> O(12, static_cast<double>(0.0));
-
-  const std::vector<std::vector<double>> key_profile = SelectKeyProfile(profile_type);
-  M = key_profile[0];
-  m = key_profile[1];
-
-  if (key_profile.size() == 3) {
-    O = key_profile[2];
-  }
-
-  /*
-  Assumptions:
-    - We consider that the tonal hierarchy is kept when dealing with polyphonic sounds.
-      That means that Krumhansl profiles are seen as the tonal hierarchy of
-      each of the chords of the harmonic scale within a major/minor tonal contest.
-    - We compute from these chord profiles the corresponding note (pitch class) profiles,
-      which will be compared to HPCP values.
-
-  Rationale:
-    - Each note contribute to the different harmonics.
-    - All the chords of the major/minor key are considered.
-
-  Procedure:
-    - First, profiles are initialized to 0
-    - We take _M[i], n[i] as Krumhansl profiles i=1,...12 related to each of the chords
-      of the major/minor key.
-    - For each chord, we add its contribution to the three notes (pitch classes) of the chord.
-      We use the same weight for all the notes of the chord.
-    - For each note, we add its contribution to the different harmonics
-
-    --essentia: https://github.com/MTG/essentia/blob/master/src/algorithms/tonal/key.cpp
-  */
-
-  std::vector<double> M_chords_empty(12, static_cast<double>(0.0));
-  std::vector<double> m_chords_empty(12, static_cast<double>(0.0));
-
-  // MAJOR KEY
-  std::vector<double> M_chords = fplus::fwd::apply(
-      M_chords_empty,
-      // Tonic (I)
-      [&M, &num_harmonics, &slope](auto chords) { return AddMajorTriad(chords, 0, M[0], num_harmonics, slope); },
-      // II
-      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddMinorTriad(chords, 2, M[2], num_harmonics, slope);
-        return chords;
-      },
-      // III
-      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddMinorTriad(chords, 4, M[4], num_harmonics, slope);
-        return chords;
-      },
-      // Subdominant (IV)
-      [&M, &num_harmonics, &slope](auto chords) { return AddMajorTriad(chords, 5, M[5], num_harmonics, slope); },
-      // Dominant (V)
-      [&M, &num_harmonics, &slope](auto chords) { return AddMajorTriad(chords, 7, M[7], num_harmonics, slope); },
-      // VI
-      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddMinorTriad(chords, 9, M[9], num_harmonics, slope);
-        return chords;
-      },
-      // VII (5th diminished)
-      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 11, M[11], num_harmonics, slope);
-        return chords;
-      },
-      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 2, M[11], num_harmonics, slope);
-        return chords;
-      },
-      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 5, M[11], num_harmonics, slope);
-        return chords;
-      });
-
-  // MINOR KEY
-  std::vector<double> m_chords = fplus::fwd::apply(
-      m_chords_empty,
-      // Tonica (I)
-      [&m, &num_harmonics, &slope](auto chords) { return AddMinorTriad(chords, 0, m[0], num_harmonics, slope); },
-      // II (5th diminished)
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 2, m[2], num_harmonics, slope);
-        return chords;
-      },
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 5, m[2], num_harmonics, slope);
-        return chords;
-      },
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 8, m[2], num_harmonics, slope);
-        return chords;
-      },
-      // III (5th augmented)
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 3, m[3], num_harmonics, slope);
-        return chords;
-      },
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 7, m[3], num_harmonics, slope);
-        return chords;
-      },
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 11, m[3], num_harmonics, slope);
-        return chords;
-      },
-      // Subdominant (IV)
-      [&m, &num_harmonics, &slope](auto chords) { return AddMinorTriad(chords, 5, m[5], num_harmonics, slope); },
-      // Dominant (V) (harmonic minor scale)
-      [&m, &num_harmonics, &slope](auto chords) { return AddMajorTriad(chords, 7, m[7], num_harmonics, slope); },
-      // VI
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddMajorTriad(chords, 8, m[8], num_harmonics, slope);
-        return chords;
-      },
-      // VII (diminished 5th)
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 11, m[8], num_harmonics, slope);
-        return chords;
-      },
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 2, m[8], num_harmonics, slope);
-        return chords;
-      },
-      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
-        if (!use_three_chords) return AddContributionHarmonics(chords, 5, m[8], num_harmonics, slope);
-        return chords;
-      });
-
-  std::vector<double> M_final;
-  std::vector<double> m_final;
-
-  if (use_polphony) {
-    M_final = M_chords;
-    m_final = m_chords;
-  } else {
-    M_final = M;
-    m_final = m;
-  }
+  std::shared_ptr<const KeyProfilePlan> plan =
+      GetKeyProfilePlan(profile_type, use_polphony, use_three_chords, num_harmonics, slope, use_maj_min, pcp_size);
+  return EstimateKey(pcp, *plan);
+}
 
-  // RESIZE
-  std::vector<double> profile_doM;
-  double mean_profile_M;
-  double std_profile_M = 0.;
-  std::tie(profile_doM, mean_profile_M, std_profile_M) = ResizeProfileToPcpSize(pcp_size, M_final);
+KeyOutput EstimateKey(const std::vector<double>& pcp, const KeyProfilePlan& plan) {
+  StageTimer stage_timer(&PipelineStats::estimate_seconds);
+  // Correlation of the PCP with every shift of the profiles.
+  return EstimateKey(pcp, CorrelateKeyProfiles(pcp, plan), plan);
+}
 
-  std::vector<double> profile_dom;
-  double mean_profile_m;
-  double std_profile_m = 0.;
-  std::tie(profile_dom, mean_profile_m, std_profile_m) = ResizeProfileToPcpSize(pcp_size, m_final);
+KeyOutput EstimateKey(const std::vector<double>& pcp,
+                      const KeyCorrelations& key_correlations,
+                      const KeyProfilePlan& plan) {
+  StageTimer stage_timer(&PipelineStats::estimate_seconds);
+  unsigned int pcp_size = static_cast<unsigned int>(pcp.size());
+  unsigned int n = pcp_size / 12;
 
-  std::vector<double> profile_doO;
-  double mean_profile_O;
-  double std_profile_O = 0.;
-  std::tie(profile_doO, mean_profile_O, std_profile_O) = ResizeProfileToPcpSize(pcp_size, O);
+  if (pcp_size != plan.pcp_size) throw std::runtime_error("Key: input PCP size does not match the key profile plan");
+  if (key_correlations.major.size() != pcp_size || key_correlations.minor.size() != pcp_size ||
+      (plan.use_maj_min && key_correlations.other.size() != pcp_size))
+    throw std::runtime_error("Key: correlations do not match the key profile plan");
 
-  // Compute correlation
-  double mean_pcp = fplus::mean<double, std::vector<double>>(pcp);
-  double std_pcp = StandardDeviation(mean_pcp, pcp);
+  const bool use_maj_min = plan.use_maj_min;
 
   // Compute correlation matrix
   int key_index = -1;            // index of the first maximum
@@ -465,7 +240,7 @@ KeyOutput EstimateKey(const std::vector<double>& pcp,
   // Calculate the correlation between the profiles and the PCP...
   // we shift the profile around to find the best match
   for (unsigned int shift = 0; shift < pcp_size; shift++) {
-    double corr_major = Correlation(pcp, mean_pcp, std_pcp, profile_doM, mean_profile_M, std_profile_M, shift);
+    double corr_major = key_correlations.major[shift];
     // Compute maximum value for major keys
     if (corr_major > max_major) {
       max_2_major = max_major;
@@ -473,7 +248,7 @@ KeyOutput EstimateKey(const std::vector<double>& pcp,
       key_index_major = shift;
     }
 
-    double corr_minor = Correlation(pcp, mean_pcp, std_pcp, profile_dom, mean_profile_m, std_profile_m, shift);
+    double corr_minor = key_correlations.minor[shift];
     // Compute maximum value for minor keys
     if (corr_minor > max_minor) {
       max_2_minor = max_minor;
@@ -483,7 +258,7 @@ KeyOutput EstimateKey(const std::vector<double>& pcp,
 
     double corr_other = 0;
     if (use_maj_min) {
-      corr_other = Correlation(pcp, mean_pcp, std_pcp, profile_doO, mean_profile_O, std_profile_O, shift);
+      corr_other = key_correlations.other[shift];
       // Compute maximum value for other keys
       if (corr_other > max_other) {
         max_2_other = max_other;
@@ -517,7 +292,7 @@ KeyOutput EstimateKey(const std::vector<double>& pcp,
   // In the case of Wei Chai algorithm, the scale is detected in a second step
   // In this point, always the major relative is detected, as it is the first
   // maximum
-  if (profile_type == "Weichai") {
+  if (plan.profile_type == "Weichai") {
     if (scale == Scales::MINOR)
       throw std::runtime_error("Key: error in Wei Chai algorithm. Wei Chai algorithm does not support minor scales.");
 
@@ -563,45 +338,395 @@ KeyOutput EstimateKey(const std::vector<double>& pcp,
   return key_output;
 }
 
-KeyOutput DetectKey(const std::vector<std::vector<double>>& normalized_samples,
-                    double sample_rate,
-                    const std::string profile_type,
-                    const bool use_polphony,
-                    const bool use_three_chords,
-                    const unsigned int num_harmonics,
-                    const double slope,
-                    const bool use_maj_min,
-                    const unsigned int pcp_size,
-                    const int frame_size,
-                    const int hop_size,
-                    const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
-                    unsigned int max_num_peaks,
-                    double window_size) {
-  std::vector<double> mixed_audio = MonoMixer(normalized_samples);
-
-  Framecutter framecutter(mixed_audio, frame_size, hop_size);
-
-  int count = 0;
-  std::vector<double> sums(static_cast<size_t>(pcp_size), 0.);
-
-  for (const std::vector<double>& frame : framecutter) {
-    // NOTE: Windowing and ConvertToFrequencySpectrum are slowest functions here.
-    std::vector<double> windowed_frame = Windowing(frame, window_type_func);
-    std::vector<double> spectrum = ConvertToFrequencySpectrum(windowed_frame);
-    std::vector<std::tuple<double, double>> spectral_peaks =
-        SpectralPeaks(spectrum, -1000.0, "height", max_num_peaks, sample_rate, 0, sample_rate / 2);
-    std::vector<double> hpcp = HPCP(spectral_peaks, pcp_size, 440.0, num_harmonics - 1, true, 500.0, 40.0, 5000.0,
-                                    "squared cosine", window_size);
-
-    for (int i = 0; i < static_cast<int>(hpcp.size()); i++) {
-      sums[i] += hpcp[i];
+std::vector<KeyOutput> EstimateKeys(const double* pcps, size_t num_rows, const KeyProfilePlan& plan) {
+  KeyCorrelationMatrix key_correlations = CorrelateKeyProfiles(pcps, num_rows, plan);
+  std::vector<KeyOutput> key_outputs;
+  key_outputs.reserve(num_rows);
+  std::vector<double> pcp;
+  for (size_t row = 0; row < num_rows; row++) {
+    pcp.assign(pcps + row * plan.pcp_size, pcps + (row + 1) * plan.pcp_size);
+    key_outputs.push_back(EstimateKey(pcp, key_correlations.Row(row), plan));
+  }
+  return key_outputs;
+}
+
+std::vector<KeyOutput> EstimateKeys(const std::vector<std::vector<double>>& pcps, const KeyProfilePlan& plan) {
+  std::vector<double> pcp_matrix;
+  pcp_matrix.reserve(pcps.size() * plan.pcp_size);
+  for (const std::vector<double>& pcp : pcps) {
+    if (pcp.size() != plan.pcp_size)
+      throw std::runtime_error("Key: input PCP size does not match the key profile plan");
+    pcp_matrix.insert(pcp_matrix.end(), pcp.begin(), pcp.end());
+  }
+  return EstimateKeys(pcp_matrix.data(), pcps.size(), plan);
+}
+
+std::vector<KeyOutput> EstimateKeys(const std::vector<std::vector<double>>& pcps,
+                                    const bool use_polphony,
+                                    const bool use_three_chords,
+                                    const unsigned int num_harmonics,
+                                    const double slope,
+                                    const std::string profile_type,
+                                    const bool use_maj_min) {
+  if (pcps.empty()) return std::vector<KeyOutput>();
+
+  unsigned int pcp_size = static_cast<unsigned int>(pcps[0].size());
+  std::shared_ptr<const KeyProfilePlan> plan =
+      GetKeyProfilePlan(profile_type, use_polphony, use_three_chords, num_harmonics, slope, use_maj_min, pcp_size);
+  return EstimateKeys(pcps, *plan);
+}
+
+namespace {
+
+/**
+ * @brief Adds the frame of the signal that starts at start_index to the detector.
+ */
+using AddKeyFrame = std::function<void(KeyDetector& key_detector, int64_t start_index)>;
+
+/**
+ * @brief Feeds the selected frames to the detector, one at a time.
+ *
+ * Samples that are not part of any selected frame are never touched. With convergence_frames > 0 the loop stops as
+ * soon as the detector has converged.
+ *
+ * @return int Index of the last visited frame, -1 if no frame was visited.
+ */
+int AccumulateKeyFrames(KeyDetector& key_detector,
+                        const AddKeyFrame& add_frame,
+                        const int frame_size,
+                        const int hop_size,
+                        const std::vector<int>& frame_indices,
+                        unsigned int convergence_frames = 0,
+                        unsigned int estimate_interval = 0,
+                        double convergence_tolerance = 0.) {
+  bool adaptive = convergence_frames > 0 && estimate_interval > 0;
+  bool converged = false;
+  int last_frame_index = -1;
+  for (size_t chunk_begin = 0; chunk_begin < frame_indices.size() && !converged; chunk_begin += kTraceChunkFrames) {
+    size_t chunk_end = std::min(chunk_begin + kTraceChunkFrames, frame_indices.size());
+    TraceSpan trace_span("AnalyzeFrames", "dsp");
+    trace_span.SetArg("first_frame", frame_indices[chunk_begin]);
+    trace_span.SetArg("num_frames", static_cast<int64_t>(chunk_end - chunk_begin));
+
+    for (size_t i = chunk_begin; i < chunk_end; i++) {
+      int frame_index = frame_indices[i];
+      int frame_count = key_detector.FrameCount();
+      add_frame(key_detector, FrameStartIndex(frame_index, frame_size, hop_size));
+      last_frame_index = frame_index;
+      if (key_detector.FrameCount() == frame_count) continue;  // Skipped by the energy gate.
+
+      if (adaptive && key_detector.FrameCount() % estimate_interval == 0 &&
+          key_detector.HasConverged(convergence_frames, convergence_tolerance)) {
+        converged = true;
+        break;
+      }
     }
-    count += 1;
   }
-  std::vector<double> avgs(sums.size());
-  std::transform(sums.begin(), sums.end(), avgs.begin(), [&count](auto const& sum) { return sum / count; });
-  return EstimateKey(avgs, use_polphony, use_three_chords, num_harmonics, slope, profile_type, use_maj_min);
+
+  if (key_detector.FrameCount() == 0 && key_detector.SkippedFrameCount() > 0)
+    throw std::runtime_error("DetectKey: every frame is below the RMS threshold");
+  return last_frame_index;
+}
+
+/**
+ * @brief Everything AnalyzeKey does after the analysis sampling rate has been applied, except for the stats.
+ */
+KeyAnalysis AnalyzeSampledFrames(const AddKeyFrame& add_frame,
+                                 int64_t num_samples,
+                                 double sample_rate,
+                                 const DetectKeyOptions& options) {
+  const int frame_size = options.frame_size;
+  const int hop_size = options.hop_size;
+  KeyDetector key_detector(sample_rate, options);
+
+  int num_frames = CountFrames(static_cast<size_t>(num_samples), frame_size, hop_size);
+  std::vector<int> frame_indices = SampleFrameIndices(num_frames, options.frame_sampling, options.frame_stride,
+                                                      options.num_sampled_frames, options.sampling_seed);
+
+  int last_frame_index =
+      AccumulateKeyFrames(key_detector, add_frame, frame_size, hop_size, frame_indices, options.convergence_frames,
+                          options.estimate_interval, options.convergence_tolerance);
+
+  if (key_detector.FrameCount() == 0) throw std::runtime_error("DetectKey: no frames have been analyzed");
+
+  KeyAnalysis key_analysis;
+  {
+    TraceSpan trace_span("EstimateKey", "dsp");
+    key_analysis.average_hpcp = key_detector.AverageHPCP();
+    std::shared_ptr<const KeyProfilePlan> plan =
+        GetKeyProfilePlan(options.profile_type, options.use_polphony, options.use_three_chords, options.num_harmonics,
+                          options.slope, options.use_maj_min, options.pcp_size);
+    key_analysis.correlations = CorrelateKeyProfiles(key_analysis.average_hpcp, *plan);
+    key_analysis.key_scores = ScoreKeys(key_analysis.correlations);
+    static_cast<KeyOutput&>(key_analysis) = EstimateKey(key_analysis.average_hpcp, key_analysis.correlations, *plan);
+  }
+
+  // End of the last analyzed frame.
+  int64_t analyzed_end = FrameStartIndex(last_frame_index, frame_size, hop_size) + frame_size;
+  analyzed_end = std::max<int64_t>(0, std::min<int64_t>(analyzed_end, num_samples));
+
+  int frames_visited = key_detector.FrameCount() + key_detector.SkippedFrameCount();
+  key_analysis.frames_analyzed = key_detector.FrameCount();
+  key_analysis.frames_skipped = key_detector.SkippedFrameCount();
+  key_analysis.seconds_analyzed = static_cast<double>(analyzed_end) / sample_rate;
+  key_analysis.analyzed_ratio = static_cast<double>(frames_visited) / num_frames;
+  return key_analysis;
+}
+
+}  // namespace
+
+DetectKeyOptions AnalysisRateOptions(const DetectKeyOptions& options, double sample_rate) {
+  DetectKeyOptions analysis_options = options;
+  analysis_options.analysis_sample_rate = 0.;
+  if (options.analysis_sample_rate > 0. && options.analysis_sample_rate < sample_rate) {
+    const double ratio = options.analysis_sample_rate / sample_rate;
+    analysis_options.frame_size = std::max(2, static_cast<int>(std::lround(options.frame_size * ratio)));
+    analysis_options.hop_size = std::max(1, static_cast<int>(std::lround(options.hop_size * ratio)));
+  }
+  return analysis_options;
+}
+
+KeyAnalysis AnalyzeKey(const std::vector<std::vector<double>>& normalized_samples,
+                       double sample_rate,
+                       const DetectKeyOptions& options) {
+  const PipelineStats start_stats = BeginCallStats();
+  if (options.analysis_sample_rate > 0. && options.analysis_sample_rate < sample_rate) {
+    DetectKeyOptions analysis_options = AnalysisRateOptions(options, sample_rate);
+    std::vector<std::vector<double>> analysis_samples = {
+        Resample(MonoMixer(normalized_samples), sample_rate, options.analysis_sample_rate)};
+    KeyAnalysis key_analysis = AnalyzeKey(analysis_samples, options.analysis_sample_rate, analysis_options);
+    key_analysis.stats = EndCallStats(start_stats);
+    return key_analysis;
+  }
+
+  // The detector cuts and downmixes each frame in its own frame buffer, no frame allocates.
+  int64_t num_samples = normalized_samples.empty() ? 0 : static_cast<int64_t>(normalized_samples[0].size());
+  KeyAnalysis key_analysis = AnalyzeSampledFrames(
+      [&normalized_samples](KeyDetector& key_detector, int64_t start_index) {
+        key_detector.AddFrameAt(normalized_samples, start_index);
+      },
+      num_samples, sample_rate, options);
+  key_analysis.stats = EndCallStats(start_stats);
+  return key_analysis;
+}
+
+KeyAnalysis AnalyzeKeyFrames(const KeyFrameReader& read_frame,
+                             int64_t num_samples,
+                             double sample_rate,
+                             const DetectKeyOptions& options) {
+  const PipelineStats start_stats = BeginCallStats();
+  std::vector<double> frame(static_cast<size_t>(std::max(options.frame_size, 0)));
+  RecordPeakBytes(&PipelineStats::peak_frame_bytes, VectorBytes(frame));
+  KeyAnalysis key_analysis = AnalyzeSampledFrames(
+      [&read_frame, &frame](KeyDetector& key_detector, int64_t start_index) {
+        read_frame(start_index, frame);
+        key_detector.AddFrame(frame);
+      },
+      num_samples, sample_rate, options);
+  key_analysis.stats = EndCallStats(start_stats);
+  return key_analysis;
+}
+
+DetectKeyOutput DetectKey(const std::vector<std::vector<double>>& normalized_samples,
+                          double sample_rate,
+                          const DetectKeyOptions& options) {
+  return AnalyzeKey(normalized_samples, sample_rate, options);
+}
+
+DetectKeyOutput DetectKey(const std::vector<std::vector<double>>& normalized_samples,
+                          double sample_rate,
+                          const std::string profile_type,
+                          const bool use_polphony,
+                          const bool use_three_chords,
+                          const unsigned int num_harmonics,
+                          const double slope,
+                          const bool use_maj_min,
+                          const unsigned int pcp_size,
+                          const int frame_size,
+                          const int hop_size,
+                          const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                          unsigned int max_num_peaks,
+                          double window_size) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.frame_size = frame_size;
+  options.hop_size = hop_size;
+  options.window_type_func = window_type_func;
+  options.max_num_peaks = max_num_peaks;
+  options.window_size = window_size;
+  return DetectKey(normalized_samples, sample_rate, options);
+}
+
+std::vector<double> ScoreKeys(const KeyCorrelations& key_correlations) {
+  int pcp_size = static_cast<int>(key_correlations.major.size());
+  std::vector<double> key_scores(24, -1.);
+
+  // Same mapping from shift to key index as EstimateKey, key k covers the shifts [k * n, (k + 1) * n).
+  for (int shift = 0; shift < pcp_size; shift++) {
+    int key_index = shift * 12 / pcp_size;
+    key_scores[key_index] = std::max(key_scores[key_index], key_correlations.major[shift]);
+    key_scores[12 + key_index] = std::max(key_scores[12 + key_index], key_correlations.minor[shift]);
+  }
+  return key_scores;
+}
+
+std::vector<std::string> KeyProfileTypes() {
+  std::vector<std::string> profile_types;
+  for (const KeyProfileTable& key_profile : kKeyProfileTables) profile_types.push_back(key_profile.name);
+  return profile_types;
+}
+
+KeyOutput VoteKey(const std::vector<KeyOutput>& key_outputs, const std::string vote_type) {
+  if (key_outputs.empty()) throw std::runtime_error("VoteKey: there are no key estimates to vote on");
+  if (vote_type != "majority" && vote_type != "weighted")
+    throw std::runtime_error("VoteKey: vote type '" + vote_type + "' is not supported");
+
+  // Candidates in order of first appearance, so ties go to the first listed profile.
+  std::vector<std::pair<std::string, std::string>> candidates;
+  std::vector<double> votes;
+  std::vector<double> strength_sums;
+  std::vector<int> num_voters;
+  for (const KeyOutput& key_output : key_outputs) {
+    std::pair<std::string, std::string> candidate(key_output.key, key_output.scale);
+    size_t i = std::find(candidates.begin(), candidates.end(), candidate) - candidates.begin();
+    if (i == candidates.size()) {
+      candidates.push_back(candidate);
+      votes.push_back(0.);
+      strength_sums.push_back(0.);
+      num_voters.push_back(0);
+    }
+
+    votes[i] += vote_type == "weighted" ? std::max(key_output.strength, 0.) : 1.;
+    strength_sums[i] += key_output.strength;
+    num_voters[i] += 1;
+  }
+
+  // With majority votes, equal vote counts are decided by the summed strength.
+  size_t winner = 0;
+  for (size_t i = 1; i < candidates.size(); i++) {
+    if (votes[i] > votes[winner] || (votes[i] == votes[winner] && strength_sums[i] > strength_sums[winner]))
+      winner = i;
+  }
+  double runner_up_votes = 0.;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (i != winner) runner_up_votes = std::max(runner_up_votes, votes[i]);
+  }
+
+  KeyOutput vote;
+  vote.key = candidates[winner].first;
+  vote.scale = candidates[winner].second;
+  vote.strength = strength_sums[winner] / num_voters[winner];
+  vote.first_to_second_relative_strength = votes[winner] > 0. ? (votes[winner] - runner_up_votes) / votes[winner] : 0.;
+  return vote;
+}
+
+EnsembleKeyOutput DetectKeyEnsemble(const std::vector<std::vector<double>>& normalized_samples,
+                                    double sample_rate,
+                                    const std::vector<std::string>& profile_types,
+                                    const std::string vote_type,
+                                    const DetectKeyOptions& options) {
+  if (options.analysis_sample_rate > 0. && options.analysis_sample_rate < sample_rate) {
+    DetectKeyOptions analysis_options = AnalysisRateOptions(options, sample_rate);
+    std::vector<std::vector<double>> analysis_samples = {
+        Resample(MonoMixer(normalized_samples), sample_rate, options.analysis_sample_rate)};
+    return DetectKeyEnsemble(analysis_samples, options.analysis_sample_rate, profile_types, vote_type,
+                             analysis_options);
+  }
+
+  EnsembleKeyOutput ensemble_key_output;
+  const std::vector<std::string> requested_profile_types = profile_types.empty() ? KeyProfileTypes() : profile_types;
+  if (requested_profile_types.empty()) throw std::runtime_error("DetectKeyEnsemble: there are no profile types");
+
+  // Resolve every plan first so an invalid profile type fails before the expensive part.
+  std::vector<std::shared_ptr<const KeyProfilePlan>> plans;
+  for (const std::string& profile_type : requested_profile_types) {
+    plans.push_back(GetKeyProfilePlan(profile_type, options.use_polphony, options.use_three_chords,
+                                      options.num_harmonics, options.slope, options.use_maj_min, options.pcp_size));
+  }
+
+  // The HPCPs do not depend on the profile, they are averaged once.
+  const int frame_size = options.frame_size;
+  const int hop_size = options.hop_size;
+  DetectKeyOptions detector_options = options;
+  detector_options.profile_type = requested_profile_types[0];
+  KeyDetector key_detector(sample_rate, detector_options);
+
+  size_t num_samples = normalized_samples.empty() ? 0 : normalized_samples[0].size();
+  int num_frames = CountFrames(num_samples, frame_size, hop_size);
+  std::vector<int> frame_indices = SampleFrameIndices(num_frames, options.frame_sampling, options.frame_stride,
+                                                      options.num_sampled_frames, options.sampling_seed);
+  AccumulateKeyFrames(
+      key_detector,
+      [&normalized_samples](KeyDetector& detector, int64_t start_index) {
+        detector.AddFrameAt(normalized_samples, start_index);
+      },
+      frame_size, hop_size, frame_indices, options.convergence_frames, options.estimate_interval,
+      options.convergence_tolerance);
+  if (key_detector.FrameCount() == 0) throw std::runtime_error("DetectKeyEnsemble: no frames have been analyzed");
+
+  std::vector<double> average_hpcp = key_detector.AverageHPCP();
+  for (size_t i = 0; i < plans.size(); i++) {
+    // The profile types are valid, a failure here is specific to this HPCP and only costs the profile its vote.
+    try {
+      ensemble_key_output.key_outputs.push_back(EstimateKey(average_hpcp, *plans[i]));
+      ensemble_key_output.profile_types.push_back(requested_profile_types[i]);
+    } catch (const std::runtime_error&) {
+      ensemble_key_output.dropped_profile_types.push_back(requested_profile_types[i]);
+    }
+  }
+  if (ensemble_key_output.key_outputs.empty())
+    throw std::runtime_error("DetectKeyEnsemble: no profile type could estimate the key");
+  if (vote_type != "none") ensemble_key_output.vote = VoteKey(ensemble_key_output.key_outputs, vote_type);
+  ensemble_key_output.frames_analyzed = key_detector.FrameCount();
+  ensemble_key_output.frames_skipped = key_detector.SkippedFrameCount();
+  return ensemble_key_output;
+}
+
+EnsembleKeyOutput DetectKeyEnsemble(const std::vector<std::vector<double>>& normalized_samples,
+                                    double sample_rate,
+                                    const std::vector<std::string>& profile_types,
+                                    const std::string vote_type,
+                                    const bool use_polphony,
+                                    const bool use_three_chords,
+                                    const unsigned int num_harmonics,
+                                    const double slope,
+                                    const bool use_maj_min,
+                                    const unsigned int pcp_size,
+                                    const int frame_size,
+                                    const int hop_size,
+                                    const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                                    unsigned int max_num_peaks,
+                                    double window_size,
+                                    const std::string frame_sampling,
+                                    unsigned int frame_stride,
+                                    unsigned int num_sampled_frames,
+                                    unsigned int sampling_seed,
+                                    double rms_threshold) {
+  DetectKeyOptions options;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.frame_size = frame_size;
+  options.hop_size = hop_size;
+  options.window_type_func = window_type_func;
+  options.max_num_peaks = max_num_peaks;
+  options.window_size = window_size;
+  options.frame_sampling = frame_sampling;
+  options.frame_stride = frame_stride;
+  options.num_sampled_frames = num_sampled_frames;
+  options.sampling_seed = sampling_seed;
+  options.rms_threshold = rms_threshold;
+  return DetectKeyEnsemble(normalized_samples, sample_rate, profile_types, vote_type, options);
 }
 
 }  // namespace core
-}  // namespace musher
\ No newline at end of file
+}  // namespace musher
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <vector>
 
 #include "src/core/hpcp.h"
+#include "src/core/key_profile_plan.h"
+#include "src/core/pipeline_stats.h"
 #include "src/core/utils.h"
 #include "src/core/windowing.h"
 
@@ -26,6 +30,47 @@ struct KeyOutput {
   double first_to_second_relative_strength;
 };
 
+/**
+ * @brief Key estimate of DetectKey along with how much of the signal was analyzed to get it.
+ *
+ * Contains same attributes as KeyOutput.
+ */
+struct DetectKeyOutput : KeyOutput {
+  int frames_analyzed;      //!< Number of frames that contributed to the estimate.
+  int frames_skipped;       //!< Number of visited frames that were skipped because they were below the RMS threshold.
+  double seconds_analyzed;  //!< Position in the signal up to which frames were analyzed \[Seconds\].
+  double analyzed_ratio;    /*!< Number of visited (analyzed or skipped) frames divided by the number of frames in the
+                                 whole signal. Smaller than 1 when the analysis stopped early or frames were sampled.*/
+  PipelineStats stats;      /*!< Time spent in each stage and counters of this call, all zeros unless stats are enabled
+                                 (see SetStatsEnabled). The decoding is not part of the call, see ThreadStats.*/
+};
+
+/**
+ * @brief Key estimate of DetectKey together with the intermediate results it was computed from.
+ *
+ * Storing the averaged HPCP is enough to re-estimate the key later with other profiles (see EstimateKey) without
+ * running the spectral analysis again.
+ */
+struct KeyAnalysis : DetectKeyOutput {
+  std::vector<double> average_hpcp;  //!< Average of the HPCPs of the analyzed frames, of size pcp_size.
+  KeyCorrelations correlations;      //!< Correlation of the averaged HPCP with every shift of the key profiles.
+  std::vector<double> key_scores;    /*!< Best correlation of each of the 24 keys, the 12 major keys followed by the 12
+                                          minor keys, in the order A, Bb, B, C, C#, D, Eb, E, F, F#, G, Ab.*/
+};
+
+/**
+ * @brief Key estimates of several key profiles computed from the same averaged HPCP.
+ */
+struct EnsembleKeyOutput {
+  std::vector<std::string> profile_types;          //!< Profile types that produced an estimate.
+  std::vector<KeyOutput> key_outputs;              //!< Key estimate of each profile type, in the same order.
+  std::vector<std::string> dropped_profile_types;  /*!< Profile types whose estimation failed on this HPCP (e.g.
+                                                        Weichai when the best match is a minor key). They do not vote.*/
+  KeyOutput vote;                                  //!< Result of the vote, empty when the vote type is "none".
+  int frames_analyzed;                             //!< Number of frames that contributed to the averaged HPCP.
+  int frames_skipped;                              //!< Number of frames skipped by the RMS threshold.
+};
+
 /**
  * @brief Select a key profile given the type.
  *
@@ -201,34 +246,181 @@ KeyOutput EstimateKey(const std::vector<double>& pcp,
                       const std::string profile_type = "Bgate",
                       const bool use_maj_min = false);
 
+/**
+ * @brief Overloaded function for EstimateKey that uses prebuilt key profiles.
+ *
+ * Only the correlation between the PCP and the profiles is computed, which makes this the cheap way to re-estimate the
+ * key many times with the same parameters. See GetKeyProfilePlan.
+ *
+ * @param pcp The input pitch class profile, of size plan.pcp_size.
+ * @param plan Key profiles built with the parameters of the estimation.
+ * @return KeyOutput See EstimateKey.
+ */
+KeyOutput EstimateKey(const std::vector<double>& pcp, const KeyProfilePlan& plan);
+
+/**
+ * @brief Overloaded function for EstimateKey that picks the key from correlations that were already computed with
+ * CorrelateKeyProfiles.
+ *
+ * @param pcp The input pitch class profile, of size plan.pcp_size.
+ * @param key_correlations Correlations of the PCP with the profiles of the plan.
+ * @param plan Key profiles the correlations were computed with.
+ * @return KeyOutput See EstimateKey.
+ */
+KeyOutput EstimateKey(const std::vector<double>& pcp,
+                      const KeyCorrelations& key_correlations,
+                      const KeyProfilePlan& plan);
+
+/**
+ * @brief Reduces the per-shift correlations to one score per key.
+ *
+ * The score of a key is the best correlation of the shifts that EstimateKey maps to that key.
+ *
+ * @param key_correlations Correlations computed with CorrelateKeyProfiles.
+ * @return std::vector<double> 24 scores, the 12 major keys followed by the 12 minor keys, in the order A, Bb, B, C,
+ * C#, D, Eb, E, F, F#, G, Ab.
+ */
+std::vector<double> ScoreKeys(const KeyCorrelations& key_correlations);
+
+/**
+ * @brief Computes the key estimate of every row of a matrix of PCPs (e.g. many tracks or many segments of a track).
+ *
+ * The profiles are built once and all the rows are correlated with all the shifts as one matrix product, see
+ * CorrelateKeyProfiles.
+ *
+ * @param pcps Pitch class profiles, num_rows x plan.pcp_size in row-major order.
+ * @param num_rows Number of PCPs.
+ * @param plan Key profiles built with the parameters of the estimation.
+ * @return std::vector<KeyOutput> Key estimate of each PCP, in the same order.
+ */
+std::vector<KeyOutput> EstimateKeys(const double* pcps, size_t num_rows, const KeyProfilePlan& plan);
+
+/**
+ * @brief Overloaded function for EstimateKeys that takes the PCPs as separate vectors, copied into one matrix.
+ *
+ * @param pcps Pitch class profiles, one per row, each of size plan.pcp_size.
+ * @param plan Key profiles built with the parameters of the estimation.
+ * @return std::vector<KeyOutput> Key estimate of each PCP, in the same order.
+ */
+std::vector<KeyOutput> EstimateKeys(const std::vector<std::vector<double>>& pcps, const KeyProfilePlan& plan);
+
+/**
+ * @brief Overloaded function for EstimateKeys that takes the parameters of EstimateKey. The key profiles are taken
+ * from the cache, see GetKeyProfilePlan.
+ *
+ * @return std::vector<KeyOutput> Key estimate of each PCP, in the same order.
+ */
+std::vector<KeyOutput> EstimateKeys(const std::vector<std::vector<double>>& pcps,
+                                    const bool use_polphony = true,
+                                    const bool use_three_chords = true,
+                                    const unsigned int num_harmonics = 4,
+                                    const double slope = 0.6,
+                                    const std::string profile_type = "Bgate",
+                                    const bool use_maj_min = false);
+
+/**
+ * @brief Parameters of DetectKey and AnalyzeKey besides the samples and their sampling rate.
+ *
+ * The defaults are the ones of DetectKey, so only the parameters that differ need to be set:
+ *
+ *     DetectKeyOptions options;
+ *     options.profile_type = "Temperley";
+ *     options.frame_sampling = "even";
+ *     options.num_sampled_frames = 200;
+ *     DetectKeyOutput key_output = DetectKey(normalized_samples, sample_rate, options);
+ */
+struct DetectKeyOptions {
+  std::string profile_type = "Bgate";  //!< The type of polyphic profile to use for correlation calculation.
+  bool use_polphony = true;            /*!< Enables the use of polyphonic profiles to define key profiles (this
+                                            includes the contributions from triads as well as pitch harmonics).*/
+  bool use_three_chords = true;        /*!< Consider only the 3 main triad chords of the key (T, D, SD) to build the
+                                            polyphonic profiles.*/
+  unsigned int num_harmonics = 4;      /*!< Number of harmonics that should contribute to the polyphonic profile (1
+                                            only considers the fundamental harmonic).*/
+  double slope = 0.6;  //!< Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+  bool use_maj_min = false;  /*!< Use a third profile called 'majmin' for ambiguous tracks. Only available for the
+                                  edma, bgate and braw profiles.*/
+  unsigned int pcp_size = 36;  //!< Number of array elements used to represent a semitone times 12.
+  int frame_size = 4096;       //!< Output frame size.
+  int hop_size = 512;          //!< Hop size between frames.
+  /** The window type function. Examples: BlackmanHarris92dB, BlackmanHarris62dB... */
+  std::function<std::vector<double>(const std::vector<double>&)> window_type_func = BlackmanHarris62dB;
+  unsigned int max_num_peaks = 100;  //!< Maximum number of returned peaks (set to 0 to return all peaks).
+  double window_size = .5;           //!< Size, in semitones, of the window used for the weighting.
+
+  unsigned int convergence_frames = 0;  /*!< Adaptive mode: stop consuming frames once the winning key and its
+                                             first_to_second_relative_strength have been stable for this many frames
+                                             (0 analyzes the whole signal).*/
+  unsigned int estimate_interval = 32;  //!< Adaptive mode: number of frames between two re-estimations of the key.
+  double convergence_tolerance = 0.05;  /*!< Adaptive mode: maximum change of first_to_second_relative_strength that
+                                             is still considered stable.*/
+
+  std::string frame_sampling = "all";  /*!< Which frames to analyze: "all", "stride", "even" or "random". See
+                                            SampleFrameIndices. Useful to get a global key estimate of very long
+                                            recordings without analyzing every hop. Only the selected frames are cut,
+                                            mixed down and analyzed. DetectKeyFile also reads only the samples of the
+                                            selected frames of a .wav file (see AnalyzeKeyFrames).*/
+  unsigned int frame_stride = 1;       //!< Analyze every frame_stride-th frame when frame_sampling is "stride".
+  unsigned int num_sampled_frames = 0;  //!< Number of frames to analyze when frame_sampling is "even" or "random".
+  unsigned int sampling_seed = 0;       //!< Seed of the random frame selection when frame_sampling is "random".
+
+  double rms_threshold = 0.;  /*!< Energy gate: frames whose root mean square is below this value are skipped before
+                                   windowing and FFT, so silences do not cost time nor pull the average HPCP towards
+                                   zero (0 disables the gate).*/
+  double analysis_sample_rate = 0.;  /*!< Sampling rate to analyze the signal at \[Hz\]. When it is below
+                                          sample_rate, the mixdown is resampled to it (see Resampler) and frame_size
+                                          and hop_size are scaled by the same ratio, so the frames keep their duration
+                                          and frequency resolution while costing proportionally less. The HPCP only
+                                          uses frequencies up to 5000 Hz: 22050 keeps all of them, 11025 attenuates
+                                          the last few semitones. 0, or any rate that is not below sample_rate,
+                                          analyzes the signal at sample_rate.*/
+
+  int64_t max_memory_bytes = 0;  /*!< Memory budget of the decoded samples and the analysis of DetectKeyFile and
+                                      DetectKeyFiles \[Bytes\]. Files that do not fit are streamed instead of decoded
+                                      whole, with the same key estimate. 0 always decodes the whole file.*/
+};
+
+/**
+ * @brief Options of the analysis at options.analysis_sample_rate.
+ *
+ * When analysis_sample_rate applies (see DetectKeyOptions), frame_size and hop_size are scaled by
+ * analysis_sample_rate / sample_rate so that the frames keep their duration. analysis_sample_rate is cleared in
+ * either case.
+ *
+ * @param options Options of the analysis at sample_rate.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @return DetectKeyOptions Options of the resampled signal.
+ */
+DetectKeyOptions AnalysisRateOptions(const DetectKeyOptions& options, double sample_rate);
+
 /**
  * @brief Computes key estimate given normalized samples.
  *
  * @param normalized_samples Normalized samples, either stereo or mono.
  * @param sample_rate Sampling rate of the audio signal \[Hz\].
- * @param profile_type The type of polyphic profile to use for correlation calculation.
- * @param use_polphony Enables the use of polyphonic profiles to define key profiles (this includes the contributions
- * from triads as well as pitch harmonics).
- * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic profiles.
- * @param num_harmonics Number of harmonics that should contribute to the polyphonic profile (1 only considers the
- * fundamental harmonic).
- * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
- * @param use_maj_min Use a third profile called 'majmin' for ambiguous tracks [4]. Only available for the edma, bgate
- * and braw profiles.
- * @param pcp_size Number of array elements used to represent a semitone times 12.
- * @param frame_size Output frame size.
- * @param hop_size Hop size between frames.
- * @param window_type_func The window type function. Examples: BlackmanHarris92dB, BlackmanHarris62dB...
- * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
- * @param window_size Size, in semitones, of the window used for the weighting.
- * @return KeyOutput A struct containing the following:
+ * @param options Parameters of the analysis, see DetectKeyOptions.
+ * @return DetectKeyOutput A struct containing the following:
  *      key: Estimated key, from A to G.
  *      scale: Scale of the key (major or minor).
  *      strength: Strength of the estimated key.
  *      first_to_second_relative_strength: The relative strength difference between the best estimate and second best
  *       estimate of the key.
+ *      frames_analyzed: Number of frames that contributed to the estimate.
+ *      frames_skipped: Number of frames skipped by the energy gate.
+ *      seconds_analyzed: Position in the signal up to which frames were analyzed (end of the last analyzed frame).
+ *      analyzed_ratio: Ratio of the frames of the signal that were visited.
  */
-KeyOutput DetectKey(
+DetectKeyOutput DetectKey(const std::vector<std::vector<double>>& normalized_samples,
+                          double sample_rate,
+                          const DetectKeyOptions& options);
+
+/**
+ * @brief Overloaded function for DetectKey that takes the spectral and profile parameters positionally. The adaptive
+ * mode, frame sampling, energy gate and analysis sampling rate keep their defaults, see DetectKeyOptions.
+ *
+ * @return DetectKeyOutput See the DetectKey overload taking DetectKeyOptions.
+ */
+DetectKeyOutput DetectKey(
     const std::vector<std::vector<double>>& normalized_samples,
     double sample_rate = 44100.,
     const std::string profile_type = "Bgate",
@@ -244,5 +436,117 @@ KeyOutput DetectKey(
     unsigned int max_num_peaks = 100,
     double window_size = .5);
 
+/**
+ * @brief Variant of DetectKey that also returns the averaged HPCP, the correlation of every shift of the major, minor
+ * and majmin profiles, and the 24 key scores.
+ *
+ * The parameters are the ones of DetectKey.
+ *
+ * @return KeyAnalysis Everything DetectKey returns, plus the intermediate results.
+ */
+KeyAnalysis AnalyzeKey(const std::vector<std::vector<double>>& normalized_samples,
+                       double sample_rate = 44100.,
+                       const DetectKeyOptions& options = DetectKeyOptions());
+
+/**
+ * @brief Fills frame, of frame_size samples, with the mixdown of the signal from start_index on, see AnalyzeKeyFrames.
+ *
+ * start_index may be negative, samples outside of the signal are zeros as with CutFrame.
+ */
+using KeyFrameReader = std::function<void(int64_t start_index, std::vector<double>& frame)>;
+
+/**
+ * @brief Variant of AnalyzeKey for a signal that is not held in memory, e.g. a file that can be read at any position.
+ *
+ * Only the frames selected by the frame sampling options are read, one at a time, and the adaptive mode stops reading
+ * once the estimate has converged. The results are the ones of AnalyzeKey on the whole signal.
+ *
+ * @param read_frame Gives the frame that starts at a sample index.
+ * @param num_samples Number of samples of the signal.
+ * @param sample_rate Sampling rate of the frames \[Hz\]. options.analysis_sample_rate is not used, the frames must
+ * already be at the analysis sampling rate (see AnalysisRateOptions).
+ * @param options Analysis parameters, see DetectKeyOptions.
+ * @return KeyAnalysis See AnalyzeKey.
+ */
+KeyAnalysis AnalyzeKeyFrames(const KeyFrameReader& read_frame,
+                             int64_t num_samples,
+                             double sample_rate,
+                             const DetectKeyOptions& options);
+
+/**
+ * @brief Names of all the profile types accepted by SelectKeyProfile.
+ *
+ * @return std::vector<std::string> Profile types.
+ */
+std::vector<std::string> KeyProfileTypes();
+
+/**
+ * @brief Combines the key estimates of several profiles into one.
+ *
+ * Vote types:
+ * - **majority** - Each estimate is one vote for its key and scale. Equal vote counts are decided by the summed
+ *      strength.
+ * - **weighted** - Each estimate votes with its strength (negative strengths count as 0).
+ *
+ * @param key_outputs Key estimates to vote on.
+ * @param vote_type Either "majority" or "weighted".
+ * @return KeyOutput A struct containing the following:
+ *      key: Winning key.
+ *      scale: Winning scale.
+ *      strength: Mean strength of the estimates that voted for the winner.
+ *      first_to_second_relative_strength: Relative difference of votes between the winner and the runner-up.
+ */
+KeyOutput VoteKey(const std::vector<KeyOutput>& key_outputs, const std::string vote_type = "majority");
+
+/**
+ * @brief Computes the key estimate of several key profiles in a single pass over the audio.
+ *
+ * The HPCP of every frame is computed and averaged once, only the correlation with the key profiles is done per
+ * profile. All the other options are the ones of DetectKey and are shared by every profile, options.profile_type is
+ * replaced by profile_types (the adaptive mode follows the estimate of the first one). A profile whose estimation
+ * fails (EstimateKey throws, as Weichai does when the best match is a minor key) is listed in dropped_profile_types
+ * and left out of the vote.
+ *
+ * @param normalized_samples Normalized samples, either stereo or mono.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param profile_types Profile types to evaluate, see SelectKeyProfile. Empty evaluates all of them (KeyProfileTypes).
+ * @param vote_type "majority", "weighted" or "none". See VoteKey.
+ * @param options Analysis parameters shared by every profile, see DetectKeyOptions.
+ * @return EnsembleKeyOutput Key estimate of each profile, and the vote.
+ */
+EnsembleKeyOutput DetectKeyEnsemble(const std::vector<std::vector<double>>& normalized_samples,
+                                    double sample_rate,
+                                    const std::vector<std::string>& profile_types,
+                                    const std::string vote_type,
+                                    const DetectKeyOptions& options);
+
+/**
+ * @brief Overloaded function for DetectKeyEnsemble that takes the analysis parameters positionally. The adaptive mode
+ * and analysis sampling rate keep their defaults, see DetectKeyOptions.
+ *
+ * @return EnsembleKeyOutput See the DetectKeyEnsemble overload taking DetectKeyOptions.
+ */
+EnsembleKeyOutput DetectKeyEnsemble(
+    const std::vector<std::vector<double>>& normalized_samples,
+    double sample_rate = 44100.,
+    const std::vector<std::string>& profile_types = std::vector<std::string>(),
+    const std::string vote_type = "majority",
+    const bool use_polphony = true,
+    const bool use_three_chords = true,
+    const unsigned int num_harmonics = 4,
+    const double slope = 0.6,
+    const bool use_maj_min = false,
+    const unsigned int pcp_size = 36,
+    const int frame_size = 4096,
+    const int hop_size = 512,
+    const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func = BlackmanHarris62dB,
+    unsigned int max_num_peaks = 100,
+    double window_size = .5,
+    const std::string frame_sampling = "all",
+    unsigned int frame_stride = 1,
+    unsigned int num_sampled_frames = 0,
+    unsigned int sampling_seed = 0,
+    double rms_threshold = 0.);
+
 }  // namespace core
 }  // namespace musher
@@ -0,0 +1,167 @@
+#include "src/core/key_changes.h"
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/core/key.h"
+
+namespace musher {
+namespace core {
+
+namespace {
+
+const int kNumKeys = 24;
+
+}  // namespace
+
+std::vector<KeySegment> TrackKeyChanges(const Chromagram &chromagram,
+                                        const KeyProfilePlan &plan,
+                                        const std::vector<double> &transition_costs) {
+  if (transition_costs.size() != kNumKeys * kNumKeys)
+    throw std::runtime_error("TrackKeyChanges: transition costs should be a 24 x 24 matrix");
+  if (chromagram.pcp_size != static_cast<int>(plan.pcp_size))
+    throw std::runtime_error("TrackKeyChanges: chromagram PCP size does not match the key profile plan");
+
+  const int num_rows = chromagram.num_frames;
+  if (num_rows == 0) return {};
+
+  // Scores of every key for every row, all the rows are correlated at once.
+  KeyCorrelationMatrix key_correlations =
+      CorrelateKeyProfiles(chromagram.hpcps.data(), static_cast<size_t>(num_rows), plan);
+  std::vector<double> scores(static_cast<size_t>(num_rows) * kNumKeys);
+  for (int row = 0; row < num_rows; row++) {
+    std::vector<double> key_scores = ScoreKeys(key_correlations.Row(static_cast<size_t>(row)));
+
+    for (int key = 0; key < kNumKeys; key++) {
+      // A flat PCP (e.g. silence) has no standard deviation, it gives no evidence for any key.
+      double score = key_scores[key];
+      scores[row * kNumKeys + key] = std::isfinite(score) ? score : 0.;
+    }
+  }
+
+  // Viterbi forward pass, staying in the same key wins ties.
+  std::vector<double> path_scores(scores.begin(), scores.begin() + kNumKeys);
+  std::vector<double> next_path_scores(kNumKeys);
+  std::vector<int> back_pointers(static_cast<size_t>(num_rows) * kNumKeys);
+  for (int key = 0; key < kNumKeys; key++) back_pointers[key] = key;
+
+  for (int row = 1; row < num_rows; row++) {
+    for (int to = 0; to < kNumKeys; to++) {
+      int best_from = to;
+      double best_score = path_scores[to] - transition_costs[to * kNumKeys + to];
+      for (int from = 0; from < kNumKeys; from++) {
+        double score = path_scores[from] - transition_costs[from * kNumKeys + to];
+        if (score > best_score) {
+          best_score = score;
+          best_from = from;
+        }
+      }
+      next_path_scores[to] = best_score + scores[row * kNumKeys + to];
+      back_pointers[row * kNumKeys + to] = best_from;
+    }
+    path_scores.swap(next_path_scores);
+  }
+
+  // Backtracking.
+  std::vector<int> path(static_cast<size_t>(num_rows));
+  int last_key = 0;
+  for (int key = 1; key < kNumKeys; key++) {
+    if (path_scores[key] > path_scores[last_key]) last_key = key;
+  }
+  path[num_rows - 1] = last_key;
+  for (int row = num_rows - 1; row > 0; row--) path[row - 1] = back_pointers[row * kNumKeys + path[row]];
+
+  // Merge consecutive rows of the same key.
+  const char *key_names[] = { "A", "Bb", "B", "C", "C#", "D", "Eb", "E", "F", "F#", "G", "Ab" };
+  const std::vector<double> &timestamps = chromagram.timestamps;
+  std::vector<KeySegment> key_segments;
+  int segment_start = 0;
+  for (int row = 1; row <= num_rows; row++) {
+    if (row < num_rows && path[row] == path[segment_start]) continue;
+
+    int key = path[segment_start];
+    double strength = 0.;
+    for (int i = segment_start; i < row; i++) strength += scores[i * kNumKeys + key];
+
+    KeySegment key_segment;
+    key_segment.start_time = segment_start == 0 ? 0. : (timestamps[segment_start - 1] + timestamps[segment_start]) / 2;
+    if (row < num_rows)
+      key_segment.end_time = (timestamps[row - 1] + timestamps[row]) / 2;
+    else if (num_rows > 1)
+      key_segment.end_time = timestamps[num_rows - 1] + (timestamps[num_rows - 1] - timestamps[num_rows - 2]) / 2;
+    else
+      key_segment.end_time = timestamps[0];
+    key_segment.key = key_names[key % 12];
+    key_segment.scale = key < 12 ? "major" : "minor";
+    key_segment.strength = strength / (row - segment_start);
+    key_segments.push_back(key_segment);
+
+    segment_start = row;
+  }
+  return key_segments;
+}
+
+std::vector<KeySegment> TrackKeyChanges(const Chromagram &chromagram,
+                                        const KeyProfilePlan &plan,
+                                        double transition_cost) {
+  std::vector<double> transition_costs(kNumKeys * kNumKeys, transition_cost);
+  for (int key = 0; key < kNumKeys; key++) transition_costs[key * kNumKeys + key] = 0.;
+  return TrackKeyChanges(chromagram, plan, transition_costs);
+}
+
+std::vector<KeySegment> DetectKeyChanges(const std::vector<std::vector<double>> &normalized_samples,
+                                         double sample_rate,
+                                         const DetectKeyOptions &options,
+                                         unsigned int segment_frames,
+                                         double transition_cost) {
+  std::shared_ptr<const KeyProfilePlan> plan =
+      GetKeyProfilePlan(options.profile_type, options.use_polphony, options.use_three_chords, options.num_harmonics,
+                        options.slope, options.use_maj_min, options.pcp_size);
+  Chromagram chromagram =
+      ComputeChromagram(normalized_samples, sample_rate, options.pcp_size, options.num_harmonics - 1,
+                        options.frame_size, options.hop_size, options.window_type_func, options.max_num_peaks,
+                        options.window_size, segment_frames);
+
+  std::vector<KeySegment> key_segments = TrackKeyChanges(chromagram, *plan, transition_cost);
+  if (!key_segments.empty()) key_segments.back().end_time = normalized_samples[0].size() / sample_rate;
+  return key_segments;
+}
+
+std::vector<KeySegment> DetectKeyChanges(
+    const std::vector<std::vector<double>> &normalized_samples,
+    double sample_rate,
+    const std::string profile_type,
+    const bool use_polphony,
+    const bool use_three_chords,
+    const unsigned int num_harmonics,
+    const double slope,
+    const bool use_maj_min,
+    const unsigned int pcp_size,
+    const int frame_size,
+    const int hop_size,
+    const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func,
+    unsigned int max_num_peaks,
+    double window_size,
+    unsigned int segment_frames,
+    double transition_cost) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.frame_size = frame_size;
+  options.hop_size = hop_size;
+  options.window_type_func = window_type_func;
+  options.max_num_peaks = max_num_peaks;
+  options.window_size = window_size;
+  return DetectKeyChanges(normalized_samples, sample_rate, options, segment_frames, transition_cost);
+}
+
+}  // namespace core
+}  // namespace musher
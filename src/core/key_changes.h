@@ -0,0 +1,124 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "src/core/chromagram.h"
+#include "src/core/key.h"
+#include "src/core/key_profile_plan.h"
+#include "src/core/windowing.h"
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Part of a signal that stays in the same key.
+ *
+ */
+struct KeySegment {
+  double start_time;  //!< \[Seconds\]
+  double end_time;    //!< \[Seconds\]
+  std::string key;
+  std::string scale;
+  double strength;  //!< Mean correlation of the key with the rows of the segment.
+};
+
+/**
+ * @brief Finds the most likely sequence of keys of a chromagram with the Viterbi algorithm.
+ *
+ * Every row of the chromagram is scored against the 24 keys with the cached key profiles (see ScoreKeys), then the
+ * path that maximizes the sum of the scores minus the transition costs is found in O(rows * 24 * 24). Rows are
+ * usually aggregated over a few seconds (see ComputeChromagram), since the key of a single frame is very noisy. Rows
+ * without any pitched content score 0 for every key.
+ *
+ * @param chromagram HPCPs of the segments of the signal, with a PCP size matching the plan.
+ * @param plan Key profiles to score the rows with.
+ * @param transition_costs Cost of moving from one key to another, a 24 x 24 row-major matrix indexed by
+ * [from * 24 + to]. Keys are the 12 major keys followed by the 12 minor keys, in the order A, Bb, B, C, C#, D, Eb, E,
+ * F, F#, G, Ab.
+ * @return std::vector<KeySegment> Consecutive segments of constant key. The first segment starts at 0 and the
+ * boundaries between segments lie halfway between the timestamps of the rows.
+ */
+std::vector<KeySegment> TrackKeyChanges(const Chromagram &chromagram,
+                                        const KeyProfilePlan &plan,
+                                        const std::vector<double> &transition_costs);
+
+/**
+ * @brief Overloaded function for TrackKeyChanges with the same cost for every key change.
+ *
+ * @param chromagram HPCPs of the segments of the signal, with a PCP size matching the plan.
+ * @param plan Key profiles to score the rows with.
+ * @param transition_cost Cost of any key change. Higher values give fewer, longer segments (0 picks the best key of
+ * every row independently).
+ * @return std::vector<KeySegment> Consecutive segments of constant key.
+ */
+std::vector<KeySegment> TrackKeyChanges(const Chromagram &chromagram,
+                                        const KeyProfilePlan &plan,
+                                        double transition_cost = 1.);
+
+/**
+ * @brief Detects the keys of a signal that modulates, along with when they change.
+ *
+ * The chromagram is computed with the same analysis as DetectKey, and every segment_frames frames are averaged into
+ * one row before tracking the key changes with TrackKeyChanges. The key profile and spectral options apply, every
+ * frame is part of the chromagram so the adaptive mode, frame sampling, energy gate and analysis sampling rate do not.
+ *
+ * @param normalized_samples Normalized samples, either stereo or mono.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param options Key profile and spectral options, see DetectKeyOptions.
+ * @param segment_frames Number of frames averaged into each scored segment.
+ * @param transition_cost Cost of any key change, see TrackKeyChanges.
+ * @return std::vector<KeySegment> Consecutive segments of constant key, the last one ends at the end of the signal.
+ */
+std::vector<KeySegment> DetectKeyChanges(const std::vector<std::vector<double>> &normalized_samples,
+                                         double sample_rate,
+                                         const DetectKeyOptions &options,
+                                         unsigned int segment_frames = 128,
+                                         double transition_cost = 1.);
+
+/**
+ * @brief Overloaded function for DetectKeyChanges that takes the parameters positionally.
+ *
+ * @param normalized_samples Normalized samples, either stereo or mono.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param profile_type The type of polyphic profile to use for correlation calculation.
+ * @param use_polphony Enables the use of polyphonic profiles to define key profiles (this includes the contributions
+ * from triads as well as pitch harmonics).
+ * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic
+ * profiles.
+ * @param num_harmonics Number of harmonics that should contribute to the polyphonic profile (1 only considers the
+ * fundamental harmonic).
+ * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+ * @param use_maj_min Use a third profile called 'majmin' for ambiguous tracks [4]. Only available for the edma,
+ * bgate and braw profiles.
+ * @param pcp_size Number of array elements used to represent a semitone times 12.
+ * @param frame_size Output frame size.
+ * @param hop_size Hop size between frames.
+ * @param window_type_func The window type function. Examples: BlackmanHarris92dB, BlackmanHarris62dB...
+ * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
+ * @param window_size Size, in semitones, of the window used for the weighting.
+ * @param segment_frames Number of frames averaged into each scored segment.
+ * @param transition_cost Cost of any key change, see TrackKeyChanges.
+ * @return std::vector<KeySegment> Consecutive segments of constant key, the last one ends at the end of the signal.
+ */
+std::vector<KeySegment> DetectKeyChanges(
+    const std::vector<std::vector<double>> &normalized_samples,
+    double sample_rate = 44100.,
+    const std::string profile_type = "Bgate",
+    const bool use_polphony = true,
+    const bool use_three_chords = true,
+    const unsigned int num_harmonics = 4,
+    const double slope = 0.6,
+    const bool use_maj_min = false,
+    const unsigned int pcp_size = 36,
+    const int frame_size = 4096,
+    const int hop_size = 512,
+    const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func = BlackmanHarris62dB,
+    unsigned int max_num_peaks = 100,
+    double window_size = .5,
+    unsigned int segment_frames = 128,
+    double transition_cost = 1.);
+
+}  // namespace core
+}  // namespace musher
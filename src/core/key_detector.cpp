@@ -0,0 +1,255 @@
+#include "src/core/key_detector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/backend.h"
+#include "src/core/framecutter.h"
+#include "src/core/pipeline_stats.h"
+#include "src/core/reference_backend.h"
+#include "src/core/simd_kernels.h"
+#include "src/core/spectral_peaks.h"
+#include "src/core/trace_events.h"
+#include "src/core/utils.h"
+
+namespace musher {
+namespace core {
+
+KeyDetector::KeyDetector(double sample_rate,
+                         const std::string profile_type,
+                         const bool use_polphony,
+                         const bool use_three_chords,
+                         const unsigned int num_harmonics,
+                         const double slope,
+                         const bool use_maj_min,
+                         const unsigned int pcp_size,
+                         const int frame_size,
+                         const int hop_size,
+                         const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func,
+                         unsigned int max_num_peaks,
+                         double window_size,
+                         double rms_threshold)
+    : sample_rate_(sample_rate),
+      frame_size_(frame_size),
+      hop_size_(hop_size),
+      num_harmonics_(num_harmonics),
+      max_num_peaks_(max_num_peaks),
+      window_size_(window_size),
+      rms_threshold_(rms_threshold),
+      key_profile_plan_(GetKeyProfilePlan(profile_type, use_polphony, use_three_chords, num_harmonics, slope,
+                                          use_maj_min, pcp_size)),
+      spectrum_plan_(frame_size > 1 ? static_cast<size_t>(frame_size) : 2),
+      hpcp_plan_(pcp_size, 440.0, num_harmonics - 1, true, 500.0, 40.0, 5000.0, "squared cosine", window_size) {
+  if (frame_size_ <= 1) throw std::runtime_error("KeyDetector: frame size should be larger than 1");
+  if (hop_size_ <= 0) throw std::runtime_error("KeyDetector: hop size should be larger than 0");
+
+  // Same window as Windowing with normalization.
+  window_ = Normalize(window_type_func(std::vector<double>(static_cast<size_t>(frame_size_))));
+  if (window_.size() != static_cast<size_t>(frame_size_))
+    throw std::runtime_error("KeyDetector: the window function gives an empty window");
+
+  frame_.resize(static_cast<size_t>(frame_size_));
+  windowed_frame_.resize(static_cast<size_t>(frame_size_));
+  spectrum_.resize(spectrum_plan_.SpectrumSize());
+  // A spectrum can not have more peaks than bins.
+  spectral_peaks_.reserve(spectrum_plan_.SpectrumSize());
+  hpcp_.resize(pcp_size);
+
+  Reset();
+}
+
+KeyDetector::KeyDetector(double sample_rate, const DetectKeyOptions &options)
+    : KeyDetector(sample_rate, options.profile_type, options.use_polphony, options.use_three_chords,
+                  options.num_harmonics, options.slope, options.use_maj_min, options.pcp_size, options.frame_size,
+                  options.hop_size, options.window_type_func, options.max_num_peaks, options.window_size,
+                  options.rms_threshold) {}
+
+void KeyDetector::Reset() {
+  count_ = 0;
+  skipped_count_ = 0;
+  sums_.assign(key_profile_plan_->pcp_size, 0.);
+
+  stable_key_.clear();
+  stable_scale_.clear();
+  stable_relative_strength_ = 0.;
+  stable_since_ = 0;
+}
+
+void KeyDetector::RecordWorkBufferBytes() const {
+  RecordPeakBytes(&PipelineStats::peak_frame_bytes, VectorBytes(frame_));
+  RecordPeakBytes(&PipelineStats::peak_spectrum_bytes, VectorBytes(windowed_frame_) + VectorBytes(spectrum_) +
+                                                           VectorBytes(spectral_peaks_) + VectorBytes(hpcp_));
+}
+
+void KeyDetector::AddFrame(const std::vector<double> &frame) {
+  if (frame.size() != static_cast<size_t>(frame_size_))
+    throw std::runtime_error("KeyDetector: frame size does not match the detector");
+
+  // Silent frames would only add a near-zero HPCP, skip them before the expensive spectral analysis.
+  if (rms_threshold_ > 0. && RootMeanSquare(frame) < rms_threshold_) {
+    skipped_count_ += 1;
+    CountStat(&PipelineStats::frames_skipped, 1);
+    return;
+  }
+  CountStat(&PipelineStats::frames_processed, 1);
+
+  // The other backends allocate, only the optimized one analyzes the frames without allocating.
+  Backend backend = ActiveBackend();
+  if (backend == Backend::kReference) {
+    hpcp_ = reference::AnalyzeFrame(frame, window_, sample_rate_, key_profile_plan_->pcp_size, num_harmonics_ - 1,
+                                    max_num_peaks_, window_size_)
+                .hpcp;
+  } else {
+    // Same stages as FrameHPCP, each one writing to its work buffer.
+    ApplyWindow(frame, window_, windowed_frame_);
+    spectrum_plan_.Compute(windowed_frame_, spectrum_);
+    SpectralPeaks(spectrum_, spectral_peaks_, -1000.0, "height", max_num_peaks_, sample_rate_, 0,
+                  static_cast<int>(sample_rate_ / 2));
+    hpcp_plan_.Compute(spectral_peaks_, hpcp_);
+
+    if (backend == Backend::kCrossCheck)
+      RecordFrameDeviations(FrameStages{windowed_frame_, spectrum_, spectral_peaks_, hpcp_},
+                            reference::AnalyzeFrame(frame, window_, sample_rate_, key_profile_plan_->pcp_size,
+                                                    num_harmonics_ - 1, max_num_peaks_, window_size_));
+  }
+
+  AddHPCP(hpcp_);
+}
+
+void KeyDetector::AddHPCP(const std::vector<double> &hpcp) {
+  if (hpcp.size() != sums_.size()) throw std::runtime_error("KeyDetector: HPCP size does not match the PCP size");
+
+  AccumulateScaled(hpcp.data(), 1., sums_.size(), sums_.data());
+  count_ += 1;
+}
+
+void KeyDetector::AddFrameAt(const std::vector<std::vector<double>> &normalized_samples, int64_t start_index) {
+  if (normalized_samples.empty() || normalized_samples.size() > 2)
+    throw std::runtime_error("KeyDetector: audio samples must be either mono or stereo");
+  int64_t num_samples = static_cast<int64_t>(normalized_samples[0].size());
+  if (normalized_samples.size() == 2 && static_cast<int64_t>(normalized_samples[1].size()) != num_samples)
+    throw std::runtime_error("KeyDetector: audio channels must be the same length");
+
+  // Same frame as CutFrame, zero-padded outside of the signal.
+  int64_t begin = std::min<int64_t>(std::max<int64_t>(start_index, 0), start_index + frame_size_);
+  int64_t end = std::max(begin, std::min<int64_t>(start_index + frame_size_, num_samples));
+  {
+    StageTimer stage_timer(&PipelineStats::frame_seconds);
+    std::fill(frame_.begin(), frame_.begin() + (begin - start_index), 0.);
+    std::fill(frame_.begin() + (end - start_index), frame_.end(), 0.);
+  }
+  {
+    // Same mixdown as MonoMixer, of the samples of this frame only.
+    StageTimer stage_timer(&PipelineStats::mix_seconds);
+    const std::vector<double> &channel_one = normalized_samples[0];
+    if (normalized_samples.size() == 1) {
+      std::copy(channel_one.begin() + begin, channel_one.begin() + end, frame_.begin() + (begin - start_index));
+    } else {
+      const std::vector<double> &channel_two = normalized_samples[1];
+      for (int64_t i = begin; i < end; i++) frame_[i - start_index] = 0.5 * (channel_one[i] + channel_two[i]);
+    }
+  }
+  RecordWorkBufferBytes();
+
+  AddFrame(frame_);
+}
+
+DetectKeyOutput KeyDetector::Detect(const std::vector<std::vector<double>> &normalized_samples) {
+  if (normalized_samples.empty() || normalized_samples.size() > 2)
+    throw std::runtime_error("KeyDetector: audio samples must be either mono or stereo");
+  Reset();
+  const PipelineStats start_stats = BeginCallStats();
+
+  // Same mixdown as MonoMixer.
+  size_t num_samples = normalized_samples[0].size();
+  {
+    StageTimer stage_timer(&PipelineStats::mix_seconds);
+    mono_.resize(num_samples);
+    if (normalized_samples.size() == 1) {
+      std::copy(normalized_samples[0].begin(), normalized_samples[0].end(), mono_.begin());
+    } else {
+      if (normalized_samples[1].size() != num_samples)
+        throw std::runtime_error("KeyDetector: audio channels must be the same length");
+      for (size_t i = 0; i < num_samples; i++)
+        mono_[i] = 0.5 * (normalized_samples[0][i] + normalized_samples[1][i]);
+    }
+  }
+  RecordPeakBytes(&PipelineStats::peak_mono_bytes, VectorBytes(mono_));
+  RecordWorkBufferBytes();
+
+  int num_frames = CountFrames(num_samples, frame_size_, hop_size_);
+  for (int chunk_begin = 0; chunk_begin < num_frames; chunk_begin += kTraceChunkFrames) {
+    int chunk_end = std::min(chunk_begin + kTraceChunkFrames, num_frames);
+    TraceSpan trace_span("AnalyzeFrames", "dsp");
+    trace_span.SetArg("first_frame", chunk_begin);
+    trace_span.SetArg("num_frames", chunk_end - chunk_begin);
+
+    for (int frame_index = chunk_begin; frame_index < chunk_end; frame_index++) {
+      {
+        // Same frame as CutFrame, zero-padded outside of the signal.
+        StageTimer stage_timer(&PipelineStats::frame_seconds);
+        int64_t start_index = FrameStartIndex(frame_index, frame_size_, hop_size_);
+        int64_t begin = std::max<int64_t>(start_index, 0);
+        int64_t end = std::min<int64_t>(start_index + frame_size_, static_cast<int64_t>(num_samples));
+        std::fill(frame_.begin(), frame_.end(), 0.);
+        if (begin < end)
+          std::copy(mono_.begin() + begin, mono_.begin() + end, frame_.begin() + (begin - start_index));
+      }
+
+      AddFrame(frame_);
+    }
+  }
+
+  if (count_ == 0) throw std::runtime_error("DetectKey: no frames have been analyzed");
+
+  DetectKeyOutput detect_key_output;
+  static_cast<KeyOutput &>(detect_key_output) = Estimate();
+
+  // End of the last frame.
+  int64_t analyzed_end = FrameStartIndex(num_frames - 1, frame_size_, hop_size_) + frame_size_;
+  analyzed_end = std::max<int64_t>(0, std::min<int64_t>(analyzed_end, static_cast<int64_t>(num_samples)));
+
+  detect_key_output.frames_analyzed = count_;
+  detect_key_output.frames_skipped = skipped_count_;
+  detect_key_output.seconds_analyzed = static_cast<double>(analyzed_end) / sample_rate_;
+  detect_key_output.analyzed_ratio = 1.;
+  detect_key_output.stats = EndCallStats(start_stats);
+  return detect_key_output;
+}
+
+bool KeyDetector::HasConverged(unsigned int convergence_frames, double tolerance) {
+  if (count_ == 0) return false;
+
+  KeyOutput key_output = Estimate();
+  bool stable = key_output.key == stable_key_ && key_output.scale == stable_scale_ &&
+                std::abs(key_output.first_to_second_relative_strength - stable_relative_strength_) <= tolerance;
+
+  if (!stable) {
+    stable_key_ = key_output.key;
+    stable_scale_ = key_output.scale;
+    stable_relative_strength_ = key_output.first_to_second_relative_strength;
+    stable_since_ = count_;
+  }
+  return count_ - stable_since_ >= static_cast<int>(convergence_frames);
+}
+
+std::vector<double> KeyDetector::AverageHPCP() const {
+  std::vector<double> avgs(sums_.size());
+  for (size_t i = 0; i < sums_.size(); i++) avgs[i] = sums_[i] / count_;
+  return avgs;
+}
+
+KeyOutput KeyDetector::Estimate() const {
+  if (count_ == 0) throw std::runtime_error("KeyDetector: no frames have been analyzed yet");
+
+  TraceSpan trace_span("EstimateKey", "dsp");
+  return EstimateKey(AverageHPCP(), *key_profile_plan_);
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/hpcp.h"
+#include "src/core/key.h"
+#include "src/core/key_profile_plan.h"
+#include "src/core/spectrum.h"
+#include "src/core/windowing.h"
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Reusable key detection context that owns every table and work buffer of the analysis.
+ *
+ * The window, FFT plan, HPCP plan, key profiles and the buffers of every stage are set up once in the constructor.
+ * Analyzing a frame then does not allocate any memory (with the default optimized Backend), and the same detector can
+ * be used for any number of signals.
+ * The results are the same as DetectKey with the same parameters.
+ *
+ * @code
+ *   KeyDetector key_detector(sample_rate, "Temperley");
+ *
+ *   for (const auto &normalized_samples : signals) {
+ *       DetectKeyOutput key_output = key_detector.Detect(normalized_samples);
+ *   }
+ * @endcode
+ */
+class KeyDetector {
+ private:
+  const double sample_rate_;
+  const int frame_size_;
+  const int hop_size_;
+  const unsigned int num_harmonics_;
+  const unsigned int max_num_peaks_;
+  const double window_size_;
+  const double rms_threshold_;
+  const std::shared_ptr<const KeyProfilePlan> key_profile_plan_;
+
+  std::vector<double> window_;
+  SpectrumPlan spectrum_plan_;
+  HPCPPlan hpcp_plan_;
+
+  // Work buffers, reused by every frame.
+  std::vector<double> mono_;
+  std::vector<double> frame_;
+  std::vector<double> windowed_frame_;
+  std::vector<double> spectrum_;
+  std::vector<std::tuple<double, double>> spectral_peaks_;
+  std::vector<double> hpcp_;
+
+  std::vector<double> sums_;
+  int count_;
+  int skipped_count_;
+
+  // Convergence state. The estimate is considered stable since frame stable_since_.
+  std::string stable_key_;
+  std::string stable_scale_;
+  double stable_relative_strength_;
+  int stable_since_;
+
+  void RecordWorkBufferBytes() const;
+
+ public:
+  /**
+   * @brief Construct a new KeyDetector object
+   *
+   * @param sample_rate Sampling rate of the audio signal \[Hz\].
+   * @param profile_type The type of polyphic profile to use for correlation calculation.
+   * @param use_polphony Enables the use of polyphonic profiles to define key profiles (this includes the contributions
+   * from triads as well as pitch harmonics).
+   * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic
+   * profiles.
+   * @param num_harmonics Number of harmonics that should contribute to the polyphonic profile (1 only considers the
+   * fundamental harmonic).
+   * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+   * @param use_maj_min Use a third profile called 'majmin' for ambiguous tracks [4]. Only available for the edma,
+   * bgate and braw profiles.
+   * @param pcp_size Number of array elements used to represent a semitone times 12.
+   * @param frame_size Output frame size.
+   * @param hop_size Hop size between frames.
+   * @param window_type_func The window type function. Examples: BlackmanHarris92dB, BlackmanHarris62dB...
+   * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
+   * @param window_size Size, in semitones, of the window used for the weighting.
+   * @param rms_threshold Frames whose root mean square is below this value are skipped before any spectral analysis
+   * (0 keeps every frame).
+   */
+  KeyDetector(double sample_rate = 44100.,
+              const std::string profile_type = "Bgate",
+              const bool use_polphony = true,
+              const bool use_three_chords = true,
+              const unsigned int num_harmonics = 4,
+              const double slope = 0.6,
+              const bool use_maj_min = false,
+              const unsigned int pcp_size = 36,
+              const int frame_size = 4096,
+              const int hop_size = 512,
+              const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func =
+                  BlackmanHarris62dB,
+              unsigned int max_num_peaks = 100,
+              double window_size = .5,
+              double rms_threshold = 0.);
+
+  /**
+   * @brief Construct a new KeyDetector object with the key profile, spectral and energy gate options of DetectKey.
+   *
+   * The adaptive mode, frame sampling and analysis sampling rate are up to the caller, see AnalyzeKey.
+   *
+   * @param sample_rate Sampling rate of the analyzed frames \[Hz\].
+   * @param options Analysis parameters, see DetectKeyOptions.
+   */
+  KeyDetector(double sample_rate, const DetectKeyOptions &options);
+
+  ~KeyDetector() {}
+
+  /**
+   * @brief Detects the key of a whole signal, see DetectKey.
+   *
+   * The accumulator is reset first. Only the mono mixdown buffer may grow, when the signal is longer than every
+   * signal analyzed before.
+   *
+   * @param normalized_samples Normalized samples, either stereo or mono.
+   * @return DetectKeyOutput Key estimate of the signal.
+   */
+  DetectKeyOutput Detect(const std::vector<std::vector<double>> &normalized_samples);
+
+  /**
+   * @brief Analyze a single frame and add its HPCP to the accumulator, without allocating.
+   *
+   * Frames that are quieter than rms_threshold are only counted as skipped.
+   *
+   * @param frame Audio frame of frame_size samples.
+   */
+  void AddFrame(const std::vector<double> &frame);
+
+  /**
+   * @brief Add an already computed HPCP to the accumulator.
+   *
+   * @param hpcp Harmonic pitch class profile of size pcp_size.
+   */
+  void AddHPCP(const std::vector<double> &hpcp);
+
+  /**
+   * @brief Cut the frame that starts at start_index from every channel, mix it down and analyze it like AddFrame,
+   * without allocating.
+   *
+   * Only the frame_size samples of the frame are read, so a few frames of a long signal can be analyzed without
+   * mixing down the whole signal. Samples outside of the signal are zeros, as with CutFrame.
+   *
+   * @param normalized_samples Normalized samples, either stereo or mono.
+   * @param start_index Position of the first sample of the frame in the signal, may be negative. See FrameStartIndex.
+   */
+  void AddFrameAt(const std::vector<std::vector<double>> &normalized_samples, int64_t start_index);
+
+  /**
+   * @brief Computes the key estimate of every frame accumulated since the last Reset.
+   *
+   * @return KeyOutput Current key estimate. See EstimateKey.
+   */
+  KeyOutput Estimate() const;
+
+  /**
+   * @brief Re-estimates the key and checks whether the estimate has stopped changing.
+   *
+   * The estimate is stable while the winning key and scale stay the same and first_to_second_relative_strength does
+   * not move further than the tolerance from the value it had when it became stable. This should be called
+   * periodically while frames are being added (e.g. every few dozen frames), the span is measured in frames.
+   *
+   * @param convergence_frames Number of frames the estimate must have been stable for.
+   * @param tolerance Maximum allowed change of first_to_second_relative_strength.
+   * @return true If the estimate has been stable for at least convergence_frames frames.
+   * @return false Otherwise, or if no frames have been analyzed yet.
+   */
+  bool HasConverged(unsigned int convergence_frames, double tolerance = 0.05);
+
+  /**
+   * @brief Average of all the HPCPs accumulated so far.
+   *
+   * @return std::vector<double> Averaged harmonic pitch class profile.
+   */
+  std::vector<double> AverageHPCP() const;
+
+  /**
+   * @brief Number of frames accumulated so far.
+   *
+   * @return int Frame count.
+   */
+  int FrameCount() const { return count_; }
+
+  /**
+   * @brief Number of frames skipped so far because they were below rms_threshold.
+   *
+   * @return int Skipped frame count.
+   */
+  int SkippedFrameCount() const { return skipped_count_; }
+
+  /**
+   * @brief Clear the accumulator and the convergence state, the tables and work buffers are kept.
+   */
+  void Reset();
+};
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,294 @@
+#include "src/core/key_files.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/core/audio_decoders.h"
+#include "src/core/framecutter.h"
+#include "src/core/key_detector.h"
+#include "src/core/key_tracker.h"
+#include "src/core/pipeline_stats.h"
+#include "src/core/resampler.h"
+#include "src/core/trace_events.h"
+#include "src/core/utils.h"
+
+namespace musher {
+namespace core {
+
+namespace {
+
+// Above this many samples per channel, larger blocks barely reduce the overhead of the callbacks.
+const size_t kMaxStreamingBlockSize = 1 << 20;
+// One frame of the default KeyTracker, smaller blocks would not save memory.
+const size_t kMinStreamingBlockSize = 4096;
+// The window of StreamMp3, the frame and the spectra of the analysis.
+const int64_t kStreamingOverheadBytes = 1 << 19;
+
+int64_t FileSize(const std::string& file_path) {
+  std::ifstream audio_file(file_path, std::ios::binary | std::ios::ate);
+  if (!audio_file) throw std::runtime_error("Failed to load file '" + file_path + "'");
+  return static_cast<int64_t>(audio_file.tellg());
+}
+
+/**
+ * @brief Peak memory of decoding a whole file and analyzing it with DetectKey.
+ *
+ * The decoders hold the file data together with the interleaved and the deinterleaved samples (see
+ * PipelineStats::peak_decoded_bytes), the frames of the analysis are small next to them.
+ */
+int64_t FullDecodingBytes(const std::string& file_path, const AudioDecoded& audio_info) {
+  int64_t values = static_cast<int64_t>(audio_info.samples_per_channel) * 2 * audio_info.channels;
+  return FileSize(file_path) + values * static_cast<int64_t>(sizeof(double));
+}
+
+/**
+ * @brief Samples per channel of the streamed blocks that keep the memory under the budget.
+ *
+ * @param bytes_per_sample Bytes held per sample of a block, across the buffers of the decoder and the KeyTracker.
+ */
+size_t StreamingBlockSize(int64_t max_memory_bytes, int64_t bytes_per_sample) {
+  int64_t block_size = std::max<int64_t>((max_memory_bytes - kStreamingOverheadBytes) / bytes_per_sample, 0);
+  return std::min(kMaxStreamingBlockSize, std::max(kMinStreamingBlockSize, static_cast<size_t>(block_size)));
+}
+
+DetectKeyOutput StreamKeyFile(const std::string& file_path, const DetectKeyOptions& options) {
+  // Each sample of a block is held as doubles by the decoder, the mixdown and the pending samples of the KeyTracker,
+  // plus the pending and resampled samples of its resampler.
+  const int64_t tracker_buffers = options.analysis_sample_rate > 0. ? 4 : 2;
+  auto bytes_per_sample = [tracker_buffers](const AudioDecoded& audio_info, int64_t raw_bytes) {
+    return raw_bytes + (audio_info.channels + tracker_buffers) * static_cast<int64_t>(sizeof(double));
+  };
+
+  std::unique_ptr<KeyTracker> key_tracker;
+  AudioBlockCallback add_block = [&key_tracker](const std::vector<std::vector<double>>& block) {
+    key_tracker->AddSamples(block);
+  };
+  int64_t samples_per_channel;
+  double sample_rate;
+  if (HasFileExtension(file_path, ".wav")) {
+    WavDecoded wav_info = ReadWavInfo(file_path);
+    sample_rate = static_cast<double>(wav_info.sample_rate);
+    key_tracker.reset(new KeyTracker(sample_rate, options, wav_info.samples_per_channel));
+    // The wav samples are also read as raw bytes.
+    size_t block_size = StreamingBlockSize(options.max_memory_bytes,
+                                           bytes_per_sample(wav_info, wav_info.channels * wav_info.bit_depth / 8));
+    samples_per_channel = StreamWav(file_path, block_size, add_block).samples_per_channel;
+  } else {
+    Mp3Decoded mp3_info = ReadMp3Info(file_path);
+    sample_rate = static_cast<double>(mp3_info.sample_rate);
+    size_t block_size = StreamingBlockSize(options.max_memory_bytes, bytes_per_sample(mp3_info, 0));
+    // The frames are sampled from the length of the signal, which ReadMp3Info only estimates. Only decoding the whole
+    // file gives it exactly.
+    int64_t num_samples = -1;
+    if (options.frame_sampling != "all") {
+      num_samples = StreamMp3(file_path, block_size, [](const std::vector<std::vector<double>>&) {})
+                        .samples_per_channel;
+    }
+    key_tracker.reset(new KeyTracker(sample_rate, options, num_samples));
+    samples_per_channel = StreamMp3(file_path, block_size, add_block).samples_per_channel;
+  }
+  key_tracker->Flush();
+
+  if (key_tracker->FrameCount() == 0 && key_tracker->SkippedFrameCount() > 0)
+    throw std::runtime_error("DetectKey: every frame is below the RMS threshold");
+  if (key_tracker->FrameCount() == 0) throw std::runtime_error("DetectKey: no frames have been analyzed");
+
+  DetectKeyOutput key_output;
+  {
+    TraceSpan trace_span("EstimateKey", "dsp");
+    static_cast<KeyOutput&>(key_output) = key_tracker->Estimate();
+  }
+
+  // Same statistics as AnalyzeKey, of the signal at the analysis sampling rate. The sampled frames are visited in
+  // order.
+  const DetectKeyOptions analysis_options = AnalysisRateOptions(options, sample_rate);
+  double analysis_sample_rate = sample_rate;
+  int64_t num_samples = samples_per_channel;
+  if (options.analysis_sample_rate > 0. && options.analysis_sample_rate < sample_rate) {
+    analysis_sample_rate = options.analysis_sample_rate;
+    num_samples = Resampler(sample_rate, analysis_sample_rate).OutputSize(samples_per_channel);
+  }
+  int num_frames = CountFrames(static_cast<size_t>(num_samples), analysis_options.frame_size,
+                               analysis_options.hop_size);
+  std::vector<int> frame_indices = SampleFrameIndices(num_frames, options.frame_sampling, options.frame_stride,
+                                                      options.num_sampled_frames, options.sampling_seed);
+  int frames_visited = key_tracker->FrameCount() + key_tracker->SkippedFrameCount();
+  int last_frame_index = frame_indices[static_cast<size_t>(frames_visited - 1)];
+  int64_t analyzed_end = FrameStartIndex(last_frame_index, analysis_options.frame_size, analysis_options.hop_size) +
+                         analysis_options.frame_size;
+  analyzed_end = std::max<int64_t>(0, std::min<int64_t>(analyzed_end, num_samples));
+
+  key_output.frames_analyzed = key_tracker->FrameCount();
+  key_output.frames_skipped = key_tracker->SkippedFrameCount();
+  key_output.seconds_analyzed = static_cast<double>(analyzed_end) / analysis_sample_rate;
+  key_output.analyzed_ratio = static_cast<double>(frames_visited) / num_frames;
+  return key_output;
+}
+
+/**
+ * @brief Mixdown of a block of mono or stereo samples, same as MonoMixer.
+ */
+void MixBlock(const std::vector<std::vector<double>>& block, double* mono) {
+  if (block.size() == 1) {
+    std::copy(block[0].begin(), block[0].end(), mono);
+  } else {
+    for (size_t i = 0; i < block[0].size(); i++) mono[i] = 0.5 * (block[0][i] + block[1][i]);
+  }
+}
+
+/**
+ * @brief DetectKey of a wav file that only reads the frames selected by the frame sampling options.
+ *
+ * The frames are read one at a time with a WavReader, so neither the memory nor the decoding grow with the length of
+ * the file. With an analysis sampling rate, each frame is resampled from the input samples it depends on, which gives
+ * the samples of resampling the whole signal.
+ */
+DetectKeyOutput DetectSampledWavKey(const std::string& file_path, const DetectKeyOptions& options) {
+  WavReader wav_reader(file_path);
+  const WavDecoded& wav_info = wav_reader.Info();
+  if (wav_info.channels < 1 || wav_info.channels > 2)
+    throw std::runtime_error("Audio samples must be either mono or stereo.");
+  const double sample_rate = static_cast<double>(wav_info.sample_rate);
+  const int64_t num_samples = static_cast<int64_t>(wav_info.samples_per_channel);
+
+  std::vector<std::vector<double>> block;
+  if (!(options.analysis_sample_rate > 0. && options.analysis_sample_rate < sample_rate)) {
+    KeyFrameReader read_frame = [&wav_reader, &block](int64_t start_index, std::vector<double>& frame) {
+      wav_reader.Read(start_index, frame.size(), block);
+      MixBlock(block, frame.data());
+    };
+    return AnalyzeKeyFrames(read_frame, num_samples, sample_rate, options);
+  }
+
+  const Resampler resampler(sample_rate, options.analysis_sample_rate);
+  const int64_t num_outputs = resampler.OutputSize(num_samples);
+  std::vector<double> mono;
+  KeyFrameReader read_frame = [&](int64_t start_index, std::vector<double>& frame) {
+    std::fill(frame.begin(), frame.end(), 0.);
+    int64_t first_output = std::max<int64_t>(start_index, 0);
+    int64_t end_output = std::min<int64_t>(start_index + static_cast<int64_t>(frame.size()), num_outputs);
+    if (first_output >= end_output) return;
+
+    int64_t first_input = std::max<int64_t>(resampler.FirstInput(first_output), 0);
+    int64_t end_input = std::min<int64_t>(resampler.LastInput(end_output - 1) + 1, num_samples);
+    wav_reader.Read(first_input, static_cast<size_t>(std::max<int64_t>(end_input - first_input, 0)), block);
+    mono.resize(block[0].size());
+    MixBlock(block, mono.data());
+    size_t num_outputs_read = static_cast<size_t>(end_output - first_output);
+    resampler.ResampleRange(mono.data(), first_input, num_samples, first_output, num_outputs_read,
+                            frame.data() + (first_output - start_index));
+  };
+  return AnalyzeKeyFrames(read_frame, num_outputs, options.analysis_sample_rate,
+                          AnalysisRateOptions(options, sample_rate));
+}
+
+/**
+ * @brief Whether KeyDetector::Detect alone gives the result of DetectKey with these options.
+ */
+bool AnalyzesEveryFrame(const DetectKeyOptions& options, double sample_rate) {
+  return options.convergence_frames == 0 && options.frame_sampling == "all" &&
+         !(options.analysis_sample_rate > 0. && options.analysis_sample_rate < sample_rate);
+}
+
+}  // namespace
+
+DetectKeyOutput DetectKeyFile(const std::string& file_path, const DetectKeyOptions& options) {
+  const PipelineStats start_stats = BeginCallStats();
+  bool wav = HasFileExtension(file_path, ".wav");
+  if (!wav && !HasFileExtension(file_path, ".mp3")) throw std::runtime_error("Only .wav and .mp3 files are supported.");
+
+  DetectKeyOutput key_output;
+  if (wav && options.frame_sampling != "all") {
+    key_output = DetectSampledWavKey(file_path, options);
+    key_output.stats = EndCallStats(start_stats);
+    return key_output;
+  }
+
+  if (options.max_memory_bytes > 0) {
+    AudioDecoded audio_info = wav ? static_cast<AudioDecoded>(ReadWavInfo(file_path))
+                                  : static_cast<AudioDecoded>(ReadMp3Info(file_path));
+    if (FullDecodingBytes(file_path, audio_info) > options.max_memory_bytes) {
+      key_output = StreamKeyFile(file_path, options);
+      key_output.stats = EndCallStats(start_stats);
+      return key_output;
+    }
+  }
+
+  AudioDecoded audio_decoded = DecodeAudioFile(file_path);
+  double sample_rate = static_cast<double>(audio_decoded.sample_rate);
+  key_output = DetectKey(audio_decoded.normalized_samples, sample_rate, options);
+  key_output.stats = EndCallStats(start_stats);
+  return key_output;
+}
+
+DetectKeyOutput DetectKeyFile(const std::string& file_path, const std::string profile_type, int64_t max_memory_bytes) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.max_memory_bytes = max_memory_bytes;
+  return DetectKeyFile(file_path, options);
+}
+
+std::vector<DetectKeyOutput> DetectKeyFiles(const std::vector<std::string>& file_paths,
+                                            const DetectKeyOptions& options,
+                                            int num_threads) {
+  if (num_threads <= 0) num_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  num_threads = std::max(1, std::min(num_threads, static_cast<int>(file_paths.size())));
+
+  std::vector<DetectKeyOutput> key_outputs(file_paths.size());
+  // Rebuilt only when the sample rate changes, the files of a directory usually share one.
+  std::vector<std::unique_ptr<KeyDetector>> key_detectors(static_cast<size_t>(num_threads));
+  std::vector<double> detector_sample_rates(static_cast<size_t>(num_threads), 0.);
+
+  auto detect_file = [&](size_t file_index, int thread) {
+    const std::string& file_path = file_paths[file_index];
+    TraceSpan trace_span("DetectKeyFile", "file");
+    trace_span.SetArg("file_path", file_path);
+    try {
+      if (options.max_memory_bytes > 0 || (options.frame_sampling != "all" && HasFileExtension(file_path, ".wav"))) {
+        key_outputs[file_index] = DetectKeyFile(file_path, options);
+        return;
+      }
+
+      // The stats of each file include its decoding.
+      const PipelineStats start_stats = BeginCallStats();
+      AudioDecoded audio_decoded = DecodeAudioFile(file_path);
+      double sample_rate = static_cast<double>(audio_decoded.sample_rate);
+      if (AnalyzesEveryFrame(options, sample_rate)) {
+        std::unique_ptr<KeyDetector>& key_detector = key_detectors[static_cast<size_t>(thread)];
+        if (!key_detector || sample_rate != detector_sample_rates[static_cast<size_t>(thread)]) {
+          key_detector.reset(new KeyDetector(sample_rate, options));
+          detector_sample_rates[static_cast<size_t>(thread)] = sample_rate;
+        }
+        key_outputs[file_index] = key_detector->Detect(audio_decoded.normalized_samples);
+      } else {
+        key_outputs[file_index] = DetectKey(audio_decoded.normalized_samples, sample_rate, options);
+      }
+      key_outputs[file_index].stats = EndCallStats(start_stats);
+    } catch (const std::exception& e) {
+      throw std::runtime_error("DetectKeyFiles: '" + file_path + "': " + std::string(e.what()));
+    }
+  };
+  ParallelFor(file_paths.size(), num_threads, detect_file, "WaitForFile");
+
+  return key_outputs;
+}
+
+std::vector<DetectKeyOutput> DetectKeyFiles(const std::vector<std::string>& file_paths,
+                                            const std::string profile_type,
+                                            int num_threads,
+                                            int64_t max_memory_bytes) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.max_memory_bytes = max_memory_bytes;
+  return DetectKeyFiles(file_paths, options, num_threads);
+}
+
+}  // namespace core
+}  // namespace musher
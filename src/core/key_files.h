@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/core/key.h"
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Detects the key of an audio file while keeping the memory of the analysis under a budget.
+ *
+ * The file is decoded fully and analyzed with DetectKey when the decoded samples fit in options.max_memory_bytes.
+ * Larger files are streamed block by block through the decoder and a KeyTracker built from the same options (see
+ * StreamWav and StreamMp3), so that only one block of samples is held at a time. Both strategies give the same key
+ * estimate as DetectKey with the same options.
+ *
+ * With frame sampling (see DetectKeyOptions::frame_sampling), a .wav file is never decoded fully: only the samples of
+ * the selected frames are read, one frame at a time with a WavReader, whatever the budget. A .mp3 file can't be read
+ * at a given sample, so it is still decoded fully; when it is streamed, it is decoded once more beforehand to count
+ * its samples, from which the frames are selected.
+ *
+ * @param file_path Path of a .wav or .mp3 file.
+ * @param options Analysis parameters and memory budget, see DetectKeyOptions.
+ * @return DetectKeyOutput Key estimate. Its stats include the decoding of the file.
+ */
+DetectKeyOutput DetectKeyFile(const std::string& file_path, const DetectKeyOptions& options);
+
+/**
+ * @brief Overloaded function for DetectKeyFile with the default analysis parameters.
+ *
+ * @param file_path Path of a .wav or .mp3 file.
+ * @param profile_type The type of polyphic profile to use for correlation calculation.
+ * @param max_memory_bytes Memory budget of the decoded samples and the analysis \[Bytes\]. 0 always decodes the
+ * whole file.
+ * @return DetectKeyOutput Key estimate. Its stats include the decoding of the file.
+ */
+DetectKeyOutput DetectKeyFile(const std::string& file_path,
+                              const std::string profile_type = "Bgate",
+                              int64_t max_memory_bytes = 0);
+
+/**
+ * @brief Detects the key of every audio file of a list with a pool of threads.
+ *
+ * Each thread takes the next file from a shared queue, decodes it and analyzes it with its own KeyDetector, so the
+ * results are the same as decoding every file and calling DetectKey with the same options. The decoding, the chunks
+ * of analyzed frames and the waits for the next file are recorded as spans when a trace is started (see StartTrace).
+ * The stats of each output include the decoding of its file (see SetStatsEnabled). With a memory budget, and for the
+ * .wav files with frame sampling, each file goes through DetectKeyFile instead.
+ *
+ * @param file_paths Paths of .wav or .mp3 files.
+ * @param options Analysis parameters and memory budget of each file, see DetectKeyFile.
+ * @param num_threads Number of threads, the calling thread included. 0 uses every hardware thread.
+ * @return std::vector<DetectKeyOutput> Key estimate of each file, in the order of file_paths.
+ */
+std::vector<DetectKeyOutput> DetectKeyFiles(const std::vector<std::string>& file_paths,
+                                            const DetectKeyOptions& options,
+                                            int num_threads = 0);
+
+/**
+ * @brief Overloaded function for DetectKeyFiles with the default analysis parameters.
+ *
+ * @param file_paths Paths of .wav or .mp3 files.
+ * @param profile_type The type of polyphic profile to use for correlation calculation.
+ * @param num_threads Number of threads, the calling thread included. 0 uses every hardware thread.
+ * @param max_memory_bytes Memory budget of each file, see DetectKeyFile. 0 always decodes the whole files.
+ * @return std::vector<DetectKeyOutput> Key estimate of each file, in the order of file_paths.
+ */
+std::vector<DetectKeyOutput> DetectKeyFiles(const std::vector<std::string>& file_paths,
+                                            const std::string profile_type = "Bgate",
+                                            int num_threads = 0,
+                                            int64_t max_memory_bytes = 0);
+
+}  // namespace core
+}  // namespace musher
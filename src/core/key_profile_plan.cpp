@@ -0,0 +1,370 @@
+#include "src/core/key_profile_plan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fplus/fplus.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/backend.h"
+#include "src/core/key.h"
+#include "src/core/key_profiles.h"
+#include "src/core/pipeline_stats.h"
+#include "src/core/reference_backend.h"
+#include "src/core/simd_kernels.h"
+
+namespace musher {
+namespace core {
+
+namespace {
+
+// Plans kept by GetKeyProfilePlan, enough for every profile type with two sets of parameters.
+const size_t kMaxCachedPlans = 32;
+// Output rows multiplied with each row of a circulant at a time, 32 rows of 120 shifts fill a 32 KiB L1 cache.
+const size_t kCirculantRowBlock = 32;
+
+std::vector<double> BuildCirculant(const std::vector<double> &profile, double mean) {
+  int size = static_cast<int>(profile.size());
+  std::vector<double> circulant(static_cast<size_t>(size) * size);
+
+  for (int i = 0; i < size; i++) {
+    for (int shift = 0; shift < size; shift++) {
+      int index = (i - shift) % size;
+      if (index < 0) index += size;
+      circulant[static_cast<size_t>(i) * size + shift] = profile[index] - mean;
+    }
+  }
+  return circulant;
+}
+
+/**
+ * @brief out = centered_pcps x circulant, with each row then divided by std_pcps[row] * std_profile.
+ *
+ * centered_pcps is num_rows x size and circulant is size x size, both in row-major order. Each row of the circulant is
+ * accumulated into a block of output rows while it is in cache, and every element is summed in increasing i.
+ */
+void MultiplyCirculant(const std::vector<double> &centered_pcps,
+                       size_t num_rows,
+                       const std::vector<double> &circulant,
+                       const std::vector<double> &std_pcps,
+                       double std_profile,
+                       std::vector<double> &out) {
+  size_t size = centered_pcps.size() / std::max<size_t>(num_rows, 1);
+  out.assign(num_rows * size, 0.);
+  double *out_data = out.data();
+
+  for (size_t row_begin = 0; row_begin < num_rows; row_begin += kCirculantRowBlock) {
+    size_t row_end = std::min(row_begin + kCirculantRowBlock, num_rows);
+    for (size_t i = 0; i < size; i++) {
+      const double *circulant_row = circulant.data() + i * size;
+      for (size_t row = row_begin; row < row_end; row++)
+        AccumulateScaled(circulant_row, centered_pcps[row * size + i], size, out_data + row * size);
+    }
+  }
+
+  for (size_t row = 0; row < num_rows; row++) {
+    double norm = std_pcps[row] * std_profile;
+    for (size_t shift = 0; shift < size; shift++) out_data[row * size + shift] /= norm;
+  }
+}
+
+void SetRow(const KeyCorrelations &row_correlations, size_t row, KeyCorrelationMatrix &key_correlations) {
+  size_t size = key_correlations.pcp_size;
+  std::copy(row_correlations.major.begin(), row_correlations.major.end(), key_correlations.major.begin() + row * size);
+  std::copy(row_correlations.minor.begin(), row_correlations.minor.end(), key_correlations.minor.begin() + row * size);
+  std::copy(row_correlations.other.begin(), row_correlations.other.end(), key_correlations.other.begin() + row * size);
+}
+
+}  // namespace
+
+std::tuple<std::vector<double>, std::vector<double>> BuildPolyphonicProfiles(const std::vector<double> &M,
+                                                                              const std::vector<double> &m,
+                                                                              const bool use_three_chords,
+                                                                              const unsigned int num_harmonics,
+                                                                              const double slope) {
+  /*
+  Assumptions:
+    - We consider that the tonal hierarchy is kept when dealing with polyphonic sounds.
+      That means that Krumhansl profiles are seen as the tonal hierarchy of
+      each of the chords of the harmonic scale within a major/minor tonal contest.
+    - We compute from these chord profiles the corresponding note (pitch class) profiles,
+      which will be compared to HPCP values.
+
+  Rationale:
+    - Each note contribute to the different harmonics.
+    - All the chords of the major/minor key are considered.
+
+  Procedure:
+    - First, profiles are initialized to 0
+    - We take _M[i], n[i] as Krumhansl profiles i=1,...12 related to each of the chords
+      of the major/minor key.
+    - For each chord, we add its contribution to the three notes (pitch classes) of the chord.
+      We use the same weight for all the notes of the chord.
+    - For each note, we add its contribution to the different harmonics
+
+    --essentia: https://github.com/MTG/essentia/blob/master/src/algorithms/tonal/key.cpp
+  */
+
+  std::vector<double> M_chords_empty(12, static_cast<double>(0.0));
+  std::vector<double> m_chords_empty(12, static_cast<double>(0.0));
+
+  // MAJOR KEY
+  std::vector<double> M_chords = fplus::fwd::apply(
+      M_chords_empty,
+      // Tonic (I)
+      [&M, &num_harmonics, &slope](auto chords) { return AddMajorTriad(chords, 0, M[0], num_harmonics, slope); },
+      // II
+      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddMinorTriad(chords, 2, M[2], num_harmonics, slope);
+        return chords;
+      },
+      // III
+      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddMinorTriad(chords, 4, M[4], num_harmonics, slope);
+        return chords;
+      },
+      // Subdominant (IV)
+      [&M, &num_harmonics, &slope](auto chords) { return AddMajorTriad(chords, 5, M[5], num_harmonics, slope); },
+      // Dominant (V)
+      [&M, &num_harmonics, &slope](auto chords) { return AddMajorTriad(chords, 7, M[7], num_harmonics, slope); },
+      // VI
+      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddMinorTriad(chords, 9, M[9], num_harmonics, slope);
+        return chords;
+      },
+      // VII (5th diminished)
+      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 11, M[11], num_harmonics, slope);
+        return chords;
+      },
+      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 2, M[11], num_harmonics, slope);
+        return chords;
+      },
+      [&M, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 5, M[11], num_harmonics, slope);
+        return chords;
+      });
+
+  // MINOR KEY
+  std::vector<double> m_chords = fplus::fwd::apply(
+      m_chords_empty,
+      // Tonica (I)
+      [&m, &num_harmonics, &slope](auto chords) { return AddMinorTriad(chords, 0, m[0], num_harmonics, slope); },
+      // II (5th diminished)
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 2, m[2], num_harmonics, slope);
+        return chords;
+      },
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 5, m[2], num_harmonics, slope);
+        return chords;
+      },
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 8, m[2], num_harmonics, slope);
+        return chords;
+      },
+      // III (5th augmented)
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 3, m[3], num_harmonics, slope);
+        return chords;
+      },
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 7, m[3], num_harmonics, slope);
+        return chords;
+      },
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 11, m[3], num_harmonics, slope);
+        return chords;
+      },
+      // Subdominant (IV)
+      [&m, &num_harmonics, &slope](auto chords) { return AddMinorTriad(chords, 5, m[5], num_harmonics, slope); },
+      // Dominant (V) (harmonic minor scale)
+      [&m, &num_harmonics, &slope](auto chords) { return AddMajorTriad(chords, 7, m[7], num_harmonics, slope); },
+      // VI
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddMajorTriad(chords, 8, m[8], num_harmonics, slope);
+        return chords;
+      },
+      // VII (diminished 5th)
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 11, m[8], num_harmonics, slope);
+        return chords;
+      },
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 2, m[8], num_harmonics, slope);
+        return chords;
+      },
+      [&m, &num_harmonics, &slope, &use_three_chords](auto chords) {
+        if (!use_three_chords) return AddContributionHarmonics(chords, 5, m[8], num_harmonics, slope);
+        return chords;
+      });
+
+  return std::tuple<std::vector<double>, std::vector<double>>{ M_chords, m_chords };
+}
+
+KeyProfilePlan BuildKeyProfilePlan(const std::string profile_type,
+                                   const bool use_polphony,
+                                   const bool use_three_chords,
+                                   const unsigned int num_harmonics,
+                                   const double slope,
+                                   const bool use_maj_min,
+                                   const unsigned int pcp_size) {
+  if (pcp_size < 12 || pcp_size % 12 != 0)
+    throw std::runtime_error("Key: input PCP size is not a positive multiple of 12");
+  if (!std::isfinite(slope)) throw std::runtime_error("Key: slope is not a finite number");
+
+  const int table_index = FindKeyProfileTable(profile_type.c_str());
+  if (table_index < 0)
+    throw std::runtime_error("SelectKeyProfile: '" + profile_type + "' is not a valid profile type.");
+  const KeyProfileTable &key_profile = kKeyProfileTables[table_index];
+
+  const std::vector<double> M(key_profile.major.begin(), key_profile.major.end());
+  const std::vector<double> m(key_profile.minor.begin(), key_profile.minor.end());
+  const std::vector<double> O(key_profile.other.begin(), key_profile.other.end());
+
+  std::vector<double> M_final;
+  std::vector<double> m_final;
+
+  if (!use_polphony) {
+    M_final = M;
+    m_final = m;
+  } else if (num_harmonics == kDefaultNumHarmonics && slope == kDefaultSlope) {
+    // Expanded at compile time, see PolyphonicMajorProfile and PolyphonicMinorProfile.
+    const PolyphonicKeyProfiles &polyphonic = kDefaultPolyphonicKeyProfiles[table_index];
+    const PitchClassProfile &M_chords = use_three_chords ? polyphonic.major_three_chords : polyphonic.major_all_chords;
+    const PitchClassProfile &m_chords = use_three_chords ? polyphonic.minor_three_chords : polyphonic.minor_all_chords;
+    M_final.assign(M_chords.begin(), M_chords.end());
+    m_final.assign(m_chords.begin(), m_chords.end());
+  } else {
+    std::tie(M_final, m_final) = BuildPolyphonicProfiles(M, m, use_three_chords, num_harmonics, slope);
+  }
+
+  KeyProfilePlan plan;
+  plan.profile_type = profile_type;
+  plan.use_polphony = use_polphony;
+  plan.use_three_chords = use_three_chords;
+  plan.num_harmonics = num_harmonics;
+  plan.slope = slope;
+  plan.use_maj_min = use_maj_min;
+  plan.pcp_size = pcp_size;
+
+  std::tie(plan.profile_major, plan.mean_major, plan.std_major) = ResizeProfileToPcpSize(pcp_size, M_final);
+  std::tie(plan.profile_minor, plan.mean_minor, plan.std_minor) = ResizeProfileToPcpSize(pcp_size, m_final);
+  std::tie(plan.profile_other, plan.mean_other, plan.std_other) = ResizeProfileToPcpSize(pcp_size, O);
+
+  plan.circulant_major = BuildCirculant(plan.profile_major, plan.mean_major);
+  plan.circulant_minor = BuildCirculant(plan.profile_minor, plan.mean_minor);
+  if (use_maj_min) plan.circulant_other = BuildCirculant(plan.profile_other, plan.mean_other);
+  return plan;
+}
+
+std::shared_ptr<const KeyProfilePlan> GetKeyProfilePlan(const std::string profile_type,
+                                                        const bool use_polphony,
+                                                        const bool use_three_chords,
+                                                        const unsigned int num_harmonics,
+                                                        const double slope,
+                                                        const bool use_maj_min,
+                                                        const unsigned int pcp_size) {
+  using PlanKey = std::tuple<std::string, bool, bool, unsigned int, double, bool, unsigned int>;
+  static std::mutex cache_mutex;
+  static std::map<PlanKey, std::shared_ptr<const KeyProfilePlan>> cache;
+
+  // A NaN would break the ordering of the keys.
+  if (!std::isfinite(slope)) throw std::runtime_error("Key: slope is not a finite number");
+  PlanKey plan_key(profile_type, use_polphony, use_three_chords, num_harmonics, slope, use_maj_min, pcp_size);
+  std::lock_guard<std::mutex> lock(cache_mutex);
+
+  auto it = cache.find(plan_key);
+  if (it != cache.end()) return it->second;
+
+  std::shared_ptr<const KeyProfilePlan> plan = std::make_shared<const KeyProfilePlan>(BuildKeyProfilePlan(
+      profile_type, use_polphony, use_three_chords, num_harmonics, slope, use_maj_min, pcp_size));
+  // Plans handed out before stay valid, they are shared.
+  if (cache.size() >= kMaxCachedPlans) cache.clear();
+  cache.emplace(plan_key, plan);
+  return plan;
+}
+
+KeyCorrelations KeyCorrelationMatrix::Row(size_t row) const {
+  KeyCorrelations key_correlations;
+  const auto row_begin = [this, row](const std::vector<double> &matrix) { return matrix.begin() + row * pcp_size; };
+  key_correlations.major.assign(row_begin(major), row_begin(major) + pcp_size);
+  key_correlations.minor.assign(row_begin(minor), row_begin(minor) + pcp_size);
+  if (!other.empty()) key_correlations.other.assign(row_begin(other), row_begin(other) + pcp_size);
+  return key_correlations;
+}
+
+KeyCorrelations CorrelateKeyProfiles(const std::vector<double> &pcp, const KeyProfilePlan &plan) {
+  if (pcp.size() != plan.pcp_size) throw std::runtime_error("Key: input PCP size does not match the key profile plan");
+  return CorrelateKeyProfiles(pcp.data(), 1, plan).Row(0);
+}
+
+KeyCorrelationMatrix CorrelateKeyProfiles(const double *pcps, size_t num_rows, const KeyProfilePlan &plan) {
+  StageTimer stage_timer(&PipelineStats::estimate_seconds);
+  const size_t size = plan.pcp_size;
+  KeyCorrelationMatrix key_correlations;
+  key_correlations.num_rows = num_rows;
+  key_correlations.pcp_size = plan.pcp_size;
+
+  Backend backend = ActiveBackend();
+  if (backend == Backend::kReference) {
+    key_correlations.major.resize(num_rows * size);
+    key_correlations.minor.resize(num_rows * size);
+    if (plan.use_maj_min) key_correlations.other.resize(num_rows * size);
+    for (size_t row = 0; row < num_rows; row++) {
+      std::vector<double> pcp(pcps + row * size, pcps + (row + 1) * size);
+      SetRow(reference::CorrelateKeyProfiles(pcp, plan), row, key_correlations);
+    }
+    return key_correlations;
+  }
+
+  // Every row is centered once, its norm is kept for the division of its correlations.
+  std::vector<double> centered_pcps(num_rows * size);
+  std::vector<double> std_pcps(num_rows);
+  std::vector<double> pcp(size);
+  for (size_t row = 0; row < num_rows; row++) {
+    pcp.assign(pcps + row * size, pcps + (row + 1) * size);
+    double mean_pcp = fplus::mean<double, std::vector<double>>(pcp);
+    std_pcps[row] = StandardDeviation(mean_pcp, pcp);
+    for (size_t i = 0; i < size; i++) centered_pcps[row * size + i] = pcp[i] - mean_pcp;
+  }
+
+  MultiplyCirculant(centered_pcps, num_rows, plan.circulant_major, std_pcps, plan.std_major, key_correlations.major);
+  MultiplyCirculant(centered_pcps, num_rows, plan.circulant_minor, std_pcps, plan.std_minor, key_correlations.minor);
+  if (plan.use_maj_min)
+    MultiplyCirculant(centered_pcps, num_rows, plan.circulant_other, std_pcps, plan.std_other, key_correlations.other);
+
+  if (backend == Backend::kCrossCheck) {
+    for (size_t row = 0; row < num_rows; row++) {
+      pcp.assign(pcps + row * size, pcps + (row + 1) * size);
+      RecordKeyCorrelationDeviations(key_correlations.Row(row), reference::CorrelateKeyProfiles(pcp, plan));
+    }
+  }
+  return key_correlations;
+}
+
+std::vector<KeyCorrelations> CorrelateKeyProfiles(const std::vector<std::vector<double>> &pcps,
+                                                  const KeyProfilePlan &plan) {
+  std::vector<double> pcp_matrix;
+  pcp_matrix.reserve(pcps.size() * plan.pcp_size);
+  for (const std::vector<double> &pcp : pcps) {
+    if (pcp.size() != plan.pcp_size)
+      throw std::runtime_error("Key: input PCP size does not match the key profile plan");
+    pcp_matrix.insert(pcp_matrix.end(), pcp.begin(), pcp.end());
+  }
+
+  KeyCorrelationMatrix key_correlation_matrix = CorrelateKeyProfiles(pcp_matrix.data(), pcps.size(), plan);
+  std::vector<KeyCorrelations> key_correlations;
+  key_correlations.reserve(pcps.size());
+  for (size_t row = 0; row < pcps.size(); row++) key_correlations.push_back(key_correlation_matrix.Row(row));
+  return key_correlations;
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Key profiles of EstimateKey, resized to the PCP size, together with their mean and standard deviation.
+ *
+ * Building the profiles (selecting the profile type, adding the chord and harmonic contributions and resizing) only
+ * depends on the parameters stored in the plan, not on the PCP. A plan is built once and can then be used to estimate
+ * the key of any number of PCPs of size pcp_size.
+ */
+struct KeyProfilePlan {
+  std::string profile_type;
+  bool use_polphony;
+  bool use_three_chords;
+  unsigned int num_harmonics;
+  double slope;
+  bool use_maj_min;
+  unsigned int pcp_size;
+
+  std::vector<double> profile_major;
+  double mean_major;
+  double std_major;
+
+  std::vector<double> profile_minor;
+  double mean_minor;
+  double std_minor;
+
+  std::vector<double> profile_other;  //!< Profile of the 'majmin' scale, all zeros if the profile type has none.
+  double mean_other;
+  double std_other;
+
+  /*!< Mean-centered circulant matrices of the profiles, pcp_size x pcp_size in row-major order. Row i holds
+       profile[(i - shift) % pcp_size] - mean for every shift, so the correlations of all the shifts are accumulated
+       with contiguous rows.*/
+  std::vector<double> circulant_major;
+  std::vector<double> circulant_minor;
+  std::vector<double> circulant_other;
+};
+
+/**
+ * @brief Correlation of a PCP with every circular shift of the key profiles.
+ *
+ * Element `shift` of each vector is equal to Correlation(pcp, ..., profile, ..., shift).
+ */
+struct KeyCorrelations {
+  std::vector<double> major;
+  std::vector<double> minor;
+  std::vector<double> other;  //!< Empty unless the plan uses the 'majmin' profile.
+};
+
+/**
+ * @brief Correlations of a matrix of PCPs with every circular shift of the key profiles.
+ *
+ * Each member is a num_rows x pcp_size matrix in row-major order, element (row, shift) is the correlation of the PCP of
+ * that row with the profile shifted by `shift`.
+ */
+struct KeyCorrelationMatrix {
+  size_t num_rows;
+  unsigned int pcp_size;
+  std::vector<double> major;
+  std::vector<double> minor;
+  std::vector<double> other;  //!< Empty unless the plan uses the 'majmin' profile.
+
+  /**
+   * @brief Correlations of one PCP.
+   *
+   * @param row Index of the PCP.
+   * @return KeyCorrelations Copy of the row of each matrix.
+   */
+  KeyCorrelations Row(size_t row) const;
+};
+
+/**
+ * @brief Adds the chord and harmonic contributions to 12-bin major and minor profiles.
+ *
+ * This is the runtime expansion, BuildKeyProfilePlan uses the compile-time kDefaultPolyphonicKeyProfiles instead for
+ * num_harmonics = kDefaultNumHarmonics and slope = kDefaultSlope.
+ *
+ * @param M Major key profile.
+ * @param m Minor key profile.
+ * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic profiles.
+ * @param num_harmonics Number of harmonics that should contribute to the polyphonic profile.
+ * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+ * @return std::tuple<std::vector<double>, std::vector<double>> Tuple of (polyphonic major, polyphonic minor) profiles.
+ */
+std::tuple<std::vector<double>, std::vector<double>> BuildPolyphonicProfiles(const std::vector<double> &M,
+                                                                              const std::vector<double> &m,
+                                                                              const bool use_three_chords,
+                                                                              const unsigned int num_harmonics,
+                                                                              const double slope);
+
+/**
+ * @brief Builds the key profiles used by EstimateKey. See EstimateKey for the description of the parameters.
+ *
+ * @param profile_type The type of polyphic profile to use for correlation calculation.
+ * @param use_polphony Enables the use of polyphonic profiles to define key profiles.
+ * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic profiles.
+ * @param num_harmonics Number of harmonics that should contribute to the polyphonic profile.
+ * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+ * @param use_maj_min Use a third profile called 'majmin' for ambiguous tracks.
+ * @param pcp_size Size of the PCPs the plan will be used with.
+ * @return KeyProfilePlan Newly built plan. Throws a runtime_error if slope is not finite.
+ */
+KeyProfilePlan BuildKeyProfilePlan(const std::string profile_type = "Bgate",
+                                   const bool use_polphony = true,
+                                   const bool use_three_chords = true,
+                                   const unsigned int num_harmonics = 4,
+                                   const double slope = 0.6,
+                                   const bool use_maj_min = false,
+                                   const unsigned int pcp_size = 36);
+
+/**
+ * @brief Returns the cached plan for the given parameters, building it on first use.
+ *
+ * The cache is shared by the whole process and can be used from multiple threads. Plans are never modified once
+ * built, so the returned pointer can be kept and used concurrently. The cache holds a bounded number of plans and is
+ * emptied when it is full, so sweeping a parameter only rebuilds plans instead of growing the memory.
+ *
+ * @return std::shared_ptr<const KeyProfilePlan> Cached plan.
+ */
+std::shared_ptr<const KeyProfilePlan> GetKeyProfilePlan(const std::string profile_type = "Bgate",
+                                                        const bool use_polphony = true,
+                                                        const bool use_three_chords = true,
+                                                        const unsigned int num_harmonics = 4,
+                                                        const double slope = 0.6,
+                                                        const bool use_maj_min = false,
+                                                        const unsigned int pcp_size = 36);
+
+/**
+ * @brief Correlates a PCP with all the shifts of the major, minor (and majmin) profiles at once.
+ *
+ * The PCP is centered once and multiplied with the circulant matrices of the plan, with SIMD over the shifts. The
+ * summation order of each shift is the same as in Correlation(), so the results are identical.
+ *
+ * @param pcp The input pitch class profile, of size plan.pcp_size.
+ * @param plan Key profiles.
+ * @return KeyCorrelations Correlation for every shift.
+ */
+KeyCorrelations CorrelateKeyProfiles(const std::vector<double> &pcp, const KeyProfilePlan &plan);
+
+/**
+ * @brief Overloaded function for CorrelateKeyProfiles that scores a whole matrix of PCPs (e.g. many tracks or many
+ * segments of a track, see Chromagram::hpcps) against the same plan.
+ *
+ * Every row is centered once, then the centered matrix is multiplied with each circulant matrix of the plan as one
+ * matrix-matrix product (rows x shifts), block of rows by block of rows. Each correlation is still summed in the order
+ * of Correlation(), so the results are identical to correlating the rows one by one.
+ *
+ * @param pcps Pitch class profiles, num_rows x plan.pcp_size in row-major order.
+ * @param num_rows Number of PCPs.
+ * @param plan Key profiles.
+ * @return KeyCorrelationMatrix Correlations of each PCP.
+ */
+KeyCorrelationMatrix CorrelateKeyProfiles(const double *pcps, size_t num_rows, const KeyProfilePlan &plan);
+
+/**
+ * @brief Overloaded function for CorrelateKeyProfiles that takes the PCPs as separate vectors.
+ *
+ * The rows are copied into one matrix, see CorrelateKeyProfiles(const double *, size_t, const KeyProfilePlan &).
+ *
+ * @param pcps Pitch class profiles, one per row, each of size plan.pcp_size.
+ * @param plan Key profiles.
+ * @return std::vector<KeyCorrelations> Correlations of each PCP.
+ */
+std::vector<KeyCorrelations> CorrelateKeyProfiles(const std::vector<std::vector<double>> &pcps,
+                                                  const KeyProfilePlan &plan);
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+namespace musher {
+namespace core {
+
+using PitchClassProfile = std::array<double, 12>;
+
+/**
+ * @brief Key profile of a profile type, as listed in SelectKeyProfile.
+ *
+ */
+struct KeyProfileTable {
+  const char *name;
+  PitchClassProfile major;
+  PitchClassProfile minor;
+  PitchClassProfile other;  //!< Profile of the 'majmin' scale, all zeros if has_other is false.
+  bool has_other;
+};
+
+/**
+ * @brief All the key profiles, in the order of KeyProfileTypes. See SelectKeyProfile for the references.
+ *
+ */
+constexpr std::array<KeyProfileTable, 14> kKeyProfileTables = { {
+    { "Diatonic",
+      { { 1, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 1 } },
+      { { 1, 0, 1, 1, 0, 1, 0, 1, 1, 0, 0, 1 } },
+      {},
+      false },
+    { "Krumhansl",
+      { { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 } },
+      { { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 } },
+      {},
+      false },
+    { "Temperley",
+      { { 5.0, 2.0, 3.5, 2.0, 4.5, 4.0, 2.0, 4.5, 2.0, 3.5, 1.5, 4.0 } },
+      { { 5.0, 2.0, 3.5, 4.5, 2.0, 4.0, 2.0, 4.5, 3.5, 2.0, 1.5, 4.0 } },
+      {},
+      false },
+    { "Weichai",
+      { { 81302, 320, 65719, 1916, 77469, 40928, 2223, 83997, 1218, 39853, 1579, 28908 } },
+      { { 39853, 1579, 28908, 81302, 320, 65719, 1916, 77469, 40928, 2223, 83997, 1218 } },
+      {},
+      false },
+    { "Tonic Triad",
+      { { 1, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0 } },
+      { { 1, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0 } },
+      {},
+      false },
+    { "Temperley2005",
+      { { 0.748, 0.060, 0.488, 0.082, 0.67, 0.46, 0.096, 0.715, 0.104, 0.366, 0.057, 0.4 } },
+      { { 0.712, 0.084, 0.474, 0.618, 0.049, 0.46, 0.105, 0.747, 0.404, 0.067, 0.133, 0.33 } },
+      {},
+      false },
+    { "Thpcp",
+      { { 0.95162, 0.20742, 0.71758, 0.22007, 0.71341, 0.48841, 0.31431, 1.00000, 0.20957, 0.53657, 0.22585,
+          0.55363 } },
+      { { 0.94409, 0.21742, 0.64525, 0.63229, 0.27897, 0.57709, 0.26428, 1.0000, 0.26428, 0.30633, 0.45924,
+          0.35929 } },
+      {},
+      false },
+    { "Shaath",
+      { { 6.6, 2.0, 3.5, 2.3, 4.6, 4.0, 2.5, 5.2, 2.4, 3.7, 2.3, 3.4 } },
+      { { 6.5, 2.7, 3.5, 5.4, 2.6, 3.5, 2.5, 5.2, 4.0, 2.7, 4.3, 3.2 } },
+      {},
+      false },
+    { "Gomez",
+      { { 0.82, 0.00, 0.55, 0.00, 0.53, 0.30, 0.08, 1.00, 0.00, 0.38, 0.00, 0.47 } },
+      { { 0.81, 0.00, 0.53, 0.54, 0.00, 0.27, 0.07, 1.00, 0.27, 0.07, 0.10, 0.36 } },
+      {},
+      false },
+    { "Noland",
+      { { 0.0629, 0.0146, 0.061, 0.0121, 0.0623, 0.0414, 0.0248, 0.0631, 0.015, 0.0521, 0.0142, 0.0478 } },
+      { { 0.0682, 0.0138, 0.0543, 0.0519, 0.0234, 0.0544, 0.0176, 0.067, 0.0349, 0.0297, 0.0401, 0.027 } },
+      {},
+      false },
+    { "Edmm",
+      { { 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083, 0.083 } },
+      { { 0.17235348, 0.04, 0.0761009, 0.12, 0.05621498, 0.08527853, 0.0497915, 0.13451001, 0.07458916, 0.05003023,
+          0.09187879, 0.05545106 } },
+      {},
+      false },
+    // -- Profiles with other --
+    { "Bgate",
+      { { 1.00, 0.00, 0.42, 0.00, 0.53, 0.37, 0.00, 0.77, 0.00, 0.38, 0.21, 0.30 } },
+      { { 1.00, 0.00, 0.36, 0.39, 0.00, 0.38, 0.00, 0.74, 0.27, 0.00, 0.42, 0.23 } },
+      { { 1.00, 0.26, 0.35, 0.29, 0.44, 0.36, 0.21, 0.78, 0.26, 0.25, 0.32, 0.26 } },
+      true },
+    { "Braw",
+      { { 1.0000, 0.1573, 0.4200, 0.1570, 0.5296, 0.3669, 0.1632, 0.7711, 0.1676, 0.3827, 0.2113, 0.2965 } },
+      { { 1.0000, 0.2330, 0.3615, 0.3905, 0.2925, 0.3777, 0.1961, 0.7425, 0.2701, 0.2161, 0.4228, 0.2272 } },
+      { { 1.0000, 0.2608, 0.3528, 0.2935, 0.4393, 0.3580, 0.2137, 0.7809, 0.2578, 0.2539, 0.3233, 0.2615 } },
+      true },
+    { "Edma",
+      { { 1.00, 0.29, 0.50, 0.40, 0.60, 0.56, 0.32, 0.80, 0.31, 0.45, 0.42, 0.39 } },
+      { { 1.00, 0.31, 0.44, 0.58, 0.33, 0.49, 0.29, 0.78, 0.43, 0.29, 0.53, 0.32 } },
+      { { 1.00, 0.26, 0.35, 0.29, 0.44, 0.36, 0.21, 0.78, 0.26, 0.25, 0.32, 0.26 } },
+      true },
+} };
+
+/**
+ * @brief Index of a profile type in kKeyProfileTables.
+ *
+ * @param profile_type Key profile type.
+ * @return int Index of the profile type, -1 if it does not exist.
+ */
+constexpr int FindKeyProfileTable(const char *profile_type) {
+  for (int i = 0; i < static_cast<int>(kKeyProfileTables.size()); i++) {
+    const char *name = kKeyProfileTables[i].name;
+    int c = 0;
+    while (name[c] != '\0' && name[c] == profile_type[c]) c++;
+    if (name[c] == profile_type[c]) return i;
+  }
+  return -1;
+}
+
+// Parameters of EstimateKey whose polyphonic profiles are expanded at compile time.
+constexpr unsigned int kDefaultNumHarmonics = 4;
+constexpr double kDefaultSlope = 0.6;
+
+namespace key_profiles_internal {
+
+// std::array cannot be modified in a C++14 constant expression, profiles are expanded in a plain array.
+struct MutableProfile {
+  double values[12];
+};
+
+/**
+ * @brief Semitone offset of harmonic h (12 * log2(h)) split between its two closest semitones, with the squared
+ * cosine weights that AddContributionHarmonics gives them. Adding the pitch class to these offsets is exact, so the
+ * weights are the same for every pitch class.
+ */
+struct HarmonicSplit {
+  int before;
+  int after;
+  double weight_before;
+  double weight_after;
+};
+
+constexpr unsigned int kMaxNumHarmonics = 4;
+constexpr HarmonicSplit kHarmonicSplits[kMaxNumHarmonics] = {
+  { 0, 0, 1., 1. },
+  { 12, 12, 1., 1. },
+  { 19, 20, 0.99905724870513868, 0.00094275129486133243 },
+  { 24, 24, 1., 1. },
+};
+
+// Same additions, in the same order, as AddContributionHarmonics, AddMajorTriad and AddMinorTriad.
+constexpr void AccumulateHarmonics(MutableProfile &chords,
+                                   int pitch_class,
+                                   double contribution,
+                                   unsigned int num_harmonics,
+                                   double slope) {
+  double weight = contribution;
+  for (unsigned int i = 0; i < num_harmonics; i++) {
+    const HarmonicSplit &split = kHarmonicSplits[i];
+    int ibefore = (pitch_class + split.before) % 12;
+    int iafter = (pitch_class + split.after) % 12;
+    if (ibefore < iafter) {
+      chords.values[ibefore] += split.weight_before * weight;
+      chords.values[iafter] += split.weight_after * weight;
+    } else {
+      chords.values[ibefore] += weight;
+    }
+    weight *= slope;
+  }
+}
+
+constexpr void AccumulateTriad(MutableProfile &chords,
+                               int root,
+                               int third_interval,
+                               double contribution,
+                               unsigned int num_harmonics,
+                               double slope) {
+  AccumulateHarmonics(chords, root, contribution, num_harmonics, slope);
+  AccumulateHarmonics(chords, (root + third_interval) % 12, contribution, num_harmonics, slope);
+  AccumulateHarmonics(chords, (root + 7) % 12, contribution, num_harmonics, slope);
+}
+
+template <std::size_t... I>
+constexpr PitchClassProfile ToPitchClassProfile(const MutableProfile &profile, std::index_sequence<I...>) {
+  return { { profile.values[I]... } };
+}
+
+}  // namespace key_profiles_internal
+
+/**
+ * @brief Compile-time version of the polyphonic major profile built by BuildKeyProfilePlan.
+ *
+ * Gives exactly the same values as the runtime expansion with AddMajorTriad and AddContributionHarmonics.
+ *
+ * @tparam NumHarmonics Number of harmonics that should contribute to the polyphonic profile, at most 4.
+ * @param M Major key profile.
+ * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+ * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD).
+ * @return PitchClassProfile Polyphonic major profile.
+ */
+template <unsigned int NumHarmonics>
+constexpr PitchClassProfile PolyphonicMajorProfile(const PitchClassProfile &M, double slope, bool use_three_chords) {
+  static_assert(NumHarmonics >= 1 && NumHarmonics <= key_profiles_internal::kMaxNumHarmonics,
+                "Harmonic weights are only tabulated up to 4 harmonics");
+  using namespace key_profiles_internal;
+
+  MutableProfile chords{};
+  AccumulateTriad(chords, 0, 4, M[0], NumHarmonics, slope);                                   // Tonic (I)
+  if (!use_three_chords) AccumulateTriad(chords, 2, 3, M[2], NumHarmonics, slope);            // II
+  if (!use_three_chords) AccumulateTriad(chords, 4, 3, M[4], NumHarmonics, slope);            // III
+  AccumulateTriad(chords, 5, 4, M[5], NumHarmonics, slope);                                   // Subdominant (IV)
+  AccumulateTriad(chords, 7, 4, M[7], NumHarmonics, slope);                                   // Dominant (V)
+  if (!use_three_chords) AccumulateTriad(chords, 9, 3, M[9], NumHarmonics, slope);            // VI
+  if (!use_three_chords) AccumulateHarmonics(chords, 11, M[11], NumHarmonics, slope);         // VII (5th diminished)
+  if (!use_three_chords) AccumulateHarmonics(chords, 2, M[11], NumHarmonics, slope);
+  if (!use_three_chords) AccumulateHarmonics(chords, 5, M[11], NumHarmonics, slope);
+  return ToPitchClassProfile(chords, std::make_index_sequence<12>());
+}
+
+/**
+ * @brief Compile-time version of the polyphonic minor profile built by BuildKeyProfilePlan.
+ *
+ * Gives exactly the same values as the runtime expansion with AddMinorTriad and AddContributionHarmonics.
+ *
+ * @tparam NumHarmonics Number of harmonics that should contribute to the polyphonic profile, at most 4.
+ * @param m Minor key profile.
+ * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+ * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD).
+ * @return PitchClassProfile Polyphonic minor profile.
+ */
+template <unsigned int NumHarmonics>
+constexpr PitchClassProfile PolyphonicMinorProfile(const PitchClassProfile &m, double slope, bool use_three_chords) {
+  static_assert(NumHarmonics >= 1 && NumHarmonics <= key_profiles_internal::kMaxNumHarmonics,
+                "Harmonic weights are only tabulated up to 4 harmonics");
+  using namespace key_profiles_internal;
+
+  MutableProfile chords{};
+  AccumulateTriad(chords, 0, 3, m[0], NumHarmonics, slope);                            // Tonica (I)
+  if (!use_three_chords) AccumulateHarmonics(chords, 2, m[2], NumHarmonics, slope);    // II (5th diminished)
+  if (!use_three_chords) AccumulateHarmonics(chords, 5, m[2], NumHarmonics, slope);
+  if (!use_three_chords) AccumulateHarmonics(chords, 8, m[2], NumHarmonics, slope);
+  if (!use_three_chords) AccumulateHarmonics(chords, 3, m[3], NumHarmonics, slope);    // III (5th augmented)
+  if (!use_three_chords) AccumulateHarmonics(chords, 7, m[3], NumHarmonics, slope);
+  if (!use_three_chords) AccumulateHarmonics(chords, 11, m[3], NumHarmonics, slope);
+  AccumulateTriad(chords, 5, 3, m[5], NumHarmonics, slope);                            // Subdominant (IV)
+  AccumulateTriad(chords, 7, 4, m[7], NumHarmonics, slope);                            // Dominant (V)
+  if (!use_three_chords) AccumulateTriad(chords, 8, 4, m[8], NumHarmonics, slope);     // VI
+  if (!use_three_chords) AccumulateHarmonics(chords, 11, m[8], NumHarmonics, slope);   // VII (diminished 5th)
+  if (!use_three_chords) AccumulateHarmonics(chords, 2, m[8], NumHarmonics, slope);
+  if (!use_three_chords) AccumulateHarmonics(chords, 5, m[8], NumHarmonics, slope);
+  return ToPitchClassProfile(chords, std::make_index_sequence<12>());
+}
+
+/**
+ * @brief Polyphonic profiles of a profile type for kDefaultNumHarmonics and kDefaultSlope.
+ *
+ */
+struct PolyphonicKeyProfiles {
+  PitchClassProfile major_three_chords;
+  PitchClassProfile minor_three_chords;
+  PitchClassProfile major_all_chords;
+  PitchClassProfile minor_all_chords;
+};
+
+namespace key_profiles_internal {
+
+template <std::size_t... I>
+constexpr std::array<PolyphonicKeyProfiles, sizeof...(I)> ExpandDefaultKeyProfiles(std::index_sequence<I...>) {
+  return { { { PolyphonicMajorProfile<kDefaultNumHarmonics>(kKeyProfileTables[I].major, kDefaultSlope, true),
+               PolyphonicMinorProfile<kDefaultNumHarmonics>(kKeyProfileTables[I].minor, kDefaultSlope, true),
+               PolyphonicMajorProfile<kDefaultNumHarmonics>(kKeyProfileTables[I].major, kDefaultSlope, false),
+               PolyphonicMinorProfile<kDefaultNumHarmonics>(kKeyProfileTables[I].minor, kDefaultSlope, false) }... } };
+}
+
+}  // namespace key_profiles_internal
+
+/**
+ * @brief Polyphonic profiles of every profile type for the default parameters, in the order of kKeyProfileTables.
+ *
+ * Computed entirely at compile time.
+ */
+constexpr std::array<PolyphonicKeyProfiles, kKeyProfileTables.size()> kDefaultPolyphonicKeyProfiles =
+    key_profiles_internal::ExpandDefaultKeyProfiles(std::make_index_sequence<kKeyProfileTables.size()>());
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,216 @@
+#include "src/core/key_tracker.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/core/framecutter.h"
+#include "src/core/key.h"
+#include "src/core/mono_mixer.h"
+#include "src/core/pipeline_stats.h"
+
+namespace musher {
+namespace core {
+
+namespace {
+
+DetectKeyOptions TrackerOptions(const std::string profile_type,
+                                const bool use_polphony,
+                                const bool use_three_chords,
+                                const unsigned int num_harmonics,
+                                const double slope,
+                                const bool use_maj_min,
+                                const unsigned int pcp_size,
+                                const int frame_size,
+                                const int hop_size,
+                                const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func,
+                                unsigned int max_num_peaks,
+                                double window_size,
+                                double rms_threshold) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.frame_size = frame_size;
+  options.hop_size = hop_size;
+  options.window_type_func = window_type_func;
+  options.max_num_peaks = max_num_peaks;
+  options.window_size = window_size;
+  options.rms_threshold = rms_threshold;
+  return options;
+}
+
+bool UsesAnalysisSampleRate(const DetectKeyOptions &options, double sample_rate) {
+  return options.analysis_sample_rate > 0. && options.analysis_sample_rate < sample_rate;
+}
+
+}  // namespace
+
+KeyTracker::KeyTracker(double sample_rate,
+                       const std::string profile_type,
+                       const bool use_polphony,
+                       const bool use_three_chords,
+                       const unsigned int num_harmonics,
+                       const double slope,
+                       const bool use_maj_min,
+                       const unsigned int pcp_size,
+                       const int frame_size,
+                       const int hop_size,
+                       const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func,
+                       unsigned int max_num_peaks,
+                       double window_size,
+                       double rms_threshold)
+    : KeyTracker(sample_rate,
+                 TrackerOptions(profile_type, use_polphony, use_three_chords, num_harmonics, slope, use_maj_min,
+                                pcp_size, frame_size, hop_size, window_type_func, max_num_peaks, window_size,
+                                rms_threshold)) {}
+
+KeyTracker::KeyTracker(double sample_rate, const DetectKeyOptions &options, int64_t num_samples)
+    : KeyTracker(sample_rate, options, AnalysisRateOptions(options, sample_rate), num_samples) {}
+
+KeyTracker::KeyTracker(double sample_rate,
+                       const DetectKeyOptions &options,
+                       const DetectKeyOptions &analysis_options,
+                       int64_t num_samples)
+    : frame_size_(analysis_options.frame_size),
+      hop_size_(analysis_options.hop_size),
+      convergence_frames_(options.convergence_frames),
+      estimate_interval_(options.estimate_interval),
+      convergence_tolerance_(options.convergence_tolerance),
+      key_detector_(UsesAnalysisSampleRate(options, sample_rate) ? options.analysis_sample_rate : sample_rate,
+                    analysis_options),
+      frame_(static_cast<size_t>(analysis_options.frame_size)),
+      sample_frames_(options.frame_sampling != "all") {
+  if (UsesAnalysisSampleRate(options, sample_rate))
+    resampler_.reset(new StreamingResampler(sample_rate, options.analysis_sample_rate));
+
+  if (sample_frames_) {
+    if (num_samples < 0) throw std::runtime_error("KeyTracker: frame sampling needs the number of samples");
+    if (resampler_) num_samples = resampler_->GetResampler().OutputSize(num_samples);
+    int num_frames = CountFrames(static_cast<size_t>(num_samples), frame_size_, hop_size_);
+    frame_indices_ = SampleFrameIndices(num_frames, options.frame_sampling, options.frame_stride,
+                                        options.num_sampled_frames, options.sampling_seed);
+  }
+
+  Reset();
+}
+
+void KeyTracker::Reset() {
+  key_detector_.Reset();
+  converged_ = false;
+  if (resampler_) resampler_->Reset();
+
+  // Same start position as Framecutter with start_from_center, the samples before 0 are zeros.
+  next_frame_start_ = -(frame_size_ + 1) / 2;
+  pending_start_ = next_frame_start_;
+  pending_.assign(static_cast<size_t>(-next_frame_start_), 0.);
+  total_samples_ = 0;
+  flushed_ = false;
+  next_sampled_frame_ = 0;
+  next_frame_index_ = 0;
+}
+
+void KeyTracker::ProcessPendingFrames(bool zero_pad) {
+  RecordPeakBytes(&PipelineStats::peak_frame_bytes, VectorBytes(frame_));
+
+  while (true) {
+    int64_t frame_end = next_frame_start_ + frame_size_;
+
+    if (!zero_pad) {
+      // Only complete frames can be analyzed before the end of the signal is known.
+      if (frame_end > total_samples_) break;
+    } else {
+      // Mirrors the stop conditions of Framecutter for the trailing, zero-padded frames.
+      if (next_frame_start_ >= total_samples_) break;
+    }
+
+    bool analyzed = !sample_frames_ || (next_sampled_frame_ < frame_indices_.size() &&
+                                        frame_indices_[next_sampled_frame_] == next_frame_index_);
+    next_frame_index_++;
+    if (analyzed) {
+      if (sample_frames_) next_sampled_frame_++;
+      int64_t offset = next_frame_start_ - pending_start_;
+      int64_t available = std::min<int64_t>(frame_size_, static_cast<int64_t>(pending_.size()) - offset);
+      std::copy(pending_.begin() + offset, pending_.begin() + offset + available, frame_.begin());
+      std::fill(frame_.begin() + available, frame_.end(), 0.);
+
+      int frame_count = key_detector_.FrameCount();
+      key_detector_.AddFrame(frame_);
+      // Same checks as DetectKey, after every estimate_interval-th analyzed frame.
+      if (convergence_frames_ > 0 && estimate_interval_ > 0 && key_detector_.FrameCount() != frame_count &&
+          key_detector_.FrameCount() % estimate_interval_ == 0 &&
+          key_detector_.HasConverged(convergence_frames_, convergence_tolerance_)) {
+        converged_ = true;
+        pending_.clear();
+        return;
+      }
+    }
+
+    bool last_frame = zero_pad && frame_end > total_samples_ && next_frame_start_ + frame_size_ / 2 >= total_samples_;
+    next_frame_start_ += hop_size_;
+    if (last_frame) {
+      next_frame_start_ = total_samples_;
+      break;
+    }
+  }
+
+  // Drop the samples that no future frame will overlap.
+  int64_t consumed = std::min<int64_t>(next_frame_start_ - pending_start_, static_cast<int64_t>(pending_.size()));
+  if (consumed > 0) {
+    pending_.erase(pending_.begin(), pending_.begin() + consumed);
+    pending_start_ += consumed;
+  }
+}
+
+void KeyTracker::AddSamples(const std::vector<double> &samples) {
+  if (flushed_) throw std::runtime_error("KeyTracker: cannot add samples after Flush, call Reset first");
+  // Nothing left to analyze once the estimate has converged or every sampled frame has been analyzed.
+  if (converged_ || (sample_frames_ && next_sampled_frame_ == frame_indices_.size())) return;
+
+  if (resampler_) {
+    resampler_->Process(samples, resampled_);
+    AddAnalysisSamples(resampled_);
+  } else {
+    AddAnalysisSamples(samples);
+  }
+}
+
+void KeyTracker::AddAnalysisSamples(const std::vector<double> &samples) {
+  if (samples.empty()) return;
+
+  pending_.insert(pending_.end(), samples.begin(), samples.end());
+  total_samples_ += static_cast<int64_t>(samples.size());
+  RecordPeakBytes(&PipelineStats::peak_mono_bytes, VectorBytes(pending_));
+
+  ProcessPendingFrames(false);
+}
+
+void KeyTracker::AddSamples(const std::vector<std::vector<double>> &normalized_samples) {
+  AddSamples(MonoMixer(normalized_samples));
+}
+
+void KeyTracker::Flush() {
+  if (flushed_) return;
+  if (resampler_ && !converged_) {
+    resampler_->Flush(resampled_);
+    AddAnalysisSamples(resampled_);
+  }
+  // Like Framecutter, an empty signal has no frames at all.
+  if (total_samples_ > 0 && !converged_) ProcessPendingFrames(true);
+  pending_.clear();
+  flushed_ = true;
+}
+
+void KeyTracker::AddFrame(const std::vector<double> &frame) { key_detector_.AddFrame(frame); }
+
+void KeyTracker::AddHPCP(const std::vector<double> &hpcp) { key_detector_.AddHPCP(hpcp); }
+
+KeyOutput KeyTracker::Estimate() const { return key_detector_.Estimate(); }
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/core/key.h"
+#include "src/core/key_detector.h"
+#include "src/core/resampler.h"
+#include "src/core/windowing.h"
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Incremental key estimator that keeps a running HPCP accumulator.
+ *
+ * Frames (or raw blocks of mono samples) can be fed to the tracker as they become available, and the current key
+ * estimate can be requested at any moment. The frames are cut exactly like Framecutter does with
+ * `start_from_center = true`, so feeding a whole signal through AddSamples() followed by Flush() gives the same result
+ * as DetectKey().
+ *
+ * @code
+ *   KeyTracker key_tracker(sample_rate);
+ *
+ *   while (ReadNextBlock(block)) {
+ *       key_tracker.AddSamples(block);
+ *       KeyOutput provisional_key = key_tracker.Estimate();
+ *   }
+ *   key_tracker.Flush();
+ *   KeyOutput final_key = key_tracker.Estimate();
+ * @endcode
+ */
+class KeyTracker {
+ private:
+  const int frame_size_;
+  const int hop_size_;
+
+  // Adaptive mode, see DetectKeyOptions. Once the estimate has converged the following samples are ignored.
+  const unsigned int convergence_frames_;
+  const unsigned int estimate_interval_;
+  const double convergence_tolerance_;
+  bool converged_;
+
+  // Every frame is analyzed and accumulated by the detector, the tracker only cuts the frames out of the stream.
+  KeyDetector key_detector_;
+  std::vector<double> frame_;
+
+  // Brings the samples to the analysis sampling rate, null when they are analyzed at their own rate.
+  std::unique_ptr<StreamingResampler> resampler_;
+  std::vector<double> resampled_;
+
+  // Frame sampling, see DetectKeyOptions::frame_sampling. When sample_frames_ is set only the frames of frame_indices_
+  // are analyzed, the other frames are only cut past.
+  bool sample_frames_;
+  std::vector<int> frame_indices_;
+  size_t next_sampled_frame_;
+  int next_frame_index_;
+
+  // Streaming state. Positions are absolute sample indices of the analyzed signal; the first frame starts before 0.
+  std::vector<double> pending_;
+  int64_t pending_start_;
+  int64_t next_frame_start_;
+  int64_t total_samples_;
+  bool flushed_;
+
+  KeyTracker(double sample_rate,
+             const DetectKeyOptions &options,
+             const DetectKeyOptions &analysis_options,
+             int64_t num_samples);
+
+  void AddAnalysisSamples(const std::vector<double> &samples);
+  void ProcessPendingFrames(bool zero_pad);
+
+ public:
+  /**
+   * @brief Construct a new KeyTracker object
+   *
+   * @param sample_rate Sampling rate of the audio signal \[Hz\].
+   * @param profile_type The type of polyphic profile to use for correlation calculation.
+   * @param use_polphony Enables the use of polyphonic profiles to define key profiles (this includes the contributions
+   * from triads as well as pitch harmonics).
+   * @param use_three_chords Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic
+   * profiles.
+   * @param num_harmonics Number of harmonics that should contribute to the polyphonic profile (1 only considers the
+   * fundamental harmonic).
+   * @param slope Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+   * @param use_maj_min Use a third profile called 'majmin' for ambiguous tracks [4]. Only available for the edma,
+   * bgate and braw profiles.
+   * @param pcp_size Number of array elements used to represent a semitone times 12.
+   * @param frame_size Output frame size.
+   * @param hop_size Hop size between frames.
+   * @param window_type_func The window type function. Examples: BlackmanHarris92dB, BlackmanHarris62dB...
+   * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
+   * @param window_size Size, in semitones, of the window used for the weighting.
+   * @param rms_threshold Frames whose root mean square is below this value are skipped before any spectral analysis
+   * (0 keeps every frame).
+   */
+  KeyTracker(double sample_rate = 44100.,
+             const std::string profile_type = "Bgate",
+             const bool use_polphony = true,
+             const bool use_three_chords = true,
+             const unsigned int num_harmonics = 4,
+             const double slope = 0.6,
+             const bool use_maj_min = false,
+             const unsigned int pcp_size = 36,
+             const int frame_size = 4096,
+             const int hop_size = 512,
+             const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func =
+                 BlackmanHarris62dB,
+             unsigned int max_num_peaks = 100,
+             double window_size = .5,
+             double rms_threshold = 0.);
+
+  /**
+   * @brief Construct a new KeyTracker object with the options of DetectKey, so that streaming a signal gives the same
+   * result as DetectKey with the same options.
+   *
+   * With an adaptive mode, the samples that arrive once the estimate has converged are ignored (see Converged). With
+   * an analysis sampling rate, the mixdown is resampled block by block with a StreamingResampler and AddFrame takes
+   * frames at the analysis sampling rate. With frame sampling, only the selected frames are analyzed; they are
+   * selected from the number of frames of the whole signal, so num_samples must be known in advance.
+   *
+   * @param sample_rate Sampling rate of the added samples \[Hz\].
+   * @param options Analysis parameters, see DetectKeyOptions.
+   * @param num_samples Number of samples of the whole signal at sample_rate, only needed when options.frame_sampling
+   * is not "all".
+   */
+  KeyTracker(double sample_rate, const DetectKeyOptions &options, int64_t num_samples = -1);
+
+  ~KeyTracker() {}
+
+  /**
+   * @brief Add a block of mono samples.
+   *
+   * Every frame that is completely covered by the samples received so far is analyzed immediately. The remaining
+   * samples are kept until the next call to AddSamples() or Flush().
+   *
+   * @param samples Block of mono samples, of any size.
+   */
+  void AddSamples(const std::vector<double> &samples);
+
+  /**
+   * @brief Overloaded function for AddSamples that accepts a block of mono or stereo samples.
+   *
+   * The block is downmixed with MonoMixer before being framed.
+   *
+   * @param normalized_samples Block of normalized samples, either stereo or mono.
+   */
+  void AddSamples(const std::vector<std::vector<double>> &normalized_samples);
+
+  /**
+   * @brief Analyze the samples that are still pending as zero-padded trailing frames.
+   *
+   * Call this once the end of the signal has been reached. No more samples can be added afterwards until Reset() is
+   * called.
+   */
+  void Flush();
+
+  /**
+   * @brief Analyze a single frame and add its HPCP to the running accumulator.
+   *
+   * Frames that are quieter than rms_threshold are only counted as skipped. See KeyDetector::AddFrame.
+   *
+   * @param frame Audio frame of frame_size samples.
+   */
+  void AddFrame(const std::vector<double> &frame);
+
+  /**
+   * @brief Add an already computed HPCP to the running accumulator.
+   *
+   * @param hpcp Harmonic pitch class profile of size pcp_size.
+   */
+  void AddHPCP(const std::vector<double> &hpcp);
+
+  /**
+   * @brief Computes the key estimate of everything accumulated so far.
+   *
+   * @return KeyOutput Current key estimate. See EstimateKey.
+   */
+  KeyOutput Estimate() const;
+
+  /**
+   * @brief Re-estimates the key and checks whether the estimate has stopped changing, see KeyDetector::HasConverged.
+   *
+   * @param convergence_frames Number of frames the estimate must have been stable for.
+   * @param tolerance Maximum allowed change of first_to_second_relative_strength.
+   * @return true If the estimate has been stable for at least convergence_frames frames.
+   * @return false Otherwise, or if no frames have been analyzed yet.
+   */
+  bool HasConverged(unsigned int convergence_frames, double tolerance = 0.05) {
+    return key_detector_.HasConverged(convergence_frames, tolerance);
+  }
+
+  /**
+   * @brief Average of all the HPCPs accumulated so far.
+   *
+   * @return std::vector<double> Averaged harmonic pitch class profile.
+   */
+  std::vector<double> AverageHPCP() const { return key_detector_.AverageHPCP(); }
+
+  /**
+   * @brief Whether the adaptive mode has stopped the analysis, see DetectKeyOptions::convergence_frames.
+   *
+   * @return true If the estimate has converged, the samples added from then on are ignored.
+   * @return false Otherwise, or without an adaptive mode.
+   */
+  bool Converged() const { return converged_; }
+
+  /**
+   * @brief Number of frames accumulated so far.
+   *
+   * @return int Frame count.
+   */
+  int FrameCount() const { return key_detector_.FrameCount(); }
+
+  /**
+   * @brief Number of frames skipped so far because they were below rms_threshold.
+   *
+   * @return int Skipped frame count.
+   */
+  int SkippedFrameCount() const { return key_detector_.SkippedFrameCount(); }
+
+  /**
+   * @brief Clear the accumulator and the streaming state so the tracker can be reused for a new signal.
+   */
+  void Reset();
+};
+
+}  // namespace core
+}  // namespace musher
@@ -1,29 +1,34 @@
 #include <stdexcept>
 #include <vector>
 
+#include "src/core/pipeline_stats.h"
+
 namespace musher {
 namespace core {
 
 std::vector<double> MonoMixer(const std::vector<std::vector<double>> &input) {
-  int num_channels = input.size();
+  StageTimer stage_timer(&PipelineStats::mix_seconds);
+  size_t num_channels = input.size();
   if (num_channels > 2 || input.empty()) {
-    std::runtime_error("Audio samples must be either mono or stereo.");
+    throw std::runtime_error("Audio samples must be either mono or stereo.");
   }
 
   if (num_channels == 1) {
+    RecordPeakBytes(&PipelineStats::peak_mono_bytes, static_cast<int64_t>(input[0].size() * sizeof(double)));
     return input[0];
   }
 
-  const std::vector<double> channel_one = input[0];
-  const std::vector<double> channel_two = input[1];
+  const std::vector<double> &channel_one = input[0];
+  const std::vector<double> &channel_two = input[1];
 
-  if (channel_one.size() != channel_two.size()) std::runtime_error("Audio channels must be the same length.");
-  int size = channel_one.size();
+  if (channel_one.size() != channel_two.size()) throw std::runtime_error("Audio channels must be the same length.");
+  size_t size = channel_one.size();
   std::vector<double> result(size);
 
-  for (int i = 0; i < size; ++i) {
+  for (size_t i = 0; i < size; ++i) {
     result[i] = 0.5 * (channel_one[i] + channel_two[i]);
   }
+  RecordPeakBytes(&PipelineStats::peak_mono_bytes, VectorBytes(result));
   return result;
 }
 
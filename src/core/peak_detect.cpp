@@ -8,6 +8,9 @@
 #include <tuple>
 #include <vector>
 
+#include "src/core/pipeline_stats.h"
+#include "src/core/simd_kernels.h"
+
 namespace musher {
 namespace core {
 
@@ -18,14 +21,16 @@ std::tuple<double, double> QuadraticInterpolation(double a, double b, double y,
   return std::make_tuple(peak_location, peak_height_estimate);
 }
 
-std::vector<std::tuple<double, double>> PeakDetect(const std::vector<double> &inp,
-                                                   double threshold,
-                                                   bool interpolate,
-                                                   std::string sort_by,
-                                                   int max_num_peaks,
-                                                   double range,
-                                                   int min_pos,
-                                                   int max_pos) {
+void PeakDetect(const std::vector<double> &inp,
+                std::vector<std::tuple<double, double>> &estimated_peaks,
+                double threshold,
+                bool interpolate,
+                const std::string &sort_by,
+                int max_num_peaks,
+                double range,
+                int min_pos,
+                int max_pos) {
+  StageTimer stage_timer(&PipelineStats::peaks_seconds);
   int _max_pos = max_pos;
   const int inp_size = inp.size();
   if (inp_size < 2) {
@@ -38,7 +43,7 @@ std::vector<std::tuple<double, double>> PeakDetect(const std::vector<double> &in
     throw std::runtime_error(err_msg);
   }
 
-  std::vector<std::tuple<double, double>> estimated_peaks;
+  estimated_peaks.clear();
 
   double scale = 1;
   if (range > 0) {
@@ -61,101 +66,69 @@ std::vector<std::tuple<double, double>> PeakDetect(const std::vector<double> &in
     estimated_peaks.push_back(peak);
   }
 
-  while (true) {
-    //  Down:
-    //    [0, 3, 4, 3, 2, 1, 1, 0]
-    //           ^  ^  ^  ^  ^
-    //
-    while (i + 1 < inp_size - 1 && inp[i] >= inp[i + 1]) {
-      i++;
-    }
-
-    //  Up:
-    //    [0, 0, 1, 2, 3, 4, 3, 2]
-    //           ^  ^  ^  ^
-
-    while (i + 1 < inp_size - 1 && inp[i] < inp[i + 1]) {
-      i++;
-    }
-    // Do not register a peak here because we need to check for a flat peak
-
-    //  Flat peak:
-    //    [0, 0, 1, 1, 1, 1, 0, 0]
-    //           ^  ^  ^  ^
-    int j = i;
-    while (j + 1 < inp_size - 1 && (inp[j] == inp[j + 1])) {
-      j++;
-    }
-
-    // Check element right before the last element
-    if (i + 1 >= inp_size - 1) {
-      if (i == inp_size - 2 && inp[i - 1] < inp[i] && inp[i + 1] < inp[i] && inp[i] > threshold) {
-        double pos;
-        double val;
-
-        if (interpolate) {
-          std::tie(pos, val) = QuadraticInterpolation(inp[i - 1], inp[i], inp[i + 1], j);
-        } else {
-          pos = i;
-          val = inp[i];
-        }
-        std::tuple<double, double> peak(pos * scale, val);
-        estimated_peaks.push_back(peak);
+  // A peak is the last sample j of a rise followed by an optional plateau [plateau_start, j], followed by a descent.
+  // The candidates are found with a vectorized scan, the rise is checked here.
+  const double *data = inp.data();
+  const size_t scan_end = static_cast<size_t>(inp_size - 1);
+  const int start = i;
+  // Starting right before the last element, the lower bound is checked once more as a regular peak.
+  const int scan_begin = std::max(start == inp_size - 2 ? start : start + 1, 1);
+  bool max_pos_reached = false;
+  for (size_t candidate = NextPeakCandidate(data, static_cast<size_t>(scan_begin), scan_end, threshold);
+       candidate < scan_end; candidate = NextPeakCandidate(data, candidate + 1, scan_end, threshold)) {
+    int j = static_cast<int>(candidate);
+    int plateau_start = j;
+    while (plateau_start > start && inp[plateau_start - 1] == inp[plateau_start]) plateau_start--;
+    if ((plateau_start == start && start != inp_size - 2) || !(inp[plateau_start - 1] < inp[plateau_start])) continue;
+
+    double pos;
+    double val;
+
+    if (j != plateau_start) {  // Flat peak between plateau_start and j
+      if (interpolate) {
+        // Get the middle of the flat peak
+        pos = (plateau_start + j) * 0.5;
+      } else {
+        // Get rising edge of flat peak
+        pos = plateau_start;
       }
-
-      // We are dividing by scale because the scale should have been accounted for when the user input the value
-      double scale_removed_max_pos = _max_pos / scale;
-      // Check if element before last is a peak right before breaking the loop
-      if (scale_removed_max_pos > inp_size - 2 && scale_removed_max_pos <= inp_size - 1 &&
-          inp[inp_size - 1] > inp[inp_size - 2] && inp[inp_size - 1] > threshold) {
-        std::tuple<double, double> peak((inp_size - 1) * scale, inp[inp_size - 1]);
-        estimated_peaks.push_back(peak);
+      val = inp[plateau_start];
+    } else {  // Interpolate peak at j-1, j and j+1
+      if (interpolate) {
+        std::tie(pos, val) = QuadraticInterpolation(inp[j - 1], inp[j], inp[j + 1], j);
+      } else {
+        pos = j;
+        val = inp[j];
       }
-      break;
     }
 
-    // Flat peak ends, check if we are going down
-    if ((j + 1 <= inp_size - 1) && inp[j] > inp[j + 1] && inp[j] > threshold) {
-      double pos;
-      double val;
-
-      if (j != i) {  // Flat peak between i and j
-        if (interpolate) {
-          // Get the middle of the flat peak
-          pos = (i + j) * 0.5;
-        } else {
-          // Get rising edge of flat peak
-          pos = i;
-        }
-        val = inp[i];
-      } else {  // Interpolate peak at i-1, i and i+1
-        if (interpolate) {
-          std::tie(pos, val) = QuadraticInterpolation(inp[i - 1], inp[i], inp[i + 1], j);
-        } else {
-          pos = j;
-          val = inp[j];
-        }
-      }
+    // A single peak right before the last element is always kept, like the walk this scan replaced did.
+    if (pos * scale > _max_pos && !(j == plateau_start && j == inp_size - 2)) {
+      max_pos_reached = true;
+      break;
+    }
 
-      if (pos * scale > _max_pos) break;
+    std::tuple<double, double> peak(pos * scale, val);
+    estimated_peaks.push_back(peak);
+  }
 
-      std::tuple<double, double> peak(pos * scale, val);
+  if (!max_pos_reached) {
+    // We are dividing by scale because the scale should have been accounted for when the user input the value
+    double scale_removed_max_pos = _max_pos / scale;
+    // Check if the last element is a peak
+    if (scale_removed_max_pos > inp_size - 2 && scale_removed_max_pos <= inp_size - 1 &&
+        inp[inp_size - 1] > inp[inp_size - 2] && inp[inp_size - 1] > threshold) {
+      std::tuple<double, double> peak((inp_size - 1) * scale, inp[inp_size - 1]);
       estimated_peaks.push_back(peak);
     }
-
-    // No flat peak... We continue up, so we start loop again
-    i = j;
   }
 
   // Sorting
-  std::transform(sort_by.begin(), sort_by.end(), sort_by.begin(), [](unsigned char c) { return std::tolower(c); });
-
-  std::vector<std::tuple<double, double>> sorted_estimated_peaks = estimated_peaks;
   if (sort_by == "position") {
     // Already sorted by position (Frequency)
   } else if (sort_by == "height") {
     // height (Magnitude)
-    std::sort(sorted_estimated_peaks.begin(), sorted_estimated_peaks.end(),
+    std::sort(estimated_peaks.begin(), estimated_peaks.end(),
               [](auto const &t1, auto const &t2) { return std::get<1>(t1) > std::get<1>(t2); });
   } else {
     std::string err_msg = "Sorting by '" + sort_by + "' is not supported.";
@@ -164,15 +137,23 @@ std::vector<std::tuple<double, double>> PeakDetect(const std::vector<double> &in
 
   // Shrink to max number of peaks
   size_t num_peaks = max_num_peaks;
-  if (num_peaks != 0 && num_peaks < sorted_estimated_peaks.size()) {
-    std::vector<std::tuple<double, double>> limited_num_of_sorted_estimated_peaks = sorted_estimated_peaks;
-    limited_num_of_sorted_estimated_peaks.resize(num_peaks);
-    limited_num_of_sorted_estimated_peaks.shrink_to_fit();
+  if (num_peaks != 0 && num_peaks < estimated_peaks.size()) estimated_peaks.resize(num_peaks);
+  CountStat(&PipelineStats::peaks_found, static_cast<int64_t>(estimated_peaks.size()));
+}
 
-    return limited_num_of_sorted_estimated_peaks;
-  }
+std::vector<std::tuple<double, double>> PeakDetect(const std::vector<double> &inp,
+                                                   double threshold,
+                                                   bool interpolate,
+                                                   std::string sort_by,
+                                                   int max_num_peaks,
+                                                   double range,
+                                                   int min_pos,
+                                                   int max_pos) {
+  std::transform(sort_by.begin(), sort_by.end(), sort_by.begin(), [](unsigned char c) { return std::tolower(c); });
 
-  return sorted_estimated_peaks;
+  std::vector<std::tuple<double, double>> estimated_peaks;
+  PeakDetect(inp, estimated_peaks, threshold, interpolate, sort_by, max_num_peaks, range, min_pos, max_pos);
+  return estimated_peaks;
 }
 
 }  // namespace core
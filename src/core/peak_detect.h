@@ -65,5 +65,30 @@ std::vector<std::tuple<double, double>> PeakDetect(const std::vector<double> &in
                                                    int min_pos = 0,
                                                    int max_pos = 0);
 
+/**
+ * @brief Overloaded function for PeakDetect that writes the peaks to an existing vector.
+ *
+ * Does not allocate as long as the capacity of estimated_peaks is large enough (at most inp.size() peaks are found).
+ *
+ * @param inp Input vector.
+ * @param estimated_peaks Output vector of peaks, each peak being a tuple (positions, heights). It is cleared first.
+ * @param threshold Peaks below this given threshold are not outputted.
+ * @param interpolate Enables interpolation.
+ * @param sort_by Ordering type of the outputted peaks, either "position" or "height" (lowercase).
+ * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
+ * @param range Input range.
+ * @param min_pos Maximum position of the range to evaluate.
+ * @param max_pos Minimum position of the range to evaluate.
+ */
+void PeakDetect(const std::vector<double> &inp,
+                std::vector<std::tuple<double, double>> &estimated_peaks,
+                double threshold,
+                bool interpolate,
+                const std::string &sort_by,
+                int max_num_peaks,
+                double range,
+                int min_pos,
+                int max_pos);
+
 }  // namespace core
 }  // namespace musher
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "src/core/pipeline_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace musher {
+namespace core {
+
+namespace detail {
+std::atomic<bool> stats_enabled(false);
+}  // namespace detail
+
+namespace {
+
+// Whether a stage is being timed on this thread, the stages it calls are then part of it.
+thread_local bool stage_active = false;
+
+}  // namespace
+
+void SetStatsEnabled(bool enabled) { detail::stats_enabled.store(enabled); }
+
+PipelineStats &ThreadStats() {
+  thread_local PipelineStats thread_stats;
+  return thread_stats;
+}
+
+void ResetThreadStats() { ThreadStats() = PipelineStats(); }
+
+PipelineStats StatsDifference(const PipelineStats &end, const PipelineStats &start) {
+  PipelineStats difference;
+  difference.decode_seconds = end.decode_seconds - start.decode_seconds;
+  difference.mix_seconds = end.mix_seconds - start.mix_seconds;
+  difference.resample_seconds = end.resample_seconds - start.resample_seconds;
+  difference.frame_seconds = end.frame_seconds - start.frame_seconds;
+  difference.window_seconds = end.window_seconds - start.window_seconds;
+  difference.fft_seconds = end.fft_seconds - start.fft_seconds;
+  difference.peaks_seconds = end.peaks_seconds - start.peaks_seconds;
+  difference.hpcp_seconds = end.hpcp_seconds - start.hpcp_seconds;
+  difference.estimate_seconds = end.estimate_seconds - start.estimate_seconds;
+  difference.frames_processed = end.frames_processed - start.frames_processed;
+  difference.frames_skipped = end.frames_skipped - start.frames_skipped;
+  difference.peaks_found = end.peaks_found - start.peaks_found;
+  difference.bytes_decoded = end.bytes_decoded - start.bytes_decoded;
+  difference.peak_file_bytes = end.peak_file_bytes;
+  difference.peak_decoded_bytes = end.peak_decoded_bytes;
+  difference.peak_mono_bytes = end.peak_mono_bytes;
+  difference.peak_frame_bytes = end.peak_frame_bytes;
+  difference.peak_spectrum_bytes = end.peak_spectrum_bytes;
+  return difference;
+}
+
+PipelineStats BeginCallStats() {
+  if (!StatsEnabled()) return PipelineStats();
+  PipelineStats &stats = ThreadStats();
+  PipelineStats start = stats;
+  stats.peak_file_bytes = 0;
+  stats.peak_decoded_bytes = 0;
+  stats.peak_mono_bytes = 0;
+  stats.peak_frame_bytes = 0;
+  stats.peak_spectrum_bytes = 0;
+  return start;
+}
+
+PipelineStats EndCallStats(const PipelineStats &start) {
+  if (!StatsEnabled()) return PipelineStats();
+  PipelineStats &stats = ThreadStats();
+  PipelineStats call_stats = StatsDifference(stats, start);
+  stats.peak_file_bytes = std::max(stats.peak_file_bytes, start.peak_file_bytes);
+  stats.peak_decoded_bytes = std::max(stats.peak_decoded_bytes, start.peak_decoded_bytes);
+  stats.peak_mono_bytes = std::max(stats.peak_mono_bytes, start.peak_mono_bytes);
+  stats.peak_frame_bytes = std::max(stats.peak_frame_bytes, start.peak_frame_bytes);
+  stats.peak_spectrum_bytes = std::max(stats.peak_spectrum_bytes, start.peak_spectrum_bytes);
+  return call_stats;
+}
+
+StageTimer::StageTimer(double PipelineStats::*stage) : stage_(nullptr) {
+  if (!StatsEnabled() || stage_active) return;
+  stage_ = stage;
+  stage_active = true;
+  start_ = std::chrono::steady_clock::now();
+}
+
+StageTimer::~StageTimer() {
+  if (stage_ == nullptr) return;
+  ThreadStats().*stage_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  stage_active = false;
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Time spent in each stage of the analysis and counters of the processed data.
+ *
+ * The stages are accumulated per thread while stats are enabled (see SetStatsEnabled). When a stage calls another
+ * instrumented function, the time goes to the outer stage only, so the stage times never overlap. The peaks are the
+ * largest number of bytes the buffers of a stage held at once, for example the decoded channels together with the
+ * temporary buffers of the decoder. Their sum bounds the memory of an analysis.
+ */
+struct PipelineStats {
+  double decode_seconds = 0.;    //!< LoadAudioFile, DecodeWav and DecodeMp3.
+  double mix_seconds = 0.;       //!< Downmix to mono.
+  double resample_seconds = 0.;  //!< Resampling to the analysis sample rate.
+  double frame_seconds = 0.;     //!< Cutting the frames.
+  double window_seconds = 0.;    //!< Windowing.
+  double fft_seconds = 0.;       //!< Magnitude and power spectra.
+  double peaks_seconds = 0.;     //!< Spectral peak detection.
+  double hpcp_seconds = 0.;      //!< HPCP of the spectral peaks.
+  double estimate_seconds = 0.;  //!< Key profile correlation and key estimation.
+
+  int64_t frames_processed = 0;  //!< Frames whose HPCP was computed.
+  int64_t frames_skipped = 0;    //!< Frames skipped because they were below the RMS threshold.
+  int64_t peaks_found = 0;       //!< Spectral peaks returned by the peak detection.
+  int64_t bytes_decoded = 0;     //!< Size of the decoded audio files.
+
+  int64_t peak_file_bytes = 0;      //!< Audio file data loaded in memory.
+  int64_t peak_decoded_bytes = 0;   //!< Decoded channels and the intermediate buffers of the decoder.
+  int64_t peak_mono_bytes = 0;      //!< Mono mixdown of the signal.
+  int64_t peak_frame_bytes = 0;     //!< Frames cut from the channels and their mixdown.
+  int64_t peak_spectrum_bytes = 0;  //!< Windowed frame, spectrum, spectral peaks and HPCP of a frame.
+};
+
+namespace detail {
+extern std::atomic<bool> stats_enabled;
+}  // namespace detail
+
+/**
+ * @brief Enable or disable the stats of every thread. Disabled by default, the instrumentation then only costs a
+ * relaxed atomic load per stage.
+ *
+ * @param enabled Whether to record the stats.
+ */
+void SetStatsEnabled(bool enabled);
+
+/**
+ * @brief Whether the stats are recorded.
+ *
+ * @return bool True if enabled.
+ */
+inline bool StatsEnabled() { return detail::stats_enabled.load(std::memory_order_relaxed); }
+
+/**
+ * @brief Stats accumulated by the calling thread since the last ResetThreadStats.
+ *
+ * @return PipelineStats& Accumulator of the calling thread.
+ */
+PipelineStats &ThreadStats();
+
+/**
+ * @brief Clear the stats of the calling thread.
+ */
+void ResetThreadStats();
+
+/**
+ * @brief Stats accumulated between two snapshots of ThreadStats.
+ *
+ * @param end Later snapshot.
+ * @param start Earlier snapshot.
+ * @return PipelineStats end - start, field by field, except the peaks which are the ones of end.
+ */
+PipelineStats StatsDifference(const PipelineStats &end, const PipelineStats &start);
+
+/**
+ * @brief Start measuring the stats of a call. The peaks of ThreadStats are cleared, so that they only see the call
+ * until EndCallStats.
+ *
+ * @return PipelineStats Snapshot of ThreadStats to pass to EndCallStats, all zeros if stats are disabled.
+ */
+PipelineStats BeginCallStats();
+
+/**
+ * @brief Stats of the call started by BeginCallStats. The peaks of ThreadStats become the peaks of the thread again.
+ *
+ * @param start Snapshot returned by BeginCallStats.
+ * @return PipelineStats Stats of the call, all zeros if stats are disabled.
+ */
+PipelineStats EndCallStats(const PipelineStats &start);
+
+/**
+ * @brief Add to a counter of the calling thread if stats are enabled.
+ *
+ * @param counter Counter of PipelineStats, for example &PipelineStats::peaks_found.
+ * @param amount Amount to add.
+ */
+inline void CountStat(int64_t PipelineStats::*counter, int64_t amount) {
+  if (StatsEnabled()) ThreadStats().*counter += amount;
+}
+
+/**
+ * @brief Raise a peak of the calling thread to bytes if stats are enabled.
+ *
+ * @param peak Peak of PipelineStats, for example &PipelineStats::peak_frame_bytes.
+ * @param bytes Bytes held by the stage.
+ */
+inline void RecordPeakBytes(int64_t PipelineStats::*peak, int64_t bytes) {
+  if (!StatsEnabled()) return;
+  PipelineStats &stats = ThreadStats();
+  if (bytes > stats.*peak) stats.*peak = bytes;
+}
+
+/**
+ * @brief Bytes allocated by a vector.
+ *
+ * @param vector Vector.
+ * @return int64_t capacity() * sizeof(T).
+ */
+template <typename T>
+int64_t VectorBytes(const std::vector<T> &vector) {
+  return static_cast<int64_t>(vector.capacity() * sizeof(T));
+}
+
+/**
+ * @brief Adds the time between its construction and destruction to a stage of the calling thread.
+ *
+ * @code
+ *   std::vector<double> Windowing(...) {
+ *     StageTimer stage_timer(&PipelineStats::window_seconds);
+ *     ...
+ *   }
+ * @endcode
+ */
+class StageTimer {
+ public:
+  explicit StageTimer(double PipelineStats::*stage);
+  ~StageTimer();
+
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+
+ private:
+  double PipelineStats::*stage_;  //!< Null when stats are disabled or an outer stage is already timed.
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,455 @@
+#include "src/core/reference_backend.h"
+
+#include <pocketfft/pocketfft.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/hpcp.h"
+#include "src/core/key.h"
+#include "src/core/peak_detect.h"
+#include "src/core/spectrum.h"
+
+namespace musher {
+namespace core {
+namespace reference {
+
+std::vector<double> Windowing(const std::vector<double> &audio_frame, const std::vector<double> &window) {
+  int signal_size = audio_frame.size();
+  if (signal_size <= 1) throw std::runtime_error("Windowing: frame (signal) size should be larger than 1");
+  if (window.size() != audio_frame.size()) throw std::runtime_error("Windowing: window and frame sizes do not match");
+
+  // The second half of the windowed frame goes first.
+  std::vector<double> windowed_signal(audio_frame.size());
+  int half = signal_size / 2;
+  for (int i = half; i < signal_size; i++) windowed_signal[i - half] = audio_frame[i] * window[i];
+  for (int i = 0; i < half; i++) windowed_signal[signal_size - half + i] = audio_frame[i] * window[i];
+  return windowed_signal;
+}
+
+std::vector<double> ConvertToFrequencySpectrum(const std::vector<double> &audio_frame) {
+  if (audio_frame.empty()) return std::vector<double>();
+
+  std::vector<double> padded_frame(audio_frame);
+  padded_frame.resize(NextFastLen(audio_frame.size() - 1), 0.0);
+
+  pocketfft::shape_t shape{padded_frame.size()};
+  pocketfft::stride_t stride_in{sizeof(double)};
+  pocketfft::stride_t stride_out{sizeof(std::complex<double>)};
+  std::vector<std::complex<double>> transform(padded_frame.size() / 2 + 1);
+  pocketfft::r2c(shape, stride_in, stride_out, 0, pocketfft::FORWARD, padded_frame.data(), transform.data(), 1.0);
+
+  std::vector<double> spectrum(transform.size());
+  for (size_t i = 0; i < transform.size(); i++) spectrum[i] = Magnitude(transform[i]);
+  return spectrum;
+}
+
+std::vector<std::tuple<double, double>> PeakDetect(const std::vector<double> &inp,
+                                                   double threshold,
+                                                   bool interpolate,
+                                                   std::string sort_by,
+                                                   int max_num_peaks,
+                                                   double range,
+                                                   int min_pos,
+                                                   int max_pos) {
+  int _max_pos = max_pos;
+  const int inp_size = inp.size();
+  if (inp_size < 2) {
+    std::string err_msg = "Peak detection input vector must be greater than 2.";
+    throw std::runtime_error(err_msg);
+  }
+
+  if (min_pos != 0 && _max_pos != 0 && min_pos >= _max_pos) {
+    std::string err_msg = "Peak detection max position must be greater than min position.";
+    throw std::runtime_error(err_msg);
+  }
+
+  std::vector<std::tuple<double, double>> estimated_peaks;
+
+  double scale = 1;
+  if (range > 0) {
+    scale = range / static_cast<double>(inp_size - 1);
+  }
+  // Start at minimum position
+  int i = 0;
+  if (min_pos > 0) {
+    // We are dividing by scale because the scale should have been accounted for when the user input the value
+    i = static_cast<int>(std::ceil(min_pos / scale));
+  }
+
+  if (_max_pos == 0) {
+    _max_pos = (inp_size - 1) * scale;
+  }
+
+  // Check if lower bound is a peak
+  if (inp[i] > inp[i + 1] && inp[i] > threshold) {
+    std::tuple<double, double> peak(i * scale, inp[i]);
+    estimated_peaks.push_back(peak);
+  }
+
+  while (true) {
+    // Down
+    while (i + 1 < inp_size - 1 && inp[i] >= inp[i + 1]) {
+      i++;
+    }
+
+    // Up, do not register a peak here because we need to check for a flat peak
+    while (i + 1 < inp_size - 1 && inp[i] < inp[i + 1]) {
+      i++;
+    }
+
+    // Flat peak
+    int j = i;
+    while (j + 1 < inp_size - 1 && (inp[j] == inp[j + 1])) {
+      j++;
+    }
+
+    // Check element right before the last element
+    if (i + 1 >= inp_size - 1) {
+      if (i == inp_size - 2 && inp[i - 1] < inp[i] && inp[i + 1] < inp[i] && inp[i] > threshold) {
+        double pos;
+        double val;
+
+        if (interpolate) {
+          std::tie(pos, val) = QuadraticInterpolation(inp[i - 1], inp[i], inp[i + 1], j);
+        } else {
+          pos = i;
+          val = inp[i];
+        }
+        std::tuple<double, double> peak(pos * scale, val);
+        estimated_peaks.push_back(peak);
+      }
+
+      // We are dividing by scale because the scale should have been accounted for when the user input the value
+      double scale_removed_max_pos = _max_pos / scale;
+      // Check if the last element is a peak right before breaking the loop
+      if (scale_removed_max_pos > inp_size - 2 && scale_removed_max_pos <= inp_size - 1 &&
+          inp[inp_size - 1] > inp[inp_size - 2] && inp[inp_size - 1] > threshold) {
+        std::tuple<double, double> peak((inp_size - 1) * scale, inp[inp_size - 1]);
+        estimated_peaks.push_back(peak);
+      }
+      break;
+    }
+
+    // Flat peak ends, check if we are going down
+    if ((j + 1 <= inp_size - 1) && inp[j] > inp[j + 1] && inp[j] > threshold) {
+      double pos;
+      double val;
+
+      if (j != i) {  // Flat peak between i and j
+        if (interpolate) {
+          // Get the middle of the flat peak
+          pos = (i + j) * 0.5;
+        } else {
+          // Get rising edge of flat peak
+          pos = i;
+        }
+        val = inp[i];
+      } else {  // Interpolate peak at i-1, i and i+1
+        if (interpolate) {
+          std::tie(pos, val) = QuadraticInterpolation(inp[i - 1], inp[i], inp[i + 1], j);
+        } else {
+          pos = j;
+          val = inp[j];
+        }
+      }
+
+      if (pos * scale > _max_pos) break;
+
+      std::tuple<double, double> peak(pos * scale, val);
+      estimated_peaks.push_back(peak);
+    }
+
+    // No flat peak... We continue up, so we start loop again
+    i = j;
+  }
+
+  // Sorting
+  std::transform(sort_by.begin(), sort_by.end(), sort_by.begin(), [](unsigned char c) { return std::tolower(c); });
+  if (sort_by == "position") {
+    // Already sorted by position (Frequency)
+  } else if (sort_by == "height") {
+    // height (Magnitude)
+    std::sort(estimated_peaks.begin(), estimated_peaks.end(),
+              [](auto const &t1, auto const &t2) { return std::get<1>(t1) > std::get<1>(t2); });
+  } else {
+    std::string err_msg = "Sorting by '" + sort_by + "' is not supported.";
+    throw std::runtime_error(err_msg);
+  }
+
+  // Shrink to max number of peaks
+  size_t num_peaks = max_num_peaks;
+  if (num_peaks != 0 && num_peaks < estimated_peaks.size()) estimated_peaks.resize(num_peaks);
+  return estimated_peaks;
+}
+
+std::vector<double> HPCP(const std::vector<std::tuple<double, double>> &peaks,
+                         unsigned int size,
+                         double reference_frequency,
+                         unsigned int harmonics,
+                         bool band_preset,
+                         double band_split_frequency,
+                         double min_frequency,
+                         double max_frequency,
+                         std::string _weight_type,
+                         double window_size,
+                         bool max_shifted,
+                         bool non_linear,
+                         std::string _normalized) {
+  // Input validation
+  if (size % 12 != 0) {
+    throw std::runtime_error("HPCP: The size parameter is not a multiple of 12.");
+  }
+
+  if ((max_frequency - min_frequency) < 200.0) {
+    throw std::runtime_error("HPCP: Minimum and maximum frequencies are too close");
+  }
+
+  if (band_preset) {
+    if ((band_split_frequency - min_frequency) < 200.0) {
+      throw std::runtime_error("HPCP: Low band frequency range too small");
+    }
+    if ((max_frequency - band_split_frequency) < 200.0) {
+      throw std::runtime_error("HPCP: High band frequency range too small");
+    }
+  }
+
+  if (window_size * size / 12 < 1.0) {
+    throw std::runtime_error("HPCP: Your window_size needs to span at least one hpcp bin (window_size >= 12/size)");
+  }
+
+  WeightType weight_type;
+  if (_weight_type == "none")
+    weight_type = NONE;
+  else if (_weight_type == "cosine")
+    weight_type = COSINE;
+  else if (_weight_type == "squared cosine")
+    weight_type = SQUARED_COSINE;
+  else {
+    std::string err_message = "HPCP: Invalid weight type of: ";
+    err_message += _weight_type;
+    throw std::runtime_error(err_message);
+  }
+
+  NormalizeType Normalized;
+  if (_normalized == "none")
+    Normalized = N_NONE;
+  else if (_normalized == "unit sum")
+    Normalized = N_UNIT_SUM;
+  else if (_normalized == "unit max")
+    Normalized = N_UNIT_MAX;
+  else {
+    std::string err_message = "HPCP: Invalid Normalize type of: ";
+    err_message += _normalized;
+    throw std::runtime_error(err_message);
+  }
+
+  if (non_linear && Normalized != N_UNIT_MAX) {
+    throw std::runtime_error("HPCP: Cannot apply non-linear filter when HPCP vector is not Normalized to unit max.");
+  }
+
+  std::vector<HarmonicPeak> harmonic_peaks = InitHarmonicContributionTable(harmonics);
+  std::vector<double> hpcp(size, 0.0);
+  std::vector<double> hpcp_LO(band_preset ? size : 0, 0.0);
+  std::vector<double> hpcp_HI(band_preset ? size : 0, 0.0);
+
+  // Add each contribution of the spectral frequencies to the HPCP
+  for (const std::tuple<double, double> &peak : peaks) {
+    double freq = std::get<0>(peak);
+    double mag_lin = std::get<1>(peak);
+
+    // Filter out frequencies not between min and max
+    if (freq >= min_frequency && freq <= max_frequency) {
+      if (band_preset) {
+        AddContribution(freq, mag_lin, reference_frequency, window_size, weight_type, harmonic_peaks,
+                        (freq < band_split_frequency) ? hpcp_LO : hpcp_HI);
+      } else {
+        AddContribution(freq, mag_lin, reference_frequency, window_size, weight_type, harmonic_peaks, hpcp);
+      }
+    }
+  }
+
+  if (band_preset) {
+    if (Normalized == N_UNIT_MAX) {
+      NormalizeInPlace(hpcp_LO);
+      NormalizeInPlace(hpcp_HI);
+    } else if (Normalized == N_UNIT_SUM) {
+      NormalizeSumInPlace(hpcp_LO);
+      NormalizeSumInPlace(hpcp_HI);
+    }
+
+    for (size_t i = 0; i < hpcp.size(); i++) {
+      hpcp[i] = hpcp_LO[i] + hpcp_HI[i];
+    }
+  }
+
+  if (Normalized == N_UNIT_MAX) {
+    NormalizeInPlace(hpcp);
+  } else if (Normalized == N_UNIT_SUM) {
+    NormalizeSumInPlace(hpcp);
+  }
+
+  // Jordi non-linear post-processing step
+  if (non_linear) {
+    for (size_t i = 0; i < hpcp.size(); i++) {
+      hpcp[i] = std::sin(hpcp[i] * M_PI * 0.5);
+      hpcp[i] *= hpcp[i];
+      if (hpcp[i] < 0.6) {
+        hpcp[i] *= hpcp[i] / 0.6 * hpcp[i] / 0.6;
+      }
+    }
+  }
+
+  // Shift all of the elements so that the largest HPCP value is at index 0
+  if (max_shifted) {
+    std::rotate(hpcp.begin(), hpcp.begin() + ArgMax(hpcp), hpcp.end());
+  }
+  return hpcp;
+}
+
+namespace {
+
+/**
+ * @brief Adds the chords of the key to an empty profile, one contribution at a time in the order of the original
+ * EstimateKey.
+ */
+std::vector<double> PolyphonicMajorProfile(const std::vector<double> &M,
+                                           bool use_three_chords,
+                                           unsigned int num_harmonics,
+                                           double slope) {
+  const int h = static_cast<int>(num_harmonics);
+  std::vector<double> chords(12, 0.0);
+  chords = AddMajorTriad(chords, 0, M[0], h, slope);  // Tonic (I)
+  if (!use_three_chords) {
+    chords = AddMinorTriad(chords, 2, M[2], h, slope);  // II
+    chords = AddMinorTriad(chords, 4, M[4], h, slope);  // III
+  }
+  chords = AddMajorTriad(chords, 5, M[5], h, slope);  // Subdominant (IV)
+  chords = AddMajorTriad(chords, 7, M[7], h, slope);  // Dominant (V)
+  if (!use_three_chords) {
+    chords = AddMinorTriad(chords, 9, M[9], h, slope);  // VI
+    // VII (5th diminished)
+    chords = AddContributionHarmonics(chords, 11, M[11], h, slope);
+    chords = AddContributionHarmonics(chords, 2, M[11], h, slope);
+    chords = AddContributionHarmonics(chords, 5, M[11], h, slope);
+  }
+  return chords;
+}
+
+std::vector<double> PolyphonicMinorProfile(const std::vector<double> &m,
+                                           bool use_three_chords,
+                                           unsigned int num_harmonics,
+                                           double slope) {
+  const int h = static_cast<int>(num_harmonics);
+  std::vector<double> chords(12, 0.0);
+  chords = AddMinorTriad(chords, 0, m[0], h, slope);  // Tonic (I)
+  if (!use_three_chords) {
+    // II (5th diminished)
+    chords = AddContributionHarmonics(chords, 2, m[2], h, slope);
+    chords = AddContributionHarmonics(chords, 5, m[2], h, slope);
+    chords = AddContributionHarmonics(chords, 8, m[2], h, slope);
+    // III (5th augmented)
+    chords = AddContributionHarmonics(chords, 3, m[3], h, slope);
+    chords = AddContributionHarmonics(chords, 7, m[3], h, slope);
+    chords = AddContributionHarmonics(chords, 11, m[3], h, slope);
+  }
+  chords = AddMinorTriad(chords, 5, m[5], h, slope);  // Subdominant (IV)
+  chords = AddMajorTriad(chords, 7, m[7], h, slope);  // Dominant (V) (harmonic minor scale)
+  if (!use_three_chords) {
+    chords = AddMajorTriad(chords, 8, m[8], h, slope);  // VI
+    // VII (diminished 5th)
+    chords = AddContributionHarmonics(chords, 11, m[8], h, slope);
+    chords = AddContributionHarmonics(chords, 2, m[8], h, slope);
+    chords = AddContributionHarmonics(chords, 5, m[8], h, slope);
+  }
+  return chords;
+}
+
+/**
+ * @brief Correlation of the PCP with every shift of a profile, walking the shifted profile with a modulo.
+ */
+std::vector<double> CorrelateShifts(const std::vector<double> &pcp,
+                                    double mean_pcp,
+                                    double std_pcp,
+                                    const std::vector<double> &profile) {
+  const int size = static_cast<int>(pcp.size());
+  double sum_profile = 0.0;
+  for (double value : profile) sum_profile += value;
+  const double mean_profile = sum_profile / size;
+  double std_profile = 0.0;
+  for (double value : profile) std_profile += (value - mean_profile) * (value - mean_profile);
+  std_profile = std::sqrt(std_profile);
+
+  std::vector<double> correlations(pcp.size());
+  for (int shift = 0; shift < size; shift++) {
+    double r = 0.0;
+    for (int i = 0; i < size; i++) {
+      int index = (i - shift) % size;
+      if (index < 0) index += size;
+      r += (pcp[i] - mean_pcp) * (profile[index] - mean_profile);
+    }
+    correlations[shift] = r / (std_pcp * std_profile);
+  }
+  return correlations;
+}
+
+}  // namespace
+
+KeyCorrelations CorrelateKeyProfiles(const std::vector<double> &pcp, const KeyProfilePlan &plan) {
+  if (pcp.size() != plan.pcp_size) throw std::runtime_error("Key: input PCP size does not match the key profile plan");
+
+  // The profiles are built again from the parameters of the plan, without the compile-time expansion nor the
+  // circulant matrices, so that the cross-check also covers how the plan was built.
+  const std::vector<std::vector<double>> key_profile = SelectKeyProfile(plan.profile_type);
+  std::vector<double> M = key_profile[0];
+  std::vector<double> m = key_profile[1];
+  std::vector<double> O = key_profile.size() == 3 ? key_profile[2] : std::vector<double>(12, 0.0);
+  if (plan.use_polphony) {
+    M = PolyphonicMajorProfile(key_profile[0], plan.use_three_chords, plan.num_harmonics, plan.slope);
+    m = PolyphonicMinorProfile(key_profile[1], plan.use_three_chords, plan.num_harmonics, plan.slope);
+  }
+
+  double sum_pcp = 0.0;
+  for (double value : pcp) sum_pcp += value;
+  const double mean_pcp = sum_pcp / pcp.size();
+  double std_pcp = 0.0;
+  for (double value : pcp) std_pcp += (value - mean_pcp) * (value - mean_pcp);
+  std_pcp = std::sqrt(std_pcp);
+
+  KeyCorrelations key_correlations;
+  key_correlations.major =
+      CorrelateShifts(pcp, mean_pcp, std_pcp, std::get<0>(ResizeProfileToPcpSize(plan.pcp_size, M)));
+  key_correlations.minor =
+      CorrelateShifts(pcp, mean_pcp, std_pcp, std::get<0>(ResizeProfileToPcpSize(plan.pcp_size, m)));
+  if (plan.use_maj_min)
+    key_correlations.other =
+        CorrelateShifts(pcp, mean_pcp, std_pcp, std::get<0>(ResizeProfileToPcpSize(plan.pcp_size, O)));
+  return key_correlations;
+}
+
+FrameStages AnalyzeFrame(const std::vector<double> &frame,
+                         const std::vector<double> &window,
+                         double sample_rate,
+                         unsigned int pcp_size,
+                         unsigned int harmonics,
+                         unsigned int max_num_peaks,
+                         double window_size) {
+  FrameStages stages;
+  stages.windowed_frame = Windowing(frame, window);
+  stages.spectrum = ConvertToFrequencySpectrum(stages.windowed_frame);
+  stages.spectral_peaks =
+      PeakDetect(stages.spectrum, -1000.0, true, "height", max_num_peaks, sample_rate / 2.0, 0, sample_rate / 2);
+  stages.hpcp = HPCP(stages.spectral_peaks, pcp_size, 440.0, harmonics, true, 500.0, 40.0, 5000.0, "squared cosine",
+                     window_size);
+  return stages;
+}
+
+}  // namespace reference
+}  // namespace core
+}  // namespace musher
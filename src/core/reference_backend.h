@@ -0,0 +1,100 @@
+#pragma once
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/core/backend.h"
+#include "src/core/key_profile_plan.h"
+
+namespace musher {
+namespace core {
+namespace reference {
+
+/**
+ * The reference backend: straightforward scalar implementations of the frame analysis stages and of the key profile
+ * correlation. They do not use the plans, work buffers or SIMD kernels of the optimized stages, so the optimized
+ * results can be checked against them (see Backend::kCrossCheck).
+ */
+
+/**
+ * @brief Zero-phase windowing of a frame without zero padding, see core::Windowing.
+ *
+ * @param audio_frame Frame to window.
+ * @param window Normalized window of the same size as the frame.
+ * @return std::vector<double> Windowed frame.
+ */
+std::vector<double> Windowing(const std::vector<double> &audio_frame, const std::vector<double> &window);
+
+/**
+ * @brief Magnitude spectrum of a frame, padded to the same FFT length as core::ConvertToFrequencySpectrum.
+ *
+ * @param audio_frame Windowed frame.
+ * @return std::vector<double> Magnitude spectrum.
+ */
+std::vector<double> ConvertToFrequencySpectrum(const std::vector<double> &audio_frame);
+
+/**
+ * @brief Peak detection by walking down and up the input, see core::PeakDetect for the parameters.
+ */
+std::vector<std::tuple<double, double>> PeakDetect(const std::vector<double> &inp,
+                                                   double threshold,
+                                                   bool interpolate,
+                                                   std::string sort_by,
+                                                   int max_num_peaks,
+                                                   double range,
+                                                   int min_pos,
+                                                   int max_pos);
+
+/**
+ * @brief HPCP of spectral peaks, see core::HPCP for the parameters.
+ */
+std::vector<double> HPCP(const std::vector<std::tuple<double, double>> &peaks,
+                         unsigned int size,
+                         double reference_frequency,
+                         unsigned int harmonics,
+                         bool band_preset,
+                         double band_split_frequency,
+                         double min_frequency,
+                         double max_frequency,
+                         std::string _weight_type,
+                         double window_size,
+                         bool max_shifted = false,
+                         bool non_linear = false,
+                         std::string _normalized = "unit max");
+
+/**
+ * @brief Correlation of a PCP with every shift of the key profiles, one shift at a time.
+ *
+ * Only the parameters of the plan are used: the profiles are selected, expanded with the chord and harmonic
+ * contributions at runtime and resized again, so a plan built wrongly does not go unnoticed in cross-check mode.
+ *
+ * @param pcp PCP of size plan.pcp_size.
+ * @param plan Key profiles.
+ * @return KeyCorrelations See core::CorrelateKeyProfiles.
+ */
+KeyCorrelations CorrelateKeyProfiles(const std::vector<double> &pcp, const KeyProfilePlan &plan);
+
+/**
+ * @brief Every stage of the analysis of a frame, with the same parameters as core::FrameHPCP.
+ *
+ * @param frame Audio frame of any size larger than 1.
+ * @param window Normalized window of the same size as the frame.
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param pcp_size Size of the HPCP (must be a positive nonzero multiple of 12).
+ * @param harmonics Number of harmonics for frequency contribution.
+ * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
+ * @param window_size Size, in semitones, of the window used for the weighting.
+ * @return FrameStages Output of each stage.
+ */
+FrameStages AnalyzeFrame(const std::vector<double> &frame,
+                         const std::vector<double> &window,
+                         double sample_rate,
+                         unsigned int pcp_size,
+                         unsigned int harmonics,
+                         unsigned int max_num_peaks,
+                         double window_size);
+
+}  // namespace reference
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,222 @@
+#include "src/core/resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "src/core/pipeline_stats.h"
+#include "src/core/simd_kernels.h"
+
+namespace musher {
+namespace core {
+
+namespace {
+
+int64_t GreatestCommonDivisor(int64_t a, int64_t b) {
+  while (b != 0) {
+    int64_t remainder = a % b;
+    a = b;
+    b = remainder;
+  }
+  return a;
+}
+
+// Modified Bessel function of the first kind of order 0, by its power series.
+double BesselI0(double x) {
+  double sum = 1.;
+  double term = 1.;
+  const double quarter_x_squared = x * x / 4.;
+  for (int k = 1; k < 100 && term > sum * 1e-17; k++) {
+    term *= quarter_x_squared / (static_cast<double>(k) * static_cast<double>(k));
+    sum += term;
+  }
+  return sum;
+}
+
+int64_t WholeSampleRate(double sample_rate) {
+  if (!(sample_rate > 0.) || std::floor(sample_rate) != sample_rate || sample_rate > 1e9)
+    throw std::runtime_error("Resampler: sample rates should be positive whole numbers of Hz");
+  return static_cast<int64_t>(sample_rate);
+}
+
+}  // namespace
+
+Resampler::Resampler(double input_sample_rate, double output_sample_rate, const std::string quality)
+    : input_sample_rate_(input_sample_rate), output_sample_rate_(output_sample_rate), quality_(quality) {
+  int half_lower_rate_taps;
+  double kaiser_beta;
+  double rolloff;
+  if (quality == "low") {
+    half_lower_rate_taps = 8;
+    kaiser_beta = 6.;
+    rolloff = .85;
+  } else if (quality == "medium") {
+    half_lower_rate_taps = 16;
+    kaiser_beta = 8.;
+    rolloff = .9;
+  } else if (quality == "high") {
+    half_lower_rate_taps = 32;
+    kaiser_beta = 10.;
+    rolloff = .94;
+  } else {
+    throw std::runtime_error("Resampler: quality '" + quality + "' is not supported. Use low, medium or high.");
+  }
+
+  const int64_t input_rate = WholeSampleRate(input_sample_rate);
+  const int64_t output_rate = WholeSampleRate(output_sample_rate);
+  const int64_t divisor = GreatestCommonDivisor(input_rate, output_rate);
+  upsampling_ = output_rate / divisor;
+  downsampling_ = input_rate / divisor;
+
+  if (upsampling_ == downsampling_) {
+    num_taps_ = 0;
+    return;
+  }
+
+  // The filter runs at the upsampled rate L * input_sample_rate. Its cutoff and length are set relative to the lower
+  // of the two rates: the window spans half_lower_rate_taps samples of the lower rate on each side.
+  const double lower_rate = static_cast<double>(std::min(input_rate, output_rate));
+  const double upsampled_rate = static_cast<double>(upsampling_) * input_sample_rate;
+  const double cutoff = rolloff * lower_rate / 2. / upsampled_rate;  // Cycles per upsampled sample.
+  const double half_length =
+      static_cast<double>(half_lower_rate_taps) * static_cast<double>(std::max(upsampling_, downsampling_));
+  const int64_t half_taps = (static_cast<int64_t>(half_length) + upsampling_ - 1) / upsampling_;
+  num_taps_ = static_cast<int>(2 * half_taps);
+
+  const double kaiser_norm = BesselI0(kaiser_beta);
+  phases_.resize(static_cast<size_t>(upsampling_) * static_cast<size_t>(num_taps_));
+  for (int64_t phase = 0; phase < upsampling_; phase++) {
+    double *coefficients = &phases_[static_cast<size_t>(phase * num_taps_)];
+    double sum = 0.;
+    for (int64_t tap = 0; tap < num_taps_; tap++) {
+      // Distance, in upsampled samples, between the output sample and input sample first + tap.
+      const double distance = static_cast<double>(phase + (half_taps - 1 - tap) * upsampling_);
+      const double ratio = distance / half_length;
+      double coefficient = 0.;
+      if (std::abs(ratio) < 1.) {
+        const double x = 2. * cutoff * distance;
+        const double sinc = x == 0. ? 1. : std::sin(M_PI * x) / (M_PI * x);
+        coefficient = sinc * BesselI0(kaiser_beta * std::sqrt(1. - ratio * ratio)) / kaiser_norm;
+      }
+      coefficients[tap] = coefficient;
+      sum += coefficient;
+    }
+    // Unit gain at DC for every phase, which also compensates the zeros inserted by the upsampling.
+    for (int64_t tap = 0; tap < num_taps_; tap++) coefficients[tap] /= sum;
+  }
+}
+
+int64_t Resampler::OutputSize(int64_t num_samples) const {
+  return (num_samples * upsampling_ + downsampling_ - 1) / downsampling_;
+}
+
+int64_t Resampler::FirstInput(int64_t output_index) const {
+  if (upsampling_ == downsampling_) return output_index;
+  return output_index * downsampling_ / upsampling_ - num_taps_ / 2 + 1;
+}
+
+int64_t Resampler::LastInput(int64_t output_index) const {
+  if (upsampling_ == downsampling_) return output_index;
+  return FirstInput(output_index) + num_taps_ - 1;
+}
+
+std::vector<double> Resampler::Resample(const std::vector<double> &signal) const {
+  StageTimer stage_timer(&PipelineStats::resample_seconds);
+  if (upsampling_ == downsampling_) return signal;
+
+  const int64_t num_samples = static_cast<int64_t>(signal.size());
+  std::vector<double> output(static_cast<size_t>(OutputSize(num_samples)));
+  ResampleRange(signal.data(), 0, num_samples, 0, output.size(), output.data());
+  return output;
+}
+
+void Resampler::ResampleRange(const double *samples,
+                              int64_t samples_start,
+                              int64_t samples_end,
+                              int64_t first_output,
+                              size_t num_outputs,
+                              double *output) const {
+  if (upsampling_ == downsampling_) {
+    std::copy(samples + (first_output - samples_start), samples + (first_output - samples_start + num_outputs), output);
+    return;
+  }
+
+  const int64_t half_taps = num_taps_ / 2;
+  // Output n lies at n * M / L input samples: input sample `base` plus `phase` / L.
+  int64_t base = first_output * downsampling_ / upsampling_;
+  int64_t phase = first_output * downsampling_ % upsampling_;
+  for (size_t i = 0; i < num_outputs; i++) {
+    const double *coefficients = &phases_[static_cast<size_t>(phase * num_taps_)];
+    const int64_t first = base - half_taps + 1;
+    if (first >= 0 && first + num_taps_ <= samples_end) {
+      output[i] = DotProduct(coefficients, samples + (first - samples_start), static_cast<size_t>(num_taps_));
+    } else {
+      // Edges, the samples outside the signal are zeros.
+      double sum = 0.;
+      for (int64_t tap = std::max<int64_t>(0, -first); tap < num_taps_ && first + tap < samples_end; tap++)
+        sum += coefficients[tap] * samples[first + tap - samples_start];
+      output[i] = sum;
+    }
+    phase += downsampling_;
+    base += phase / upsampling_;
+    phase %= upsampling_;
+  }
+}
+
+StreamingResampler::StreamingResampler(double input_sample_rate,
+                                       double output_sample_rate,
+                                       const std::string quality)
+    : resampler_(input_sample_rate, output_sample_rate, quality) {
+  Reset();
+}
+
+void StreamingResampler::Reset() {
+  pending_.clear();
+  pending_start_ = 0;
+  num_inputs_ = 0;
+  num_outputs_ = 0;
+}
+
+void StreamingResampler::ComputeOutputs(int64_t end_output, std::vector<double> &output) {
+  StageTimer stage_timer(&PipelineStats::resample_seconds);
+  output.resize(static_cast<size_t>(std::max<int64_t>(end_output - num_outputs_, 0)));
+  resampler_.ResampleRange(pending_.data(), pending_start_, num_inputs_, num_outputs_, output.size(), output.data());
+  num_outputs_ += static_cast<int64_t>(output.size());
+
+  // Drop the input samples that no future output depends on.
+  const int64_t first_needed = resampler_.FirstInput(num_outputs_);
+  int64_t consumed = std::min<int64_t>(first_needed - pending_start_, static_cast<int64_t>(pending_.size()));
+  if (consumed > 0) {
+    pending_.erase(pending_.begin(), pending_.begin() + consumed);
+    pending_start_ += consumed;
+  }
+}
+
+void StreamingResampler::Process(const std::vector<double> &block, std::vector<double> &output) {
+  pending_.insert(pending_.end(), block.begin(), block.end());
+  num_inputs_ += static_cast<int64_t>(block.size());
+
+  // Only the outputs whose last input sample has been received are complete.
+  int64_t end_output = num_outputs_;
+  while (end_output < resampler_.OutputSize(num_inputs_) && resampler_.LastInput(end_output) < num_inputs_)
+    end_output++;
+  ComputeOutputs(end_output, output);
+}
+
+void StreamingResampler::Flush(std::vector<double> &output) {
+  ComputeOutputs(resampler_.OutputSize(num_inputs_), output);
+  Reset();
+}
+
+std::vector<double> Resample(const std::vector<double> &signal,
+                             double input_sample_rate,
+                             double output_sample_rate,
+                             const std::string quality) {
+  return Resampler(input_sample_rate, output_sample_rate, quality).Resample(signal);
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Polyphase windowed-sinc resampler between two integer sample rates.
+ *
+ * The ratio output_sample_rate / input_sample_rate is reduced to L / M. Conceptually the signal is upsampled by L,
+ * low-pass filtered below the Nyquist frequency of the lower rate and decimated by M. Only the L phases of the
+ * Kaiser-windowed sinc filter are stored, every output sample is then a single dot product of NumTaps input samples
+ * (see DotProduct). The filter spans the same number of samples of the lower rate whatever the ratio, so decimating
+ * costs the same per input sample for any M.
+ *
+ * The filter is zero phase: output sample n is the signal at time n / output_sample_rate, without any delay. Samples
+ * before the start and after the end of the signal are zeros.
+ *
+ * Frequencies are fractions of the Nyquist frequency of the lower rate:
+ *
+ * | Quality | Filter length (samples of the lower rate) | Flat (< 0.5 dB) up to | -6 dB at | Stopband attenuation |
+ * | ------- | ----------------------------------------- | --------------------- | -------- | -------------------- |
+ * | low     | 16                                        | 0.70                  | 0.85     | ~60 dB               |
+ * | medium  | 32                                        | 0.80                  | 0.90     | ~80 dB               |
+ * | high    | 64                                        | 0.85                  | 0.94     | ~85-100 dB           |
+ *
+ * @code
+ *   Resampler resampler(44100., 11025.);
+ *   std::vector<double> decimated = resampler.Resample(signal);
+ * @endcode
+ */
+class Resampler {
+ private:
+  const double input_sample_rate_;
+  const double output_sample_rate_;
+  const std::string quality_;
+  int64_t upsampling_;    //!< L.
+  int64_t downsampling_;  //!< M.
+  int num_taps_;
+
+  /*!< Phases of the filter, upsampling_ x num_taps_ in row-major order. Row p holds the coefficients of the input
+       samples around an output sample that falls p / L input samples after an input sample.*/
+  std::vector<double> phases_;
+
+ public:
+  /**
+   * @brief Construct a new Resampler object, the filter phases are computed once here.
+   *
+   * @param input_sample_rate Sampling rate of the input signal \[Hz\], a whole number.
+   * @param output_sample_rate Sampling rate of the output signal \[Hz\], a whole number.
+   * @param quality Length and cutoff of the filter: "low", "medium" or "high". See Resampler.
+   */
+  Resampler(double input_sample_rate, double output_sample_rate, const std::string quality = "medium");
+
+  ~Resampler() {}
+
+  /**
+   * @brief Resample a signal.
+   *
+   * @param signal Signal at input_sample_rate.
+   * @return std::vector<double> Signal at output_sample_rate, of ceil(signal.size() * L / M) samples.
+   */
+  std::vector<double> Resample(const std::vector<double> &signal) const;
+
+  /**
+   * @brief Compute the output samples [first_output, first_output + num_outputs) from a part of the signal.
+   *
+   * The samples are the same as the ones of Resample, as long as the part holds every input sample of the signal
+   * between FirstInput(first_output) and LastInput(first_output + num_outputs - 1).
+   *
+   * @param samples Input samples of the signal, from samples_start on.
+   * @param samples_start Index in the signal of samples[0].
+   * @param samples_end End of the signal, the input samples from there on are zeros.
+   * @param first_output Index of the first output sample to compute.
+   * @param num_outputs Number of output samples to compute.
+   * @param output Receives the num_outputs output samples.
+   */
+  void ResampleRange(const double *samples,
+                     int64_t samples_start,
+                     int64_t samples_end,
+                     int64_t first_output,
+                     size_t num_outputs,
+                     double *output) const;
+
+  /**
+   * @brief Index of the first input sample an output sample is computed from, may be negative.
+   *
+   * @param output_index Index of the output sample.
+   * @return int64_t Index of the input sample.
+   */
+  int64_t FirstInput(int64_t output_index) const;
+
+  /**
+   * @brief Index of the last input sample an output sample is computed from.
+   *
+   * @param output_index Index of the output sample.
+   * @return int64_t Index of the input sample.
+   */
+  int64_t LastInput(int64_t output_index) const;
+
+  /**
+   * @brief Number of output samples of a signal.
+   *
+   * @param num_samples Number of input samples.
+   * @return int64_t ceil(num_samples * L / M).
+   */
+  int64_t OutputSize(int64_t num_samples) const;
+
+  double InputSampleRate() const { return input_sample_rate_; }
+  double OutputSampleRate() const { return output_sample_rate_; }
+  const std::string &Quality() const { return quality_; }
+
+  /**
+   * @brief Number of input samples each output sample is computed from.
+   *
+   * @return int Taps per phase of the filter.
+   */
+  int NumTaps() const { return num_taps_; }
+};
+
+/**
+ * @brief Resampler of a signal that arrives block by block.
+ *
+ * Each output sample is computed as soon as the last input sample it depends on has been received, and only the input
+ * samples that later outputs still depend on are kept. The concatenated outputs are the same samples as the ones of
+ * Resampler::Resample on the whole signal.
+ *
+ * @code
+ *   StreamingResampler streaming_resampler(44100., 22050.);
+ *
+ *   while (ReadNextBlock(block)) {
+ *       streaming_resampler.Process(block, resampled_block);
+ *       Consume(resampled_block);
+ *   }
+ *   streaming_resampler.Flush(resampled_block);
+ *   Consume(resampled_block);
+ * @endcode
+ */
+class StreamingResampler {
+ private:
+  const Resampler resampler_;
+
+  // Input samples from pending_start_ on, positions are absolute sample indices of the input signal.
+  std::vector<double> pending_;
+  int64_t pending_start_;
+  int64_t num_inputs_;
+  int64_t num_outputs_;
+
+  void ComputeOutputs(int64_t end_output, std::vector<double> &output);
+
+ public:
+  /**
+   * @brief Construct a new StreamingResampler object, see Resampler.
+   *
+   * @param input_sample_rate Sampling rate of the input signal \[Hz\], a whole number.
+   * @param output_sample_rate Sampling rate of the output signal \[Hz\], a whole number.
+   * @param quality Length and cutoff of the filter: "low", "medium" or "high". See Resampler.
+   */
+  StreamingResampler(double input_sample_rate, double output_sample_rate, const std::string quality = "medium");
+
+  ~StreamingResampler() {}
+
+  /**
+   * @brief Add a block of input samples.
+   *
+   * @param block Block of samples at input_sample_rate, of any size.
+   * @param output Receives the output samples that are complete with this block, possibly none.
+   */
+  void Process(const std::vector<double> &block, std::vector<double> &output);
+
+  /**
+   * @brief End the signal: the remaining output samples are computed with zeros after the last input sample, then the
+   * resampler is reset for a new signal.
+   *
+   * @param output Receives the remaining output samples.
+   */
+  void Flush(std::vector<double> &output);
+
+  /**
+   * @brief Forget the samples of the current signal.
+   */
+  void Reset();
+
+  const Resampler &GetResampler() const { return resampler_; }
+};
+
+/**
+ * @brief Overloaded function for Resample that builds the resampler of a single signal.
+ *
+ * @param signal Signal at input_sample_rate.
+ * @param input_sample_rate Sampling rate of the input signal \[Hz\], a whole number.
+ * @param output_sample_rate Sampling rate of the output signal \[Hz\], a whole number.
+ * @param quality Length and cutoff of the filter: "low", "medium" or "high". See Resampler.
+ * @return std::vector<double> Signal at output_sample_rate.
+ */
+std::vector<double> Resample(const std::vector<double> &signal,
+                             double input_sample_rate,
+                             double output_sample_rate,
+                             const std::string quality = "medium");
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,423 @@
+#include "src/core/simd_kernels.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "src/core/cpu_dispatch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// A fused multiply-add rounds once instead of twice, contracting a * b + c would make the AVX levels (which allow FMA
+// instructions) differ from the others.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+// The AVX2 and AVX-512 kernels are compiled with target attributes, so the rest of the library keeps the baseline
+// instruction set and the same binary runs on every x86-64 CPU.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MUSHER_X86_TARGETS
+#include <immintrin.h>
+#endif
+
+namespace musher {
+namespace core {
+
+namespace {
+
+/*
+Reference implementations, also used for the tails of the vectorized kernels.
+*/
+namespace scalar {
+
+void ConvertInt16ToDouble(const int16_t *in, size_t size, double scale, double *out) {
+  for (size_t i = 0; i < size; i++) out[i] = static_cast<double>(in[i]) * scale;
+}
+
+void MultiplyArrays(const double *a, const double *b, size_t size, double *out) {
+  for (size_t i = 0; i < size; i++) out[i] = a[i] * b[i];
+}
+
+void AddArrays(const double *a, const double *b, size_t size, double *out) {
+  for (size_t i = 0; i < size; i++) out[i] = a[i] + b[i];
+}
+
+void AccumulateScaled(const double *x, double scale, size_t size, double *out) {
+  for (size_t i = 0; i < size; i++) out[i] += scale * x[i];
+}
+
+// Adds the remaining elements to the 8 partial sums of DotProduct and combines them, shared by every level.
+double DotProductTail(const double *a, const double *b, size_t size, double *sums) {
+  for (size_t i = 0; i < size; i++) sums[i % 8] += a[i] * b[i];
+  double pairs[4];
+  for (size_t lane = 0; lane < 4; lane++) pairs[lane] = sums[lane] + sums[lane + 4];
+  return (pairs[0] + pairs[2]) + (pairs[1] + pairs[3]);
+}
+
+double DotProduct(const double *a, const double *b, size_t size) {
+  double sums[8] = {0., 0., 0., 0., 0., 0., 0., 0.};
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    for (size_t lane = 0; lane < 8; lane++) sums[lane] += a[i + lane] * b[i + lane];
+  }
+  return DotProductTail(a + i, b + i, size - i, sums);
+}
+
+void InterleavedPower(const double *pairs, size_t size, double *out) {
+  for (size_t i = 0; i < size; i++) out[i] = pairs[2 * i] * pairs[2 * i] + pairs[2 * i + 1] * pairs[2 * i + 1];
+}
+
+void InterleavedMagnitude(const double *pairs, size_t size, double *out) {
+  for (size_t i = 0; i < size; i++)
+    out[i] = std::sqrt(pairs[2 * i] * pairs[2 * i] + pairs[2 * i + 1] * pairs[2 * i + 1]);
+}
+
+size_t NextPeakCandidate(const double *x, size_t begin, size_t end, double threshold) {
+  for (size_t i = begin; i < end; i++) {
+    if (x[i - 1] <= x[i] && x[i] > x[i + 1] && x[i] > threshold) return i;
+  }
+  return end;
+}
+
+}  // namespace scalar
+
+#if defined(__SSE2__)
+namespace sse2 {
+
+void ConvertInt16ToDouble(const int16_t *in, size_t size, double scale, double *out) {
+  const __m128d scale_pd = _mm_set1_pd(scale);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    // Sign extend to 32 bits by placing the samples in the upper halves.
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(lo), scale_pd));
+    _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), scale_pd));
+    _mm_storeu_pd(out + i + 4, _mm_mul_pd(_mm_cvtepi32_pd(hi), scale_pd));
+    _mm_storeu_pd(out + i + 6, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), scale_pd));
+  }
+  scalar::ConvertInt16ToDouble(in + i, size - i, scale, out + i);
+}
+
+void MultiplyArrays(const double *a, const double *b, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+  scalar::MultiplyArrays(a + i, b + i, size - i, out + i);
+}
+
+void AddArrays(const double *a, const double *b, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+  scalar::AddArrays(a + i, b + i, size - i, out + i);
+}
+
+void AccumulateScaled(const double *x, double scale, size_t size, double *out) {
+  const __m128d scale_pd = _mm_set1_pd(scale);
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2)
+    _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), _mm_mul_pd(scale_pd, _mm_loadu_pd(x + i))));
+  scalar::AccumulateScaled(x + i, scale, size - i, out + i);
+}
+
+double DotProduct(const double *a, const double *b, size_t size) {
+  __m128d sums[4] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    for (size_t k = 0; k < 4; k++)
+      sums[k] = _mm_add_pd(sums[k], _mm_mul_pd(_mm_loadu_pd(a + i + 2 * k), _mm_loadu_pd(b + i + 2 * k)));
+  }
+  double lanes[8];
+  for (size_t k = 0; k < 4; k++) _mm_storeu_pd(lanes + 2 * k, sums[k]);
+  return scalar::DotProductTail(a + i, b + i, size - i, lanes);
+}
+
+inline __m128d Power(const double *pairs) {
+  __m128d a = _mm_loadu_pd(pairs);
+  __m128d b = _mm_loadu_pd(pairs + 2);
+  a = _mm_mul_pd(a, a);
+  b = _mm_mul_pd(b, b);
+  return _mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b));
+}
+
+void InterleavedPower(const double *pairs, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) _mm_storeu_pd(out + i, Power(pairs + 2 * i));
+  scalar::InterleavedPower(pairs + 2 * i, size - i, out + i);
+}
+
+void InterleavedMagnitude(const double *pairs, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 2 <= size; i += 2) _mm_storeu_pd(out + i, _mm_sqrt_pd(Power(pairs + 2 * i)));
+  scalar::InterleavedMagnitude(pairs + 2 * i, size - i, out + i);
+}
+
+size_t NextPeakCandidate(const double *x, size_t begin, size_t end, double threshold) {
+  const __m128d threshold_pd = _mm_set1_pd(threshold);
+  size_t i = begin;
+  for (; i + 2 <= end; i += 2) {
+    __m128d c = _mm_loadu_pd(x + i);
+    __m128d rising = _mm_cmple_pd(_mm_loadu_pd(x + i - 1), c);
+    __m128d falling = _mm_cmpgt_pd(c, _mm_loadu_pd(x + i + 1));
+    __m128d mask = _mm_and_pd(_mm_and_pd(rising, falling), _mm_cmpgt_pd(c, threshold_pd));
+    int bits = _mm_movemask_pd(mask);
+    if (bits != 0) return (bits & 1) ? i : i + 1;
+  }
+  return scalar::NextPeakCandidate(x, i, end, threshold);
+}
+
+}  // namespace sse2
+#endif
+
+#if defined(MUSHER_X86_TARGETS)
+namespace avx2 {
+
+#define MUSHER_AVX2 __attribute__((target("avx2")))
+
+MUSHER_AVX2 void ConvertInt16ToDouble(const int16_t *in, size_t size, double scale, double *out) {
+  const __m256d scale_pd = _mm256_set1_pd(scale);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), scale_pd));
+    _mm256_storeu_pd(out + i + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)), scale_pd));
+  }
+  scalar::ConvertInt16ToDouble(in + i, size - i, scale, out + i);
+}
+
+MUSHER_AVX2 void MultiplyArrays(const double *a, const double *b, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4)
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+  scalar::MultiplyArrays(a + i, b + i, size - i, out + i);
+}
+
+MUSHER_AVX2 void AddArrays(const double *a, const double *b, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4)
+    _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+  scalar::AddArrays(a + i, b + i, size - i, out + i);
+}
+
+MUSHER_AVX2 void AccumulateScaled(const double *x, double scale, size_t size, double *out) {
+  // No FMA, it would round differently than the other levels.
+  const __m256d scale_pd = _mm256_set1_pd(scale);
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4)
+    _mm256_storeu_pd(out + i,
+                     _mm256_add_pd(_mm256_loadu_pd(out + i), _mm256_mul_pd(scale_pd, _mm256_loadu_pd(x + i))));
+  scalar::AccumulateScaled(x + i, scale, size - i, out + i);
+}
+
+MUSHER_AVX2 double DotProduct(const double *a, const double *b, size_t size) {
+  __m256d low = _mm256_setzero_pd();
+  __m256d high = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    low = _mm256_add_pd(low, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    high = _mm256_add_pd(high, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+  }
+  double lanes[8];
+  _mm256_storeu_pd(lanes, low);
+  _mm256_storeu_pd(lanes + 4, high);
+  // GCC does not clear the upper halves before this call, the SSE code of the tail would then stall on every call.
+  _mm256_zeroupper();
+  return scalar::DotProductTail(a + i, b + i, size - i, lanes);
+}
+
+MUSHER_AVX2 inline __m256d Power(const double *pairs) {
+  __m256d a = _mm256_loadu_pd(pairs);
+  __m256d b = _mm256_loadu_pd(pairs + 4);
+  // (p0, p2, p1, p3) back to (p0, p1, p2, p3).
+  __m256d powers = _mm256_hadd_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b));
+  return _mm256_permute4x64_pd(powers, 0xD8);
+}
+
+MUSHER_AVX2 void InterleavedPower(const double *pairs, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) _mm256_storeu_pd(out + i, Power(pairs + 2 * i));
+  scalar::InterleavedPower(pairs + 2 * i, size - i, out + i);
+}
+
+MUSHER_AVX2 void InterleavedMagnitude(const double *pairs, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) _mm256_storeu_pd(out + i, _mm256_sqrt_pd(Power(pairs + 2 * i)));
+  scalar::InterleavedMagnitude(pairs + 2 * i, size - i, out + i);
+}
+
+MUSHER_AVX2 size_t NextPeakCandidate(const double *x, size_t begin, size_t end, double threshold) {
+  const __m256d threshold_pd = _mm256_set1_pd(threshold);
+  size_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    __m256d c = _mm256_loadu_pd(x + i);
+    __m256d rising = _mm256_cmp_pd(_mm256_loadu_pd(x + i - 1), c, _CMP_LE_OQ);
+    __m256d falling = _mm256_cmp_pd(c, _mm256_loadu_pd(x + i + 1), _CMP_GT_OQ);
+    __m256d above = _mm256_cmp_pd(c, threshold_pd, _CMP_GT_OQ);
+    int bits = _mm256_movemask_pd(_mm256_and_pd(_mm256_and_pd(rising, falling), above));
+    if (bits != 0) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned int>(bits)));
+  }
+  return scalar::NextPeakCandidate(x, i, end, threshold);
+}
+
+#undef MUSHER_AVX2
+
+}  // namespace avx2
+
+namespace avx512 {
+
+#define MUSHER_AVX512 __attribute__((target("avx512f")))
+
+MUSHER_AVX512 void ConvertInt16ToDouble(const int16_t *in, size_t size, double scale, double *out) {
+  // The masked forms avoid the undefined pass-through vectors of the unmasked intrinsics, which GCC 12 warns about.
+  const __m512d scale_pd = _mm512_set1_pd(scale);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+    _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_maskz_cvtepi32_pd(0xFF, x), scale_pd));
+  }
+  scalar::ConvertInt16ToDouble(in + i, size - i, scale, out + i);
+}
+
+MUSHER_AVX512 void MultiplyArrays(const double *a, const double *b, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+    _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+  scalar::MultiplyArrays(a + i, b + i, size - i, out + i);
+}
+
+MUSHER_AVX512 void AddArrays(const double *a, const double *b, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+    _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+  scalar::AddArrays(a + i, b + i, size - i, out + i);
+}
+
+MUSHER_AVX512 void AccumulateScaled(const double *x, double scale, size_t size, double *out) {
+  const __m512d scale_pd = _mm512_set1_pd(scale);
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+    _mm512_storeu_pd(out + i,
+                     _mm512_add_pd(_mm512_loadu_pd(out + i), _mm512_mul_pd(scale_pd, _mm512_loadu_pd(x + i))));
+  scalar::AccumulateScaled(x + i, scale, size - i, out + i);
+}
+
+MUSHER_AVX512 double DotProduct(const double *a, const double *b, size_t size) {
+  __m512d sums = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+    sums = _mm512_add_pd(sums, _mm512_mul_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+  double lanes[8];
+  _mm512_storeu_pd(lanes, sums);
+  _mm256_zeroupper();
+  return scalar::DotProductTail(a + i, b + i, size - i, lanes);
+}
+
+MUSHER_AVX512 inline __m512d Power(const double *pairs) {
+  const __m512i even = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+  const __m512i odd = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+  __m512d a = _mm512_loadu_pd(pairs);
+  __m512d b = _mm512_loadu_pd(pairs + 8);
+  a = _mm512_mul_pd(a, a);
+  b = _mm512_mul_pd(b, b);
+  return _mm512_add_pd(_mm512_permutex2var_pd(a, even, b), _mm512_permutex2var_pd(a, odd, b));
+}
+
+MUSHER_AVX512 void InterleavedPower(const double *pairs, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) _mm512_storeu_pd(out + i, Power(pairs + 2 * i));
+  scalar::InterleavedPower(pairs + 2 * i, size - i, out + i);
+}
+
+MUSHER_AVX512 void InterleavedMagnitude(const double *pairs, size_t size, double *out) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) _mm512_storeu_pd(out + i, _mm512_maskz_sqrt_pd(0xFF, Power(pairs + 2 * i)));
+  scalar::InterleavedMagnitude(pairs + 2 * i, size - i, out + i);
+}
+
+MUSHER_AVX512 size_t NextPeakCandidate(const double *x, size_t begin, size_t end, double threshold) {
+  const __m512d threshold_pd = _mm512_set1_pd(threshold);
+  size_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m512d c = _mm512_loadu_pd(x + i);
+    __mmask8 bits = _mm512_cmp_pd_mask(_mm512_loadu_pd(x + i - 1), c, _CMP_LE_OQ);
+    bits = _mm512_mask_cmp_pd_mask(bits, c, _mm512_loadu_pd(x + i + 1), _CMP_GT_OQ);
+    bits = _mm512_mask_cmp_pd_mask(bits, c, threshold_pd, _CMP_GT_OQ);
+    if (bits != 0) return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned int>(bits)));
+  }
+  return scalar::NextPeakCandidate(x, i, end, threshold);
+}
+
+#undef MUSHER_AVX512
+
+}  // namespace avx512
+#endif
+
+}  // namespace
+
+/*
+The levels missing from a build (for example AVX2 on ARM) fall through to the next lower one that exists.
+*/
+#if defined(MUSHER_X86_TARGETS)
+#define MUSHER_DISPATCH_X86(name, ...)    \
+  case SimdLevel::kAvx512:                \
+    return avx512::name(__VA_ARGS__);     \
+  case SimdLevel::kAvx2:                  \
+    return avx2::name(__VA_ARGS__);
+#else
+#define MUSHER_DISPATCH_X86(name, ...)
+#endif
+
+#if defined(__SSE2__)
+#define MUSHER_DISPATCH_SSE2(name, ...) \
+  case SimdLevel::kSse2:                \
+    return sse2::name(__VA_ARGS__);
+#else
+#define MUSHER_DISPATCH_SSE2(name, ...)
+#endif
+
+#define MUSHER_DISPATCH(name, ...)             \
+  switch (ActiveSimdLevel()) {                 \
+    MUSHER_DISPATCH_X86(name, __VA_ARGS__)     \
+    MUSHER_DISPATCH_SSE2(name, __VA_ARGS__)    \
+    default:                                   \
+      return scalar::name(__VA_ARGS__);        \
+  }
+
+void ConvertInt16ToDouble(const int16_t *in, size_t size, double scale, double *out) {
+  MUSHER_DISPATCH(ConvertInt16ToDouble, in, size, scale, out)
+}
+
+void MultiplyArrays(const double *a, const double *b, size_t size, double *out) {
+  MUSHER_DISPATCH(MultiplyArrays, a, b, size, out)
+}
+
+void AddArrays(const double *a, const double *b, size_t size, double *out) {
+  MUSHER_DISPATCH(AddArrays, a, b, size, out)
+}
+
+void AccumulateScaled(const double *x, double scale, size_t size, double *out) {
+  MUSHER_DISPATCH(AccumulateScaled, x, scale, size, out)
+}
+
+double DotProduct(const double *a, const double *b, size_t size) { MUSHER_DISPATCH(DotProduct, a, b, size) }
+
+void InterleavedMagnitude(const double *pairs, size_t size, double *out) {
+  MUSHER_DISPATCH(InterleavedMagnitude, pairs, size, out)
+}
+
+void InterleavedPower(const double *pairs, size_t size, double *out) {
+  MUSHER_DISPATCH(InterleavedPower, pairs, size, out)
+}
+
+size_t NextPeakCandidate(const double *x, size_t begin, size_t end, double threshold) {
+  if (begin >= end) return end;
+  MUSHER_DISPATCH(NextPeakCandidate, x, begin, end, threshold)
+}
+
+}  // namespace core
+}  // namespace musher
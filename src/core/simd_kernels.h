@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace musher {
+namespace core {
+
+/**
+ * Hot loops of the analysis, dispatched at runtime to the fastest implementation the CPU supports (see
+ * ActiveSimdLevel). Every kernel only uses element-wise additions, multiplications and square roots, in the same
+ * order at every level, so all levels give bit-identical results. The reductions (DotProduct) sum in a fixed number
+ * of interleaved partial sums for the same reason.
+ */
+
+/**
+ * @brief Convert 16 bit PCM samples to doubles, out[i] = in[i] * scale.
+ *
+ * @param in Input samples.
+ * @param size Number of samples.
+ * @param scale Factor applied to every sample.
+ * @param out Output samples, may not overlap the input.
+ */
+void ConvertInt16ToDouble(const int16_t *in, size_t size, double scale, double *out);
+
+/**
+ * @brief Element-wise product, out[i] = a[i] * b[i]. Used to apply a window to a frame.
+ *
+ * @param a First input.
+ * @param b Second input.
+ * @param size Number of elements.
+ * @param out Output, may be the same array as one of the inputs.
+ */
+void MultiplyArrays(const double *a, const double *b, size_t size, double *out);
+
+/**
+ * @brief Element-wise sum, out[i] = a[i] + b[i].
+ *
+ * @param a First input.
+ * @param b Second input.
+ * @param size Number of elements.
+ * @param out Output, may be the same array as one of the inputs.
+ */
+void AddArrays(const double *a, const double *b, size_t size, double *out);
+
+/**
+ * @brief Scaled accumulation, out[i] += scale * x[i]. Used to accumulate HPCPs and to correlate key profiles.
+ *
+ * @param x Input.
+ * @param scale Factor applied to every element of the input.
+ * @param size Number of elements.
+ * @param out Accumulator.
+ */
+void AccumulateScaled(const double *x, double scale, size_t size, double *out);
+
+/**
+ * @brief Dot product, sum(a[i] * b[i]). Used by the filters of the resampler.
+ *
+ * Element i goes to the partial sum i % 8, the 8 partial sums are then added pairwise: (s0 + s4), (s1 + s5)... then
+ * (s0 + s4) + (s2 + s6)... and finally the two remaining sums.
+ *
+ * @param a First input.
+ * @param b Second input.
+ * @param size Number of elements.
+ * @return double Dot product.
+ */
+double DotProduct(const double *a, const double *b, size_t size);
+
+/**
+ * @brief Magnitudes of interleaved complex numbers, out[i] = sqrt(re[i]^2 + im[i]^2).
+ *
+ * The layout of std::complex<double> arrays and of the packed spectrum of a real FFT.
+ *
+ * @param pairs Interleaved real and imaginary parts, 2 * size values.
+ * @param size Number of complex numbers.
+ * @param out Magnitudes.
+ */
+void InterleavedMagnitude(const double *pairs, size_t size, double *out);
+
+/**
+ * @brief Powers of interleaved complex numbers, out[i] = re[i]^2 + im[i]^2.
+ *
+ * @param pairs Interleaved real and imaginary parts, 2 * size values.
+ * @param size Number of complex numbers.
+ * @param out Powers.
+ */
+void InterleavedPower(const double *pairs, size_t size, double *out);
+
+/**
+ * @brief Find the next candidate peak, the first index i in [begin, end) with
+ * x[i - 1] <= x[i] > x[i + 1] and x[i] > threshold.
+ *
+ * @param x Input, x[begin - 1] to x[end] must be readable.
+ * @param begin First index to check, at least 1.
+ * @param end End of the indices to check.
+ * @param threshold Minimum value of a peak (exclusive).
+ * @return size_t Index of the candidate, end if there is none.
+ */
+size_t NextPeakCandidate(const double *x, size_t begin, size_t end, double threshold);
+
+}  // namespace core
+}  // namespace musher
@@ -16,5 +16,17 @@ std::vector<std::tuple<double, double>> SpectralPeaks(const std::vector<double>
   return PeakDetect(input_spectrum, threshold, true, sort_by, max_num_peaks, sample_rate / 2.0, min_pos, max_pos);
 }
 
+void SpectralPeaks(const std::vector<double> &input_spectrum,
+                   std::vector<std::tuple<double, double>> &spectral_peaks,
+                   double threshold,
+                   const std::string &sort_by,
+                   unsigned int max_num_peaks,
+                   double sample_rate,
+                   int min_pos,
+                   int max_pos) {
+  PeakDetect(input_spectrum, spectral_peaks, threshold, true, sort_by, max_num_peaks, sample_rate / 2.0, min_pos,
+             max_pos);
+}
+
 }  // namespace core
 }  // namespace musher
\ No newline at end of file
@@ -1,7 +1,8 @@
 #pragma once
 
-#include <vector>
 #include <string>
+#include <tuple>
+#include <vector>
 
 namespace musher {
 namespace core {
@@ -38,5 +39,28 @@ std::vector<std::tuple<double, double>> SpectralPeaks(const std::vector<double>
                                                       int min_pos = 0,
                                                       int max_pos = 0);
 
+/**
+ * @brief Overloaded function for SpectralPeaks that writes the peaks to an existing vector.
+ *
+ * Does not allocate as long as the capacity of spectral_peaks is at least the size of the spectrum.
+ *
+ * @param input_spectrum Input spectrum.
+ * @param spectral_peaks Output vector of spectral peaks, each peak being a tuple (frequency, magnitude).
+ * @param threshold Peaks below this given threshold are not outputted.
+ * @param sort_by Ordering type of the outputted peaks, either "position" or "height" (lowercase).
+ * @param max_num_peaks Maximum number of returned peaks (set to 0 to return all peaks).
+ * @param sample_rate Sampling rate of the audio signal \[Hz\].
+ * @param min_pos Maximum frequency (position) of the range to evaluate \[Hz\].
+ * @param max_pos Minimum frequency (position) of the range to evaluate \[Hz\].
+ */
+void SpectralPeaks(const std::vector<double> &input_spectrum,
+                   std::vector<std::tuple<double, double>> &spectral_peaks,
+                   double threshold,
+                   const std::string &sort_by,
+                   unsigned int max_num_peaks,
+                   double sample_rate,
+                   int min_pos,
+                   int max_pos);
+
 }  // namespace core
 }  // namespace musher
\ No newline at end of file
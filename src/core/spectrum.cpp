@@ -4,9 +4,13 @@
 
 #include <algorithm>
 #include <complex>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
+#include "src/core/pipeline_stats.h"
+#include "src/core/simd_kernels.h"
+
 namespace musher {
 namespace core {
 
@@ -50,6 +54,7 @@ size_t NextFastLen(size_t n) {
 }
 
 std::vector<double> ConvertToFrequencySpectrum(const std::vector<double> &audio_frame) {
+  StageTimer stage_timer(&PipelineStats::fft_seconds);
   std::vector<double> v1(audio_frame);
   std::vector<double> ret;
 
@@ -87,11 +92,51 @@ std::vector<double> ConvertToFrequencySpectrum(const std::vector<double> &audio_
 
   // Get element-wise absolute value of a complex vector
   ret.resize(v1_out.size());
-  auto calculate_magnitude = [](const std::complex<double> x) { return Magnitude(x); };
-  std::transform(v1_out.begin(), v1_out.end(), ret.begin(), calculate_magnitude);
+  InterleavedMagnitude(reinterpret_cast<const double *>(v1_out.data()), v1_out.size(), ret.data());
 
   return ret;
 }
 
+SpectrumPlan::SpectrumPlan(size_t frame_size)
+    : frame_size_(frame_size),
+      // Same padded length as ConvertToFrequencySpectrum.
+      fft_size_(frame_size > 1 ? NextFastLen(frame_size - 1) : 1),
+      plan_(std::make_shared<pocketfft::detail::pocketfft_r<double>>(fft_size_)),
+      buffer_(fft_size_),
+      scratch_(fft_size_) {
+  if (frame_size_ <= 1) throw std::runtime_error("SpectrumPlan: frame size should be larger than 1");
+}
+
+void SpectrumPlan::Transform(const std::vector<double> &audio_frame) {
+  if (audio_frame.size() != frame_size_) throw std::runtime_error("SpectrumPlan: frame size does not match the plan");
+
+  size_t copy_size = std::min(frame_size_, fft_size_);
+  std::copy(audio_frame.begin(), audio_frame.begin() + copy_size, buffer_.begin());
+  std::fill(buffer_.begin() + copy_size, buffer_.end(), 0.);
+
+  plan_->forward(buffer_.data(), 1., scratch_.data());
+}
+
+void SpectrumPlan::Compute(const std::vector<double> &audio_frame, std::vector<double> &spectrum) {
+  StageTimer stage_timer(&PipelineStats::fft_seconds);
+  Transform(audio_frame);
+
+  // Unpack the halfcomplex result (r0, r1, i1, r2, i2, ..., [r(n/2)]) like pocketfft::r2c does.
+  spectrum.resize(SpectrumSize());
+  spectrum[0] = Magnitude(std::complex<double>(buffer_[0], 0.));
+  InterleavedMagnitude(buffer_.data() + 1, (fft_size_ - 1) / 2, spectrum.data() + 1);
+  if (fft_size_ % 2 == 0) spectrum.back() = Magnitude(std::complex<double>(buffer_[fft_size_ - 1], 0.));
+}
+
+void SpectrumPlan::ComputePower(const std::vector<double> &audio_frame, std::vector<double> &power_spectrum) {
+  StageTimer stage_timer(&PipelineStats::fft_seconds);
+  Transform(audio_frame);
+
+  power_spectrum.resize(SpectrumSize());
+  power_spectrum[0] = buffer_[0] * buffer_[0];
+  InterleavedPower(buffer_.data() + 1, (fft_size_ - 1) / 2, power_spectrum.data() + 1);
+  if (fft_size_ % 2 == 0) power_spectrum.back() = buffer_[fft_size_ - 1] * buffer_[fft_size_ - 1];
+}
+
 }  // namespace core
 }  // namespace musher
\ No newline at end of file
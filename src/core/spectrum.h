@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <pocketfft/pocketfft.h>
 
@@ -44,5 +45,52 @@ size_t NextFastLen(size_t n);
  */
 std::vector<double> ConvertToFrequencySpectrum(const std::vector<double> &audio_frame);
 
+/**
+ * @brief Precomputed FFT plan and work buffers to compute the spectrum of many frames of the same size.
+ *
+ * Gives the same spectrum as ConvertToFrequencySpectrum, without allocating once constructed.
+ */
+class SpectrumPlan {
+ private:
+  size_t frame_size_;
+  size_t fft_size_;
+  std::shared_ptr<pocketfft::detail::pocketfft_r<double>> plan_;
+  std::vector<double> buffer_;
+  std::vector<double> scratch_;
+
+  void Transform(const std::vector<double> &audio_frame);
+
+ public:
+  /**
+   * @brief Construct a new SpectrumPlan object
+   *
+   * @param frame_size Size of the frames the plan will be used with.
+   */
+  explicit SpectrumPlan(size_t frame_size);
+
+  /**
+   * @brief Size of the spectra computed by the plan.
+   *
+   * @return size_t Number of frequency bins.
+   */
+  size_t SpectrumSize() const { return fft_size_ / 2 + 1; }
+
+  /**
+   * @brief Computes the frequency spectrum of a frame.
+   *
+   * @param audio_frame Input audio frame of frame_size samples.
+   * @param spectrum Output magnitude spectrum, resized to SpectrumSize().
+   */
+  void Compute(const std::vector<double> &audio_frame, std::vector<double> &spectrum);
+
+  /**
+   * @brief Computes the power spectrum of a frame, the square of every bin of Compute.
+   *
+   * @param audio_frame Input audio frame of frame_size samples.
+   * @param power_spectrum Output power spectrum, resized to SpectrumSize().
+   */
+  void ComputePower(const std::vector<double> &audio_frame, std::vector<double> &power_spectrum);
+};
+
 }  // namespace core
 }  // namespace musher
\ No newline at end of file
@@ -1,4 +1,8 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "src/core/audio_decoders.h"
@@ -176,3 +180,172 @@ TEST(AudioFileDecoding, DecodeMp3FromFile) {
   int actual_avg_bitrate_kbps = mp3_decoded.avg_bitrate_kbps;
   EXPECT_EQ(expected_avg_bitrate_kbps, actual_avg_bitrate_kbps);
 }
+
+/**
+ * @brief The decoder is chosen from the extension of the file, whatever its case.
+ *
+ */
+TEST(AudioFileDecoding, DecodeAudioFile) {
+  const std::string data_dir = TEST_DATA_DIR + std::string("audio_files/");
+  AudioDecoded wav_decoded = DecodeAudioFile(data_dir + "CantinaBand3sec.wav");
+  EXPECT_EQ(wav_decoded.file_type, "wav");
+  EXPECT_EQ(wav_decoded.normalized_samples, DecodeWav(data_dir + "CantinaBand3sec.wav").normalized_samples);
+
+  AudioDecoded mp3_decoded = DecodeAudioFile(data_dir + "700kb.mp3");
+  EXPECT_EQ(mp3_decoded.file_type, "mp3");
+  EXPECT_EQ(mp3_decoded.samples_per_channel, DecodeMp3(data_dir + "700kb.mp3").samples_per_channel);
+
+  EXPECT_TRUE(HasFileExtension("song.MP3", ".mp3"));
+  EXPECT_FALSE(HasFileExtension("mp3", ".mp3"));
+  EXPECT_THROW(DecodeAudioFile(data_dir + "song.flac"), std::runtime_error);
+}
+
+/**
+ * @brief Streamed blocks put together are the samples of the whole decoding, whatever the block size.
+ *
+ */
+TEST(AudioFileDecoding, StreamMatchesDecode) {
+  const std::string data_dir = TEST_DATA_DIR + std::string("audio_files/");
+  auto stream = [](std::vector<std::vector<double>> &streamed_samples) {
+    return [&streamed_samples](const std::vector<std::vector<double>> &block) {
+      streamed_samples.resize(block.size());
+      for (size_t channel = 0; channel < block.size(); channel++)
+        streamed_samples[channel].insert(streamed_samples[channel].end(), block[channel].begin(), block[channel].end());
+    };
+  };
+
+  WavDecoded wav_decoded = DecodeWav(data_dir + "CantinaBand3sec.wav");
+  EXPECT_EQ(ReadWavInfo(data_dir + "CantinaBand3sec.wav").samples_per_channel, wav_decoded.samples_per_channel);
+  for (size_t block_size : {1000, 1 << 20}) {
+    std::vector<std::vector<double>> streamed_samples;
+    WavDecoded wav_streamed = StreamWav(data_dir + "CantinaBand3sec.wav", block_size, stream(streamed_samples));
+    EXPECT_EQ(streamed_samples, wav_decoded.normalized_samples);
+    EXPECT_EQ(wav_streamed.samples_per_channel, wav_decoded.samples_per_channel);
+    EXPECT_EQ(wav_streamed.bit_depth, wav_decoded.bit_depth);
+    EXPECT_TRUE(wav_streamed.normalized_samples.empty());
+  }
+
+  Mp3Decoded mp3_decoded = DecodeMp3(data_dir + "700kb.mp3");
+  EXPECT_NEAR(ReadMp3Info(data_dir + "700kb.mp3").samples_per_channel, mp3_decoded.samples_per_channel,
+              0.05 * mp3_decoded.samples_per_channel);
+  for (size_t block_size : {1000, 1 << 20}) {
+    std::vector<std::vector<double>> streamed_samples;
+    Mp3Decoded mp3_streamed = StreamMp3(data_dir + "700kb.mp3", block_size, stream(streamed_samples));
+    EXPECT_EQ(streamed_samples, mp3_decoded.normalized_samples);
+    EXPECT_EQ(mp3_streamed.samples_per_channel, mp3_decoded.samples_per_channel);
+    EXPECT_EQ(mp3_streamed.avg_bitrate_kbps, mp3_decoded.avg_bitrate_kbps);
+  }
+
+  EXPECT_THROW(StreamWav(data_dir + "CantinaBand3sec.wav", 0, stream(wav_decoded.normalized_samples)),
+               std::runtime_error);
+  EXPECT_THROW(StreamMp3("/unknown/abs/file/path.mp3", 1000, stream(wav_decoded.normalized_samples)),
+               std::runtime_error);
+}
+
+namespace {
+
+/**
+ * @brief Header of a PCM wav file, the data chunk follows it.
+ */
+std::vector<uint8_t> WavHeaderData(uint16_t num_channels,
+                                   uint32_t sample_rate,
+                                   uint16_t bit_depth,
+                                   uint32_t data_size) {
+  std::vector<uint8_t> header_data;
+  auto add = [&header_data](uint32_t value, int num_bytes) {
+    for (int byte = 0; byte < num_bytes; byte++) header_data.push_back(static_cast<uint8_t>(value >> (8 * byte)));
+  };
+  auto add_id = [&header_data](const std::string &id) { header_data.insert(header_data.end(), id.begin(), id.end()); };
+  uint16_t block_size = static_cast<uint16_t>(num_channels * bit_depth / 8);
+
+  add_id("RIFF");
+  add(36 + data_size, 4);
+  add_id("WAVE");
+  add_id("fmt ");
+  add(16, 4);
+  add(1, 2);  // PCM
+  add(num_channels, 2);
+  add(sample_rate, 4);
+  add(sample_rate * block_size, 4);
+  add(block_size, 2);
+  add(bit_depth, 2);
+  add_id("data");
+  add(data_size, 4);
+  return header_data;
+}
+
+}  // namespace
+
+/**
+ * @brief A 24 bit mono file goes through the sample by sample conversion, streamed or not.
+ *
+ */
+TEST(AudioFileDecoding, StreamWav24BitMono) {
+  const std::vector<int32_t> values = {0, 1, -1, 8388607, -8388608, 12345, -54321};
+  std::vector<uint8_t> data_chunk;
+  for (int32_t value : values) {
+    for (int byte = 0; byte < 3; byte++) data_chunk.push_back(static_cast<uint8_t>((value >> (8 * byte)) & 0xFF));
+  }
+  std::vector<uint8_t> file_data = WavHeaderData(1, 8000, 24, static_cast<uint32_t>(data_chunk.size()));
+  file_data.insert(file_data.end(), data_chunk.begin(), data_chunk.end());
+
+  WavDecoded wav_decoded = DecodeWav(file_data);
+  ASSERT_EQ(wav_decoded.normalized_samples.size(), 1u);
+  EXPECT_EQ(wav_decoded.normalized_samples[0], std::vector<double>(values.begin(), values.end()));
+
+  const std::string file_path = (std::filesystem::temp_directory_path() / "musher_test_24bit.wav").string();
+  {
+    std::ofstream wav_file(file_path, std::ios::binary);
+    wav_file.write(reinterpret_cast<const char *>(file_data.data()), static_cast<std::streamsize>(file_data.size()));
+  }
+  std::vector<double> streamed_samples;
+  WavDecoded wav_streamed = StreamWav(file_path, 3, [&](const std::vector<std::vector<double>> &block) {
+    ASSERT_EQ(block.size(), 1u);
+    EXPECT_LE(block[0].size(), 3u);
+    streamed_samples.insert(streamed_samples.end(), block[0].begin(), block[0].end());
+  });
+  EXPECT_EQ(ReadWavInfo(file_path).samples_per_channel, 7);
+  std::filesystem::remove(file_path);
+  EXPECT_EQ(streamed_samples, wav_decoded.normalized_samples[0]);
+  EXPECT_EQ(wav_streamed.samples_per_channel, 7);
+  EXPECT_TRUE(wav_streamed.mono);
+}
+
+/**
+ * @brief A wav file with more than 2^31 samples is streamed up to its last sample.
+ *
+ * The file is sparse, only its header and its last bytes are written, so the test needs neither the disk space nor the
+ * memory of the samples.
+ */
+TEST(AudioFileDecoding, StreamWavPast2GB) {
+  const int64_t num_samples = (int64_t(1) << 31) + 12345;
+  const std::vector<uint8_t> last_bytes = {0, 64, 128, 192, 255};
+  const std::string file_path = (std::filesystem::temp_directory_path() / "musher_test_large.wav").string();
+  {
+    std::ofstream wav_file(file_path, std::ios::binary);
+    std::vector<uint8_t> header_data = WavHeaderData(1, 8000, 8, static_cast<uint32_t>(num_samples));
+    wav_file.write(reinterpret_cast<const char *>(header_data.data()),
+                   static_cast<std::streamsize>(header_data.size()));
+    wav_file.seekp(static_cast<std::streamoff>(header_data.size() + num_samples - last_bytes.size()));
+    wav_file.write(reinterpret_cast<const char *>(last_bytes.data()), static_cast<std::streamsize>(last_bytes.size()));
+  }
+
+  EXPECT_EQ(ReadWavInfo(file_path).samples_per_channel, num_samples);
+
+  int64_t streamed_samples = 0;
+  std::vector<double> last_samples;
+  bool zeros = true;
+  WavDecoded wav_streamed = StreamWav(file_path, 1 << 22, [&](const std::vector<std::vector<double>> &block) {
+    streamed_samples += static_cast<int64_t>(block[0].size());
+    zeros = zeros && block[0].front() == NormalizeInt8_t(0);
+    last_samples.insert(last_samples.end(), block[0].end() - std::min<size_t>(block[0].size(), 5), block[0].end());
+  });
+  std::filesystem::remove(file_path);
+
+  EXPECT_EQ(streamed_samples, num_samples);
+  EXPECT_EQ(wav_streamed.samples_per_channel, num_samples);
+  EXPECT_TRUE(zeros);
+  std::vector<double> expected_last_samples;
+  for (uint8_t byte : last_bytes) expected_last_samples.push_back(NormalizeInt8_t(byte));
+  EXPECT_EQ(std::vector<double>(last_samples.end() - 5, last_samples.end()), expected_last_samples);
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/backend.h"
+#include "src/core/key.h"
+#include "src/core/key_detector.h"
+#include "src/core/key_profile_plan.h"
+#include "src/core/peak_detect.h"
+#include "src/core/reference_backend.h"
+#include "src/core/spectral_peaks.h"
+#include "src/core/spectrum.h"
+#include "src/core/test/gtest_extras.h"
+#include "src/core/windowing.h"
+
+using namespace musher::core;
+
+namespace {
+
+/**
+ * @brief Decoded samples and sample rate of every audio file of the test data.
+ */
+struct TestSignal {
+  std::string file_name;
+  std::vector<std::vector<double>> normalized_samples;
+  double sample_rate;
+};
+
+std::vector<TestSignal> DecodeTestSignals() {
+  std::vector<std::string> file_paths;
+  for (const auto &entry : std::filesystem::directory_iterator(TEST_DATA_DIR + std::string("audio_files"))) {
+    if (entry.is_regular_file()) file_paths.push_back(entry.path().string());
+  }
+  std::sort(file_paths.begin(), file_paths.end());
+
+  std::vector<TestSignal> signals;
+  for (const std::string &file_path : file_paths) {
+    if (!HasFileExtension(file_path, ".wav") && !HasFileExtension(file_path, ".mp3")) continue;
+    AudioDecoded audio_decoded = DecodeAudioFile(file_path);
+    TestSignal signal;
+    signal.file_name = std::filesystem::path(file_path).filename().string();
+    signal.normalized_samples = audio_decoded.normalized_samples;
+    signal.sample_rate = audio_decoded.sample_rate;
+    signals.push_back(signal);
+  }
+  return signals;
+}
+
+}  // namespace
+
+/**
+ * @brief The reference and optimized backends detect the same key on every audio file of the test data, and the
+ * cross-check mode finds no deviation in any stage.
+ *
+ */
+TEST(Backend, DetectKeyMatchesReferenceOnAllFiles) {
+  std::vector<TestSignal> signals = DecodeTestSignals();
+  ASSERT_FALSE(signals.empty());
+
+  for (const TestSignal &signal : signals) {
+    SCOPED_TRACE(signal.file_name);
+
+    SetBackend(Backend::kOptimized);
+    DetectKeyOutput expected_key_output = DetectKey(signal.normalized_samples, signal.sample_rate, "Temperley");
+
+    SetBackend(Backend::kReference);
+    DetectKeyOutput actual_key_output = DetectKey(signal.normalized_samples, signal.sample_rate, "Temperley");
+    EXPECT_EQ(actual_key_output.key, expected_key_output.key);
+    EXPECT_EQ(actual_key_output.scale, expected_key_output.scale);
+    EXPECT_NEAR(actual_key_output.strength, expected_key_output.strength, 1e-9);
+    EXPECT_NEAR(actual_key_output.first_to_second_relative_strength,
+                expected_key_output.first_to_second_relative_strength, 1e-9);
+    EXPECT_EQ(actual_key_output.frames_analyzed, expected_key_output.frames_analyzed);
+
+    SetBackend(Backend::kCrossCheck);
+    ResetCrossCheckReport();
+    actual_key_output = DetectKey(signal.normalized_samples, signal.sample_rate, "Temperley");
+    CrossCheckReport report = GetCrossCheckReport();
+    EXPECT_EQ(actual_key_output.key, expected_key_output.key);
+    EXPECT_EQ(actual_key_output.strength, expected_key_output.strength);
+    EXPECT_EQ(report.frames_checked, expected_key_output.frames_analyzed);
+    EXPECT_GE(report.estimates_checked, 1);
+    EXPECT_LT(report.windowing_deviation, 1e-12);
+    EXPECT_LT(report.spectrum_deviation, 1e-12);
+    EXPECT_LT(report.spectral_peaks_deviation, 1e-12);
+    EXPECT_LT(report.hpcp_deviation, 1e-9);
+    EXPECT_LT(report.key_correlation_deviation, 1e-9);
+  }
+  ResetBackend();
+}
+
+/**
+ * @brief The KeyDetector work buffers give the same stages as the reference backend.
+ *
+ */
+TEST(Backend, KeyDetectorMatchesReference) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/CantinaBand3sec.wav");
+  WavDecoded wav_decoded = DecodeWav(file_path);
+  KeyDetector key_detector(wav_decoded.sample_rate, "Temperley");
+
+  SetBackend(Backend::kOptimized);
+  DetectKeyOutput expected_key_output = key_detector.Detect(wav_decoded.normalized_samples);
+
+  SetBackend(Backend::kReference);
+  DetectKeyOutput actual_key_output = key_detector.Detect(wav_decoded.normalized_samples);
+  EXPECT_EQ(actual_key_output.key, expected_key_output.key);
+  EXPECT_EQ(actual_key_output.scale, expected_key_output.scale);
+  EXPECT_NEAR(actual_key_output.strength, expected_key_output.strength, 1e-9);
+
+  SetBackend(Backend::kCrossCheck);
+  ResetCrossCheckReport();
+  key_detector.Detect(wav_decoded.normalized_samples);
+  CrossCheckReport report = GetCrossCheckReport();
+  EXPECT_EQ(report.frames_checked, expected_key_output.frames_analyzed);
+  EXPECT_EQ(report.estimates_checked, 1);
+  EXPECT_LT(report.spectrum_deviation, 1e-9);
+  EXPECT_LT(report.spectral_peaks_deviation, 1e-9);
+  EXPECT_LT(report.hpcp_deviation, 1e-9);
+  ResetBackend();
+}
+
+/**
+ * @brief The reference stages match the optimized ones on a frame with plateaus and peaks at both ends.
+ *
+ */
+TEST(Backend, ReferenceStages) {
+  std::vector<double> spectrum = {3., 1., 2., 2., 2., 1., 4., 5., 4., 4., 6., 7.};
+  for (int max_pos : {0, 5, 11}) {
+    EXPECT_EQ(reference::PeakDetect(spectrum, -1000., true, "position", 0, 0., 0, max_pos),
+              PeakDetect(spectrum, -1000., true, "position", 0, 0., 0, max_pos));
+  }
+
+  std::vector<double> frame(1024);
+  for (size_t i = 0; i < frame.size(); i++) frame[i] = std::sin(0.1 * i) + 0.5 * std::sin(0.37 * i);
+  std::vector<double> window = Normalize(BlackmanHarris62dB(std::vector<double>(frame.size())));
+
+  std::vector<double> windowed_frame = Windowing(frame, BlackmanHarris62dB);
+  EXPECT_EQ(reference::Windowing(frame, window), windowed_frame);
+  std::vector<double> expected_spectrum = ConvertToFrequencySpectrum(windowed_frame);
+  std::vector<double> actual_spectrum = reference::ConvertToFrequencySpectrum(windowed_frame);
+  EXPECT_VEC_NEAR(actual_spectrum, expected_spectrum, 1e-12);
+}
+
+/**
+ * @brief The reference correlations rebuild the profiles from the parameters of the plan: they agree with every
+ * correctly built plan and the cross-check catches a plan whose profiles are wrong.
+ *
+ */
+TEST(Backend, ReferenceKeyCorrelations) {
+  std::vector<double> pcp(36);
+  for (size_t i = 0; i < pcp.size(); i++) pcp[i] = 0.5 + 0.5 * std::sin(0.7 * i) * std::cos(0.11 * i);
+
+  for (const std::string &profile_type : KeyProfileTypes()) {
+    for (bool use_polphony : {false, true}) {
+      for (bool use_three_chords : {false, true}) {
+        for (double slope : {0.6, 0.35}) {
+          SCOPED_TRACE(profile_type);
+          // Without a 'majmin' profile the correlations of the other scale are not defined.
+          bool use_maj_min = SelectKeyProfile(profile_type).size() == 3;
+          KeyProfilePlan plan =
+              BuildKeyProfilePlan(profile_type, use_polphony, use_three_chords, 4, slope, use_maj_min, 36);
+          KeyCorrelations expected_correlations = CorrelateKeyProfiles(pcp, plan);
+          KeyCorrelations actual_correlations = reference::CorrelateKeyProfiles(pcp, plan);
+          EXPECT_VEC_NEAR(actual_correlations.major, expected_correlations.major, 1e-9);
+          EXPECT_VEC_NEAR(actual_correlations.minor, expected_correlations.minor, 1e-9);
+          EXPECT_VEC_NEAR(actual_correlations.other, expected_correlations.other, 1e-9);
+        }
+      }
+    }
+  }
+
+  // A plan whose major profile was built with other parameters than the ones it records.
+  KeyProfilePlan broken_plan = BuildKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 36);
+  broken_plan.circulant_major = BuildKeyProfilePlan("Temperley", true, false, 4, 0.6, false, 36).circulant_major;
+
+  SetBackend(Backend::kCrossCheck);
+  ResetCrossCheckReport();
+  CorrelateKeyProfiles(pcp, *GetKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 36));
+  EXPECT_LT(GetCrossCheckReport().key_correlation_deviation, 1e-9);
+  CorrelateKeyProfiles(pcp, broken_plan);
+  EXPECT_GT(GetCrossCheckReport().key_correlation_deviation, 1e-3);
+  ResetBackend();
+}
+
+/**
+ * @brief Backend names.
+ *
+ */
+TEST(Backend, ParseBackend) {
+  for (Backend backend : {Backend::kOptimized, Backend::kReference, Backend::kCrossCheck})
+    EXPECT_EQ(ParseBackend(BackendName(backend)), backend);
+  EXPECT_EQ(ParseBackend("Cross_Check"), Backend::kCrossCheck);
+
+  EXPECT_THROW(
+      {
+        try {
+          ParseBackend("fast");
+        } catch (const std::runtime_error &e) {
+          EXPECT_STREQ("Backend 'fast' is not supported. Use optimized, reference or cross_check.", e.what());
+          throw;
+        }
+      },
+      std::runtime_error);
+}
@@ -1,23 +1,92 @@
-// TEST(AudioFileDecoding, BeatDetection) {
-//   const std::string filePath = TEST_DATA_DIR + std::string("audio_files/CantinaBand3sec.wav");
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
-//   WavDecoded wav_decoded = DecodeWav(filePath);
-//   uint32_t sampleRate = wav_decoded.sample_rate;
-//   std::vector<double> interleaved_normalized_samples = wav_decoded.interleaved_normalized_samples;
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/bpm.h"
 
-//   double bpm = BPMOverWindow(interleaved_normalized_samples, sampleRate, 3);
-//   EXPECT_EQ(bpm, 80.);
-// }
+using namespace musher::core;
 
-// TEST(AudioFileDecoding, MP3BPM) {
-//   std::vector<double> NormalizedSamples;
-//   const std::string filePathMp3 = TEST_DATA_DIR + std::string("audio_files/126bpm.mp3");
+namespace {
 
-//   Mp3Decoded mp3_decoded = CDecodeMp3(filePathMp3);
-//   uint32_t sampleRate = mp3_decoded.sample_rate;
-//   std::vector<double> interleaved_normalized_samples = mp3_decoded.interleaved_normalized_samples;
+// Decaying 1 kHz bursts at a steady tempo.
+std::vector<double> ClickTrack(double bpm, double sample_rate, double seconds) {
+  std::vector<double> signal(static_cast<size_t>(seconds * sample_rate), 0.);
+  const double period = 60. / bpm * sample_rate;
+  for (double onset = 0.; onset < static_cast<double>(signal.size()); onset += period) {
+    for (size_t i = 0; i < 2000 && static_cast<size_t>(onset) + i < signal.size(); i++) {
+      const double t = static_cast<double>(i) / sample_rate;
+      signal[static_cast<size_t>(onset) + i] = std::exp(-t * 200.) * std::sin(2. * M_PI * 1000. * t);
+    }
+  }
+  return signal;
+}
 
-//   double bpm = BPMOverWindow(interleaved_normalized_samples, sampleRate, 3);
-//   // std::cout << bpm << std::endl;
-//   EXPECT_DOUBLE_EQ(bpm, 125.);
-// }
+}  // namespace
+
+/**
+ * @brief The autocorrelation matches the direct sum for every lag.
+ *
+ */
+TEST(BeatDetection, Autocorrelation) {
+  for (size_t size : {1, 2, 7, 64, 1001}) {
+    SCOPED_TRACE(size);
+    std::vector<double> signal(size);
+    for (size_t i = 0; i < size; i++) signal[i] = std::sin(0.3 * i) + 0.01 * i;
+
+    std::vector<double> correlation = Autocorrelation(signal);
+    ASSERT_EQ(correlation.size(), size);
+    for (size_t lag = 0; lag < size; lag++) {
+      double expected = 0.;
+      for (size_t j = 0; j + lag < size; j++) expected += signal[j] * signal[j + lag];
+      EXPECT_NEAR(correlation[lag], expected, 1e-9 * (1. + std::abs(expected)));
+    }
+  }
+  EXPECT_TRUE(Autocorrelation({}).empty());
+}
+
+/**
+ * @brief The tempo of a click track is found, silence and too short signals have none.
+ *
+ */
+TEST(BeatDetection, ClickTrack) {
+  const double sample_rate = 44100.;
+  for (double bpm : {70., 90., 120., 128.}) {
+    SCOPED_TRACE(bpm);
+    EXPECT_NEAR(BPMDetection(ClickTrack(bpm, sample_rate, 6.), sample_rate), bpm, 1.);
+  }
+
+  EXPECT_EQ(BPMDetection(std::vector<double>(3 * 44100, 0.), sample_rate), 0.);
+  EXPECT_EQ(BPMDetection(std::vector<double>(100, 0.5), sample_rate), 0.);
+  EXPECT_EQ(BPMOverWindow({ClickTrack(120., sample_rate, 2.)}, sample_rate, 3.), 0.);
+  EXPECT_THROW(BPMOverWindow({ClickTrack(120., sample_rate, 2.)}, sample_rate, 0.), std::runtime_error);
+}
+
+/**
+ * @brief A single window of a .wav file.
+ *
+ */
+TEST(BeatDetection, BeatDetection) {
+  const std::string filePath = TEST_DATA_DIR + std::string("audio_files/CantinaBand3sec.wav");
+
+  WavDecoded wav_decoded = DecodeWav(filePath);
+  double bpm = BPMOverWindow(wav_decoded.normalized_samples, wav_decoded.sample_rate, 3.);
+  EXPECT_EQ(bpm, 114.);
+}
+
+/**
+ * @brief The windows give the same median on any number of threads.
+ *
+ */
+TEST(BeatDetection, MP3BPM) {
+  const std::string filePathMp3 = TEST_DATA_DIR + std::string("audio_files/126bpm.mp3");
+
+  Mp3Decoded mp3_decoded = DecodeMp3(filePathMp3);
+  for (int num_threads : {1, 4}) {
+    SCOPED_TRACE(num_threads);
+    double bpm = BPMOverWindow(mp3_decoded.normalized_samples, mp3_decoded.sample_rate, 3., num_threads);
+    EXPECT_DOUBLE_EQ(bpm, 125.);
+  }
+}
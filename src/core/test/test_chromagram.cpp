@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/chromagram.h"
+#include "src/core/key.h"
+#include "src/core/test/gtest_extras.h"
+
+using namespace musher::core;
+
+/**
+ * @brief Averaging the rows of the chromagram gives the averaged HPCP of DetectKey.
+ *
+ */
+TEST(Chromagram, MatchesAnalyzeKey) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  std::vector<std::vector<double>> normalized_samples = mp3_decoded.normalized_samples;
+  double sample_rate = mp3_decoded.sample_rate;
+
+  Chromagram chromagram = ComputeChromagram(normalized_samples, sample_rate);
+  DetectKeyOptions options;
+  options.profile_type = "Temperley";
+  KeyAnalysis key_analysis = AnalyzeKey(normalized_samples, sample_rate, options);
+
+  ASSERT_EQ(chromagram.num_frames, key_analysis.frames_analyzed);
+  ASSERT_EQ(chromagram.pcp_size, 36);
+  ASSERT_EQ(chromagram.hpcps.size(), static_cast<size_t>(chromagram.num_frames) * 36);
+  ASSERT_EQ(chromagram.timestamps.size(), static_cast<size_t>(chromagram.num_frames));
+  EXPECT_DOUBLE_EQ(chromagram.timestamps[0], 0.);
+  EXPECT_DOUBLE_EQ(chromagram.timestamps[1], 512 / sample_rate);
+
+  std::vector<double> sums(36, 0.);
+  for (int frame = 0; frame < chromagram.num_frames; frame++) {
+    for (int i = 0; i < 36; i++) sums[i] += chromagram.hpcps[frame * 36 + i];
+  }
+  for (int i = 0; i < 36; i++) EXPECT_DOUBLE_EQ(sums[i] / chromagram.num_frames, key_analysis.average_hpcp[i]);
+}
+
+/**
+ * @brief Aggregated rows are the mean or maximum of the frames they cover.
+ *
+ */
+TEST(Chromagram, Aggregation) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  std::vector<std::vector<double>> normalized_samples = mp3_decoded.normalized_samples;
+  std::vector<double> first_seconds(normalized_samples[0].begin(), normalized_samples[0].begin() + 3 * 44100);
+  normalized_samples = {first_seconds};
+  double sample_rate = mp3_decoded.sample_rate;
+
+  Chromagram frames = ComputeChromagram(normalized_samples, sample_rate, 12, 3, 4096, 512, BlackmanHarris62dB, 100, 1.);
+  Chromagram means = ComputeChromagram(normalized_samples, sample_rate, 12, 3, 4096, 512, BlackmanHarris62dB, 100, 1., 8);
+  Chromagram maxima =
+      ComputeChromagram(normalized_samples, sample_rate, 12, 3, 4096, 512, BlackmanHarris62dB, 100, 1., 8, "max");
+
+  ASSERT_EQ(means.num_frames, (frames.num_frames + 7) / 8);
+  ASSERT_EQ(maxima.num_frames, means.num_frames);
+  for (int row = 0; row < means.num_frames; row++) {
+    int first_frame = row * 8;
+    int last_frame = std::min(first_frame + 8, frames.num_frames) - 1;
+    EXPECT_DOUBLE_EQ(means.timestamps[row], (frames.timestamps[first_frame] + frames.timestamps[last_frame]) / 2);
+
+    for (int i = 0; i < 12; i++) {
+      double sum = 0., max = 0.;
+      for (int frame = first_frame; frame <= last_frame; frame++) {
+        sum += frames.hpcps[frame * 12 + i];
+        max = std::max(max, frames.hpcps[frame * 12 + i]);
+      }
+      EXPECT_NEAR(means.hpcps[row * 12 + i], sum / (last_frame - first_frame + 1), 1e-12);
+      EXPECT_DOUBLE_EQ(maxima.hpcps[row * 12 + i], max);
+    }
+  }
+
+  EXPECT_THROW(ComputeChromagram(normalized_samples, sample_rate, 12, 3, 4096, 512, BlackmanHarris62dB, 100, 1., 0),
+               std::runtime_error);
+  EXPECT_THROW(
+      ComputeChromagram(normalized_samples, sample_rate, 12, 3, 4096, 512, BlackmanHarris62dB, 100, 1., 8, "median"),
+      std::runtime_error);
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/constant_q.h"
+#include "src/core/hpcp.h"
+#include "src/core/key.h"
+
+using namespace musher::core;
+
+namespace {
+
+std::vector<double> Tones(const std::vector<double> &frequencies, double sample_rate, size_t size) {
+  std::vector<double> signal(size, 0.);
+  for (double frequency : frequencies) {
+    for (size_t i = 0; i < size; i++)
+      signal[i] += 0.5 * std::sin(2. * M_PI * frequency * static_cast<double>(i) / sample_rate);
+  }
+  return signal;
+}
+
+std::vector<double> AverageRows(const Chromagram &chromagram) {
+  std::vector<double> average(static_cast<size_t>(chromagram.pcp_size), 0.);
+  for (int row = 0; row < chromagram.num_frames; row++) {
+    for (int i = 0; i < chromagram.pcp_size; i++)
+      average[static_cast<size_t>(i)] += chromagram.hpcps[static_cast<size_t>(row * chromagram.pcp_size + i)];
+  }
+  return average;
+}
+
+}  // namespace
+
+/**
+ * @brief A sine at the frequency of a bin gives half its amplitude in that bin, and little in the bins a semitone
+ * away.
+ *
+ */
+TEST(ConstantQ, BinMagnitudes) {
+  const double sample_rate = 44100.;
+  ConstantQPlan plan(sample_rate, 36, 55., 6);
+  EXPECT_LT(plan.KernelSize(), plan.BinsPerOctave() * (plan.FrameSize() / 2 + 1) / 10);
+
+  // Bin 6 of the highest octave, 1760 Hz * 2^(6 / 36).
+  const double frequency = 1760. * std::pow(2., 6. / 36.);
+  std::vector<double> frame(plan.FrameSize());
+  for (size_t i = 0; i < frame.size(); i++) frame[i] = std::cos(2. * M_PI * frequency * i / sample_rate);
+
+  std::vector<std::complex<double>> bins;
+  plan.Compute(frame, bins);
+  ASSERT_EQ(bins.size(), 36u);
+  EXPECT_NEAR(std::abs(bins[6]), 0.5, 1e-3);
+  EXPECT_LT(std::abs(bins[3]), 0.01);
+  EXPECT_LT(std::abs(bins[9]), 0.01);
+}
+
+/**
+ * @brief Tones land in their pitch class in every octave, pitch class 0 being A. Two tones a semitone apart in the
+ * lowest octave are resolved.
+ *
+ */
+TEST(ConstantQ, ChromagramPitchClasses) {
+  const double sample_rate = 44100.;
+  for (double frequency : {440., 261.63, 65.41, 2093.}) {
+    SCOPED_TRACE(frequency);
+    Chromagram chromagram = ComputeConstantQChromagram({Tones({frequency}, sample_rate, 44100)}, sample_rate);
+    EXPECT_EQ(chromagram.pcp_size, 36);
+    EXPECT_EQ(chromagram.num_frames, 87);
+    EXPECT_DOUBLE_EQ(chromagram.timestamps[2], 1024. / sample_rate);
+
+    std::vector<double> average = AverageRows(chromagram);
+    int expected_pitch_class = static_cast<int>(std::lround(36. * std::log2(frequency / 440.) + 360.)) % 36;
+    EXPECT_EQ(ArgMax(average), expected_pitch_class);
+  }
+
+  // A2 and Bb2, the peaks of a 4096 samples spectrum are 10.8 Hz apart, the two tones 6.5 Hz.
+  Chromagram chromagram = ComputeConstantQChromagram({Tones({110., 116.54}, sample_rate, 44100)}, sample_rate);
+  std::vector<double> average = AverageRows(chromagram);
+  NormalizeInPlace(average);
+  EXPECT_GT(average[0], 0.5);
+  EXPECT_GT(average[3], 0.5);
+  EXPECT_LT(average[1], 0.5);
+  EXPECT_LT(average[2], 0.5);
+}
+
+/**
+ * @brief Invalid parameters are rejected.
+ *
+ */
+TEST(ConstantQ, InvalidParameters) {
+  EXPECT_THROW(ConstantQPlan(44100., 30), std::runtime_error);
+  EXPECT_THROW(ConstantQPlan(44100., 36, 55., 0), std::runtime_error);
+  EXPECT_THROW(ConstantQPlan(44100., 36, 0.), std::runtime_error);
+  // The highest octave would end at 14080 Hz.
+  EXPECT_THROW(ConstantQPlan(22050., 36, 55., 8), std::runtime_error);
+  EXPECT_THROW(ComputeConstantQChromagram({{0., 1.}}, 44100., 36, 0), std::runtime_error);
+}
+
+/**
+ * @brief The constant-Q front end finds the key of the classical test file.
+ *
+ */
+TEST(ConstantQ, DetectKeyConstantQ) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+
+  DetectKeyOutput key_output = DetectKeyConstantQ(mp3_decoded.normalized_samples, mp3_decoded.sample_rate, "Temperley");
+  EXPECT_EQ(key_output.key, "C");
+  EXPECT_EQ(key_output.scale, "major");
+  EXPECT_GT(key_output.frames_analyzed, 0);
+  EXPECT_EQ(key_output.frames_skipped, 0);
+  EXPECT_EQ(key_output.analyzed_ratio, 1.);
+}
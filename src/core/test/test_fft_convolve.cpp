@@ -0,0 +1,113 @@
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/fft_convolve.h"
+
+using namespace musher::core;
+
+namespace {
+
+std::vector<double> RandomSignal(size_t size, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> uniform(-1., 1.);
+  std::vector<double> signal(size);
+  for (double &sample : signal) sample = uniform(rng);
+  return signal;
+}
+
+// Full discrete linear convolution, or correlation, by the definition.
+std::vector<double> DirectFull(const std::vector<double> &signal, const std::vector<double> &kernel, bool correlate) {
+  std::vector<double> full(signal.size() + kernel.size() - 1, 0.);
+  for (size_t n = 0; n < signal.size(); n++) {
+    for (size_t k = 0; k < kernel.size(); k++) {
+      const double tap = correlate ? kernel[kernel.size() - 1 - k] : kernel[k];
+      full[n + k] += signal[n] * tap;
+    }
+  }
+  return full;
+}
+
+std::vector<double> Slice(const std::vector<double> &full, size_t begin, size_t size) {
+  return std::vector<double>(full.begin() + begin, full.begin() + begin + size);
+}
+
+void ExpectNear(const std::vector<double> &actual, const std::vector<double> &expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); i++) EXPECT_NEAR(actual[i], expected[i], 1e-9) << "at " << i;
+}
+
+}  // namespace
+
+/**
+ * @brief Every method gives the full, same and valid outputs of the definition, for convolutions and correlations.
+ *
+ */
+TEST(ConvolverPlan, MatchesDefinition) {
+  const std::vector<std::vector<size_t>> sizes = {
+    // {signal size, kernel size}: direct, direct, fft, overlap_save, direct, fft.
+    {1000, 5}, {20, 700}, {3000, 100}, {20000, 100}, {1, 1}, {100, 101},
+  };
+  for (const std::vector<size_t> &size : sizes) {
+    const std::vector<double> signal = RandomSignal(size[0], 1);
+    const std::vector<double> kernel = RandomSignal(size[1], 2);
+    for (bool correlate : {false, true}) {
+      ConvolverPlan plan(kernel, correlate, 3);
+      SCOPED_TRACE(std::to_string(size[0]) + " x " + std::to_string(size[1]) + " " + plan.Method(signal.size()) +
+                   (correlate ? " correlation" : " convolution"));
+      const std::vector<double> full = DirectFull(signal, kernel, correlate);
+
+      ExpectNear(plan.Convolve(signal), full);
+      ExpectNear(plan.Convolve(signal, "same"), Slice(full, (kernel.size() - 1) / 2, signal.size()));
+      if (signal.size() >= kernel.size())
+        ExpectNear(plan.Convolve(signal, "valid"), Slice(full, kernel.size() - 1, signal.size() - kernel.size() + 1));
+      else
+        EXPECT_TRUE(plan.Convolve(signal, "valid").empty());
+      // The second call reuses the cached spectra.
+      ExpectNear(plan.Convolve(signal, "same"), Slice(full, (kernel.size() - 1) / 2, signal.size()));
+    }
+  }
+}
+
+/**
+ * @brief Tiny kernels are convolved directly, long signals by blocks and kernels as long as the signal by a single
+ * FFT. The blocks give the same output on any number of threads.
+ *
+ */
+TEST(ConvolverPlan, Methods) {
+  ConvolverPlan tiny(RandomSignal(ConvolverPlan::DirectMaxKernelSize(), 1));
+  EXPECT_EQ(tiny.Method(1 << 20), "direct");
+
+  ConvolverPlan plan(RandomSignal(100, 1));
+  EXPECT_EQ(plan.Method(10), "direct");
+  EXPECT_EQ(plan.Method(1 << 20), "overlap_save");
+  EXPECT_EQ(plan.Method(500), "fft");
+  EXPECT_GE(plan.BlockSize(), 8 * plan.KernelSize());
+
+  const std::vector<double> signal = RandomSignal(1 << 18, 3);
+  const std::vector<double> expected = ConvolverPlan(RandomSignal(100, 1), true, 1).Convolve(signal, "same");
+  for (int num_threads : {2, 4, 0}) {
+    ConvolverPlan threaded(RandomSignal(100, 1), true, num_threads);
+    EXPECT_GE(threaded.NumThreads(), 1);
+    EXPECT_TRUE(threaded.Correlate());
+    EXPECT_EQ(threaded.Convolve(signal, "same"), expected);
+  }
+}
+
+/**
+ * @brief FFTConvolve keeps its 'same' output, and invalid parameters are rejected.
+ *
+ */
+TEST(ConvolverPlan, FFTConvolveAndInvalidParameters) {
+  const std::vector<double> signal = RandomSignal(500, 1);
+  const std::vector<double> kernel = RandomSignal(64, 2);
+  ExpectNear(FFTConvolve(signal, kernel), CenterVector(DirectFull(signal, kernel, false), signal.size()));
+  EXPECT_TRUE(FFTConvolve({}, kernel).empty());
+  EXPECT_TRUE(ConvolverPlan(kernel).Convolve({}).empty());
+
+  EXPECT_THROW(ConvolverPlan({}), std::runtime_error);
+  EXPECT_THROW(ConvolverPlan(kernel).Convolve(signal, "circular"), std::runtime_error);
+}
@@ -1,8 +1,11 @@
 #include "src/core/test/gtest_extras.h"
+#include "src/core/framecutter.h"
 #include "src/core/test/utils.h"
 #include "gtest/gtest.h"
 #include <vector>
+#include <algorithm>
 #include <numeric>
+#include <stdexcept>
 
 using namespace musher::core;
 using namespace musher::core::test;
@@ -1276,3 +1279,107 @@ TEST(Framecutter, TestDontDropLastFrameStartFromCenterOddFrameSize2) {
 
   EXPECT_MATRIX_EQ(actual_frames, expected_frames);
 }
+
+/**
+ * @brief NumFrames agrees with the number of iterated frames for every combination of options.
+ *
+ */
+TEST(Framecutter, TestNumFrames) {
+  for (size_t buffer_size : { 0, 1, 6, 1000 }) {
+    std::vector<double> buffer(buffer_size);
+    std::iota(buffer.begin(), buffer.end(), 0.);
+
+    for (int frame_size : { 1, 7, 64, 100, 1001 }) {
+      for (int hop_size : { 1, 32, 60, 1200 }) {
+        for (bool start_from_center : { true, false }) {
+          for (bool last_frame_to_end_of_file : { true, false }) {
+            for (double valid_frame_threshold_ratio : { 0., 0.3, 1. }) {
+              if (start_from_center && valid_frame_threshold_ratio > 0.5) continue;
+
+              Framecutter framecutter(buffer, frame_size, hop_size, start_from_center, last_frame_to_end_of_file,
+                                      valid_frame_threshold_ratio);
+              int expected_num_frames = 0;
+              for (const std::vector<double> &frame : framecutter) {
+                (void)frame;
+                expected_num_frames++;
+              }
+
+              EXPECT_EQ(framecutter.NumFrames(), expected_num_frames)
+                  << "frame_size=" << frame_size << " hop_size=" << hop_size
+                  << " start_from_center=" << start_from_center
+                  << " last_frame_to_end_of_file=" << last_frame_to_end_of_file
+                  << " valid_frame_threshold_ratio=" << valid_frame_threshold_ratio << " buffer_size=" << buffer_size;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Cutting a frame at its start index gives the same frame as iterating with Framecutter.
+ *
+ */
+TEST(Framecutter, TestCutFrameMatchesIteration) {
+  std::vector<double> buffer(1000);
+  std::iota(buffer.begin(), buffer.end(), 1.);
+
+  for (int frame_size : { 1, 64, 101, 1500 }) {
+    for (int hop_size : { 17, 512 }) {
+      Framecutter framecutter(buffer, frame_size, hop_size);
+      int frame_index = 0;
+      for (const std::vector<double> &expected_frame : framecutter) {
+        std::vector<double> actual_frame =
+            CutFrame(buffer, FrameStartIndex(frame_index, frame_size, hop_size), frame_size);
+        EXPECT_VEC_EQ(actual_frame, expected_frame);
+        frame_index++;
+      }
+      EXPECT_EQ(frame_index, CountFrames(buffer.size(), frame_size, hop_size));
+    }
+  }
+}
+
+/**
+ * @brief Frame indices selected by each sampling type.
+ *
+ */
+TEST(Framecutter, TestSampleFrameIndices) {
+  EXPECT_VEC_EQ(SampleFrameIndices(5), std::vector<int>({ 0, 1, 2, 3, 4 }));
+  EXPECT_VEC_EQ(SampleFrameIndices(10, "stride", 4), std::vector<int>({ 0, 4, 8 }));
+  EXPECT_VEC_EQ(SampleFrameIndices(10, "even", 1, 5), std::vector<int>({ 1, 3, 5, 7, 9 }));
+  EXPECT_VEC_EQ(SampleFrameIndices(3, "even", 1, 5), std::vector<int>({ 0, 1, 2 }));
+  EXPECT_TRUE(SampleFrameIndices(0, "stride", 4).empty());
+
+  std::vector<int> random_indices = SampleFrameIndices(1000, "random", 1, 50, 7);
+  EXPECT_EQ(random_indices.size(), 50u);
+  EXPECT_TRUE(std::is_sorted(random_indices.begin(), random_indices.end()));
+  EXPECT_TRUE(std::adjacent_find(random_indices.begin(), random_indices.end()) == random_indices.end());
+  EXPECT_GE(random_indices.front(), 0);
+  EXPECT_LT(random_indices.back(), 1000);
+  EXPECT_VEC_EQ(SampleFrameIndices(1000, "random", 1, 50, 7), random_indices);
+  EXPECT_NE(SampleFrameIndices(1000, "random", 1, 50, 8), random_indices);
+
+  EXPECT_THROW(SampleFrameIndices(10, "stride", 0), std::runtime_error);
+  EXPECT_THROW(SampleFrameIndices(10, "even", 1, 0), std::runtime_error);
+  EXPECT_THROW(SampleFrameIndices(10, "sparse"), std::runtime_error);
+}
+
+/**
+ * @brief Frame positions past 2^31 samples. The frames repeat every 2^32 samples when the hop size divides it, so the
+ * count of a buffer longer than 2^32 is the one of the remainder plus 2^32 / hop_size.
+ *
+ */
+TEST(Framecutter, TestNumFramesPast2GB) {
+  const size_t four_gb = size_t(1) << 32;
+  for (size_t remainder : {1, 5000, 100000}) {
+    EXPECT_EQ(CountFrames(four_gb + remainder, 4096, 1 << 16), CountFrames(remainder, 4096, 1 << 16) + (1 << 16));
+  }
+  EXPECT_EQ(CountFrames((size_t(1) << 31) + 1, 1024, 1 << 20), 2049);
+  EXPECT_EQ(FrameStartIndex((1 << 16) + 3, 4096, 1 << 16), static_cast<int64_t>(four_gb) + 3 * (1 << 16) - 2048);
+
+  // 2^32 frames do not fit in an int.
+  EXPECT_EQ(CountFrames(four_gb, 1, 4, false), 1 << 30);
+  EXPECT_THROW(CountFrames(four_gb, 1, 1, false), std::runtime_error);
+  EXPECT_THROW(CountFrames(1000, 1024, 0), std::runtime_error);
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -185,3 +187,218 @@ TEST(Key, DetectGZ) {
 //        EXPECT_NEAR(key_output.first_to_second_relative_strength, 0.192236, 0.000001);
     }
 }
+
+/**
+ * @brief Adaptive key detection stops once the estimate is stable and reports how much was analyzed.
+ *
+ */
+TEST(Key, DetectKeyAdaptiveEarlyExit) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  std::vector<std::vector<double>> normalized_samples = mp3_decoded.normalized_samples;
+  double sample_rate = mp3_decoded.sample_rate;
+
+  DetectKeyOutput full_key_output = DetectKey(normalized_samples, sample_rate, "Temperley");
+  EXPECT_EQ(full_key_output.frames_analyzed, 2591);
+  EXPECT_DOUBLE_EQ(full_key_output.analyzed_ratio, 1.);
+  EXPECT_NEAR(full_key_output.seconds_analyzed, mp3_decoded.length_in_seconds, 4096. / sample_rate);
+
+  DetectKeyOptions adaptive_options;
+  adaptive_options.profile_type = "Temperley";
+  adaptive_options.convergence_frames = 500;
+  DetectKeyOutput adaptive_key_output = DetectKey(normalized_samples, sample_rate, adaptive_options);
+  EXPECT_EQ(adaptive_key_output.key, "C");
+  EXPECT_EQ(adaptive_key_output.scale, "major");
+  EXPECT_LT(adaptive_key_output.frames_analyzed, full_key_output.frames_analyzed);
+  EXPECT_LT(adaptive_key_output.analyzed_ratio, 1.);
+  EXPECT_LT(adaptive_key_output.seconds_analyzed, full_key_output.seconds_analyzed);
+  EXPECT_EQ(adaptive_key_output.frames_analyzed % 32, 0);
+}
+
+/**
+ * @brief Strided, evenly spaced and random frame sampling only analyze the selected frames.
+ *
+ */
+TEST(Key, DetectKeyFrameSampling) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  std::vector<std::vector<double>> normalized_samples = mp3_decoded.normalized_samples;
+  double sample_rate = mp3_decoded.sample_rate;
+
+  DetectKeyOutput full_key_output = DetectKey(normalized_samples, sample_rate, "Temperley");
+  DetectKeyOptions options;
+  options.profile_type = "Temperley";
+  options.frame_sampling = "stride";
+  options.frame_stride = 1;
+  DetectKeyOutput stride_one_key_output = DetectKey(normalized_samples, sample_rate, options);
+  EXPECT_EQ(stride_one_key_output.key, full_key_output.key);
+  EXPECT_EQ(stride_one_key_output.scale, full_key_output.scale);
+  EXPECT_DOUBLE_EQ(stride_one_key_output.strength, full_key_output.strength);
+  EXPECT_EQ(stride_one_key_output.frames_analyzed, full_key_output.frames_analyzed);
+
+  options.frame_stride = 8;
+  DetectKeyOutput stride_key_output = DetectKey(normalized_samples, sample_rate, options);
+  EXPECT_EQ(stride_key_output.key, "C");
+  EXPECT_EQ(stride_key_output.scale, "major");
+  EXPECT_EQ(stride_key_output.frames_analyzed, (full_key_output.frames_analyzed + 7) / 8);
+  EXPECT_NEAR(stride_key_output.analyzed_ratio, 1. / 8, 1e-3);
+
+  options.frame_sampling = "even";
+  options.frame_stride = 1;
+  options.num_sampled_frames = 200;
+  DetectKeyOutput even_key_output = DetectKey(normalized_samples, sample_rate, options);
+  EXPECT_EQ(even_key_output.key, "C");
+  EXPECT_EQ(even_key_output.scale, "major");
+  EXPECT_EQ(even_key_output.frames_analyzed, 200);
+
+  options.frame_sampling = "random";
+  options.sampling_seed = 42;
+  DetectKeyOutput random_key_output = DetectKey(normalized_samples, sample_rate, options);
+  EXPECT_EQ(random_key_output.key, "C");
+  EXPECT_EQ(random_key_output.scale, "major");
+  EXPECT_EQ(random_key_output.frames_analyzed, 200);
+}
+
+/**
+ * @brief Every profile of the ensemble gives the same estimate as DetectKey with that profile.
+ *
+ */
+TEST(Key, DetectKeyEnsemble) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  std::vector<std::vector<double>> normalized_samples = mp3_decoded.normalized_samples;
+  double sample_rate = mp3_decoded.sample_rate;
+
+  std::vector<std::string> profile_types({ "Temperley", "Krumhansl", "Bgate", "Tonic Triad" });
+  DetectKeyOptions options;
+  options.frame_sampling = "stride";
+  options.frame_stride = 4;
+  EnsembleKeyOutput ensemble_key_output =
+      DetectKeyEnsemble(normalized_samples, sample_rate, profile_types, "majority", options);
+
+  ASSERT_EQ(ensemble_key_output.key_outputs.size(), profile_types.size());
+  for (size_t i = 0; i < profile_types.size(); i++) {
+    options.profile_type = profile_types[i];
+    DetectKeyOutput expected_key_output = DetectKey(normalized_samples, sample_rate, options);
+    EXPECT_EQ(ensemble_key_output.key_outputs[i].key, expected_key_output.key);
+    EXPECT_EQ(ensemble_key_output.key_outputs[i].scale, expected_key_output.scale);
+    EXPECT_DOUBLE_EQ(ensemble_key_output.key_outputs[i].strength, expected_key_output.strength);
+    EXPECT_EQ(ensemble_key_output.frames_analyzed, expected_key_output.frames_analyzed);
+  }
+  EXPECT_EQ(ensemble_key_output.vote.key, "C");
+  EXPECT_EQ(ensemble_key_output.vote.scale, "major");
+  EXPECT_DOUBLE_EQ(ensemble_key_output.vote.first_to_second_relative_strength, 2. / 3.);
+
+  EnsembleKeyOutput all_profiles_key_output =
+      DetectKeyEnsemble(normalized_samples, sample_rate, std::vector<std::string>(), "weighted", true, true, 4, 0.6,
+                        false, 36, 4096, 512, BlackmanHarris62dB, 100, .5, "stride", 16);
+  EXPECT_EQ(all_profiles_key_output.key_outputs.size(), KeyProfileTypes().size());
+  EXPECT_EQ(all_profiles_key_output.vote.key, "C");
+  EXPECT_EQ(all_profiles_key_output.vote.scale, "major");
+
+  EXPECT_THROW(DetectKeyEnsemble(normalized_samples, sample_rate, { "Temperley", "NotAProfile" }),
+               std::runtime_error);
+}
+
+/**
+ * @brief With monophonic profiles Weichai cannot estimate the key of this recording, the default ensemble drops its vote
+ * instead of failing.
+ *
+ */
+TEST(Key, DetectKeyEnsembleDropsFailedProfiles) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  std::vector<std::vector<double>> normalized_samples = mp3_decoded.normalized_samples;
+  double sample_rate = mp3_decoded.sample_rate;
+
+  DetectKeyOptions options;
+  options.use_polphony = false;
+  options.frame_sampling = "stride";
+  options.frame_stride = 16;
+  EnsembleKeyOutput ensemble_key_output;
+  ASSERT_NO_THROW(ensemble_key_output = DetectKeyEnsemble(normalized_samples, sample_rate, std::vector<std::string>(),
+                                                          "majority", options));
+
+  EXPECT_EQ(ensemble_key_output.dropped_profile_types, std::vector<std::string>({ "Weichai" }));
+  EXPECT_EQ(ensemble_key_output.key_outputs.size(), ensemble_key_output.profile_types.size());
+  EXPECT_EQ(ensemble_key_output.profile_types.size() + 1, KeyProfileTypes().size());
+  EXPECT_EQ(std::find(ensemble_key_output.profile_types.begin(), ensemble_key_output.profile_types.end(), "Weichai"),
+            ensemble_key_output.profile_types.end());
+  EXPECT_EQ(ensemble_key_output.vote.key, "C");
+  EXPECT_EQ(ensemble_key_output.vote.scale, "major");
+
+  EXPECT_THROW(DetectKeyEnsemble(normalized_samples, sample_rate, { "Weichai" }, "majority", options),
+               std::runtime_error);
+}
+
+/**
+ * @brief Majority and weighted votes over a set of key estimates.
+ *
+ */
+TEST(Key, VoteKey) {
+  std::vector<KeyOutput> key_outputs({
+      { "C", "major", 0.5, 0.1 },
+      { "A", "minor", 0.9, 0.2 },
+      { "C", "major", 0.3, 0.1 },
+      { "A", "minor", 0.9, 0.3 },
+      { "G", "major", 0.2, 0.1 },
+  });
+
+  // 2 votes each, A minor has the larger summed strength.
+  KeyOutput majority_vote = VoteKey(key_outputs, "majority");
+  EXPECT_EQ(majority_vote.key, "A");
+  EXPECT_EQ(majority_vote.scale, "minor");
+  EXPECT_DOUBLE_EQ(majority_vote.strength, 0.9);
+  EXPECT_DOUBLE_EQ(majority_vote.first_to_second_relative_strength, 0.);
+
+  key_outputs.push_back({ "C", "major", 0.1, 0.1 });
+  majority_vote = VoteKey(key_outputs, "majority");
+  EXPECT_EQ(majority_vote.key, "C");
+  EXPECT_DOUBLE_EQ(majority_vote.strength, 0.3);
+  EXPECT_DOUBLE_EQ(majority_vote.first_to_second_relative_strength, 1. / 3.);
+
+  KeyOutput weighted_vote = VoteKey(key_outputs, "weighted");
+  EXPECT_EQ(weighted_vote.key, "A");
+  EXPECT_EQ(weighted_vote.scale, "minor");
+  EXPECT_DOUBLE_EQ(weighted_vote.first_to_second_relative_strength, (1.8 - 0.9) / 1.8);
+
+  EXPECT_THROW(VoteKey(std::vector<KeyOutput>()), std::runtime_error);
+  EXPECT_THROW(VoteKey(key_outputs, "unanimous"), std::runtime_error);
+}
+
+/**
+ * @brief AnalyzeKey returns the averaged HPCP and scores the key was estimated from.
+ *
+ */
+TEST(Key, AnalyzeKey) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  std::vector<std::vector<double>> normalized_samples = mp3_decoded.normalized_samples;
+  double sample_rate = mp3_decoded.sample_rate;
+
+  DetectKeyOptions options;
+  options.profile_type = "Temperley";
+  KeyAnalysis key_analysis = AnalyzeKey(normalized_samples, sample_rate, options);
+  DetectKeyOutput detect_key_output = DetectKey(normalized_samples, sample_rate, "Temperley");
+
+  EXPECT_EQ(key_analysis.key, detect_key_output.key);
+  EXPECT_EQ(key_analysis.scale, detect_key_output.scale);
+  EXPECT_DOUBLE_EQ(key_analysis.strength, detect_key_output.strength);
+  EXPECT_EQ(key_analysis.frames_analyzed, detect_key_output.frames_analyzed);
+  ASSERT_EQ(key_analysis.average_hpcp.size(), 36u);
+  ASSERT_EQ(key_analysis.correlations.major.size(), 36u);
+  ASSERT_EQ(key_analysis.correlations.minor.size(), 36u);
+  EXPECT_TRUE(key_analysis.correlations.other.empty());
+  ASSERT_EQ(key_analysis.key_scores.size(), 24u);
+
+  // Re-estimating from the stored HPCP gives the same key without running the DSP again.
+  KeyOutput key_output = EstimateKey(key_analysis.average_hpcp, true, true, 4, 0.6, "Temperley");
+  EXPECT_EQ(key_output.key, key_analysis.key);
+  EXPECT_DOUBLE_EQ(key_output.strength, key_analysis.strength);
+
+  // C major is index 3 of the major keys, and its score is the strength of the estimate.
+  size_t best_key = std::max_element(key_analysis.key_scores.begin(), key_analysis.key_scores.end()) -
+                    key_analysis.key_scores.begin();
+  EXPECT_EQ(best_key, 3u);
+  EXPECT_DOUBLE_EQ(key_analysis.key_scores[best_key], key_analysis.strength);
+}
@@ -0,0 +1,101 @@
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/chromagram.h"
+#include "src/core/key_changes.h"
+#include "src/core/key_profile_plan.h"
+
+using namespace musher::core;
+
+namespace {
+
+/**
+ * @brief Chromagram whose rows are the major profile of the plan shifted to the given keys.
+ *
+ */
+Chromagram ChromagramOfMajorKeys(const KeyProfilePlan& plan, const std::vector<int>& keys) {
+  Chromagram chromagram;
+  chromagram.num_frames = static_cast<int>(keys.size());
+  chromagram.pcp_size = static_cast<int>(plan.pcp_size);
+  for (size_t row = 0; row < keys.size(); row++) {
+    for (unsigned int i = 0; i < plan.pcp_size; i++) {
+      chromagram.hpcps.push_back(plan.profile_major[(i + 12 * plan.pcp_size - keys[row]) % plan.pcp_size]);
+    }
+    chromagram.timestamps.push_back(row * 2.);
+  }
+  return chromagram;
+}
+
+}  // namespace
+
+/**
+ * @brief A modulation gives two segments, and an isolated outlier row is smoothed out by the transition cost.
+ *
+ */
+TEST(KeyChanges, TrackKeyChanges) {
+  KeyProfilePlan plan = BuildKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 12);
+
+  // C major (3) for 6 rows, then G major (10) for 6 rows, with an A major (0) outlier in the middle of the C major.
+  std::vector<int> keys = { 3, 3, 3, 0, 3, 3, 10, 10, 10, 10, 10, 10 };
+  Chromagram chromagram = ChromagramOfMajorKeys(plan, keys);
+
+  std::vector<KeySegment> key_segments = TrackKeyChanges(chromagram, plan, 1.);
+  ASSERT_EQ(key_segments.size(), 2u);
+  EXPECT_EQ(key_segments[0].key, "C");
+  EXPECT_EQ(key_segments[0].scale, "major");
+  EXPECT_DOUBLE_EQ(key_segments[0].start_time, 0.);
+  EXPECT_DOUBLE_EQ(key_segments[0].end_time, 11.);
+  EXPECT_EQ(key_segments[1].key, "G");
+  EXPECT_EQ(key_segments[1].scale, "major");
+  EXPECT_DOUBLE_EQ(key_segments[1].start_time, 11.);
+  EXPECT_DOUBLE_EQ(key_segments[1].end_time, 23.);
+  EXPECT_DOUBLE_EQ(key_segments[1].strength, 1.);
+
+  // Without transition cost every row gets its own best key.
+  key_segments = TrackKeyChanges(chromagram, plan, 0.);
+  ASSERT_EQ(key_segments.size(), 4u);
+  EXPECT_EQ(key_segments[1].key, "A");
+  EXPECT_DOUBLE_EQ(key_segments[1].start_time, 5.);
+  EXPECT_DOUBLE_EQ(key_segments[1].end_time, 7.);
+
+  // A silent row gives no evidence and follows its neighbours.
+  for (int i = 0; i < 12; i++) chromagram.hpcps[3 * 12 + i] = 0.;
+  key_segments = TrackKeyChanges(chromagram, plan, 1.);
+  ASSERT_EQ(key_segments.size(), 2u);
+
+  EXPECT_THROW(TrackKeyChanges(chromagram, plan, std::vector<double>(10, 0.)), std::runtime_error);
+  KeyProfilePlan plan_36 = BuildKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 36);
+  EXPECT_THROW(TrackKeyChanges(chromagram, plan_36, 1.), std::runtime_error);
+}
+
+/**
+ * @brief A C major piece followed by an Eb major piece changes key where the pieces are joined.
+ *
+ */
+TEST(KeyChanges, DetectKeyChanges) {
+  Mp3Decoded c_major = DecodeMp3(TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3"));
+  Mp3Decoded eb_major = DecodeMp3(TEST_DATA_DIR + std::string("audio_files/EDM_Eb_major_2min.mp3"));
+  ASSERT_EQ(c_major.sample_rate, eb_major.sample_rate);
+
+  std::vector<double> samples = c_major.normalized_samples[0];
+  samples.insert(samples.end(), eb_major.normalized_samples[0].begin(),
+                 eb_major.normalized_samples[0].begin() + 30 * eb_major.sample_rate);
+  std::vector<std::vector<double>> normalized_samples = { samples };
+
+  std::vector<KeySegment> key_segments = DetectKeyChanges(normalized_samples, c_major.sample_rate, "Temperley");
+
+  ASSERT_GE(key_segments.size(), 2u);
+  EXPECT_EQ(key_segments.front().key, "C");
+  EXPECT_EQ(key_segments.front().scale, "major");
+  EXPECT_NEAR(key_segments.front().end_time, 30., 1.5);
+  EXPECT_EQ(key_segments[1].key, "Eb");
+  EXPECT_EQ(key_segments[1].scale, "major");
+  EXPECT_DOUBLE_EQ(key_segments.front().start_time, 0.);
+  EXPECT_DOUBLE_EQ(key_segments.back().end_time, samples.size() / static_cast<double>(c_major.sample_rate));
+  for (size_t i = 1; i < key_segments.size(); i++) {
+    EXPECT_DOUBLE_EQ(key_segments[i].start_time, key_segments[i - 1].end_time);
+  }
+}
@@ -0,0 +1,157 @@
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/framecutter.h"
+#include "src/core/key.h"
+#include "src/core/key_detector.h"
+#include "src/core/mono_mixer.h"
+#include "src/core/test/gtest_extras.h"
+
+using namespace musher::core;
+
+namespace {
+
+// Number of calls to the global operator new since the start of the test binary.
+std::atomic<size_t> num_allocations(0);
+
+}  // namespace
+
+void *operator new(size_t size) {
+  num_allocations++;
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+/**
+ * @brief The detector gives the same key as DetectKey, also when it is reused for a second signal.
+ *
+ */
+TEST(KeyDetector, MatchesDetectKey) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  double sample_rate = mp3_decoded.sample_rate;
+
+  DetectKeyOutput expected_key_output = DetectKey(mp3_decoded.normalized_samples, sample_rate, "Temperley");
+
+  KeyDetector key_detector(sample_rate, "Temperley");
+  for (int i = 0; i < 2; i++) {
+    DetectKeyOutput actual_key_output = key_detector.Detect(mp3_decoded.normalized_samples);
+
+    EXPECT_EQ(actual_key_output.key, expected_key_output.key);
+    EXPECT_EQ(actual_key_output.scale, expected_key_output.scale);
+    EXPECT_DOUBLE_EQ(actual_key_output.strength, expected_key_output.strength);
+    EXPECT_DOUBLE_EQ(actual_key_output.first_to_second_relative_strength,
+                     expected_key_output.first_to_second_relative_strength);
+    EXPECT_EQ(actual_key_output.frames_analyzed, expected_key_output.frames_analyzed);
+    EXPECT_DOUBLE_EQ(actual_key_output.seconds_analyzed, expected_key_output.seconds_analyzed);
+  }
+}
+
+/**
+ * @brief Analyzing frames does not allocate any memory once the detector is constructed.
+ *
+ */
+TEST(KeyDetector, NoAllocationsPerFrame) {
+  const double sample_rate = 44100.;
+  const int frame_size = 4096;
+  KeyDetector key_detector(sample_rate, "Temperley");
+
+  // Chord of C major with a few harmonics.
+  std::vector<double> frame(frame_size);
+  const double frequencies[] = { 261.63, 329.63, 392.0 };
+  for (int i = 0; i < frame_size; i++) {
+    for (double frequency : frequencies) {
+      for (int harmonic = 1; harmonic <= 3; harmonic++) {
+        frame[i] += std::sin(2. * M_PI * frequency * harmonic * i / sample_rate) / harmonic;
+      }
+    }
+  }
+
+  key_detector.AddFrame(frame);
+
+  size_t allocations_before = num_allocations;
+  const int num_frames = 200;
+  for (int i = 0; i < num_frames; i++) key_detector.AddFrame(frame);
+  size_t allocations_after = num_allocations;
+
+  EXPECT_EQ(allocations_after - allocations_before, 0u);
+  EXPECT_EQ(key_detector.FrameCount(), num_frames + 1);
+
+  KeyOutput key_output = key_detector.Estimate();
+  EXPECT_EQ(key_output.key, "C");
+  EXPECT_EQ(key_output.scale, "major");
+}
+
+/**
+ * @brief Detecting the key of a whole signal only allocates for the result, not for every frame.
+ *
+ */
+TEST(KeyDetector, FewAllocationsPerSignal) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  double sample_rate = mp3_decoded.sample_rate;
+
+  KeyDetector key_detector(sample_rate, "Temperley");
+  DetectKeyOutput first_key_output = key_detector.Detect(mp3_decoded.normalized_samples);
+
+  size_t allocations_before = num_allocations;
+  DetectKeyOutput second_key_output = key_detector.Detect(mp3_decoded.normalized_samples);
+  size_t allocations_after = num_allocations;
+
+  EXPECT_EQ(second_key_output.key, first_key_output.key);
+  EXPECT_LT(allocations_after - allocations_before, 100u);
+  EXPECT_GT(second_key_output.frames_analyzed, 1000);
+}
+
+/**
+ * @brief Cutting the frames from the channels gives the same HPCPs as cutting them from the mixdown, without
+ * allocating.
+ *
+ */
+TEST(KeyDetector, AddFrameAtMatchesCutFrame) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  double sample_rate = mp3_decoded.sample_rate;
+  const std::vector<std::vector<double>> &normalized_samples = mp3_decoded.normalized_samples;
+  ASSERT_EQ(normalized_samples.size(), 2u);
+  const std::vector<double> mixed_audio = MonoMixer(normalized_samples);
+  const int num_frames = CountFrames(mixed_audio.size(), 4096, 512);
+
+  // The first and last frames are zero-padded.
+  const std::vector<int> frame_indices = { 0, 1, 100, 1000, num_frames - 2, num_frames - 1 };
+  KeyDetector expected_key_detector(sample_rate, "Temperley");
+  for (int frame_index : frame_indices)
+    expected_key_detector.AddFrame(CutFrame(mixed_audio, FrameStartIndex(frame_index, 4096, 512), 4096));
+
+  KeyDetector actual_key_detector(sample_rate, "Temperley");
+  actual_key_detector.AddFrameAt(normalized_samples, FrameStartIndex(frame_indices[0], 4096, 512));
+  size_t allocations_before = num_allocations;
+  for (size_t i = 1; i < frame_indices.size(); i++)
+    actual_key_detector.AddFrameAt(normalized_samples, FrameStartIndex(frame_indices[i], 4096, 512));
+  size_t allocations_after = num_allocations;
+
+  EXPECT_EQ(allocations_after - allocations_before, 0u);
+  EXPECT_EQ(actual_key_detector.FrameCount(), static_cast<int>(frame_indices.size()));
+  const std::vector<double> actual_hpcp = actual_key_detector.AverageHPCP();
+  const std::vector<double> expected_hpcp = expected_key_detector.AverageHPCP();
+  EXPECT_VEC_EQ(actual_hpcp, expected_hpcp);
+  EXPECT_THROW(actual_key_detector.AddFrameAt({}, 0), std::runtime_error);
+}
@@ -0,0 +1,243 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/key.h"
+#include "src/core/key_files.h"
+#include "src/core/pipeline_stats.h"
+#include "src/core/trace_events.h"
+
+using namespace musher::core;
+
+namespace {
+
+int CountOccurrences(const std::string &text, const std::string &pattern) {
+  int count = 0;
+  for (size_t position = text.find(pattern); position != std::string::npos;
+       position = text.find(pattern, position + pattern.size()))
+    count++;
+  return count;
+}
+
+}  // namespace
+
+/**
+ * @brief Every file of the batch gets the same key as DetectKey, whatever the number of threads.
+ *
+ */
+TEST(KeyFiles, DetectKeyFiles) {
+  const std::string data_dir = TEST_DATA_DIR + std::string("audio_files/");
+  std::vector<std::string> file_paths = {data_dir + "CantinaBand3sec.wav", data_dir + "126bpm.mp3",
+                                         data_dir + "CantinaBand3sec.wav"};
+  WavDecoded wav_decoded = DecodeWav(file_paths[0]);
+  DetectKeyOutput wav_key_output = DetectKey(wav_decoded.normalized_samples, wav_decoded.sample_rate);
+  Mp3Decoded mp3_decoded = DecodeMp3(file_paths[1]);
+  DetectKeyOutput mp3_key_output = DetectKey(mp3_decoded.normalized_samples, mp3_decoded.sample_rate);
+
+  for (int num_threads : {1, 2, 0}) {
+    SCOPED_TRACE(num_threads);
+    std::vector<DetectKeyOutput> key_outputs = DetectKeyFiles(file_paths, "Bgate", num_threads);
+    ASSERT_EQ(key_outputs.size(), file_paths.size());
+    for (size_t i : {0, 2}) {
+      EXPECT_EQ(key_outputs[i].key, wav_key_output.key);
+      EXPECT_EQ(key_outputs[i].scale, wav_key_output.scale);
+      EXPECT_NEAR(key_outputs[i].strength, wav_key_output.strength, 1e-9);
+      EXPECT_EQ(key_outputs[i].frames_analyzed, wav_key_output.frames_analyzed);
+    }
+    EXPECT_EQ(key_outputs[1].key, mp3_key_output.key);
+    EXPECT_NEAR(key_outputs[1].strength, mp3_key_output.strength, 1e-9);
+  }
+
+  EXPECT_TRUE(DetectKeyFiles({}).empty());
+  EXPECT_THROW(DetectKeyFiles({data_dir + "CantinaBand3sec.wav", data_dir + "missing.flac"}), std::runtime_error);
+}
+
+/**
+ * @brief A traced batch has a decode span per file, DSP and queue spans, and a thread name per thread.
+ *
+ */
+TEST(KeyFiles, Trace) {
+  const std::string data_dir = TEST_DATA_DIR + std::string("audio_files/");
+  std::vector<std::string> file_paths = {data_dir + "CantinaBand3sec.wav", data_dir + "126bpm.mp3"};
+  const std::string trace_path = (std::filesystem::temp_directory_path() / "musher_test_trace.json").string();
+
+  StartTrace(trace_path);
+  EXPECT_TRUE(TraceEnabled());
+  DetectKeyFiles(file_paths, "Bgate", 2);
+  StopTrace();
+  EXPECT_FALSE(TraceEnabled());
+
+  std::ifstream trace_file(trace_path);
+  std::string trace((std::istreambuf_iterator<char>(trace_file)), std::istreambuf_iterator<char>());
+  std::filesystem::remove(trace_path);
+
+  EXPECT_EQ(trace.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["), 0u);
+  EXPECT_EQ(CountOccurrences(trace, "{"), CountOccurrences(trace, "}"));
+  EXPECT_EQ(CountOccurrences(trace, "\"name\": \"DecodeWav\""), 1);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\": \"DecodeMp3\""), 1);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\": \"DetectKeyFile\""), 2);
+  EXPECT_GE(CountOccurrences(trace, "\"name\": \"AnalyzeFrames\""), 2);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\": \"EstimateKey\""), 2);
+  // Each thread waits for a file, and once more before it finds the queue empty.
+  EXPECT_GE(CountOccurrences(trace, "\"cat\": \"queue\""), 3);
+  EXPECT_NE(trace.find("\"file_path\": \"" + file_paths[1] + "\""), std::string::npos);
+  EXPECT_GE(CountOccurrences(trace, "\"name\": \"thread_name\""), 1);
+
+  // Nothing is recorded once stopped.
+  DetectKeyFiles(file_paths, "Bgate", 1);
+  StopTrace();
+  EXPECT_FALSE(std::filesystem::exists(trace_path));
+}
+
+/**
+ * @brief A trace cannot be started without a writable file.
+ *
+ */
+TEST(KeyFiles, TraceFileError) {
+  EXPECT_THROW(StartTrace("/nonexistent_directory/trace.json"), std::runtime_error);
+  EXPECT_FALSE(TraceEnabled());
+}
+
+/**
+ * @brief The stats of each file include its decoding.
+ *
+ */
+TEST(KeyFiles, Stats) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/CantinaBand3sec.wav");
+  SetStatsEnabled(true);
+  std::vector<DetectKeyOutput> key_outputs = DetectKeyFiles({file_path, file_path}, "Bgate", 2);
+  SetStatsEnabled(false);
+
+  for (const DetectKeyOutput &key_output : key_outputs) {
+    EXPECT_EQ(key_output.stats.bytes_decoded, static_cast<int64_t>(std::filesystem::file_size(file_path)));
+    EXPECT_EQ(key_output.stats.peak_file_bytes, key_output.stats.bytes_decoded);
+    EXPECT_GT(key_output.stats.decode_seconds, 0.);
+    EXPECT_EQ(key_output.stats.frames_processed, key_output.frames_analyzed);
+  }
+}
+
+/**
+ * @brief Files streamed under a memory budget get the same key as the whole decoding, with less memory.
+ *
+ */
+TEST(KeyFiles, DetectKeyFileMemoryBudget) {
+  const std::string data_dir = TEST_DATA_DIR + std::string("audio_files/");
+  SetStatsEnabled(true);
+  for (const std::string file_name : {"CantinaBand3sec.wav", "700kb.wav", "700kb.mp3"}) {
+    SCOPED_TRACE(file_name);
+    DetectKeyOutput expected_key_output = DetectKeyFile(data_dir + file_name, "Temperley");
+    // A budget larger than the whole decoding does not change the strategy.
+    DetectKeyOutput decoded_key_output = DetectKeyFile(data_dir + file_name, "Temperley", 1LL << 40);
+    DetectKeyOutput streamed_key_output = DetectKeyFile(data_dir + file_name, "Temperley", 1);
+
+    for (const DetectKeyOutput &key_output : {decoded_key_output, streamed_key_output}) {
+      EXPECT_EQ(key_output.key, expected_key_output.key);
+      EXPECT_EQ(key_output.scale, expected_key_output.scale);
+      EXPECT_NEAR(key_output.strength, expected_key_output.strength, 1e-9);
+      EXPECT_NEAR(key_output.first_to_second_relative_strength,
+                  expected_key_output.first_to_second_relative_strength, 1e-9);
+      EXPECT_EQ(key_output.frames_analyzed, expected_key_output.frames_analyzed);
+      EXPECT_EQ(key_output.frames_skipped, expected_key_output.frames_skipped);
+      EXPECT_NEAR(key_output.seconds_analyzed, expected_key_output.seconds_analyzed, 1e-9);
+      EXPECT_EQ(key_output.analyzed_ratio, expected_key_output.analyzed_ratio);
+    }
+    EXPECT_EQ(decoded_key_output.stats.peak_decoded_bytes, expected_key_output.stats.peak_decoded_bytes);
+    EXPECT_LT(streamed_key_output.stats.peak_decoded_bytes, expected_key_output.stats.peak_decoded_bytes);
+    EXPECT_GT(streamed_key_output.stats.bytes_decoded, 0);
+  }
+  SetStatsEnabled(false);
+
+  std::vector<DetectKeyOutput> key_outputs = DetectKeyFiles({data_dir + "700kb.mp3"}, "Temperley", 1, 1);
+  ASSERT_EQ(key_outputs.size(), 1u);
+  EXPECT_EQ(key_outputs[0].key, DetectKeyFile(data_dir + "700kb.mp3", "Temperley").key);
+  EXPECT_THROW(DetectKeyFile(data_dir + "missing.flac", "Temperley", 1), std::runtime_error);
+}
+
+/**
+ * @brief A budgeted run streams the file with every option of the full decoding, and gets the same estimate.
+ *
+ */
+TEST(KeyFiles, DetectKeyFileMemoryBudgetOptions) {
+  const std::string data_dir = TEST_DATA_DIR + std::string("audio_files/");
+  DetectKeyOptions options;
+  options.profile_type = "Temperley";
+  options.use_three_chords = false;
+  options.pcp_size = 24;
+  options.frame_size = 2048;
+  options.hop_size = 1024;
+  options.window_type_func = BlackmanHarris92dB;
+  options.max_num_peaks = 50;
+  options.convergence_frames = 64;
+  options.estimate_interval = 16;
+  options.rms_threshold = 0.01;
+
+  for (const std::string file_name : {"700kb.wav", "700kb.mp3"}) {
+    for (double analysis_sample_rate : {0., 16000.}) {
+      SCOPED_TRACE(file_name + " at " + std::to_string(analysis_sample_rate));
+      options.analysis_sample_rate = analysis_sample_rate;
+      options.max_memory_bytes = 0;
+      DetectKeyOutput expected_key_output = DetectKeyFile(data_dir + file_name, options);
+      options.max_memory_bytes = 1;
+      DetectKeyOutput streamed_key_output = DetectKeyFile(data_dir + file_name, options);
+
+      EXPECT_EQ(streamed_key_output.key, expected_key_output.key);
+      EXPECT_EQ(streamed_key_output.scale, expected_key_output.scale);
+      EXPECT_NEAR(streamed_key_output.strength, expected_key_output.strength, 1e-9);
+      EXPECT_NEAR(streamed_key_output.first_to_second_relative_strength,
+                  expected_key_output.first_to_second_relative_strength, 1e-9);
+      EXPECT_EQ(streamed_key_output.frames_analyzed, expected_key_output.frames_analyzed);
+      EXPECT_EQ(streamed_key_output.frames_skipped, expected_key_output.frames_skipped);
+      EXPECT_NEAR(streamed_key_output.seconds_analyzed, expected_key_output.seconds_analyzed, 1e-9);
+      EXPECT_DOUBLE_EQ(streamed_key_output.analyzed_ratio, expected_key_output.analyzed_ratio);
+    }
+  }
+}
+
+/**
+ * @brief With frame sampling, a wav file is only read at the sampled frames and the estimate is the one of DetectKey
+ * on the whole decoded file, with and without a memory budget.
+ *
+ */
+TEST(KeyFiles, DetectKeyFileSampledFrames) {
+  const std::string data_dir = TEST_DATA_DIR + std::string("audio_files/");
+  DetectKeyOptions options;
+  options.frame_sampling = "even";
+  options.num_sampled_frames = 40;
+  options.rms_threshold = 0.01;
+
+  SetStatsEnabled(true);
+  for (const std::string file_name : {"700kb.wav", "700kb.mp3"}) {
+    AudioDecoded audio_decoded = DecodeAudioFile(data_dir + file_name);
+    for (double analysis_sample_rate : {0., 16000.}) {
+      for (int64_t max_memory_bytes : {0, 1}) {
+        SCOPED_TRACE(file_name + " at " + std::to_string(analysis_sample_rate) + " with a budget of " +
+                     std::to_string(max_memory_bytes));
+        options.analysis_sample_rate = analysis_sample_rate;
+        options.max_memory_bytes = max_memory_bytes;
+        DetectKeyOutput expected_key_output =
+            DetectKey(audio_decoded.normalized_samples, static_cast<double>(audio_decoded.sample_rate), options);
+        DetectKeyOutput sampled_key_output = DetectKeyFile(data_dir + file_name, options);
+
+        EXPECT_EQ(sampled_key_output.key, expected_key_output.key);
+        EXPECT_EQ(sampled_key_output.scale, expected_key_output.scale);
+        EXPECT_NEAR(sampled_key_output.strength, expected_key_output.strength, 1e-9);
+        EXPECT_NEAR(sampled_key_output.first_to_second_relative_strength,
+                    expected_key_output.first_to_second_relative_strength, 1e-9);
+        EXPECT_EQ(sampled_key_output.frames_analyzed, expected_key_output.frames_analyzed);
+        EXPECT_EQ(sampled_key_output.frames_skipped, expected_key_output.frames_skipped);
+        EXPECT_NEAR(sampled_key_output.seconds_analyzed, expected_key_output.seconds_analyzed, 1e-9);
+        EXPECT_DOUBLE_EQ(sampled_key_output.analyzed_ratio, expected_key_output.analyzed_ratio);
+        if (file_name == "700kb.wav") {
+          int64_t file_size = static_cast<int64_t>(std::filesystem::file_size(data_dir + file_name));
+          EXPECT_LT(sampled_key_output.stats.bytes_decoded, file_size / 2);
+        }
+      }
+    }
+  }
+  SetStatsEnabled(false);
+}
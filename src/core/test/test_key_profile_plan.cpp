@@ -0,0 +1,237 @@
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/key.h"
+#include "src/core/key_profile_plan.h"
+#include "src/core/key_profiles.h"
+#include "src/core/test/gtest_extras.h"
+
+using namespace musher::core;
+
+/**
+ * @brief The cache returns the same plan for the same parameters and a different one otherwise.
+ *
+ */
+TEST(KeyProfilePlan, CachedPlanIsShared) {
+  std::shared_ptr<const KeyProfilePlan> plan_1 = GetKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 36);
+  std::shared_ptr<const KeyProfilePlan> plan_2 = GetKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 36);
+  std::shared_ptr<const KeyProfilePlan> plan_3 = GetKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 12);
+  std::shared_ptr<const KeyProfilePlan> plan_4 = GetKeyProfilePlan("Temperley", true, true, 4, 0.5, false, 36);
+
+  EXPECT_EQ(plan_1, plan_2);
+  EXPECT_NE(plan_1, plan_3);
+  EXPECT_NE(plan_1, plan_4);
+  EXPECT_EQ(plan_1->profile_major.size(), 36u);
+  EXPECT_EQ(plan_3->profile_major.size(), 12u);
+
+  KeyProfilePlan built_plan = BuildKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 36);
+  EXPECT_VEC_EQ(built_plan.profile_major, plan_1->profile_major);
+  EXPECT_VEC_EQ(built_plan.profile_minor, plan_1->profile_minor);
+  EXPECT_DOUBLE_EQ(built_plan.std_major, plan_1->std_major);
+
+  EXPECT_THROW(GetKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 30), std::runtime_error);
+  EXPECT_THROW(GetKeyProfilePlan("NotAProfile"), std::runtime_error);
+}
+
+/**
+ * @brief A sweep of the slope does not grow the cache without bound, plans handed out before stay usable.
+ *
+ */
+TEST(KeyProfilePlan, CacheIsBounded) {
+  std::shared_ptr<const KeyProfilePlan> first_plan = GetKeyProfilePlan("Krumhansl", true, true, 4, 0.01, false, 36);
+  for (int i = 2; i <= 100; i++) GetKeyProfilePlan("Krumhansl", true, true, 4, i * 0.01, false, 36);
+
+  // Evicted by the sweep, the lookup builds a new plan with the same profiles.
+  std::shared_ptr<const KeyProfilePlan> rebuilt_plan = GetKeyProfilePlan("Krumhansl", true, true, 4, 0.01, false, 36);
+  EXPECT_NE(rebuilt_plan, first_plan);
+  EXPECT_VEC_EQ(rebuilt_plan->profile_major, first_plan->profile_major);
+  EXPECT_EQ(rebuilt_plan, GetKeyProfilePlan("Krumhansl", true, true, 4, 0.01, false, 36));
+
+  EXPECT_THROW(GetKeyProfilePlan("Krumhansl", true, true, 4, std::nan(""), false, 36), std::runtime_error);
+  EXPECT_THROW(GetKeyProfilePlan("Krumhansl", true, true, 4, INFINITY, false, 36), std::runtime_error);
+  EXPECT_THROW(BuildKeyProfilePlan("Krumhansl", true, true, 4, std::nan(""), false, 36), std::runtime_error);
+}
+
+/**
+ * @brief Estimating with a plan gives the same result as estimating from the parameters.
+ *
+ */
+TEST(KeyProfilePlan, EstimateKeyWithPlan) {
+  std::vector<double> pcp({ 1., 0., 0.5, 0., 0.8, 0.6, 0., 1., 0., 0.4, 0., 0.2 });
+
+  for (const std::string profile_type : { "Bgate", "Temperley", "Edma", "Krumhansl" }) {
+    for (bool use_maj_min : { false, true }) {
+      KeyOutput expected_key_output = EstimateKey(pcp, true, false, 3, 0.5, profile_type, use_maj_min);
+      KeyProfilePlan plan = BuildKeyProfilePlan(profile_type, true, false, 3, 0.5, use_maj_min, 12);
+      KeyOutput actual_key_output = EstimateKey(pcp, plan);
+
+      EXPECT_EQ(actual_key_output.key, expected_key_output.key);
+      EXPECT_EQ(actual_key_output.scale, expected_key_output.scale);
+      EXPECT_DOUBLE_EQ(actual_key_output.strength, expected_key_output.strength);
+      EXPECT_DOUBLE_EQ(actual_key_output.first_to_second_relative_strength,
+                       expected_key_output.first_to_second_relative_strength);
+    }
+  }
+
+  KeyProfilePlan plan = BuildKeyProfilePlan("Bgate", true, true, 4, 0.6, false, 36);
+  EXPECT_THROW(EstimateKey(pcp, plan), std::runtime_error);
+}
+
+/**
+ * @brief Concurrent lookups of the same parameters all get the same plan.
+ *
+ */
+TEST(KeyProfilePlan, ConcurrentLookups) {
+  const int num_threads = 8;
+  std::vector<std::shared_ptr<const KeyProfilePlan>> plans(num_threads);
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&plans, i]() { plans[i] = GetKeyProfilePlan("Shaath", false, true, 2, 0.9, false, 120); });
+  }
+  for (std::thread &thread : threads) thread.join();
+
+  for (int i = 1; i < num_threads; i++) EXPECT_EQ(plans[i], plans[0]);
+}
+
+/**
+ * @brief All-shift correlations are identical to calling Correlation for every shift.
+ *
+ */
+TEST(KeyProfilePlan, CorrelateKeyProfilesMatchesCorrelation) {
+  for (unsigned int pcp_size : { 12u, 36u, 120u }) {
+    std::vector<double> pcp(pcp_size);
+    for (unsigned int i = 0; i < pcp_size; i++) pcp[i] = 0.5 + 0.5 * std::sin(1.7 * i + 0.3);
+
+    KeyProfilePlan plan = BuildKeyProfilePlan("Edma", true, true, 4, 0.6, true, pcp_size);
+    KeyCorrelations key_correlations = CorrelateKeyProfiles(pcp, plan);
+
+    double mean_pcp = std::accumulate(pcp.begin(), pcp.end(), 0.) / pcp_size;
+    double std_pcp = StandardDeviation(mean_pcp, pcp);
+    ASSERT_EQ(key_correlations.major.size(), pcp_size);
+    ASSERT_EQ(key_correlations.other.size(), pcp_size);
+    for (unsigned int shift = 0; shift < pcp_size; shift++) {
+      EXPECT_EQ(key_correlations.major[shift],
+                Correlation(pcp, mean_pcp, std_pcp, plan.profile_major, plan.mean_major, plan.std_major, shift));
+      EXPECT_EQ(key_correlations.minor[shift],
+                Correlation(pcp, mean_pcp, std_pcp, plan.profile_minor, plan.mean_minor, plan.std_minor, shift));
+      EXPECT_EQ(key_correlations.other[shift],
+                Correlation(pcp, mean_pcp, std_pcp, plan.profile_other, plan.mean_other, plan.std_other, shift));
+    }
+  }
+
+  KeyProfilePlan plan = BuildKeyProfilePlan("Bgate", true, true, 4, 0.6, false, 12);
+  EXPECT_TRUE(CorrelateKeyProfiles(std::vector<double>(12, 1.), plan).other.empty());
+}
+
+/**
+ * @brief Scoring a matrix of PCPs gives the same keys as estimating each PCP on its own.
+ *
+ */
+TEST(KeyProfilePlan, EstimateKeysBatch) {
+  std::vector<std::vector<double>> pcps;
+  for (int row = 0; row < 24; row++) {
+    std::vector<double> pcp(36);
+    for (int i = 0; i < 36; i++) pcp[i] = 0.5 + 0.5 * std::cos(0.9 * i * (row + 1) + row);
+    pcps.push_back(pcp);
+  }
+
+  std::vector<KeyOutput> key_outputs = EstimateKeys(pcps, true, true, 4, 0.6, "Temperley");
+  ASSERT_EQ(key_outputs.size(), pcps.size());
+  for (size_t row = 0; row < pcps.size(); row++) {
+    KeyOutput expected_key_output = EstimateKey(pcps[row], true, true, 4, 0.6, "Temperley");
+    EXPECT_EQ(key_outputs[row].key, expected_key_output.key);
+    EXPECT_EQ(key_outputs[row].scale, expected_key_output.scale);
+    EXPECT_EQ(key_outputs[row].strength, expected_key_output.strength);
+  }
+
+  std::vector<KeyCorrelations> key_correlations =
+      CorrelateKeyProfiles(pcps, *GetKeyProfilePlan("Temperley", true, true, 4, 0.6, false, 36));
+  EXPECT_EQ(key_correlations.size(), pcps.size());
+  EXPECT_TRUE(EstimateKeys(std::vector<std::vector<double>>()).empty());
+}
+
+/**
+ * @brief Correlating a contiguous matrix of PCPs, over several blocks of rows, gives the correlations of each row on
+ * its own.
+ *
+ */
+TEST(KeyProfilePlan, CorrelateKeyProfilesMatrix) {
+  const size_t num_rows = 70;
+  const unsigned int pcp_size = 36;
+  std::vector<double> pcps(num_rows * pcp_size);
+  for (size_t i = 0; i < pcps.size(); i++) pcps[i] = 0.5 + 0.5 * std::sin(0.37 * i + 0.01 * i * i);
+
+  KeyProfilePlan plan = BuildKeyProfilePlan("Edma", true, true, 4, 0.6, true, pcp_size);
+  KeyCorrelationMatrix key_correlations = CorrelateKeyProfiles(pcps.data(), num_rows, plan);
+  ASSERT_EQ(key_correlations.num_rows, num_rows);
+  ASSERT_EQ(key_correlations.major.size(), num_rows * pcp_size);
+  ASSERT_EQ(key_correlations.other.size(), num_rows * pcp_size);
+
+  std::vector<KeyOutput> key_outputs = EstimateKeys(pcps.data(), num_rows, plan);
+  ASSERT_EQ(key_outputs.size(), num_rows);
+  for (size_t row = 0; row < num_rows; row++) {
+    std::vector<double> pcp(pcps.begin() + row * pcp_size, pcps.begin() + (row + 1) * pcp_size);
+    KeyCorrelations expected_correlations = CorrelateKeyProfiles(pcp, plan);
+    KeyCorrelations row_correlations = key_correlations.Row(row);
+    EXPECT_EQ(row_correlations.major, expected_correlations.major);
+    EXPECT_EQ(row_correlations.minor, expected_correlations.minor);
+    EXPECT_EQ(row_correlations.other, expected_correlations.other);
+
+    KeyOutput expected_key_output = EstimateKey(pcp, plan);
+    EXPECT_EQ(key_outputs[row].key, expected_key_output.key);
+    EXPECT_EQ(key_outputs[row].scale, expected_key_output.scale);
+    EXPECT_EQ(key_outputs[row].strength, expected_key_output.strength);
+  }
+}
+
+/**
+ * @brief The compile-time polyphonic profiles are exactly the ones of the runtime expansion.
+ *
+ */
+TEST(KeyProfilePlan, ConstexprProfilesMatchRuntime) {
+  static_assert(kKeyProfileTables.size() == 14, "Every profile type has a table");
+  static_assert(FindKeyProfileTable("Temperley") == 2, "Profile types are found by name");
+  static_assert(FindKeyProfileTable("Temperley2") == -1, "Only exact names are found");
+  static_assert(kDefaultPolyphonicKeyProfiles[0].major_three_chords[0] > 0., "Profiles are expanded at compile time");
+
+  std::vector<std::string> profile_types = KeyProfileTypes();
+  ASSERT_EQ(profile_types.size(), kKeyProfileTables.size());
+  for (size_t i = 0; i < kKeyProfileTables.size(); i++) {
+    std::vector<std::vector<double>> key_profile = SelectKeyProfile(profile_types[i]);
+    EXPECT_EQ(key_profile.size(), kKeyProfileTables[i].has_other ? 3u : 2u);
+
+    for (bool use_three_chords : { true, false }) {
+      std::vector<double> M_chords, m_chords;
+      std::tie(M_chords, m_chords) = BuildPolyphonicProfiles(key_profile[0], key_profile[1], use_three_chords,
+                                                             kDefaultNumHarmonics, kDefaultSlope);
+      const PolyphonicKeyProfiles& polyphonic = kDefaultPolyphonicKeyProfiles[i];
+      const PitchClassProfile& M_expanded =
+          use_three_chords ? polyphonic.major_three_chords : polyphonic.major_all_chords;
+      const PitchClassProfile& m_expanded =
+          use_three_chords ? polyphonic.minor_three_chords : polyphonic.minor_all_chords;
+      for (int j = 0; j < 12; j++) {
+        EXPECT_EQ(M_chords[j], M_expanded[j]) << profile_types[i];
+        EXPECT_EQ(m_chords[j], m_expanded[j]) << profile_types[i];
+      }
+    }
+  }
+
+  // Fewer harmonics and another slope, through the template directly.
+  constexpr PitchClassProfile M_expanded = PolyphonicMajorProfile<2>(kKeyProfileTables[1].major, 0.5, false);
+  std::vector<double> M_chords, m_chords;
+  std::tie(M_chords, m_chords) = BuildPolyphonicProfiles(SelectKeyProfile("Krumhansl")[0],
+                                                         SelectKeyProfile("Krumhansl")[1], false, 2, 0.5);
+  for (int j = 0; j < 12; j++) EXPECT_EQ(M_chords[j], M_expanded[j]);
+
+  // Other parameters fall back to the runtime expansion.
+  KeyProfilePlan plan = BuildKeyProfilePlan("Krumhansl", true, false, 2, 0.5, false, 12);
+  for (int j = 0; j < 12; j++) EXPECT_EQ(plan.profile_major[j], M_expanded[j]);
+}
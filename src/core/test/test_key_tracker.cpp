@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/framecutter.h"
+#include "src/core/key.h"
+#include "src/core/key_tracker.h"
+#include "src/core/mono_mixer.h"
+#include "src/core/test/gtest_extras.h"
+
+using namespace musher::core;
+
+/**
+ * @brief Streaming the samples in uneven blocks gives the same key as DetectKey.
+ *
+ */
+TEST(KeyTracker, StreamedBlocksMatchDetectKey) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  double sample_rate = mp3_decoded.sample_rate;
+  std::vector<double> mixed_audio = MonoMixer(mp3_decoded.normalized_samples);
+
+  KeyOutput expected_key_output = DetectKey(mp3_decoded.normalized_samples, sample_rate, "Temperley");
+
+  KeyTracker key_tracker(sample_rate, "Temperley");
+  const size_t block_size = 7919;
+  for (size_t start = 0; start < mixed_audio.size(); start += block_size) {
+    size_t end = std::min(start + block_size, mixed_audio.size());
+    key_tracker.AddSamples(std::vector<double>(mixed_audio.begin() + start, mixed_audio.begin() + end));
+  }
+  key_tracker.Flush();
+  KeyOutput actual_key_output = key_tracker.Estimate();
+
+  EXPECT_EQ(actual_key_output.key, expected_key_output.key);
+  EXPECT_EQ(actual_key_output.scale, expected_key_output.scale);
+  EXPECT_DOUBLE_EQ(actual_key_output.strength, expected_key_output.strength);
+  EXPECT_DOUBLE_EQ(actual_key_output.first_to_second_relative_strength,
+                   expected_key_output.first_to_second_relative_strength);
+}
+
+/**
+ * @brief The tracker cuts the same number of frames as Framecutter, including the zero-padded trailing ones.
+ *
+ */
+TEST(KeyTracker, FrameCountMatchesFramecutter) {
+  std::vector<int> signal_sizes({ 1, 100, 512, 4095, 4096, 4097, 10000 });
+
+  for (int signal_size : signal_sizes) {
+    std::vector<double> signal(static_cast<size_t>(signal_size), 0.5);
+
+    int expected_frame_count = 0;
+    Framecutter framecutter(signal, 4096, 512);
+    for (const std::vector<double> &frame : framecutter) {
+      (void)frame;
+      expected_frame_count++;
+    }
+
+    KeyTracker key_tracker(44100., "Bgate", true, true, 4, 0.6, false, 36, 4096, 512);
+    key_tracker.AddSamples(signal);
+    key_tracker.Flush();
+
+    EXPECT_EQ(key_tracker.FrameCount(), expected_frame_count) << "Signal size " << signal_size;
+  }
+}
+
+/**
+ * @brief The running average of the added HPCPs is what gets estimated.
+ *
+ */
+TEST(KeyTracker, AddHPCP) {
+  std::vector<double> hpcp_1({ 1., 0., 0.5, 0., 0.8, 0.6, 0., 1., 0., 0.4, 0., 0.2 });
+  std::vector<double> hpcp_2({ 0.8, 0., 0.3, 0., 1., 0.4, 0., 0.9, 0., 0.6, 0., 0.4 });
+
+  // A 12 bin HPCP needs a weighting window of at least one semitone.
+  KeyTracker key_tracker(44100., "Temperley", true, true, 4, 0.6, false, 12, 4096, 512, BlackmanHarris62dB, 100, 1.);
+  key_tracker.AddHPCP(hpcp_1);
+  key_tracker.AddHPCP(hpcp_2);
+
+  std::vector<double> expected_average({ 0.9, 0., 0.4, 0., 0.9, 0.5, 0., 0.95, 0., 0.5, 0., 0.3 });
+  std::vector<double> actual_average = key_tracker.AverageHPCP();
+  EXPECT_EQ(key_tracker.FrameCount(), 2);
+  EXPECT_VEC_NEAR(actual_average, expected_average, 1e-12);
+
+  KeyOutput expected_key_output = EstimateKey(actual_average, true, true, 4, 0.6, "Temperley");
+  KeyOutput actual_key_output = key_tracker.Estimate();
+  EXPECT_EQ(actual_key_output.key, expected_key_output.key);
+  EXPECT_EQ(actual_key_output.scale, expected_key_output.scale);
+  EXPECT_DOUBLE_EQ(actual_key_output.strength, expected_key_output.strength);
+
+  key_tracker.Reset();
+  EXPECT_EQ(key_tracker.FrameCount(), 0);
+  EXPECT_THROW(key_tracker.Estimate(), std::runtime_error);
+  EXPECT_THROW(key_tracker.AddHPCP(std::vector<double>(36, 0.)), std::runtime_error);
+}
+
+/**
+ * @brief Silent frames are skipped by the energy gate and do not contribute to the average.
+ *
+ */
+TEST(KeyTracker, EnergyGateSkipsSilence) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  double sample_rate = mp3_decoded.sample_rate;
+  std::vector<double> mixed_audio = MonoMixer(mp3_decoded.normalized_samples);
+
+  // 10 seconds of silence before and after the music.
+  std::vector<double> padded_audio(static_cast<size_t>(10 * sample_rate), 0.);
+  padded_audio.insert(padded_audio.end(), mixed_audio.begin(), mixed_audio.end());
+  padded_audio.insert(padded_audio.end(), static_cast<size_t>(10 * sample_rate), 0.);
+
+  DetectKeyOutput expected_key_output = DetectKey({ mixed_audio }, sample_rate, "Temperley");
+  DetectKeyOptions options;
+  options.profile_type = "Temperley";
+  options.rms_threshold = 1e-4;
+  DetectKeyOutput actual_key_output = DetectKey({ padded_audio }, sample_rate, options);
+
+  EXPECT_EQ(actual_key_output.key, expected_key_output.key);
+  EXPECT_EQ(actual_key_output.scale, expected_key_output.scale);
+  EXPECT_NEAR(actual_key_output.strength, expected_key_output.strength, 1e-3);
+  EXPECT_GT(actual_key_output.frames_skipped, static_cast<int>(19 * sample_rate / 512));
+  EXPECT_EQ(actual_key_output.frames_analyzed + actual_key_output.frames_skipped,
+            CountFrames(padded_audio.size(), 4096, 512));
+  EXPECT_DOUBLE_EQ(actual_key_output.analyzed_ratio, 1.);
+
+  KeyTracker key_tracker(sample_rate, "Temperley", true, true, 4, 0.6, false, 36, 4096, 512, BlackmanHarris62dB, 100,
+                         .5, 1e-4);
+  key_tracker.AddFrame(std::vector<double>(4096, 0.));
+  EXPECT_EQ(key_tracker.FrameCount(), 0);
+  EXPECT_EQ(key_tracker.SkippedFrameCount(), 1);
+  EXPECT_THROW(DetectKey({ std::vector<double>(44100, 0.) }, sample_rate, options), std::runtime_error);
+}
@@ -27,3 +27,13 @@ TEST(MonoMixer, MonoMixer44100) {
   EXPECT_EQ(actual_mixed_audio_size, expected_mixed_audio_size);
   EXPECT_DOUBLE_EQ(actual_mixed_audio_sum, expected_mixed_audio_sum);
 }
+
+/**
+ * @brief More than two channels or channels of different lengths are rejected.
+ *
+ */
+TEST(MonoMixer, InvalidChannels) {
+  EXPECT_THROW(MonoMixer({}), std::runtime_error);
+  EXPECT_THROW(MonoMixer({{1.}, {1.}, {1.}}), std::runtime_error);
+  EXPECT_THROW(MonoMixer({{1., 2.}, {1.}}), std::runtime_error);
+}
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -36,3 +37,47 @@ TEST(TestUtils, Deinterweave) {
 
   EXPECT_MATRIX_EQ(expected_deinterweaved_vectors, actual_deinterweaved_vectors)
 }
+
+TEST(TestUtils, RootMeanSquare) {
+  EXPECT_DOUBLE_EQ(RootMeanSquare(std::vector<double>({})), 0.);
+  EXPECT_DOUBLE_EQ(RootMeanSquare(std::vector<double>({ -3. })), 3.);
+  EXPECT_DOUBLE_EQ(RootMeanSquare(std::vector<double>({ 1., -1., 1., -1., 1., -1., 1. })), 1.);
+
+  // Lengths around the unrolled block size, compared to a plain loop.
+  for (size_t size = 1; size < 20; size++) {
+    std::vector<double> vec(size);
+    double sum = 0.;
+    for (size_t i = 0; i < size; i++) {
+      vec[i] = std::sin(static_cast<double>(i) + 0.5);
+      sum += vec[i] * vec[i];
+    }
+    EXPECT_NEAR(RootMeanSquare(vec), std::sqrt(sum / size), 1e-12) << "Size " << size;
+  }
+}
+
+TEST(TestUtils, ParallelFor) {
+  // Every item is visited exactly once, by a thread within range.
+  for (int num_threads : { 0, 1, 3, 64 }) {
+    std::vector<int> visits(100, 0);
+    std::vector<int> threads(100, -1);
+    ParallelFor(visits.size(), num_threads, [&](size_t item, int thread) {
+      visits[item] += 1;
+      threads[item] = thread;
+    });
+    for (size_t i = 0; i < visits.size(); i++) {
+      EXPECT_EQ(visits[i], 1) << "Item " << i;
+      EXPECT_GE(threads[i], 0) << "Item " << i;
+      if (num_threads > 0) {
+        EXPECT_LT(threads[i], num_threads) << "Item " << i;
+      }
+    }
+  }
+  ParallelFor(0, 4, [](size_t, int) { FAIL() << "No item to visit"; });
+
+  // The exception of an item is rethrown once every thread has finished.
+  EXPECT_THROW(ParallelFor(100, 4,
+                           [](size_t item, int) {
+                             if (item == 42) throw std::runtime_error("Item 42");
+                           }),
+               std::runtime_error);
+}
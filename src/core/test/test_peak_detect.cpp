@@ -1,8 +1,13 @@
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include <vector>
 
 #include "gtest/gtest.h"
 #include "src/core/peak_detect.h"
+#include "src/core/reference_backend.h"
 #include "src/core/test/gtest_extras.h"
 
 using namespace musher::core;
@@ -288,3 +293,63 @@ TEST(PeakDetection, QuadraticInterpolation) {
   EXPECT_NEAR(expected_peak_location, actual_peak_location, 0.00001);
   EXPECT_NEAR(expected_peak_height_estimate, actual_peak_height_estimate, 0.00001);
 }
+
+/**
+ * @brief The candidate scan finds the same peaks as the reference walk down and up the input.
+ *
+ * The inputs take few distinct values so that they have plateaus, including at both edges, and the parameters cover
+ * the threshold, the range, the bounds and both sort orders. Inputs of 2 elements are checked on their own: the walk
+ * reads before the input for them.
+ */
+TEST(PeakDetection, MatchesReferenceOnRandomInputs) {
+  std::mt19937 rng(38);
+  std::uniform_int_distribution<int> size_distribution(3, 48);
+  std::uniform_int_distribution<int> level_distribution(0, 4);
+  std::uniform_int_distribution<int> coin(0, 1);
+  std::uniform_int_distribution<int> max_num_peaks_distribution(0, 4);
+  std::uniform_real_distribution<double> threshold_distribution(-1., 4.);
+
+  for (int trial = 0; trial < 5000; trial++) {
+    const int inp_size = size_distribution(rng);
+    std::vector<double> inp(inp_size);
+    for (double &value : inp) value = level_distribution(rng);
+
+    const double threshold = coin(rng) ? -1000.0 : threshold_distribution(rng);
+    const bool interpolate = coin(rng);
+    const std::string sort_by = coin(rng) ? "position" : "height";
+    const int max_num_peaks = max_num_peaks_distribution(rng);
+    const double range = coin(rng) ? 0. : 2. * (inp_size - 1);
+    const double scale = range > 0 ? range / (inp_size - 1) : 1.;
+
+    // Bounds are in the units of the range, min_pos must leave at least two samples to compare.
+    int min_pos = 0;
+    int max_pos = 0;
+    if (coin(rng)) min_pos = std::uniform_int_distribution<int>(0, static_cast<int>((inp_size - 2) * scale))(rng);
+    if (coin(rng)) max_pos = std::uniform_int_distribution<int>(1, static_cast<int>((inp_size - 1) * scale) + 2)(rng);
+    if (min_pos != 0 && max_pos != 0 && min_pos >= max_pos) {
+      EXPECT_THROW(PeakDetect(inp, threshold, interpolate, sort_by, max_num_peaks, range, min_pos, max_pos),
+                   std::runtime_error);
+      continue;
+    }
+
+    std::vector<std::tuple<double, double>> expected_peaks =
+        reference::PeakDetect(inp, threshold, interpolate, sort_by, max_num_peaks, range, min_pos, max_pos);
+    std::vector<std::tuple<double, double>> actual_peaks =
+        PeakDetect(inp, threshold, interpolate, sort_by, max_num_peaks, range, min_pos, max_pos);
+
+    ASSERT_EQ(actual_peaks.size(), expected_peaks.size()) << "Trial " << trial;
+    for (size_t i = 0; i < actual_peaks.size(); i++) {
+      EXPECT_EQ(std::get<0>(actual_peaks[i]), std::get<0>(expected_peaks[i])) << "Trial " << trial << ", peak " << i;
+      EXPECT_EQ(std::get<1>(actual_peaks[i]), std::get<1>(expected_peaks[i])) << "Trial " << trial << ", peak " << i;
+    }
+  }
+
+  // The lower bound is the only peak of a falling pair, the last element the only peak of a rising one.
+  std::vector<std::tuple<double, double>> peaks = PeakDetect({ 3., 1. }, -1000.0, true, "height");
+  ASSERT_EQ(peaks.size(), 1u);
+  EXPECT_EQ(peaks[0], std::make_tuple(0., 3.));
+  peaks = PeakDetect({ 1., 3. }, -1000.0, false, "position", 0, 2.);
+  ASSERT_EQ(peaks.size(), 1u);
+  EXPECT_EQ(peaks[0], std::make_tuple(2., 3.));
+  EXPECT_TRUE(PeakDetect({ 2., 2. }).empty());
+}
@@ -0,0 +1,137 @@
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/key.h"
+#include "src/core/key_detector.h"
+#include "src/core/pipeline_stats.h"
+
+using namespace musher::core;
+
+namespace {
+
+double SumOfStages(const PipelineStats &stats) {
+  return stats.decode_seconds + stats.mix_seconds + stats.resample_seconds + stats.frame_seconds +
+         stats.window_seconds + stats.fft_seconds + stats.peaks_seconds + stats.hpcp_seconds + stats.estimate_seconds;
+}
+
+}  // namespace
+
+/**
+ * @brief Nothing is recorded while the stats are disabled.
+ *
+ */
+TEST(PipelineStats, DisabledRecordsNothing) {
+  SetStatsEnabled(false);
+  ResetThreadStats();
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/CantinaBand3sec.wav");
+  WavDecoded wav_decoded = DecodeWav(file_path);
+  DetectKeyOutput key_output = DetectKey(wav_decoded.normalized_samples, wav_decoded.sample_rate, "Temperley");
+
+  PipelineStats stats = ThreadStats();
+  EXPECT_EQ(SumOfStages(stats), 0.);
+  EXPECT_EQ(stats.frames_processed, 0);
+  EXPECT_EQ(stats.peaks_found, 0);
+  EXPECT_EQ(stats.bytes_decoded, 0);
+  EXPECT_EQ(SumOfStages(key_output.stats), 0.);
+  EXPECT_EQ(key_output.stats.frames_processed, 0);
+}
+
+/**
+ * @brief Every stage of DetectKey is timed once, and the counters match the output.
+ *
+ */
+TEST(PipelineStats, DetectKey) {
+  SetStatsEnabled(true);
+  ResetThreadStats();
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/CantinaBand3sec.wav");
+  auto start = std::chrono::steady_clock::now();
+  WavDecoded wav_decoded = DecodeWav(file_path);
+  DetectKeyOutput key_output = DetectKey(wav_decoded.normalized_samples, wav_decoded.sample_rate, "Temperley");
+  double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  SetStatsEnabled(false);
+
+  PipelineStats stats = ThreadStats();
+  EXPECT_EQ(stats.bytes_decoded, static_cast<int64_t>(std::filesystem::file_size(file_path)));
+  EXPECT_GT(stats.decode_seconds, 0.);
+  EXPECT_EQ(stats.frames_processed, key_output.frames_analyzed);
+  EXPECT_EQ(stats.frames_skipped, key_output.frames_skipped);
+  EXPECT_GT(stats.peaks_found, 0);
+  // The stages do not overlap.
+  EXPECT_LE(SumOfStages(stats), wall_seconds);
+
+  // The stats of the call are the same without the decoding.
+  const PipelineStats &call_stats = key_output.stats;
+  EXPECT_EQ(call_stats.decode_seconds, 0.);
+  EXPECT_EQ(call_stats.bytes_decoded, 0);
+  EXPECT_EQ(call_stats.frames_processed, key_output.frames_analyzed);
+  EXPECT_EQ(call_stats.peaks_found, stats.peaks_found);
+  EXPECT_GT(call_stats.mix_seconds, 0.);
+  EXPECT_GT(call_stats.frame_seconds, 0.);
+  EXPECT_GT(call_stats.window_seconds, 0.);
+  EXPECT_GT(call_stats.fft_seconds, 0.);
+  EXPECT_GT(call_stats.peaks_seconds, 0.);
+  EXPECT_GT(call_stats.hpcp_seconds, 0.);
+  EXPECT_GT(call_stats.estimate_seconds, 0.);
+}
+
+/**
+ * @brief The KeyDetector reports the stats of each Detect call.
+ *
+ */
+TEST(PipelineStats, KeyDetector) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/CantinaBand3sec.wav");
+  WavDecoded wav_decoded = DecodeWav(file_path);
+  KeyDetector key_detector(wav_decoded.sample_rate, "Temperley");
+
+  SetStatsEnabled(true);
+  DetectKeyOutput first_output = key_detector.Detect(wav_decoded.normalized_samples);
+  DetectKeyOutput second_output = key_detector.Detect(wav_decoded.normalized_samples);
+  SetStatsEnabled(false);
+
+  EXPECT_EQ(second_output.stats.frames_processed, second_output.frames_analyzed);
+  EXPECT_EQ(second_output.stats.peaks_found, first_output.stats.peaks_found);
+  EXPECT_GT(second_output.stats.mix_seconds, 0.);
+  EXPECT_GT(second_output.stats.frame_seconds, 0.);
+  EXPECT_GT(second_output.stats.fft_seconds, 0.);
+  EXPECT_GT(second_output.stats.estimate_seconds, 0.);
+}
+
+/**
+ * @brief The peaks of each stage match the buffers it holds.
+ *
+ */
+TEST(PipelineStats, PeakBytes) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/CantinaBand3sec.wav");
+  SetStatsEnabled(true);
+  ResetThreadStats();
+  WavDecoded wav_decoded = DecodeWav(file_path);
+  DetectKeyOutput key_output = DetectKey(wav_decoded.normalized_samples, wav_decoded.sample_rate, "Temperley");
+  KeyDetector key_detector(wav_decoded.sample_rate, "Temperley");
+  DetectKeyOutput detector_output = key_detector.Detect(wav_decoded.normalized_samples);
+  PipelineStats stats = ThreadStats();
+  SetStatsEnabled(false);
+
+  const int64_t num_channels = static_cast<int64_t>(wav_decoded.normalized_samples.size());
+  const int64_t signal_bytes = static_cast<int64_t>(wav_decoded.normalized_samples[0].size() * sizeof(double));
+  const int64_t frame_bytes = 4096 * static_cast<int64_t>(sizeof(double));
+  EXPECT_EQ(stats.peak_file_bytes, static_cast<int64_t>(std::filesystem::file_size(file_path)));
+  EXPECT_GE(stats.peak_decoded_bytes, num_channels * signal_bytes);
+
+  // DetectKey mixes each frame down in the frame buffer, KeyDetector::Detect mixes the whole signal down.
+  EXPECT_EQ(key_output.stats.peak_file_bytes, 0);
+  EXPECT_EQ(key_output.stats.peak_decoded_bytes, 0);
+  EXPECT_EQ(key_output.stats.peak_frame_bytes, frame_bytes);
+  EXPECT_EQ(key_output.stats.peak_mono_bytes, 0);
+  EXPECT_GT(key_output.stats.peak_spectrum_bytes, 0);
+  EXPECT_EQ(detector_output.stats.peak_mono_bytes, signal_bytes);
+  EXPECT_EQ(detector_output.stats.peak_frame_bytes, frame_bytes);
+  EXPECT_GT(detector_output.stats.peak_spectrum_bytes, 0);
+
+  // The peaks of the thread cover every call.
+  EXPECT_EQ(stats.peak_mono_bytes, signal_bytes);
+  EXPECT_EQ(stats.peak_frame_bytes, key_output.stats.peak_frame_bytes);
+}
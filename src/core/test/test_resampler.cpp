@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/key.h"
+#include "src/core/resampler.h"
+
+using namespace musher::core;
+
+namespace {
+
+std::vector<double> Sine(double frequency, double sample_rate, size_t size) {
+  std::vector<double> signal(size);
+  for (size_t i = 0; i < size; i++) signal[i] = std::sin(2. * M_PI * frequency * static_cast<double>(i) / sample_rate);
+  return signal;
+}
+
+// Largest deviation from a reference sine, away from the edges of the signal.
+double MaxDeviationFromSine(const std::vector<double> &signal, double frequency, double sample_rate) {
+  std::vector<double> expected = Sine(frequency, sample_rate, signal.size());
+  double deviation = 0.;
+  for (size_t i = signal.size() / 8; i < signal.size() * 7 / 8; i++)
+    deviation = std::max(deviation, std::abs(signal[i] - expected[i]));
+  return deviation;
+}
+
+double MaxAbs(const std::vector<double> &signal) {
+  double max_abs = 0.;
+  for (size_t i = signal.size() / 8; i < signal.size() * 7 / 8; i++) max_abs = std::max(max_abs, std::abs(signal[i]));
+  return max_abs;
+}
+
+}  // namespace
+
+/**
+ * @brief Tones below the cutoff keep their amplitude and phase, tones above the Nyquist frequency of the output are
+ * removed instead of aliased.
+ *
+ */
+TEST(Resampler, PassbandAndStopband) {
+  const std::vector<std::vector<double>> rates = {{44100., 11025.}, {48000., 22050.}, {22050., 44100.}};
+  for (const std::vector<double> &rate : rates) {
+    const double input_rate = rate[0];
+    const double output_rate = rate[1];
+    const double nyquist = std::min(input_rate, output_rate) / 2.;
+    SCOPED_TRACE(std::to_string(input_rate) + " -> " + std::to_string(output_rate));
+
+    Resampler resampler(input_rate, output_rate);
+    std::vector<double> low_tone = resampler.Resample(Sine(.5 * nyquist, input_rate, 1 << 15));
+    EXPECT_LT(MaxDeviationFromSine(low_tone, .5 * nyquist, output_rate), 1e-3);
+
+    if (output_rate < input_rate) {
+      std::vector<double> high_tone = resampler.Resample(Sine(1.2 * nyquist, input_rate, 1 << 15));
+      EXPECT_LT(MaxAbs(high_tone), 1e-3);
+    }
+  }
+}
+
+/**
+ * @brief Output sizes, and an unchanged signal when both rates are equal.
+ *
+ */
+TEST(Resampler, OutputSize) {
+  Resampler quarter(44100., 11025.);
+  EXPECT_EQ(quarter.Resample(std::vector<double>(1000)).size(), 250u);
+  EXPECT_EQ(quarter.Resample(std::vector<double>(1001)).size(), 251u);
+  EXPECT_EQ(quarter.Resample(std::vector<double>()).size(), 0u);
+  EXPECT_EQ(quarter.NumTaps(), 128);
+
+  Resampler resampler(48000., 22050.);
+  EXPECT_EQ(resampler.OutputSize(48000), 22050);
+  EXPECT_EQ(resampler.Resample(std::vector<double>(480)).size(), 221u);
+  EXPECT_EQ(resampler.Resample(std::vector<double>(3, 1.)).size(), 2u);
+
+  std::vector<double> signal = Sine(440., 44100., 100);
+  EXPECT_EQ(Resample(signal, 44100., 44100., "low"), signal);
+
+  // DC is kept exactly away from the edges.
+  std::vector<double> dc = Resample(std::vector<double>(4000, 1.), 44100., 48000., "high");
+  for (size_t i = 500; i < 3500; i++) EXPECT_NEAR(dc[i], 1., 1e-12);
+}
+
+/**
+ * @brief Streaming blocks of any size gives exactly the samples of the whole signal resampler.
+ *
+ */
+TEST(Resampler, StreamingMatchesWholeSignal) {
+  const std::vector<std::vector<double>> rates = {{44100., 11025.}, {48000., 22050.}, {22050., 44100.}, {8000., 8000.}};
+  const std::vector<size_t> block_sizes = {1, 7, 100, 4096};
+  std::vector<double> signal = Sine(440., 44100., 10000);
+  for (const std::vector<double> &rate : rates) {
+    Resampler resampler(rate[0], rate[1]);
+    std::vector<double> expected = resampler.Resample(signal);
+
+    StreamingResampler streaming_resampler(rate[0], rate[1]);
+    for (size_t block_size : block_sizes) {
+      SCOPED_TRACE(std::to_string(rate[0]) + " -> " + std::to_string(rate[1]) + ", blocks of " +
+                   std::to_string(block_size));
+      std::vector<double> actual;
+      std::vector<double> output;
+      for (size_t start = 0; start < signal.size(); start += block_size) {
+        size_t end = std::min(start + block_size, signal.size());
+        streaming_resampler.Process(std::vector<double>(signal.begin() + start, signal.begin() + end), output);
+        actual.insert(actual.end(), output.begin(), output.end());
+      }
+      streaming_resampler.Flush(output);
+      actual.insert(actual.end(), output.begin(), output.end());
+      EXPECT_EQ(actual, expected);
+    }
+  }
+}
+
+/**
+ * @brief Invalid sample rates and qualities are rejected.
+ *
+ */
+TEST(Resampler, InvalidParameters) {
+  EXPECT_THROW(Resampler(44100.5, 22050.), std::runtime_error);
+  EXPECT_THROW(Resampler(44100., 0.), std::runtime_error);
+  EXPECT_THROW(
+      {
+        try {
+          Resampler(44100., 22050., "best");
+        } catch (const std::runtime_error &e) {
+          EXPECT_STREQ("Resampler: quality 'best' is not supported. Use low, medium or high.", e.what());
+          throw;
+        }
+      },
+      std::runtime_error);
+}
+
+/**
+ * @brief Analyzing the decimated signal finds the same key as the full rate analysis.
+ *
+ */
+TEST(Resampler, DetectKeyAtAnalysisSampleRate) {
+  const std::vector<std::string> file_names = {"mozart_c_major_30sec.mp3", "CantinaBand3sec.wav", "700kb.mp3"};
+  for (const std::string &file_name : file_names) {
+    SCOPED_TRACE(file_name);
+    const std::string file_path = TEST_DATA_DIR + std::string("audio_files/") + file_name;
+    AudioDecoded audio_decoded = DecodeAudioFile(file_path);
+    const std::vector<std::vector<double>> &normalized_samples = audio_decoded.normalized_samples;
+    double sample_rate = audio_decoded.sample_rate;
+
+    DetectKeyOutput expected = DetectKey(normalized_samples, sample_rate, "Temperley");
+    DetectKeyOptions options;
+    options.profile_type = "Temperley";
+    for (double analysis_sample_rate : {22050., 11025.}) {
+      SCOPED_TRACE(analysis_sample_rate);
+      options.analysis_sample_rate = analysis_sample_rate;
+      DetectKeyOutput actual = DetectKey(normalized_samples, sample_rate, options);
+      EXPECT_EQ(actual.key, expected.key);
+      EXPECT_EQ(actual.scale, expected.scale);
+      EXPECT_NEAR(actual.strength, expected.strength, .05);
+      EXPECT_NEAR(actual.seconds_analyzed, expected.seconds_analyzed, .05);
+    }
+  }
+}
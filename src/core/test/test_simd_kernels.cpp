@@ -0,0 +1,218 @@
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/audio_decoders.h"
+#include "src/core/cpu_dispatch.h"
+#include "src/core/key.h"
+#include "src/core/peak_detect.h"
+#include "src/core/simd_kernels.h"
+#include "src/core/test/gtest_extras.h"
+
+using namespace musher::core;
+
+namespace {
+
+std::vector<SimdLevel> SupportedLevels() {
+  std::vector<SimdLevel> levels;
+  for (int level = 0; level <= static_cast<int>(DetectedSimdLevel()); level++)
+    levels.push_back(static_cast<SimdLevel>(level));
+  return levels;
+}
+
+std::vector<double> RandomVector(size_t size, std::mt19937 &rng) {
+  std::uniform_real_distribution<double> distribution(-2., 2.);
+  std::vector<double> vec(size);
+  for (double &x : vec) x = distribution(rng);
+  return vec;
+}
+
+}  // namespace
+
+/**
+ * @brief Every level gives bit-identical results to the scalar reference, for all sizes around the vector widths.
+ *
+ */
+TEST(SimdKernels, LevelsMatchScalarReference) {
+  std::mt19937 rng(7);
+
+  for (size_t size = 0; size < 40; size++) {
+    std::vector<double> a = RandomVector(size, rng);
+    std::vector<double> b = RandomVector(size, rng);
+    std::vector<double> pairs = RandomVector(2 * size, rng);
+    std::vector<int16_t> pcm(size);
+    for (int16_t &x : pcm) x = static_cast<int16_t>(static_cast<int>(rng() % 65536) - 32768);
+    // Plateaus and peaks, padded so that every index of the scan can read its neighbours.
+    std::vector<double> spectrum(size + 2);
+    for (double &x : spectrum) x = static_cast<double>(rng() % 4);
+
+    SetSimdLevel(SimdLevel::kScalar);
+    std::vector<double> expected_int16(size), expected_product(size), expected_sum(size), expected_magnitude(size),
+        expected_power(size), expected_accumulated(b);
+    ConvertInt16ToDouble(pcm.data(), size, 1. / 32768., expected_int16.data());
+    MultiplyArrays(a.data(), b.data(), size, expected_product.data());
+    AddArrays(a.data(), b.data(), size, expected_sum.data());
+    AccumulateScaled(a.data(), 0.3, size, expected_accumulated.data());
+    InterleavedMagnitude(pairs.data(), size, expected_magnitude.data());
+    InterleavedPower(pairs.data(), size, expected_power.data());
+    double expected_dot = DotProduct(a.data(), b.data(), size);
+    std::vector<size_t> expected_candidates;
+    for (size_t i = NextPeakCandidate(spectrum.data(), 1, size + 1, 0.5); i < size + 1;
+         i = NextPeakCandidate(spectrum.data(), i + 1, size + 1, 0.5))
+      expected_candidates.push_back(i);
+
+    for (SimdLevel level : SupportedLevels()) {
+      SetSimdLevel(level);
+      SCOPED_TRACE(SimdLevelName(level) + " size " + std::to_string(size));
+
+      std::vector<double> actual_int16(size), actual_product(size), actual_sum(size), actual_magnitude(size),
+          actual_power(size), actual_accumulated(b);
+      ConvertInt16ToDouble(pcm.data(), size, 1. / 32768., actual_int16.data());
+      MultiplyArrays(a.data(), b.data(), size, actual_product.data());
+      AddArrays(a.data(), b.data(), size, actual_sum.data());
+      AccumulateScaled(a.data(), 0.3, size, actual_accumulated.data());
+      InterleavedMagnitude(pairs.data(), size, actual_magnitude.data());
+      InterleavedPower(pairs.data(), size, actual_power.data());
+      double actual_dot = DotProduct(a.data(), b.data(), size);
+      std::vector<size_t> actual_candidates;
+      for (size_t i = NextPeakCandidate(spectrum.data(), 1, size + 1, 0.5); i < size + 1;
+           i = NextPeakCandidate(spectrum.data(), i + 1, size + 1, 0.5))
+        actual_candidates.push_back(i);
+
+      EXPECT_EQ(expected_int16, actual_int16);
+      EXPECT_EQ(expected_product, actual_product);
+      EXPECT_EQ(expected_sum, actual_sum);
+      EXPECT_EQ(expected_accumulated, actual_accumulated);
+      EXPECT_EQ(expected_magnitude, actual_magnitude);
+      EXPECT_EQ(expected_power, actual_power);
+      EXPECT_EQ(expected_dot, actual_dot);
+      EXPECT_EQ(expected_candidates, actual_candidates);
+    }
+  }
+  ResetSimdLevel();
+}
+
+/**
+ * @brief The scalar kernels compute what they are documented to compute.
+ *
+ */
+TEST(SimdKernels, ScalarReference) {
+  SetSimdLevel(SimdLevel::kScalar);
+
+  std::vector<int16_t> pcm({ -32768, 0, 16384 });
+  std::vector<double> converted(3);
+  ConvertInt16ToDouble(pcm.data(), pcm.size(), 1. / 32768., converted.data());
+  EXPECT_VEC_EQ(converted, std::vector<double>({ -1., 0., 0.5 }));
+
+  std::vector<double> pairs({ 3., -4., 0., 2. });
+  std::vector<double> magnitudes(2), powers(2);
+  InterleavedMagnitude(pairs.data(), 2, magnitudes.data());
+  InterleavedPower(pairs.data(), 2, powers.data());
+  EXPECT_VEC_EQ(magnitudes, std::vector<double>({ 5., 2. }));
+  EXPECT_VEC_EQ(powers, std::vector<double>({ 25., 4. }));
+
+  std::vector<double> a({ 1., 2., 3., 4., 5., 6., 7., 8., 9., 10. });
+  std::vector<double> b({ 1., -1., 1., -1., 1., -1., 1., -1., 1., 2. });
+  EXPECT_EQ(DotProduct(a.data(), b.data(), a.size()), 25.);
+  EXPECT_EQ(DotProduct(a.data(), b.data(), 0), 0.);
+
+  //                      0   1   2   3   4   5   6
+  std::vector<double> x({ 0., 1., 1., 0., 2., 3., 3. });
+  EXPECT_EQ(NextPeakCandidate(x.data(), 1, 6, -1.), 2u);
+  EXPECT_EQ(NextPeakCandidate(x.data(), 3, 6, -1.), 6u);
+  EXPECT_EQ(NextPeakCandidate(x.data(), 1, 6, 1.), 6u);
+
+  ResetSimdLevel();
+}
+
+/**
+ * @brief The level can be forced by name, but never above what the CPU supports.
+ *
+ */
+TEST(SimdKernels, ForceLevel) {
+  for (SimdLevel level : SupportedLevels()) {
+    EXPECT_EQ(ParseSimdLevel(SimdLevelName(level)), level);
+    SetSimdLevel(level);
+    EXPECT_EQ(ActiveSimdLevel(), level);
+  }
+  EXPECT_EQ(ParseSimdLevel("AVX2"), SimdLevel::kAvx2);
+  EXPECT_THROW(
+      {
+        try {
+          ParseSimdLevel("neon");
+        } catch (const std::runtime_error &e) {
+          EXPECT_STREQ("SIMD level 'neon' is not supported. Use scalar, sse2, avx2 or avx512.", e.what());
+          throw;
+        }
+      },
+      std::runtime_error);
+
+  if (DetectedSimdLevel() < SimdLevel::kAvx512) {
+    EXPECT_THROW(SetSimdLevel(SimdLevel::kAvx512), std::runtime_error);
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  setenv("MUSHER_SIMD_LEVEL", "scalar", 1);
+  ResetSimdLevel();
+  EXPECT_EQ(ActiveSimdLevel(), SimdLevel::kScalar);
+  unsetenv("MUSHER_SIMD_LEVEL");
+#endif
+
+  ResetSimdLevel();
+  EXPECT_EQ(ActiveSimdLevel(), DetectedSimdLevel());
+}
+
+/**
+ * @brief The whole key detection gives the same result at every level.
+ *
+ */
+TEST(SimdKernels, DetectKeyMatchesAtEveryLevel) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/mozart_c_major_30sec.mp3");
+
+  SetSimdLevel(SimdLevel::kScalar);
+  Mp3Decoded mp3_decoded = DecodeMp3(file_path);
+  double sample_rate = mp3_decoded.sample_rate;
+  DetectKeyOptions options;
+  options.profile_type = "Temperley";
+  KeyAnalysis expected_key_analysis = AnalyzeKey(mp3_decoded.normalized_samples, sample_rate, options);
+
+  for (SimdLevel level : SupportedLevels()) {
+    SetSimdLevel(level);
+    SCOPED_TRACE(SimdLevelName(level));
+
+    Mp3Decoded actual_mp3_decoded = DecodeMp3(file_path);
+    KeyAnalysis actual_key_analysis = AnalyzeKey(actual_mp3_decoded.normalized_samples, sample_rate, options);
+
+    EXPECT_EQ(actual_mp3_decoded.normalized_samples, mp3_decoded.normalized_samples);
+    EXPECT_EQ(actual_key_analysis.average_hpcp, expected_key_analysis.average_hpcp);
+    EXPECT_EQ(actual_key_analysis.key, expected_key_analysis.key);
+    EXPECT_EQ(actual_key_analysis.scale, expected_key_analysis.scale);
+    EXPECT_EQ(actual_key_analysis.strength, expected_key_analysis.strength);
+  }
+  ResetSimdLevel();
+}
+
+/**
+ * @brief The 16 bit WAV conversion gives the same samples at every level.
+ *
+ */
+TEST(SimdKernels, DecodeWavMatchesAtEveryLevel) {
+  const std::string file_path = TEST_DATA_DIR + std::string("audio_files/700kb.wav");
+
+  SetSimdLevel(SimdLevel::kScalar);
+  WavDecoded expected_wav_decoded = DecodeWav(file_path);
+  ASSERT_EQ(expected_wav_decoded.bit_depth, 16);
+
+  for (SimdLevel level : SupportedLevels()) {
+    SetSimdLevel(level);
+    SCOPED_TRACE(SimdLevelName(level));
+
+    WavDecoded actual_wav_decoded = DecodeWav(file_path);
+    EXPECT_EQ(actual_wav_decoded.normalized_samples, expected_wav_decoded.normalized_samples);
+  }
+  ResetSimdLevel();
+}
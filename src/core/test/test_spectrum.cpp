@@ -1,3 +1,6 @@
+#include <cmath>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "src/core/spectrum.h"
 #include "src/core/test/gtest_extras.h"
@@ -34,4 +37,50 @@ TEST(Spectrum, Magnitude) {
   double actual_magnitude = Magnitude(complex_pair);
 
   EXPECT_DOUBLE_EQ(expected_magnitude, actual_magnitude);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief A reused spectrum plan gives the same spectrum as ConvertToFrequencySpectrum.
+ * 
+ */
+TEST(Spectrum, SpectrumPlan) {
+  std::vector<size_t> frame_sizes({ 2, 7, 100, 1021, 4096 });
+
+  for (size_t frame_size : frame_sizes) {
+    SpectrumPlan spectrum_plan(frame_size);
+    std::vector<double> actual_out;
+
+    for (int trial = 0; trial < 2; trial++) {
+      std::vector<double> inp(frame_size);
+      for (size_t i = 0; i < frame_size; i++) inp[i] = std::sin(0.37 * (i + trial)) + 0.1 * (i % 5);
+
+      spectrum_plan.Compute(inp, actual_out);
+      std::vector<double> expected_out = ConvertToFrequencySpectrum(inp);
+
+      ASSERT_EQ(expected_out.size(), spectrum_plan.SpectrumSize());
+      EXPECT_VEC_NEAR(expected_out, actual_out, 1e-9);
+    }
+  }
+}
+
+
+/**
+ * @brief The power spectrum is the square of the magnitude spectrum.
+ * 
+ */
+TEST(Spectrum, SpectrumPlanPower) {
+  std::vector<size_t> frame_sizes({ 2, 7, 100, 4096 });
+
+  for (size_t frame_size : frame_sizes) {
+    SpectrumPlan spectrum_plan(frame_size);
+    std::vector<double> inp(frame_size);
+    for (size_t i = 0; i < frame_size; i++) inp[i] = std::cos(0.21 * i) - 0.05 * (i % 3);
+
+    std::vector<double> spectrum, power_spectrum;
+    spectrum_plan.Compute(inp, spectrum);
+    spectrum_plan.ComputePower(inp, power_spectrum);
+
+    ASSERT_EQ(spectrum.size(), power_spectrum.size());
+    for (size_t i = 0; i < spectrum.size(); i++) EXPECT_NEAR(spectrum[i] * spectrum[i], power_spectrum[i], 1e-9);
+  }
+}
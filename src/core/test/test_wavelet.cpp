@@ -0,0 +1,61 @@
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/core/wavelet.h"
+
+using namespace musher::core;
+
+namespace {
+
+// Reconstruction filter of db4, the decomposition filters are its reverse and its quadrature mirror.
+const double kScaling[8] = { 0.23037781330885523,  0.7148465705525415,   0.6308807679295904,  -0.02798376941698385,
+                             -0.18703481171888114, 0.030841381835986965, 0.032883011666982945, -0.010597401784997278 };
+
+}  // namespace
+
+/**
+ * @brief The coefficients are the direct filtering of the symmetric extension, like wavelib and pywt.
+ *
+ */
+TEST(Wavelet, MatchesDirectFiltering) {
+  for (long size : {1, 2, 3, 8, 13, 100, 1001}) {
+    SCOPED_TRACE(size);
+    std::vector<double> signal(static_cast<size_t>(size));
+    for (long i = 0; i < size; i++) signal[i] = std::sin(0.37 * i) + 0.1 * i;
+
+    WaveletCoefficients coefficients = DiscreteWaveletTransform(signal);
+    ASSERT_EQ(coefficients.approximation.size(), DWTCoefficientsSize(signal.size()));
+    ASSERT_EQ(coefficients.detail.size(), static_cast<size_t>((size + 7) / 2));
+
+    for (size_t i = 0; i < coefficients.approximation.size(); i++) {
+      double approximation = 0.;
+      double detail = 0.;
+      for (long l = 0; l < 8; l++) {
+        long index = 2 * static_cast<long>(i) + 1 - l;
+        while (index < 0 || index >= size) index = index < 0 ? -index - 1 : 2 * size - index - 1;
+        approximation += kScaling[7 - l] * signal[index];
+        detail += (l % 2 == 0 ? -1. : 1.) * kScaling[l] * signal[index];
+      }
+      EXPECT_NEAR(coefficients.approximation[i], approximation, 1e-12);
+      EXPECT_NEAR(coefficients.detail[i], detail, 1e-12);
+    }
+  }
+  EXPECT_TRUE(DiscreteWaveletTransform({}).approximation.empty());
+}
+
+/**
+ * @brief A constant goes to the approximation only, scaled by sqrt(2), and the filters are orthonormal.
+ *
+ */
+TEST(Wavelet, ConstantSignal) {
+  WaveletCoefficients coefficients = DiscreteWaveletTransform(std::vector<double>(64, 1.));
+  for (size_t i = 0; i < coefficients.approximation.size(); i++) {
+    EXPECT_NEAR(coefficients.approximation[i], std::sqrt(2.), 1e-12);
+    EXPECT_NEAR(coefficients.detail[i], 0., 1e-12);
+  }
+
+  double energy = 0.;
+  for (double tap : kScaling) energy += tap * tap;
+  EXPECT_NEAR(energy, 1., 1e-12);
+}
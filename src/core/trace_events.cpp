@@ -0,0 +1,147 @@
+#include "src/core/trace_events.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace musher {
+namespace core {
+
+namespace detail {
+std::atomic<bool> trace_enabled(false);
+}  // namespace detail
+
+namespace {
+
+struct TraceEvent {
+  const char *name;
+  const char *category;
+  int thread_id;
+  double start_us;
+  double duration_us;
+  std::string args;
+};
+
+// The spans are coarse (files, chunks of frames), a single lock is cheaper than merging per-thread buffers.
+std::mutex trace_mutex;
+std::string trace_file_path;
+std::chrono::steady_clock::time_point trace_start;
+std::vector<TraceEvent> trace_events;
+std::atomic<uint64_t> trace_session(0);
+
+// Small sequential thread ids, std::thread::id has no portable integer value.
+std::atomic<int> next_thread_id(0);
+
+int CurrentThreadId() {
+  thread_local int thread_id = next_thread_id.fetch_add(1);
+  return thread_id;
+}
+
+std::string EscapeJson(const std::string &value) {
+  std::string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+void StartTrace(const std::string &file_path) {
+  // Fail now rather than after a long run.
+  std::ofstream trace_file(file_path);
+  if (!trace_file) throw std::runtime_error("StartTrace: Failed to open '" + file_path + "'");
+
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  trace_file_path = file_path;
+  trace_events.clear();
+  trace_start = std::chrono::steady_clock::now();
+  trace_session.fetch_add(1);
+  detail::trace_enabled.store(true);
+}
+
+void StopTrace() {
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  if (!detail::trace_enabled.load()) return;
+  detail::trace_enabled.store(false);
+  // Spans opened during this trace are dropped when they close.
+  trace_session.fetch_add(1);
+
+  std::ofstream trace_file(trace_file_path);
+  if (!trace_file) throw std::runtime_error("StopTrace: Failed to open '" + trace_file_path + "'");
+  trace_file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  std::vector<bool> named_threads;
+  bool first = true;
+  for (const TraceEvent &event : trace_events) {
+    trace_file << (first ? "\n" : ",\n");
+    first = false;
+    size_t thread_index = static_cast<size_t>(event.thread_id);
+    if (thread_index >= named_threads.size()) named_threads.resize(thread_index + 1, false);
+    if (!named_threads[thread_index]) {
+      named_threads[thread_index] = true;
+      trace_file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << event.thread_id
+                 << ", \"args\": {\"name\": \"musher thread " << event.thread_id << "\"}},\n";
+    }
+    char timing[96];
+    std::snprintf(timing, sizeof(timing), "\"ts\": %.3f, \"dur\": %.3f", event.start_us, event.duration_us);
+    trace_file << "{\"name\": \"" << event.name << "\", \"cat\": \"" << event.category << "\", \"ph\": \"X\", "
+               << timing << ", \"pid\": 1, \"tid\": " << event.thread_id << ", \"args\": {" << event.args << "}}";
+  }
+  trace_file << "\n]}\n";
+  trace_events.clear();
+  if (!trace_file) throw std::runtime_error("StopTrace: Failed to write '" + trace_file_path + "'");
+}
+
+TraceSpan::TraceSpan(const char *name, const char *category) : name_(name), category_(category), session_(0) {
+  if (!TraceEnabled()) return;
+  session_ = trace_session.load();
+  start_ = std::chrono::steady_clock::now();
+}
+
+TraceSpan::~TraceSpan() {
+  if (session_ == 0) return;
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  int thread_id = CurrentThreadId();
+
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  if (session_ != trace_session.load()) return;
+  TraceEvent event;
+  event.name = name_;
+  event.category = category_;
+  event.thread_id = thread_id;
+  event.start_us = std::chrono::duration<double, std::micro>(start_ - trace_start).count();
+  event.duration_us = std::chrono::duration<double, std::micro>(end - start_).count();
+  event.args = std::move(args_);
+  trace_events.push_back(std::move(event));
+}
+
+void TraceSpan::SetArg(const char *name, const std::string &value) {
+  if (session_ == 0) return;
+  if (!args_.empty()) args_ += ", ";
+  args_ += "\"" + std::string(name) + "\": \"" + EscapeJson(value) + "\"";
+}
+
+void TraceSpan::SetArg(const char *name, int64_t value) {
+  if (session_ == 0) return;
+  if (!args_.empty()) args_ += ", ";
+  args_ += "\"" + std::string(name) + "\": " + std::to_string(value);
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Number of frames of a "dsp" span. The frame analysis is traced per chunk of frames, a span per frame would
+ * be larger than the trace of a whole directory.
+ */
+const int kTraceChunkFrames = 64;
+
+namespace detail {
+extern std::atomic<bool> trace_enabled;
+}  // namespace detail
+
+/**
+ * @brief Start recording trace events, written to a Chrome trace-event JSON file by StopTrace.
+ *
+ * The file can be opened in chrome://tracing or https://ui.perfetto.dev. It has a span for each decoded file, each
+ * chunk of kTraceChunkFrames analyzed frames, each key estimate and each wait for the next job of DetectKeyFiles,
+ * tagged with the thread it ran on. Starting a trace drops the events of a trace that was not stopped.
+ *
+ * @param file_path Path of the JSON file to write.
+ */
+void StartTrace(const std::string &file_path);
+
+/**
+ * @brief Stop recording and write the events recorded since StartTrace. Does nothing if no trace was started.
+ *
+ * Spans that are still open are not written.
+ */
+void StopTrace();
+
+/**
+ * @brief Whether trace events are recorded.
+ *
+ * @return bool True between StartTrace and StopTrace.
+ */
+inline bool TraceEnabled() { return detail::trace_enabled.load(std::memory_order_relaxed); }
+
+/**
+ * @brief Records a complete event ("ph": "X") from its construction to its destruction on the calling thread.
+ *
+ * Disabled traces only cost a relaxed atomic load.
+ *
+ * @code
+ *   WavDecoded DecodeWav(const std::string& file_path) {
+ *     TraceSpan trace_span("DecodeWav", "decode");
+ *     trace_span.SetArg("file_path", file_path);
+ *     ...
+ *   }
+ * @endcode
+ */
+class TraceSpan {
+ public:
+  /**
+   * @brief Open a span.
+   *
+   * @param name Name of the span, must outlive the span (a string literal).
+   * @param category Comma-separated categories of the span, must outlive the span (a string literal).
+   */
+  TraceSpan(const char *name, const char *category);
+  ~TraceSpan();
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+  /**
+   * @brief Add an argument shown with the span. Ignored when the trace is disabled.
+   *
+   * @param name Name of the argument, a string literal.
+   * @param value Value of the argument.
+   */
+  void SetArg(const char *name, const std::string &value);
+  void SetArg(const char *name, int64_t value);
+
+ private:
+  const char *name_;
+  const char *category_;
+  uint64_t session_;  //!< Trace the span belongs to, 0 when the trace was disabled.
+  std::string args_;  //!< Arguments as the members of a JSON object.
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace core
+}  // namespace musher
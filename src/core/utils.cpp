@@ -2,16 +2,25 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <cmath>
 #include <complex>
+#include <exception>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <valarray>
 #include <vector>
 
+#include "src/core/simd_kernels.h"
+#include "src/core/trace_events.h"
+
+
 namespace musher {
 namespace core {
 
@@ -40,7 +49,7 @@ std::string StrBetweenSQuotes(const std::string &s) {
   return s.substr(pos, len);
 }
 
-int16_t TwoBytesToInt(const std::vector<uint8_t> &source, const int startIndex) {
+int16_t TwoBytesToInt(const std::vector<uint8_t> &source, const size_t startIndex) {
   int16_t result;
 
   if (!IsBigEndian())
@@ -51,7 +60,7 @@ int16_t TwoBytesToInt(const std::vector<uint8_t> &source, const int startIndex)
   return result;
 }
 
-int32_t FourBytesToInt(const std::vector<uint8_t> &source, const int startIndex) {
+int32_t FourBytesToInt(const std::vector<uint8_t> &source, const size_t startIndex) {
   int32_t result;
 
   if (!IsBigEndian())
@@ -102,5 +111,48 @@ std::vector<double> OnePoleFilter(const std::vector<double> &vec) {
   return filtered_signal;
 }
 
+double RootMeanSquare(const std::vector<double> &vec) {
+  if (vec.empty()) return 0.;
+  return std::sqrt(DotProduct(vec.data(), vec.data(), vec.size()) / static_cast<double>(vec.size()));
+}
+
+void ParallelFor(size_t num_items,
+                 int num_threads,
+                 const std::function<void(size_t, int)> &fn,
+                 const char *wait_span_name) {
+  if (num_items == 0) return;
+  if (num_threads <= 0) num_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  num_threads = static_cast<int>(std::min(static_cast<size_t>(num_threads), num_items));
+
+  std::mutex queue_mutex;
+  size_t next_item = 0;
+  std::exception_ptr error;
+
+  auto worker = [&](int thread) {
+    while (true) {
+      size_t item;
+      {
+        TraceSpan trace_span(wait_span_name, "queue");
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (next_item == num_items || error) return;
+        item = next_item++;
+      }
+
+      try {
+        fn(item, thread);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (!error) error = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int thread = 1; thread < num_threads; thread++) pool.emplace_back(worker, thread);
+  worker(0);
+  for (std::thread &thread : pool) thread.join();
+  if (error) std::rethrow_exception(error);
+}
+
 }  // namespace core
 }  // namespace musher
@@ -3,7 +3,6 @@
 #define _USE_MATH_DEFINES
 
 #include <math.h>
-#include <pocketfft/pocketfft.h>
 
 #include <complex>
 #include <fplus/fplus.hpp>
@@ -44,8 +43,8 @@ std::string StrBetweenSQuotes(const std::string &s);
  * @return false If not big endian.
  */
 bool IsBigEndian(void);
-int16_t TwoBytesToInt(const std::vector<uint8_t> &source, const int startIndex);
-int32_t FourBytesToInt(const std::vector<uint8_t> &source, const int startIndex);
+int16_t TwoBytesToInt(const std::vector<uint8_t> &source, const size_t startIndex);
+int32_t FourBytesToInt(const std::vector<uint8_t> &source, const size_t startIndex);
 double NormalizeInt8_t(const uint8_t sample);
 double NormalizeInt16_t(const int16_t sample);
 double NormalizeInt32_t(const int32_t sample);
@@ -83,22 +82,21 @@ double NormalizeInt32_t(const int32_t sample);
 template <typename T>
 std::vector<std::vector<T>> Deinterweave(const std::vector<T> &interweaved_vector) {
   size_t interweaved_vec_size = interweaved_vector.size();
-  std::vector<T> channel1;
-  std::vector<T> channel2;
+  // Sized up front and filled in place, the channels are never copied.
+  std::vector<std::vector<T>> deinterweaved_vectors(2);
+  std::vector<T> &channel1 = deinterweaved_vectors[0];
+  std::vector<T> &channel2 = deinterweaved_vectors[1];
+  channel1.resize((interweaved_vec_size + 1) / 2);
+  channel2.resize(interweaved_vec_size / 2);
 
   for (size_t i = 0; i < interweaved_vec_size; ++i) {
     if (i % 2 == 0) {
-      channel1.push_back(interweaved_vector[i]);
+      channel1[i / 2] = interweaved_vector[i];
     } else {
-      channel2.push_back(interweaved_vector[i]);
+      channel2[i / 2] = interweaved_vector[i];
     }
   };
 
-  std::vector<std::vector<T>> deinterweaved_vectors({
-      channel1,
-      channel2,
-  });
-
   return deinterweaved_vectors;
 }
 
@@ -118,5 +116,35 @@ double Median(std::vector<double> &inVec);
  */
 std::vector<double> OnePoleFilter(const std::vector<double> &vec);
 
+/**
+ * @brief Compute the root mean square of a signal.
+ *
+ * The sum of squares is a DotProduct of the signal with itself, so it runs at the active SimdLevel and sums in the
+ * same order as a DotProduct, which differs slightly from a plain loop.
+ *
+ * @param vec Audio signal.
+ * @return double Root mean square, 0 for an empty signal.
+ */
+double RootMeanSquare(const std::vector<double> &vec);
+
+/**
+ * @brief Calls fn for every item of [0, num_items) on a pool of threads, the calling thread included.
+ *
+ * Each thread takes the next item from a shared counter until every item has been taken. fn also receives the index
+ * of the thread that runs it, in [0, num_threads), so each thread can keep its own buffers or detectors. The first
+ * exception thrown by fn stops the other threads from taking new items and is rethrown once every thread has
+ * finished.
+ *
+ * @param num_items Number of items.
+ * @param num_threads Number of threads, the calling thread included. 0 uses every hardware thread. Never more threads
+ * than items are started.
+ * @param fn Called with the index of the item and the index of the thread.
+ * @param wait_span_name Name of the span recorded while a thread waits for its next item, see TraceSpan.
+ */
+void ParallelFor(size_t num_items,
+                 int num_threads,
+                 const std::function<void(size_t, int)> &fn,
+                 const char *wait_span_name = "WaitForItem");
+
 }  // namespace core
 }  // namespace musher
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "src/core/wavelet.h"
+
+#include <vector>
+
+#include "src/core/simd_kernels.h"
+
+namespace musher {
+namespace core {
+
+namespace {
+
+const size_t kFilterSize = 8;
+
+// Decomposition low-pass filter of db4, the time reverse of its scaling filter.
+const double kLowPass[kFilterSize] = { -0.010597401784997278, 0.032883011666982945, 0.030841381835986965,
+                                       -0.18703481171888114,  -0.02798376941698385, 0.6308807679295904,
+                                       0.7148465705525415,    0.23037781330885523 };
+
+// Decomposition high-pass filter, the quadrature mirror of the low-pass filter.
+const double kHighPass[kFilterSize] = { -0.23037781330885523, 0.7148465705525415,   -0.6308807679295904,
+                                        -0.02798376941698385, 0.18703481171888114,  0.030841381835986965,
+                                        -0.032883011666982945, -0.010597401784997278 };
+
+// Index of sample i of the symmetric extension of a signal of size samples, for any i.
+size_t SymmetricIndex(long i, long size) {
+  long period = i % (2 * size);
+  if (period < 0) period += 2 * size;
+  return static_cast<size_t>(period < size ? period : 2 * size - 1 - period);
+}
+
+}  // namespace
+
+size_t DWTCoefficientsSize(size_t size) { return size == 0 ? 0 : (size + kFilterSize - 1) / 2; }
+
+WaveletCoefficients DiscreteWaveletTransform(const std::vector<double> &signal) {
+  WaveletCoefficients coefficients;
+  const size_t size = DWTCoefficientsSize(signal.size());
+  if (size == 0) return coefficients;
+
+  // Coefficient i is sum(filter[l] * x[2i + 1 - l]) over the symmetric extension x. With kFilterSize - 1 samples of
+  // extension on both sides, x[2i + 1 - l] is sample 2i + kFilterSize - l of the extended signal: an even sample for
+  // the even taps and an odd sample for the odd taps.
+  const long num_samples = static_cast<long>(signal.size());
+  const long extension = static_cast<long>(kFilterSize) - 1;
+  const size_t extended_size = signal.size() + 2 * (kFilterSize - 1);
+  std::vector<double> even((extended_size + 1) / 2);
+  std::vector<double> odd(extended_size / 2);
+  for (size_t k = 0; k < extended_size; k++) {
+    const double sample = signal[SymmetricIndex(static_cast<long>(k) - extension, num_samples)];
+    if (k % 2 == 0)
+      even[k / 2] = sample;
+    else
+      odd[k / 2] = sample;
+  }
+
+  coefficients.approximation.assign(size, 0.);
+  coefficients.detail.assign(size, 0.);
+  for (size_t l = 0; l < kFilterSize; l++) {
+    // Extended sample 2i + 8 - l: even[i + 4 - l / 2] for even l, odd[i + 3 - l / 2] for odd l.
+    const double *samples =
+        l % 2 == 0 ? even.data() + kFilterSize / 2 - l / 2 : odd.data() + kFilterSize / 2 - 1 - l / 2;
+    AccumulateScaled(samples, kLowPass[l], size, coefficients.approximation.data());
+    AccumulateScaled(samples, kHighPass[l], size, coefficients.detail.data());
+  }
+  return coefficients;
+}
+
+}  // namespace core
+}  // namespace musher
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace musher {
+namespace core {
+
+/**
+ * @brief Approximation and detail coefficients of one level of a discrete wavelet transform.
+ *
+ */
+struct WaveletCoefficients {
+  std::vector<double> approximation; /*!< Low-pass half of the signal, cA. */
+  std::vector<double> detail;        /*!< High-pass half of the signal, cD. */
+};
+
+/**
+ * @brief Number of coefficients of each half of a DWT level, floor((size + 7) / 2) for the 8 taps of db4.
+ *
+ * @param size Number of samples of the input signal.
+ * @return size_t Size of WaveletCoefficients::approximation and WaveletCoefficients::detail.
+ */
+size_t DWTCoefficientsSize(size_t size);
+
+/**
+ * @brief One level of the discrete wavelet transform with the Daubechies wavelet of 4 vanishing moments (db4).
+ *
+ * The signal is extended symmetrically (x[-1] = x[0], x[-2] = x[1]...) and filtered by the 8 taps decomposition
+ * filters, keeping every other sample. The coefficients are the same as pywt.dwt(signal, "db4") and as the "sym"
+ * extension and "direct" convolution of wavelib.
+ *
+ * The extended signal is split into its even and odd samples, so each tap of the filters becomes a contiguous
+ * AccumulateScaled over all the coefficients, which runs on the vector units.
+ *
+ * @param signal Input signal.
+ * @return WaveletCoefficients Approximation and detail coefficients, DWTCoefficientsSize(signal.size()) each.
+ */
+WaveletCoefficients DiscreteWaveletTransform(const std::vector<double> &signal);
+
+}  // namespace core
+}  // namespace musher
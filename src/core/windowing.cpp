@@ -1,10 +1,14 @@
 #include "src/core/windowing.h"
 
+#include <algorithm>
 #include <cmath>
 #include <functional>
 #include <vector>
 #include <stdexcept>
 
+#include "src/core/pipeline_stats.h"
+#include "src/core/simd_kernels.h"
+
 namespace musher {
 namespace core {
 
@@ -66,19 +70,54 @@ std::vector<double> Normalize(const std::vector<double> &input) {
   return Normalized_output;
 }
 
+void ApplyWindow(const std::vector<double> &audio_frame,
+                 const std::vector<double> &window,
+                 std::vector<double> &windowed_signal,
+                 unsigned int zero_padding_size,
+                 bool zero_phase) {
+  StageTimer stage_timer(&PipelineStats::window_seconds);
+  int signal_size = audio_frame.size();
+  int total_size = signal_size + zero_padding_size;
+  if (window.size() != audio_frame.size()) throw std::runtime_error("Windowing: window and frame sizes do not match");
+  windowed_signal.resize(static_cast<size_t>(total_size));
+
+  const double *frame = audio_frame.data();
+  const double *window_data = window.data();
+  double *out = windowed_signal.data();
+
+  if (zero_phase) {
+    // first half of the windowed signal is the
+    // second half of the signal with windowing!
+    int half = signal_size / 2;
+    MultiplyArrays(frame + half, window_data + half, signal_size - half, out);
+
+    // zero padding
+    std::fill(out + signal_size - half, out + signal_size - half + zero_padding_size, 0.0);
+
+    // second half of the signal
+    MultiplyArrays(frame, window_data, half, out + total_size - half);
+  } else {
+    // windowed signal
+    MultiplyArrays(frame, window_data, signal_size, out);
+
+    // zero padding
+    std::fill(out + signal_size, out + total_size, 0.0);
+  }
+}
+
 std::vector<double> Windowing(const std::vector<double> &audio_frame,
                               const std::function<std::vector<double>(const std::vector<double> &)> &window_type_func,
                               unsigned int zero_padding_size,
                               bool zero_phase,
                               bool _normalize) {
+  StageTimer stage_timer(&PipelineStats::window_seconds);
   int signal_size = audio_frame.size();
-  int total_size = signal_size + zero_padding_size;
 
   if (signal_size <= 1) {
     throw std::runtime_error("Windowing: frame (signal) size should be larger than 1");
   }
 
-  std::vector<double> windowed_signal(static_cast<size_t>(total_size));
+  std::vector<double> windowed_signal;
   std::vector<double> window(static_cast<size_t>(signal_size));
   if (_normalize) {
     window = Normalize(window_type_func(window));
@@ -86,36 +125,7 @@ std::vector<double> Windowing(const std::vector<double> &audio_frame,
     window = window_type_func(window);
   }
 
-  int i = 0;
-
-  if (zero_phase) {
-    // first half of the windowed signal is the
-    // second half of the signal with windowing!
-    for (int j = signal_size / 2; j < signal_size; j++) {
-      windowed_signal[i++] = audio_frame[j] * window[j];
-    }
-
-    // zero padding
-    for (unsigned int j = 0; j < zero_padding_size; j++) {
-      windowed_signal[i++] = 0.0;
-    }
-
-    // second half of the signal
-    for (int j = 0; j < signal_size / 2; j++) {
-      windowed_signal[i++] = audio_frame[j] * window[j];
-    }
-  } else {
-    // windowed signal
-    for (int j = 0; j < signal_size; j++) {
-      windowed_signal[i++] = audio_frame[j] * window[j];
-    }
-
-    // zero padding
-    for (unsigned int j = 0; j < zero_padding_size; j++) {
-      windowed_signal[i++] = 0.0;
-    }
-  }
-
+  ApplyWindow(audio_frame, window, windowed_signal, zero_padding_size, zero_phase);
   return windowed_signal;
 }
 
@@ -79,5 +79,22 @@ std::vector<double> Windowing(
     bool zero_phase = true,
     bool _normalize = true);
 
+/**
+ * @brief Multiplies an audio frame by a precomputed window, with the layout of Windowing.
+ *
+ * Does not allocate as long as the capacity of windowed_frame is large enough.
+ *
+ * @param audio_frame Input audio frame.
+ * @param window Window of the same size as the frame, e.g. Normalize(BlackmanHarris62dB(frame)).
+ * @param windowed_frame Output windowed audio frame, resized to the frame size plus zero_padding_size.
+ * @param zero_padding_size Size of the zero-padding.
+ * @param zero_phase Enables zero-phase windowing.
+ */
+void ApplyWindow(const std::vector<double> &audio_frame,
+                 const std::vector<double> &window,
+                 std::vector<double> &windowed_frame,
+                 unsigned zero_padding_size = 0,
+                 bool zero_phase = true);
+
 }  // namespace core
 }  // namespace musher
\ No newline at end of file
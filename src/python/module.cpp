@@ -3,7 +3,13 @@
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
+#include "src/core/backend.h"
+#include "src/core/bpm.h"
+#include "src/core/cpu_dispatch.h"
 #include "src/core/framecutter.h"
+#include "src/core/key_detector.h"
+#include "src/core/key_tracker.h"
+#include "src/core/trace_events.h"
 #include "src/python/module_descriptions.h"
 #include "src/python/wrapper.h"
 
@@ -27,6 +33,8 @@ PYBIND11_MODULE(musher_python, m) {
   m.def("decode_mp3_from_file", &_DecodeMp3FromFile, decode_mp3_from_file_description, py::arg("file_path"));
 
   m.def("mono_mixer", &_MonoMixer, mono_mixer_description, py::arg("input"));
+  m.def("resample", &_Resample, resample_description, py::arg("signal"), py::arg("input_sample_rate"),
+        py::arg("output_sample_rate"), py::arg("quality") = "medium");
 
   // Framecutter will be treated like an iterator in python.
   py::class_<Framecutter>(m, "Framecutter", framecutter_description)
@@ -76,11 +84,155 @@ PYBIND11_MODULE(musher_python, m) {
   m.def("estimate_key", &_EstimateKey, estimate_key_description, py::arg("pcp"), py::arg("use_polphony") = true,
         py::arg("use_three_chords") = true, py::arg("num_harmonics") = 4, py::arg("slope") = .6,
         py::arg("profile_type") = "Bgate", py::arg("use_maj_min") = false);
+  m.def("estimate_keys", &_EstimateKeys, estimate_keys_description, py::arg("pcps"), py::arg("use_polphony") = true,
+        py::arg("use_three_chords") = true, py::arg("num_harmonics") = 4, py::arg("slope") = .6,
+        py::arg("profile_type") = "Bgate", py::arg("use_maj_min") = false);
 
   m.def("detect_key", &_DetectKey, detect_key_description, py::arg("normalized_samples"),
         py::arg("sample_rate") = 44100., py::arg("profile_type") = "Bgate", py::arg("use_polphony") = true,
         py::arg("use_three_chords") = true, py::arg("num_harmonics") = 4, py::arg("slope") = .6,
         py::arg("use_maj_min") = false, py::arg("pcp_size") = 36, py::arg("frame_size") = 4096,
         py::arg("hop_size") = 512, py::arg("window_type_func") = py::cpp_function(BlackmanHarris62dB),
-        py::arg("max_num_peaks") = 100, py::arg("window_size") = .5);
+        py::arg("max_num_peaks") = 100, py::arg("window_size") = .5, py::arg("convergence_frames") = 0,
+        py::arg("estimate_interval") = 32, py::arg("convergence_tolerance") = 0.05, py::arg("frame_sampling") = "all",
+        py::arg("frame_stride") = 1, py::arg("num_sampled_frames") = 0, py::arg("sampling_seed") = 0,
+        py::arg("rms_threshold") = 0., py::arg("analysis_sample_rate") = 0.);
+  m.def("analyze_key", &_AnalyzeKey, analyze_key_description, py::arg("normalized_samples"),
+        py::arg("sample_rate") = 44100., py::arg("profile_type") = "Bgate", py::arg("use_polphony") = true,
+        py::arg("use_three_chords") = true, py::arg("num_harmonics") = 4, py::arg("slope") = .6,
+        py::arg("use_maj_min") = false, py::arg("pcp_size") = 36, py::arg("frame_size") = 4096,
+        py::arg("hop_size") = 512, py::arg("window_type_func") = py::cpp_function(BlackmanHarris62dB),
+        py::arg("max_num_peaks") = 100, py::arg("window_size") = .5, py::arg("convergence_frames") = 0,
+        py::arg("estimate_interval") = 32, py::arg("convergence_tolerance") = 0.05, py::arg("frame_sampling") = "all",
+        py::arg("frame_stride") = 1, py::arg("num_sampled_frames") = 0, py::arg("sampling_seed") = 0,
+        py::arg("rms_threshold") = 0., py::arg("analysis_sample_rate") = 0.);
+  m.def("chromagram", &_Chromagram, chromagram_description, py::arg("normalized_samples"),
+        py::arg("sample_rate") = 44100., py::arg("pcp_size") = 36, py::arg("harmonics") = 3,
+        py::arg("frame_size") = 4096, py::arg("hop_size") = 512,
+        py::arg("window_type_func") = py::cpp_function(BlackmanHarris62dB), py::arg("max_num_peaks") = 100,
+        py::arg("window_size") = .5, py::arg("aggregation_frames") = 1, py::arg("aggregation_type") = "mean");
+  m.def("constant_q_chromagram", &_ConstantQChromagram, constant_q_chromagram_description,
+        py::arg("normalized_samples"), py::arg("sample_rate") = 44100., py::arg("pcp_size") = 36,
+        py::arg("hop_size") = 512, py::arg("min_frequency") = 55., py::arg("num_octaves") = 6);
+  m.def("detect_key_constant_q", &_DetectKeyConstantQ, detect_key_constant_q_description,
+        py::arg("normalized_samples"), py::arg("sample_rate") = 44100., py::arg("profile_type") = "Bgate",
+        py::arg("use_polphony") = true, py::arg("use_three_chords") = true, py::arg("num_harmonics") = 4,
+        py::arg("slope") = .6, py::arg("use_maj_min") = false, py::arg("pcp_size") = 36, py::arg("hop_size") = 512,
+        py::arg("min_frequency") = 55., py::arg("num_octaves") = 6);
+  m.def("detect_key_changes", &_DetectKeyChanges, detect_key_changes_description, py::arg("normalized_samples"),
+        py::arg("sample_rate") = 44100., py::arg("profile_type") = "Bgate", py::arg("use_polphony") = true,
+        py::arg("use_three_chords") = true, py::arg("num_harmonics") = 4, py::arg("slope") = .6,
+        py::arg("use_maj_min") = false, py::arg("pcp_size") = 36, py::arg("frame_size") = 4096,
+        py::arg("hop_size") = 512, py::arg("window_type_func") = py::cpp_function(BlackmanHarris62dB),
+        py::arg("max_num_peaks") = 100, py::arg("window_size") = .5, py::arg("segment_frames") = 128,
+        py::arg("transition_cost") = 1.);
+  m.def("detect_key_ensemble", &_DetectKeyEnsemble, detect_key_ensemble_description, py::arg("normalized_samples"),
+        py::arg("sample_rate") = 44100., py::arg("profile_types") = std::vector<std::string>(),
+        py::arg("vote_type") = "majority", py::arg("use_polphony") = true, py::arg("use_three_chords") = true,
+        py::arg("num_harmonics") = 4, py::arg("slope") = .6, py::arg("use_maj_min") = false, py::arg("pcp_size") = 36,
+        py::arg("frame_size") = 4096, py::arg("hop_size") = 512,
+        py::arg("window_type_func") = py::cpp_function(BlackmanHarris62dB), py::arg("max_num_peaks") = 100,
+        py::arg("window_size") = .5, py::arg("frame_sampling") = "all", py::arg("frame_stride") = 1,
+        py::arg("num_sampled_frames") = 0, py::arg("sampling_seed") = 0, py::arg("rms_threshold") = 0.);
+  m.def("detect_key_file", &_DetectKeyFile, detect_key_file_description, py::arg("file_path"),
+        py::arg("profile_type") = "Bgate", py::arg("max_memory_bytes") = 0);
+  m.def("detect_key_files", &_DetectKeyFiles, detect_key_files_description, py::arg("file_paths"),
+        py::arg("profile_type") = "Bgate", py::arg("num_threads") = 0, py::arg("max_memory_bytes") = 0);
+  m.def("key_profile_types", &KeyProfileTypes, key_profile_types_description);
+
+  m.def("bpm_detection", &BPMDetection, bpm_detection_description, py::arg("samples"), py::arg("sample_rate"));
+  m.def("bpm_over_window", &BPMOverWindow, bpm_over_window_description, py::arg("normalized_samples"),
+        py::arg("sample_rate"), py::arg("window_seconds") = 3., py::arg("num_threads") = 0);
+
+  m.def(
+      "simd_level", []() { return SimdLevelName(ActiveSimdLevel()); }, simd_level_description);
+  m.def(
+      "detected_simd_level", []() { return SimdLevelName(DetectedSimdLevel()); }, detected_simd_level_description);
+  m.def(
+      "set_simd_level", [](const std::string& level) { SetSimdLevel(ParseSimdLevel(level)); },
+      set_simd_level_description, py::arg("level"));
+  m.def("reset_simd_level", &ResetSimdLevel, reset_simd_level_description);
+
+  m.def(
+      "backend", []() { return BackendName(ActiveBackend()); }, backend_description);
+  m.def(
+      "set_backend", [](const std::string& backend) { SetBackend(ParseBackend(backend)); }, set_backend_description,
+      py::arg("backend"));
+  m.def("reset_backend", &ResetBackend, reset_backend_description);
+  m.def(
+      "cross_check_report", []() { return ConvertCrossCheckReportToPyDict(GetCrossCheckReport()); },
+      cross_check_report_description);
+  m.def("reset_cross_check_report", &ResetCrossCheckReport, reset_cross_check_report_description);
+
+  m.def("stats_enabled", &StatsEnabled, stats_enabled_description);
+  m.def("set_stats_enabled", &SetStatsEnabled, set_stats_enabled_description, py::arg("enabled"));
+  m.def(
+      "pipeline_stats", []() { return ConvertPipelineStatsToPyDict(ThreadStats()); }, pipeline_stats_description);
+  m.def("reset_pipeline_stats", &ResetThreadStats, reset_pipeline_stats_description);
+
+  m.def("start_trace", &StartTrace, start_trace_description, py::arg("file_path"));
+  m.def("stop_trace", &StopTrace, stop_trace_description);
+  m.def("trace_enabled", &TraceEnabled, trace_enabled_description);
+
+  py::class_<KeyTracker>(m, "KeyTracker", key_tracker_description)
+      .def(py::init<double, const std::string, const bool, const bool, const unsigned int, const double, const bool,
+                    const unsigned int, const int, const int,
+                    const std::function<std::vector<double>(const std::vector<double>&)>&, unsigned int, double, double>(),
+           key_tracker_init_description, py::arg("sample_rate") = 44100., py::arg("profile_type") = "Bgate",
+           py::arg("use_polphony") = true, py::arg("use_three_chords") = true, py::arg("num_harmonics") = 4,
+           py::arg("slope") = .6, py::arg("use_maj_min") = false, py::arg("pcp_size") = 36,
+           py::arg("frame_size") = 4096, py::arg("hop_size") = 512,
+           py::arg("window_type_func") = py::cpp_function(BlackmanHarris62dB), py::arg("max_num_peaks") = 100,
+           py::arg("window_size") = .5, py::arg("rms_threshold") = 0.)
+      .def("add_samples", py::overload_cast<const std::vector<double>&>(&KeyTracker::AddSamples),
+           key_tracker_add_samples_description, py::arg("samples"))
+      .def("add_samples", py::overload_cast<const std::vector<std::vector<double>>&>(&KeyTracker::AddSamples),
+           key_tracker_add_samples_description, py::arg("normalized_samples"))
+      .def("flush", &KeyTracker::Flush, key_tracker_flush_description)
+      .def("add_frame", &KeyTracker::AddFrame, key_tracker_add_frame_description, py::arg("frame"))
+      .def("add_hpcp", &KeyTracker::AddHPCP, key_tracker_add_hpcp_description, py::arg("hpcp"))
+      .def(
+          "estimate", [](const KeyTracker& key_tracker) { return ConvertKeyOutputToPyDict(key_tracker.Estimate()); },
+          key_tracker_estimate_description)
+      .def(
+          "average_hpcp",
+          [](const KeyTracker& key_tracker) {
+            std::vector<double> avgs = key_tracker.AverageHPCP();
+            return ConvertSequenceToPyarray(avgs);
+          },
+          key_tracker_average_hpcp_description)
+      .def_property_readonly("frame_count", &KeyTracker::FrameCount)
+      .def_property_readonly("skipped_frame_count", &KeyTracker::SkippedFrameCount)
+      .def("reset", &KeyTracker::Reset);
+
+  py::class_<KeyDetector>(m, "KeyDetector", key_detector_description)
+      .def(py::init<double, const std::string, const bool, const bool, const unsigned int, const double, const bool,
+                    const unsigned int, const int, const int,
+                    const std::function<std::vector<double>(const std::vector<double>&)>&, unsigned int, double, double>(),
+           key_tracker_init_description, py::arg("sample_rate") = 44100., py::arg("profile_type") = "Bgate",
+           py::arg("use_polphony") = true, py::arg("use_three_chords") = true, py::arg("num_harmonics") = 4,
+           py::arg("slope") = .6, py::arg("use_maj_min") = false, py::arg("pcp_size") = 36,
+           py::arg("frame_size") = 4096, py::arg("hop_size") = 512,
+           py::arg("window_type_func") = py::cpp_function(BlackmanHarris62dB), py::arg("max_num_peaks") = 100,
+           py::arg("window_size") = .5, py::arg("rms_threshold") = 0.)
+      .def(
+          "detect",
+          [](KeyDetector& key_detector, const std::vector<std::vector<double>>& normalized_samples) {
+            return ConvertDetectKeyOutputToPyDict(key_detector.Detect(normalized_samples));
+          },
+          key_detector_detect_description, py::arg("normalized_samples"))
+      .def("add_frame", &KeyDetector::AddFrame, key_tracker_add_frame_description, py::arg("frame"))
+      .def(
+          "estimate", [](const KeyDetector& key_detector) { return ConvertKeyOutputToPyDict(key_detector.Estimate()); },
+          key_tracker_estimate_description)
+      .def(
+          "average_hpcp",
+          [](const KeyDetector& key_detector) {
+            std::vector<double> avgs = key_detector.AverageHPCP();
+            return ConvertSequenceToPyarray(avgs);
+          },
+          key_tracker_average_hpcp_description)
+      .def_property_readonly("frame_count", &KeyDetector::FrameCount)
+      .def_property_readonly("skipped_frame_count", &KeyDetector::SkippedFrameCount)
+      .def("reset", &KeyDetector::Reset);
 }
@@ -114,6 +114,23 @@ const char* mono_mixer_description = R"(
     numpy.ndarray[numpy.float64]: Downmixed audio signal
 )";
 
+const char* resample_description = R"(
+  Resamples a signal with a polyphase windowed-sinc filter.
+
+  Output sample n is the signal at time n / output_sample_rate, without any delay. Frequencies above the Nyquist
+  frequency of the lower rate are filtered out.
+
+  Args:
+    signal (List[float]): Signal at input_sample_rate.
+    input_sample_rate (float): Sampling rate of the signal [Hz], a whole number.
+    output_sample_rate (float): Sampling rate of the output [Hz], a whole number.
+    quality (str, optional): Length and cutoff of the filter: 'low', 'medium' or 'high'. Defaults to 'medium'.
+
+  Returns:
+    numpy.ndarray[numpy.float64]: Resampled signal, of ceil(len(signal) * output_sample_rate / input_sample_rate)
+      samples.
+)";
+
 const char* framecutter_description = R"(
   This class is an iterator.
 
@@ -361,6 +378,27 @@ const char* estimate_key_description = R"(
     KeyOutput: Details of key estimate.
 )";
 
+const char* estimate_keys_description = R"(
+  Computes the key estimate of many pitch class profiles (e.g. many tracks or many segments of a track) at once.
+
+  The key profiles are built once and every PCP is correlated with all the shifts of the profiles in one pass.
+
+  Args:
+    pcps (List[List[float]]): Pitch class profiles, one per row, all of the same size.
+    use_polphony (bool, optional): Enables the use of polyphonic profiles to define key profiles (this includes the contributions
+      from triads as well as pitch harmonics). Defaults to True.
+    use_three_chords (bool, optional): Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic profiles. Defaults to True.
+    num_harmonics (int, optional): Number of harmonics that should contribute to the polyphonic profile (1 only considers the
+      fundamental harmonic). Defaults to 4.
+    slope (float, optional): Value of the slope of the exponential harmonic contribution to the polyphonic profile. Defaults to 0.6.
+    profile_type (str, optional): The type of polyphic profile to use for correlation calculation. Defaults to 'Bgate'.
+    use_maj_min (bool, optional): Use a third profile called 'majmin' for ambiguous tracks. Only available for the edma, bgate
+      and braw profiles. Defaults to False.
+
+  Returns:
+    List[KeyOutput]: Details of the key estimate of each PCP, in the same order.
+)";
+
 const char* detect_key_description = R"(
   Computes key estimate given normalized samples.
 
@@ -383,7 +421,492 @@ const char* detect_key_description = R"(
       Examples: BlackmanHarris92dB, BlackmanHarris62dB... Defaults to BlackmanHarris62dB.
     max_num_peaks (int, optional): Maximum number of returned peaks (set to 0 to return all peaks) for spectral peaks. Defaults to 100.
     window_size (float, optional): Size, in semitones, of the window used for the weighting for HPCP. Defaults to 0.5.
+    convergence_frames (int, optional): Stop analyzing once the key estimate has been stable for this many frames. 0 analyzes
+      the whole signal. Defaults to 0.
+    estimate_interval (int, optional): Number of frames between two convergence checks in adaptive mode. Defaults to 32.
+    convergence_tolerance (float, optional): Maximum change of first_to_second_relative_strength for the estimate to still
+      count as stable. Defaults to 0.05.
+    frame_sampling (str, optional): Which frames to analyze, either 'all', 'stride' (every frame_stride-th frame), 'even'
+      (num_sampled_frames evenly spaced frames) or 'random' (num_sampled_frames random frames). The samples are
+      already decoded, the sampling only saves the analysis of the other frames. Defaults to 'all'.
+    frame_stride (int, optional): Distance between two analyzed frames when frame_sampling is 'stride'. Defaults to 1.
+    num_sampled_frames (int, optional): Number of analyzed frames when frame_sampling is 'even' or 'random'. Defaults to 0.
+    sampling_seed (int, optional): Seed of the random frame selection when frame_sampling is 'random'. Defaults to 0.
+    rms_threshold (float, optional): Frames whose root mean square is below this value are skipped before windowing and FFT.
+      0 disables the gate. Defaults to 0.0.
+    analysis_sample_rate (float, optional): Sampling rate to analyze the signal at [Hz]. When it is below sample_rate,
+      the mixdown is resampled to it and frame_size and hop_size are scaled by the same ratio, which makes the analysis
+      proportionally cheaper. 22050 keeps every frequency the HPCP uses, 11025 attenuates its last few semitones. 0
+      analyzes the signal at sample_rate. Defaults to 0.0.
+
+  Returns:
+    DetectKeyOutput: Details of key estimate, plus frames_analyzed, frames_skipped, seconds_analyzed, analyzed_ratio
+      and stats (see set_stats_enabled).
+)";
+
+const char* analyze_key_description = R"(
+  Variant of detect_key that also returns what the key was estimated from.
+
+  Storing 'average_hpcp' is enough to re-estimate the key later (see estimate_key and estimate_keys) without running
+  the spectral analysis again. The arguments are the same as detect_key.
+
+  Returns:
+    dict: Everything detect_key returns, plus:
+      average_hpcp (numpy.ndarray): Average of the HPCPs of the analyzed frames.
+      major_correlations, minor_correlations, other_correlations (numpy.ndarray): Correlation of the averaged HPCP with
+        every shift of the major, minor and majmin profiles (other_correlations is empty unless use_maj_min is True).
+      key_scores (numpy.ndarray): Best correlation of each of the 24 keys, the 12 major keys followed by the 12 minor
+        keys, in the order A, Bb, B, C, C#, D, Eb, E, F, F#, G, Ab.
+)";
+
+const char* chromagram_description = R"(
+  Computes the HPCP of every frame of the audio, with the same analysis as detect_key.
+
+  Averaging the rows of the chromagram (with aggregation_frames = 1) gives the averaged HPCP detect_key estimates the
+  key from.
+
+  Args:
+    normalized_samples (List[List[float]]): Normalized samples from a decoded file.
+    sample_rate (float, optional): Sampling rate of the audio signal [Hz]. Defaults to 44100.0.
+    pcp_size (int, optional): Size of the HPCPs, a multiple of 12. Defaults to 36.
+    harmonics (int, optional): Number of harmonics for frequency contribution, 0 indicates exclusive fundamental
+      frequency contribution. Defaults to 3.
+    frame_size (int, optional): Output frame size. Defaults to 4096.
+    hop_size (int, optional): Hop size between frames. Defaults to 512.
+    window_type_func (function, optional): The window type function. Defaults to musher.blackmanharris62dB.
+    max_num_peaks (int, optional): Maximum number of returned peaks (set to 0 to return all peaks). Defaults to 100.
+    window_size (float, optional): Size, in semitones, of the window used for the weighting. Defaults to 0.5.
+    aggregation_frames (int, optional): Number of consecutive frames combined into one row. Defaults to 1.
+    aggregation_type (str, optional): How the frames of a row are combined, either 'mean' or 'max'. Defaults to 'mean'.
+
+  Returns:
+    dict: A dictionary containing:
+      chromagram (numpy.ndarray): Array of shape (rows, pcp_size), one HPCP per row. It shares its memory with the C++
+        result, no copy is made.
+      timestamps (numpy.ndarray): Time of the center of each row [s].
+)";
+
+const char* constant_q_chromagram_description = R"(
+  Computes the constant-Q pitch class profile of every frame of the audio.
+
+  The constant-Q transform uses a sparse spectral kernel applied to one FFT per octave and hop, the lower octaves being
+  analyzed on the audio decimated by 2 per octave. Its bins resolve neighbouring semitones down to min_frequency,
+  unlike the spectral peaks of the HPCP. Pitch class 0 is A, like the HPCP.
+
+  Args:
+    normalized_samples (List[List[float]]): Normalized samples from a decoded file.
+    sample_rate (float, optional): Sampling rate of the audio signal [Hz]. Defaults to 44100.0.
+    pcp_size (int, optional): Number of bins per octave and size of the profiles, a multiple of 12. Defaults to 36.
+    hop_size (int, optional): Hop size between frames, the first frame is centered at the beginning. Defaults to 512.
+    min_frequency (float, optional): Frequency of the lowest bin [Hz]. Defaults to 55.0.
+    num_octaves (int, optional): Number of octaves, the highest must end below 0.4 * sample_rate. Defaults to 6.
+
+  Returns:
+    dict: A dictionary containing:
+      chromagram (numpy.ndarray): Array of shape (frames, pcp_size), one profile per row, normalized to a maximum of 1.
+      timestamps (numpy.ndarray): Time of the center of each frame [s].
+)";
+
+const char* detect_key_constant_q_description = R"(
+  Computes key estimate given normalized samples, from the average of constant_q_chromagram instead of the HPCPs.
+
+  Args:
+    normalized_samples (List[List[float]]): Normalized samples from a decoded file.
+    sample_rate (float, optional): Sampling rate of the audio signal [Hz]. Defaults to 44100.0.
+    profile_type (str, optional): The type of polyphic profile to use for correlation calculation. Defaults to 'Bgate'.
+    use_polphony (bool, optional): Enables the use of polyphonic profiles to define key profiles. Defaults to True.
+    use_three_chords (bool, optional): Consider only the 3 main triad chords of the key (T, D, SD) to build the
+      polyphonic profiles. Defaults to True.
+    num_harmonics (int, optional): Number of harmonics that should contribute to the polyphonic profile. Defaults to 4.
+    slope (float, optional): Value of the slope of the exponential harmonic contribution to the polyphonic profile.
+      Defaults to 0.6.
+    use_maj_min (bool, optional): Use a third profile called 'majmin' for ambiguous tracks. Defaults to False.
+    pcp_size (int, optional): Number of bins per octave and size of the profiles, a multiple of 12. Defaults to 36.
+    hop_size (int, optional): Hop size between frames. Defaults to 512.
+    min_frequency (float, optional): Frequency of the lowest bin [Hz]. Defaults to 55.0.
+    num_octaves (int, optional): Number of octaves. Defaults to 6.
+
+  Returns:
+    DetectKeyOutput: Details of key estimate, see detect_key.
+)";
+
+const char* bpm_detection_description = R"(
+  Calculates the BPM (Beats per minute) of audio samples.
+
+  The onsets are tracked with 4 levels of Daubechies-4 discrete wavelet transform, then the highest peak of the
+  autocorrelation of their envelope between 40 and 220 BPM gives the beat period.
+
+  Args:
+    samples (List[float]): Mono audio signal.
+    sample_rate (float): Sampling rate of the audio signal [Hz].
+
+  Returns:
+    float: BPM, 0.0 for silence or when no beat period is found.
+)";
+
+const char* bpm_over_window_description = R"(
+  Calculates the BPM (Beats per minute) of normalized samples over windows.
+
+  The samples are sliced into windows, the BPM of every window is calculated with bpm_detection on num_threads threads
+  and the median of the windows without silence is rounded to the nearest integer.
+
+  Args:
+    normalized_samples (List[List[float]]): Normalized samples from a decoded file.
+    sample_rate (float): Sampling rate of the audio signal [Hz].
+    window_seconds (float, optional): Size of the windows [s], typically less than 10 seconds. Defaults to 3.0.
+    num_threads (int, optional): Number of threads, 0 uses one per hardware thread. Defaults to 0.
+
+  Returns:
+    float: Median BPM over windows, 0.0 if the signal is shorter than a window or silent.
+)";
+
+const char* detect_key_changes_description = R"(
+  Detects the keys of a piece that modulates, along with when they change.
+
+  Every segment_frames frames of the chromagram are averaged and scored against the 24 keys, then the most likely
+  sequence of keys is found with the Viterbi algorithm. Each key change costs transition_cost, so higher values give
+  fewer, longer segments.
+
+  Args:
+    normalized_samples (List[List[float]]): Normalized samples from a decoded file.
+    sample_rate (float, optional): Sampling rate of the audio signal [Hz]. Defaults to 44100.0.
+    segment_frames (int, optional): Number of frames averaged into each scored segment. Defaults to 128.
+    transition_cost (float, optional): Cost of any key change, 0 picks the best key of every segment independently.
+      Defaults to 1.0.
+    The other arguments are the same as detect_key.
+
+  Returns:
+    List[dict]: Consecutive segments of constant key, each containing:
+      start_time (float): Start of the segment [s].
+      end_time (float): End of the segment [s].
+      key (str): Key of the segment.
+      scale (str): Scale of the segment.
+      strength (float): Mean correlation of the key with the segment.
+)";
+
+const char* detect_key_ensemble_description = R"(
+  Computes the key estimate of several key profiles in a single pass over the audio.
+
+  The HPCP of every frame is computed and averaged once, then every profile is correlated with the same average.
+  This is much cheaper than calling detect_key once per profile.
+
+  Args:
+    normalized_samples (List[List[float]]): Normalized samples from a decoded file.
+    sample_rate (float, optional): Sampling rate of the audio signal [Hz]. Defaults to 44100.0.
+    profile_types (List[str], optional): Profile types to evaluate. An empty list evaluates all of them
+      (see key_profile_types). Defaults to [].
+    vote_type (str, optional): How the estimates are combined, either 'majority' (one vote per profile, ties decided by the
+      summed strength), 'weighted' (each profile votes with its strength) or 'none'. Defaults to 'majority'.
+    The other arguments are the same as detect_key and are shared by every profile.
+
+  Returns:
+    dict: 'key_outputs' maps each profile type to its KeyOutput, 'dropped_profile_types' lists the profiles that could
+      not estimate a key from this audio (e.g. 'Weichai' when the best match is minor) and did not vote, 'vote' is the
+      KeyOutput of the vote (None if vote_type is 'none'), 'frames_analyzed' and 'frames_skipped' count the frames of
+      the averaged HPCP.
+
+  Examples:
+    >>> ensemble = musher.detect_key_ensemble(normalized_samples, sample_rate, ["Temperley", "Krumhansl", "Bgate"])
+    >>> ensemble["vote"]["key"], ensemble["vote"]["scale"]
+    ('C', 'major')
+)";
+
+const char* detect_key_file_description = R"(
+  Detects the key of an audio file while keeping the memory of the analysis under a budget.
+
+  The file is decoded fully when its decoded samples fit in the budget. Larger files are decoded and analyzed block by
+  block, so that only one block of samples is in memory at a time. Both give the same key estimate as decoding the
+  file and calling detect_key with the default arguments. The GIL is released during the analysis.
+
+  Args:
+    file_path (str): Path of a .wav or .mp3 file.
+    profile_type (str, optional): The type of polyphic profile to use for correlation calculation. Defaults to "Bgate".
+    max_memory_bytes (int, optional): Memory budget of the decoded samples and the analysis. 0 always decodes the
+      whole file. Defaults to 0.
+
+  Returns:
+    DetectKeyOutput: Key estimate, its stats include the decoding of the file.
+
+  Examples:
+    >>> key_output = musher.detect_key_file("concert.wav", "Temperley", max_memory_bytes=256 * 1024 * 1024)
+)";
+
+const char* detect_key_files_description = R"(
+  Detects the key of every audio file of a list with a pool of threads.
+
+  Each thread takes the next file, decodes it and analyzes it, so the results are the same as decoding every file and
+  calling detect_key with the default arguments. The GIL is released during the analysis.
+
+  Args:
+    file_paths (List[str]): Paths of .wav or .mp3 files.
+    profile_type (str, optional): The type of polyphic profile to use for correlation calculation. Defaults to "Bgate".
+    num_threads (int, optional): Number of threads. 0 uses every hardware thread. Defaults to 0.
+    max_memory_bytes (int, optional): Memory budget of each file, see detect_key_file. 0 always decodes the whole
+      files. Defaults to 0.
+
+  Returns:
+    List[DetectKeyOutput]: Key estimate of each file, in the order of file_paths.
+
+  Examples:
+    >>> musher.start_trace("trace.json")
+    >>> key_outputs = musher.detect_key_files(file_paths, "Temperley", num_threads=4)
+    >>> musher.stop_trace()
+)";
+
+const char* key_profile_types_description = R"(
+  Names of all the key profile types.
+
+  Returns:
+    List[str]: Profile types accepted by profile_type.
+)";
+
+const char* simd_level_description = R"(
+  Instruction set level the hot kernels are currently dispatched to.
+
+  Every level gives bit-identical results, only the speed differs.
+
+  Returns:
+    str: 'scalar', 'sse2', 'avx2' or 'avx512'.
+)";
+
+const char* detected_simd_level_description = R"(
+  Highest instruction set level supported by this CPU.
+
+  Returns:
+    str: 'scalar', 'sse2', 'avx2' or 'avx512'.
+)";
+
+const char* set_simd_level_description = R"(
+  Force the hot kernels to an instruction set level, for example to compare against the scalar reference.
+
+  The environment variable MUSHER_SIMD_LEVEL sets the default level when the module is first used.
+
+  Args:
+    level (str): 'scalar', 'sse2', 'avx2' or 'avx512'. Must not be above detected_simd_level().
+)";
+
+const char* reset_simd_level_description = R"(
+  Go back to the default instruction set level, the detected one or MUSHER_SIMD_LEVEL when it is set.
+)";
+
+const char* backend_description = R"(
+  Implementation the frame analysis stages and the key profile correlation currently run with.
+
+  Returns:
+    str: 'optimized', 'reference' or 'cross_check'.
+)";
+
+const char* set_backend_description = R"(
+  Run the analysis with the optimized implementations, the scalar reference implementations, or both.
+
+  In 'cross_check' mode every frame and every key estimate is computed by both backends, the optimized results are
+  returned and the largest deviation of each stage is recorded, see cross_check_report(). The environment variable
+  MUSHER_BACKEND sets the default backend when the module is first used.
+
+  Args:
+    backend (str): 'optimized', 'reference' or 'cross_check'.
+)";
+
+const char* reset_backend_description = R"(
+  Go back to the default backend, 'optimized' or MUSHER_BACKEND when it is set.
+)";
+
+const char* cross_check_report_description = R"(
+  Largest deviations between the optimized and the reference backend recorded in 'cross_check' mode.
+
+  The deviation of a stage is max|optimized - reference| / max|reference| over its output, the maximum over all the
+  checked frames is kept.
+
+  Returns:
+    dict: {
+      'frames_checked': int,
+      'estimates_checked': int,
+      'windowing_deviation': float,
+      'spectrum_deviation': float,
+      'spectral_peaks_deviation': float,
+      'hpcp_deviation': float,
+      'key_correlation_deviation': float
+    }
+)";
+
+const char* reset_cross_check_report_description = R"(
+  Clear the deviations recorded in 'cross_check' mode.
+)";
+
+const char* stats_enabled_description = R"(
+  Whether the time spent in each stage and the counters of the analysis are recorded.
+
+  Returns:
+    bool: True if enabled.
+)";
+
+const char* set_stats_enabled_description = R"(
+  Record the time spent in each stage and the counters of the analysis. Disabled by default, the instrumentation then
+  costs next to nothing.
+
+  When enabled, the outputs of detect_key and analyze_key have a 'stats' dict with the stages of that call, see
+  pipeline_stats() for its keys. The decoding is recorded by pipeline_stats() only.
+
+  Args:
+    enabled (bool): Whether to record the stats.
+)";
+
+const char* pipeline_stats_description = R"(
+  Stats accumulated by the calling thread since the last reset_pipeline_stats().
+
+  The time of a stage that calls another one goes to the outer stage only, so the stages never overlap. The peaks are
+  the largest number of bytes the buffers of a stage held at once: the file data, the decoded channels with the
+  buffers of the decoder, the mono mixdown, the frames, and the windowed frame, spectrum, peaks and HPCP of a frame.
+
+  Returns:
+    dict: {
+      'decode_seconds': float,
+      'mix_seconds': float,
+      'resample_seconds': float,
+      'frame_seconds': float,
+      'window_seconds': float,
+      'fft_seconds': float,
+      'peaks_seconds': float,
+      'hpcp_seconds': float,
+      'estimate_seconds': float,
+      'frames_processed': int,
+      'frames_skipped': int,
+      'peaks_found': int,
+      'bytes_decoded': int,
+      'peak_file_bytes': int,
+      'peak_decoded_bytes': int,
+      'peak_mono_bytes': int,
+      'peak_frame_bytes': int,
+      'peak_spectrum_bytes': int
+    }
+)";
+
+const char* reset_pipeline_stats_description = R"(
+  Clear the stats of the calling thread.
+)";
+
+const char* start_trace_description = R"(
+  Start recording trace events, written to a Chrome trace-event JSON file by stop_trace().
+
+  The file can be opened in chrome://tracing or https://ui.perfetto.dev. It has a span for each decoded file, each
+  chunk of 64 analyzed frames, each key estimate and each wait of detect_key_files for the next file, tagged with the
+  thread it ran on.
+
+  Args:
+    file_path (str): Path of the JSON file to write.
+)";
+
+const char* stop_trace_description = R"(
+  Stop recording and write the trace events. Does nothing if no trace was started.
+)";
+
+const char* trace_enabled_description = R"(
+  Whether trace events are recorded.
+
+  Returns:
+    bool: True between start_trace() and stop_trace().
+)";
+
+const char* key_tracker_description = R"(
+  Incremental key estimator that keeps a running HPCP accumulator.
+
+  Frames are cut exactly like Framecutter with start_from_center=True, so streaming a whole signal through
+  add_samples followed by flush gives the same result as detect_key.
+
+  Examples:
+    Show a provisional key while the audio is still arriving:
+
+    >>> key_tracker = musher.KeyTracker(sample_rate=44100.)
+    >>> for block in blocks:
+    ...    key_tracker.add_samples(block)
+    ...    print(key_tracker.estimate())
+    ...
+    >>> key_tracker.flush()
+    >>> key_tracker.estimate()
+    {'key': 'C', 'scale': 'major', 'strength': 0.760328, 'first_to_second_relative_strength': 0.608866}
+)";
+
+const char* key_tracker_init_description = R"(
+  Construct a new KeyTracker object
+
+  Args:
+    sample_rate (float, optional): Sampling rate of the audio signal [Hz]. Defaults to 44100.0.
+    profile_type (str, optional): The type of polyphic profile to use for correlation calculation. Defaults to 'Bgate'.
+    use_polphony (bool, optional): Enables the use of polyphonic profiles to define key profiles (this includes the contributions
+      from triads as well as pitch harmonics). Defaults to True.
+    use_three_chords (bool, optional): Consider only the 3 main triad chords of the key (T, D, SD) to build the polyphonic profiles. Defaults to True.
+    num_harmonics (int, optional): Number of harmonics that should contribute to the polyphonic profile (1 only considers the
+      fundamental harmonic). Defaults to 4.
+    slope (float, optional): Value of the slope of the exponential harmonic contribution to the polyphonic profile. Defaults to 0.6.
+    use_maj_min (bool, optional): Use a third profile called 'majmin' for ambiguous tracks. Only available for the edma, bgate
+      and braw profiles. Defaults to False.
+    pcp_size (int, optional): Number of array elements used to represent a semitone times 12. Defaults to 36.
+    frame_size (int, optional): Output frame size. Defaults to 4096.
+    hop_size (int, optional): Hop size between frames. Defaults to 512.
+    window_type_func (Callable[[List[float]], List[float]], optional): The window type function.
+      Examples: BlackmanHarris92dB, BlackmanHarris62dB... Defaults to BlackmanHarris62dB.
+    max_num_peaks (int, optional): Maximum number of returned peaks (set to 0 to return all peaks) for spectral peaks. Defaults to 100.
+    window_size (float, optional): Size, in semitones, of the window used for the weighting for HPCP. Defaults to 0.5.
+    rms_threshold (float, optional): Frames whose root mean square is below this value are skipped before any spectral
+      analysis. 0 keeps every frame. Defaults to 0.0.
+)";
+
+const char* key_tracker_add_samples_description = R"(
+  Add a block of samples, either mono (List[float]) or normalized mono/stereo samples (List[List[float]]).
+
+  Every frame that is completely covered by the samples received so far is analyzed immediately.
+)";
+
+const char* key_tracker_flush_description = R"(
+  Analyze the samples that are still pending as zero-padded trailing frames. Call this once the end of the signal
+  has been reached.
+)";
+
+const char* key_tracker_add_frame_description = R"(
+  Analyze a single frame and add its HPCP to the running accumulator.
+)";
+
+const char* key_tracker_add_hpcp_description = R"(
+  Add an already computed HPCP of size pcp_size to the running accumulator.
+)";
+
+const char* key_tracker_estimate_description = R"(
+  Computes the key estimate of everything accumulated so far.
 
   Returns:
     KeyOutput: Details of key estimate.
 )";
+
+const char* key_tracker_average_hpcp_description = R"(
+  Average of all the HPCPs accumulated so far.
+
+  Returns:
+    numpy.ndarray[numpy.float64]: Averaged harmonic pitch class profile.
+)";
+
+const char* key_detector_description = R"(
+  Reusable key detector that owns every table and work buffer of the analysis.
+
+  The window, FFT plan, HPCP plan and key profiles are set up once when the detector is constructed, so analyzing
+  a frame does not allocate any memory. Takes the same arguments as KeyTracker and gives the same results as
+  detect_key.
+
+  Examples:
+    Detect the key of many files with the same settings:
+
+    >>> key_detector = musher.KeyDetector(sample_rate=44100., profile_type="Temperley")
+    >>> for file_path in file_paths:
+    ...    wav_decoded = musher.decode_wav_from_file(file_path)
+    ...    print(key_detector.detect(wav_decoded["normalized_samples"]))
+)";
+
+const char* key_detector_detect_description = R"(
+  Detects the key of a whole signal. The accumulator is reset first.
+
+  Args:
+    normalized_samples (List[List[float]]): Normalized samples, either stereo or mono.
+
+  Returns:
+    DetectKeyOutput: Details of key estimate, plus frames_analyzed, frames_skipped, seconds_analyzed, analyzed_ratio
+      and stats (see set_stats_enabled).
+)";
@@ -72,5 +72,104 @@ py::dict ConvertKeyOutputToPyDict(KeyOutput key_output) {
   return key_output_dict;
 }
 
+py::dict ConvertDetectKeyOutputToPyDict(DetectKeyOutput detect_key_output) {
+  py::dict detect_key_output_dict = ConvertKeyOutputToPyDict(detect_key_output);
+  detect_key_output_dict["frames_analyzed"] = detect_key_output.frames_analyzed;
+  detect_key_output_dict["frames_skipped"] = detect_key_output.frames_skipped;
+  detect_key_output_dict["seconds_analyzed"] = detect_key_output.seconds_analyzed;
+  detect_key_output_dict["analyzed_ratio"] = detect_key_output.analyzed_ratio;
+  detect_key_output_dict["stats"] = ConvertPipelineStatsToPyDict(detect_key_output.stats);
+  return detect_key_output_dict;
+}
+
+py::dict ConvertKeyAnalysisToPyDict(KeyAnalysis key_analysis) {
+  py::dict key_analysis_dict = ConvertDetectKeyOutputToPyDict(key_analysis);
+  key_analysis_dict["average_hpcp"] = ConvertSequenceToPyarray(key_analysis.average_hpcp);
+  key_analysis_dict["major_correlations"] = ConvertSequenceToPyarray(key_analysis.correlations.major);
+  key_analysis_dict["minor_correlations"] = ConvertSequenceToPyarray(key_analysis.correlations.minor);
+  key_analysis_dict["other_correlations"] = ConvertSequenceToPyarray(key_analysis.correlations.other);
+  key_analysis_dict["key_scores"] = ConvertSequenceToPyarray(key_analysis.key_scores);
+  return key_analysis_dict;
+}
+
+py::dict ConvertChromagramToPyDict(Chromagram chromagram) {
+  py::dict chromagram_dict;
+  chromagram_dict["chromagram"] = ConvertSequenceToPyarray2D(chromagram.hpcps, static_cast<size_t>(chromagram.num_frames),
+                                                             static_cast<size_t>(chromagram.pcp_size));
+  chromagram_dict["timestamps"] = ConvertSequenceToPyarray(chromagram.timestamps);
+  return chromagram_dict;
+}
+
+py::list ConvertKeySegmentsToPyList(const std::vector<KeySegment>& key_segments) {
+  py::list key_segments_list;
+  for (const KeySegment& key_segment : key_segments) {
+    py::dict key_segment_dict;
+    key_segment_dict["start_time"] = key_segment.start_time;
+    key_segment_dict["end_time"] = key_segment.end_time;
+    key_segment_dict["key"] = key_segment.key;
+    key_segment_dict["scale"] = key_segment.scale;
+    key_segment_dict["strength"] = key_segment.strength;
+    key_segments_list.append(key_segment_dict);
+  }
+  return key_segments_list;
+}
+
+py::dict ConvertEnsembleKeyOutputToPyDict(EnsembleKeyOutput ensemble_key_output) {
+  py::dict key_outputs_dict;
+  for (size_t i = 0; i < ensemble_key_output.profile_types.size(); i++) {
+    key_outputs_dict[py::str(ensemble_key_output.profile_types[i])] =
+        ConvertKeyOutputToPyDict(ensemble_key_output.key_outputs[i]);
+  }
+
+  py::dict ensemble_key_output_dict;
+  ensemble_key_output_dict["key_outputs"] = key_outputs_dict;
+  py::list dropped_profile_types_list;
+  for (const std::string& profile_type : ensemble_key_output.dropped_profile_types)
+    dropped_profile_types_list.append(py::str(profile_type));
+  ensemble_key_output_dict["dropped_profile_types"] = dropped_profile_types_list;
+  if (ensemble_key_output.vote.key.empty())
+    ensemble_key_output_dict["vote"] = py::none();
+  else
+    ensemble_key_output_dict["vote"] = ConvertKeyOutputToPyDict(ensemble_key_output.vote);
+  ensemble_key_output_dict["frames_analyzed"] = ensemble_key_output.frames_analyzed;
+  ensemble_key_output_dict["frames_skipped"] = ensemble_key_output.frames_skipped;
+  return ensemble_key_output_dict;
+}
+
+py::dict ConvertCrossCheckReportToPyDict(CrossCheckReport cross_check_report) {
+  py::dict cross_check_report_dict;
+  cross_check_report_dict["frames_checked"] = cross_check_report.frames_checked;
+  cross_check_report_dict["estimates_checked"] = cross_check_report.estimates_checked;
+  cross_check_report_dict["windowing_deviation"] = cross_check_report.windowing_deviation;
+  cross_check_report_dict["spectrum_deviation"] = cross_check_report.spectrum_deviation;
+  cross_check_report_dict["spectral_peaks_deviation"] = cross_check_report.spectral_peaks_deviation;
+  cross_check_report_dict["hpcp_deviation"] = cross_check_report.hpcp_deviation;
+  cross_check_report_dict["key_correlation_deviation"] = cross_check_report.key_correlation_deviation;
+  return cross_check_report_dict;
+}
+
+py::dict ConvertPipelineStatsToPyDict(PipelineStats pipeline_stats) {
+  py::dict pipeline_stats_dict;
+  pipeline_stats_dict["decode_seconds"] = pipeline_stats.decode_seconds;
+  pipeline_stats_dict["mix_seconds"] = pipeline_stats.mix_seconds;
+  pipeline_stats_dict["resample_seconds"] = pipeline_stats.resample_seconds;
+  pipeline_stats_dict["frame_seconds"] = pipeline_stats.frame_seconds;
+  pipeline_stats_dict["window_seconds"] = pipeline_stats.window_seconds;
+  pipeline_stats_dict["fft_seconds"] = pipeline_stats.fft_seconds;
+  pipeline_stats_dict["peaks_seconds"] = pipeline_stats.peaks_seconds;
+  pipeline_stats_dict["hpcp_seconds"] = pipeline_stats.hpcp_seconds;
+  pipeline_stats_dict["estimate_seconds"] = pipeline_stats.estimate_seconds;
+  pipeline_stats_dict["frames_processed"] = pipeline_stats.frames_processed;
+  pipeline_stats_dict["frames_skipped"] = pipeline_stats.frames_skipped;
+  pipeline_stats_dict["peaks_found"] = pipeline_stats.peaks_found;
+  pipeline_stats_dict["bytes_decoded"] = pipeline_stats.bytes_decoded;
+  pipeline_stats_dict["peak_file_bytes"] = pipeline_stats.peak_file_bytes;
+  pipeline_stats_dict["peak_decoded_bytes"] = pipeline_stats.peak_decoded_bytes;
+  pipeline_stats_dict["peak_mono_bytes"] = pipeline_stats.peak_mono_bytes;
+  pipeline_stats_dict["peak_frame_bytes"] = pipeline_stats.peak_frame_bytes;
+  pipeline_stats_dict["peak_spectrum_bytes"] = pipeline_stats.peak_spectrum_bytes;
+  return pipeline_stats_dict;
+}
+
 }  // namespace python
 }  // namespace musher
\ No newline at end of file
@@ -3,7 +3,11 @@
 #include <pybind11/numpy.h>
 
 #include "src/core/audio_decoders.h"
+#include "src/core/backend.h"
+#include "src/core/chromagram.h"
 #include "src/core/key.h"
+#include "src/core/key_changes.h"
+#include "src/core/pipeline_stats.h"
 
 using namespace musher::core;
 namespace py = pybind11;
@@ -29,9 +33,37 @@ py::array_t<typename Sequence::value_type> ConvertSequenceToPyarray(Sequence& se
     );
 }
 
+/**
+ * @brief Convert a contiguous row-major sequence to a 2-D numpy array WITHOUT copying.
+ *
+ * @tparam Sequence
+ * @param seq A sequence holding rows * cols elements.
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @return py::array_t<typename Sequence::value_type> 2-D numpy array of shape (rows, cols).
+ */
+template <typename Sequence>
+py::array_t<typename Sequence::value_type> ConvertSequenceToPyarray2D(Sequence& seq, size_t rows, size_t cols) {
+    using value_type = typename Sequence::value_type;
+    Sequence* seq_ptr = new Sequence(std::move(seq));
+    auto capsule = py::capsule(seq_ptr, [](void* p) { delete reinterpret_cast<Sequence*>(p); });
+    return py::array_t<value_type>({rows, cols},                                       // shape of array
+                                   {cols * sizeof(value_type), sizeof(value_type)},  // c-style row-major strides
+                                   seq_ptr->data(),                                  // data of the sequence
+                                   capsule  // numpy array references this parent
+    );
+}
+
 py::dict ConvertWavDecodedToPyDict(WavDecoded wav_decoded);
 py::dict ConvertMp3DecodedToPyDict(Mp3Decoded mp3_decoded);
 py::dict ConvertKeyOutputToPyDict(KeyOutput key_output);
+py::dict ConvertDetectKeyOutputToPyDict(DetectKeyOutput detect_key_output);
+py::dict ConvertEnsembleKeyOutputToPyDict(EnsembleKeyOutput ensemble_key_output);
+py::dict ConvertKeyAnalysisToPyDict(KeyAnalysis key_analysis);
+py::dict ConvertChromagramToPyDict(Chromagram chromagram);
+py::list ConvertKeySegmentsToPyList(const std::vector<KeySegment>& key_segments);
+py::dict ConvertCrossCheckReportToPyDict(CrossCheckReport cross_check_report);
+py::dict ConvertPipelineStatsToPyDict(PipelineStats pipeline_stats);
 
 }  // namespace python
 }  // namespace musher
@@ -3,9 +3,14 @@
 #include <pybind11/numpy.h>
 
 #include "src/core/audio_decoders.h"
+#include "src/core/chromagram.h"
+#include "src/core/constant_q.h"
+#include "src/core/key_changes.h"
+#include "src/core/key_files.h"
 #include "src/core/hpcp.h"
 #include "src/core/mono_mixer.h"
 #include "src/core/peak_detect.h"
+#include "src/core/resampler.h"
 #include "src/core/spectral_peaks.h"
 #include "src/core/spectrum.h"
 #include "src/core/windowing.h"
@@ -42,6 +47,14 @@ py::array_t<double> _MonoMixer(const std::vector<std::vector<double>>& normalize
   return ConvertSequenceToPyarray(mixed_audio);
 }
 
+py::array_t<double> _Resample(const std::vector<double>& signal,
+                              double input_sample_rate,
+                              double output_sample_rate,
+                              const std::string quality) {
+  std::vector<double> resampled = Resample(signal, input_sample_rate, output_sample_rate, quality);
+  return ConvertSequenceToPyarray(resampled);
+}
+
 py::array_t<double> _Windowing(const std::vector<double>& audio_frame,
                                const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
                                unsigned int zero_padding_size,
@@ -154,6 +167,21 @@ py::dict _EstimateKey(const std::vector<double>& pcp,
   return ConvertKeyOutputToPyDict(key_output);
 }
 
+py::list _EstimateKeys(const std::vector<std::vector<double>>& pcps,
+                       const bool use_polphony,
+                       const bool use_three_chords,
+                       const unsigned int num_harmonics,
+                       const double slope,
+                       const std::string profile_type,
+                       const bool use_maj_min) {
+  std::vector<KeyOutput> key_outputs =
+      EstimateKeys(pcps, use_polphony, use_three_chords, num_harmonics, slope, profile_type, use_maj_min);
+
+  py::list key_output_list;
+  for (const KeyOutput& key_output : key_outputs) key_output_list.append(ConvertKeyOutputToPyDict(key_output));
+  return key_output_list;
+}
+
 py::dict _DetectKey(const std::vector<std::vector<double>>& normalized_samples,
                     double sample_rate,
                     const std::string profile_type,
@@ -167,11 +195,251 @@ py::dict _DetectKey(const std::vector<std::vector<double>>& normalized_samples,
                     const int hop_size,
                     const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
                     unsigned int max_num_peaks,
-                    double window_size) {
-  KeyOutput key_output =
-      DetectKey(normalized_samples, sample_rate, profile_type, use_polphony, use_three_chords, num_harmonics, slope,
-                use_maj_min, pcp_size, frame_size, hop_size, window_type_func, max_num_peaks, window_size);
-  return ConvertKeyOutputToPyDict(key_output);
+                    double window_size,
+                    unsigned int convergence_frames,
+                    unsigned int estimate_interval,
+                    double convergence_tolerance,
+                    const std::string frame_sampling,
+                    unsigned int frame_stride,
+                    unsigned int num_sampled_frames,
+                    unsigned int sampling_seed,
+                    double rms_threshold,
+                    double analysis_sample_rate) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.frame_size = frame_size;
+  options.hop_size = hop_size;
+  options.window_type_func = window_type_func;
+  options.max_num_peaks = max_num_peaks;
+  options.window_size = window_size;
+  options.convergence_frames = convergence_frames;
+  options.estimate_interval = estimate_interval;
+  options.convergence_tolerance = convergence_tolerance;
+  options.frame_sampling = frame_sampling;
+  options.frame_stride = frame_stride;
+  options.num_sampled_frames = num_sampled_frames;
+  options.sampling_seed = sampling_seed;
+  options.rms_threshold = rms_threshold;
+  options.analysis_sample_rate = analysis_sample_rate;
+  DetectKeyOutput detect_key_output = DetectKey(normalized_samples, sample_rate, options);
+  return ConvertDetectKeyOutputToPyDict(detect_key_output);
+}
+
+py::dict _AnalyzeKey(const std::vector<std::vector<double>>& normalized_samples,
+                     double sample_rate,
+                     const std::string profile_type,
+                     const bool use_polphony,
+                     const bool use_three_chords,
+                     const unsigned int num_harmonics,
+                     const double slope,
+                     const bool use_maj_min,
+                     const unsigned int pcp_size,
+                     const int frame_size,
+                     const int hop_size,
+                     const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                     unsigned int max_num_peaks,
+                     double window_size,
+                     unsigned int convergence_frames,
+                     unsigned int estimate_interval,
+                     double convergence_tolerance,
+                     const std::string frame_sampling,
+                     unsigned int frame_stride,
+                     unsigned int num_sampled_frames,
+                     unsigned int sampling_seed,
+                     double rms_threshold,
+                     double analysis_sample_rate) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.frame_size = frame_size;
+  options.hop_size = hop_size;
+  options.window_type_func = window_type_func;
+  options.max_num_peaks = max_num_peaks;
+  options.window_size = window_size;
+  options.convergence_frames = convergence_frames;
+  options.estimate_interval = estimate_interval;
+  options.convergence_tolerance = convergence_tolerance;
+  options.frame_sampling = frame_sampling;
+  options.frame_stride = frame_stride;
+  options.num_sampled_frames = num_sampled_frames;
+  options.sampling_seed = sampling_seed;
+  options.rms_threshold = rms_threshold;
+  options.analysis_sample_rate = analysis_sample_rate;
+  KeyAnalysis key_analysis = AnalyzeKey(normalized_samples, sample_rate, options);
+  return ConvertKeyAnalysisToPyDict(key_analysis);
+}
+
+py::dict _Chromagram(const std::vector<std::vector<double>>& normalized_samples,
+                     double sample_rate,
+                     unsigned int pcp_size,
+                     unsigned int harmonics,
+                     const int frame_size,
+                     const int hop_size,
+                     const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                     unsigned int max_num_peaks,
+                     double window_size,
+                     unsigned int aggregation_frames,
+                     const std::string aggregation_type) {
+  Chromagram chromagram = ComputeChromagram(normalized_samples, sample_rate, pcp_size, harmonics, frame_size, hop_size,
+                                            window_type_func, max_num_peaks, window_size, aggregation_frames,
+                                            aggregation_type);
+  return ConvertChromagramToPyDict(chromagram);
+}
+
+py::dict _ConstantQChromagram(const std::vector<std::vector<double>>& normalized_samples,
+                              double sample_rate,
+                              unsigned int pcp_size,
+                              const int hop_size,
+                              double min_frequency,
+                              unsigned int num_octaves) {
+  Chromagram chromagram =
+      ComputeConstantQChromagram(normalized_samples, sample_rate, pcp_size, hop_size, min_frequency, num_octaves);
+  return ConvertChromagramToPyDict(chromagram);
+}
+
+py::dict _DetectKeyConstantQ(const std::vector<std::vector<double>>& normalized_samples,
+                             double sample_rate,
+                             const std::string profile_type,
+                             const bool use_polphony,
+                             const bool use_three_chords,
+                             const unsigned int num_harmonics,
+                             const double slope,
+                             const bool use_maj_min,
+                             const unsigned int pcp_size,
+                             const int hop_size,
+                             double min_frequency,
+                             unsigned int num_octaves) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.hop_size = hop_size;
+  DetectKeyOutput detect_key_output =
+      DetectKeyConstantQ(normalized_samples, sample_rate, options, min_frequency, num_octaves);
+  return ConvertDetectKeyOutputToPyDict(detect_key_output);
+}
+
+py::list _DetectKeyChanges(const std::vector<std::vector<double>>& normalized_samples,
+                           double sample_rate,
+                           const std::string profile_type,
+                           const bool use_polphony,
+                           const bool use_three_chords,
+                           const unsigned int num_harmonics,
+                           const double slope,
+                           const bool use_maj_min,
+                           const unsigned int pcp_size,
+                           const int frame_size,
+                           const int hop_size,
+                           const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                           unsigned int max_num_peaks,
+                           double window_size,
+                           unsigned int segment_frames,
+                           double transition_cost) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.frame_size = frame_size;
+  options.hop_size = hop_size;
+  options.window_type_func = window_type_func;
+  options.max_num_peaks = max_num_peaks;
+  options.window_size = window_size;
+  std::vector<KeySegment> key_segments =
+      DetectKeyChanges(normalized_samples, sample_rate, options, segment_frames, transition_cost);
+  return ConvertKeySegmentsToPyList(key_segments);
+}
+
+py::dict _DetectKeyEnsemble(const std::vector<std::vector<double>>& normalized_samples,
+                            double sample_rate,
+                            const std::vector<std::string>& profile_types,
+                            const std::string vote_type,
+                            const bool use_polphony,
+                            const bool use_three_chords,
+                            const unsigned int num_harmonics,
+                            const double slope,
+                            const bool use_maj_min,
+                            const unsigned int pcp_size,
+                            const int frame_size,
+                            const int hop_size,
+                            const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                            unsigned int max_num_peaks,
+                            double window_size,
+                            const std::string frame_sampling,
+                            unsigned int frame_stride,
+                            unsigned int num_sampled_frames,
+                            unsigned int sampling_seed,
+                            double rms_threshold) {
+  DetectKeyOptions options;
+  options.use_polphony = use_polphony;
+  options.use_three_chords = use_three_chords;
+  options.num_harmonics = num_harmonics;
+  options.slope = slope;
+  options.use_maj_min = use_maj_min;
+  options.pcp_size = pcp_size;
+  options.frame_size = frame_size;
+  options.hop_size = hop_size;
+  options.window_type_func = window_type_func;
+  options.max_num_peaks = max_num_peaks;
+  options.window_size = window_size;
+  options.frame_sampling = frame_sampling;
+  options.frame_stride = frame_stride;
+  options.num_sampled_frames = num_sampled_frames;
+  options.sampling_seed = sampling_seed;
+  options.rms_threshold = rms_threshold;
+  EnsembleKeyOutput ensemble_key_output =
+      DetectKeyEnsemble(normalized_samples, sample_rate, profile_types, vote_type, options);
+  return ConvertEnsembleKeyOutputToPyDict(ensemble_key_output);
+}
+
+py::dict _DetectKeyFile(const std::string& file_path, const std::string profile_type, int64_t max_memory_bytes) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.max_memory_bytes = max_memory_bytes;
+  DetectKeyOutput key_output;
+  {
+    py::gil_scoped_release release;
+    key_output = DetectKeyFile(file_path, options);
+  }
+  return ConvertDetectKeyOutputToPyDict(key_output);
+}
+
+py::list _DetectKeyFiles(const std::vector<std::string>& file_paths,
+                         const std::string profile_type,
+                         int num_threads,
+                         int64_t max_memory_bytes) {
+  DetectKeyOptions options;
+  options.profile_type = profile_type;
+  options.max_memory_bytes = max_memory_bytes;
+  std::vector<DetectKeyOutput> key_outputs;
+  {
+    // The worker threads never call back into Python.
+    py::gil_scoped_release release;
+    key_outputs = DetectKeyFiles(file_paths, options, num_threads);
+  }
+
+  py::list key_output_list;
+  for (const DetectKeyOutput& key_output : key_outputs)
+    key_output_list.append(ConvertDetectKeyOutputToPyDict(key_output));
+  return key_output_list;
 }
 
 }  // namespace python
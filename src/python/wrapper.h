@@ -1,5 +1,6 @@
 #include <pybind11/numpy.h>
 
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <vector>
@@ -22,6 +23,11 @@ py::dict _DecodeMp3FromFile(const std::string file_path);
 
 py::array_t<double> _MonoMixer(const std::vector<std::vector<double>>& normalized_samples);
 
+py::array_t<double> _Resample(const std::vector<double>& signal,
+                              double input_sample_rate,
+                              double output_sample_rate,
+                              const std::string quality);
+
 py::array_t<double> _Windowing(const std::vector<double>& audio_frame,
                                const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
                                unsigned zero_padding_size,
@@ -88,6 +94,14 @@ py::dict _EstimateKey(const std::vector<double>& pcp,
                       const std::string profile_type,
                       const bool use_maj_min);
 
+py::list _EstimateKeys(const std::vector<std::vector<double>>& pcps,
+                       const bool use_polphony,
+                       const bool use_three_chords,
+                       const unsigned int num_harmonics,
+                       const double slope,
+                       const std::string profile_type,
+                       const bool use_maj_min);
+
 py::dict _DetectKey(const std::vector<std::vector<double>>& normalized_samples,
                     double sample_rate,
                     const std::string profile_type,
@@ -101,6 +115,116 @@ py::dict _DetectKey(const std::vector<std::vector<double>>& normalized_samples,
                     const int hop_size,
                     const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
                     unsigned int max_num_peaks,
-                    double window_size);
+                    double window_size,
+                    unsigned int convergence_frames,
+                    unsigned int estimate_interval,
+                    double convergence_tolerance,
+                    const std::string frame_sampling,
+                    unsigned int frame_stride,
+                    unsigned int num_sampled_frames,
+                    unsigned int sampling_seed,
+                    double rms_threshold,
+                    double analysis_sample_rate);
+
+py::dict _AnalyzeKey(const std::vector<std::vector<double>>& normalized_samples,
+                     double sample_rate,
+                     const std::string profile_type,
+                     const bool use_polphony,
+                     const bool use_three_chords,
+                     const unsigned int num_harmonics,
+                     const double slope,
+                     const bool use_maj_min,
+                     const unsigned int pcp_size,
+                     const int frame_size,
+                     const int hop_size,
+                     const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                     unsigned int max_num_peaks,
+                     double window_size,
+                     unsigned int convergence_frames,
+                     unsigned int estimate_interval,
+                     double convergence_tolerance,
+                     const std::string frame_sampling,
+                     unsigned int frame_stride,
+                     unsigned int num_sampled_frames,
+                     unsigned int sampling_seed,
+                     double rms_threshold,
+                     double analysis_sample_rate);
+
+py::dict _Chromagram(const std::vector<std::vector<double>>& normalized_samples,
+                     double sample_rate,
+                     unsigned int pcp_size,
+                     unsigned int harmonics,
+                     const int frame_size,
+                     const int hop_size,
+                     const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                     unsigned int max_num_peaks,
+                     double window_size,
+                     unsigned int aggregation_frames,
+                     const std::string aggregation_type);
+
+py::dict _ConstantQChromagram(const std::vector<std::vector<double>>& normalized_samples,
+                              double sample_rate,
+                              unsigned int pcp_size,
+                              const int hop_size,
+                              double min_frequency,
+                              unsigned int num_octaves);
+
+py::dict _DetectKeyConstantQ(const std::vector<std::vector<double>>& normalized_samples,
+                             double sample_rate,
+                             const std::string profile_type,
+                             const bool use_polphony,
+                             const bool use_three_chords,
+                             const unsigned int num_harmonics,
+                             const double slope,
+                             const bool use_maj_min,
+                             const unsigned int pcp_size,
+                             const int hop_size,
+                             double min_frequency,
+                             unsigned int num_octaves);
+
+py::list _DetectKeyChanges(const std::vector<std::vector<double>>& normalized_samples,
+                           double sample_rate,
+                           const std::string profile_type,
+                           const bool use_polphony,
+                           const bool use_three_chords,
+                           const unsigned int num_harmonics,
+                           const double slope,
+                           const bool use_maj_min,
+                           const unsigned int pcp_size,
+                           const int frame_size,
+                           const int hop_size,
+                           const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                           unsigned int max_num_peaks,
+                           double window_size,
+                           unsigned int segment_frames,
+                           double transition_cost);
+
+py::dict _DetectKeyEnsemble(const std::vector<std::vector<double>>& normalized_samples,
+                            double sample_rate,
+                            const std::vector<std::string>& profile_types,
+                            const std::string vote_type,
+                            const bool use_polphony,
+                            const bool use_three_chords,
+                            const unsigned int num_harmonics,
+                            const double slope,
+                            const bool use_maj_min,
+                            const unsigned int pcp_size,
+                            const int frame_size,
+                            const int hop_size,
+                            const std::function<std::vector<double>(const std::vector<double>&)>& window_type_func,
+                            unsigned int max_num_peaks,
+                            double window_size,
+                            const std::string frame_sampling,
+                            unsigned int frame_stride,
+                            unsigned int num_sampled_frames,
+                            unsigned int sampling_seed,
+                            double rms_threshold);
+
+py::dict _DetectKeyFile(const std::string& file_path, const std::string profile_type, int64_t max_memory_bytes);
+
+py::list _DetectKeyFiles(const std::vector<std::string>& file_paths,
+                         const std::string profile_type,
+                         int num_threads,
+                         int64_t max_memory_bytes);
 }  // namespace python
 }  // namespace musher
\ No newline at end of file
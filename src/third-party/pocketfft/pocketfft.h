@@ -2015,12 +2015,20 @@ template<typename T> void radbg(size_t ido, size_t ip, size_t l1,
 
   public:
     template<typename T> void forward(T c[], T0 fct)
+      {
+      if (length==1) { c[0]*=fct; return; }
+      arr<T> ch(length);
+      forward(c, fct, ch.data());
+      }
+
+    // musher: same as forward(c, fct) with a caller-provided work buffer of
+    // length elements, so repeated transforms do not allocate.
+    template<typename T> void forward(T c[], T0 fct, T *ch)
       {
       if (length==1) { c[0]*=fct; return; }
       size_t n=length;
       size_t l1=n, nf=fact.size();
-      arr<T> ch(n);
-      T *p1=c, *p2=ch.data();
+      T *p1=c, *p2=ch;
 
       for(size_t k1=0; k1<nf;++k1)
         {
@@ -2044,12 +2052,20 @@ template<typename T> void radbg(size_t ido, size_t ip, size_t l1,
       }
 
     template<typename T> void backward(T c[], T0 fct)
+      {
+      if (length==1) { c[0]*=fct; return; }
+      arr<T> ch(length);
+      backward(c, fct, ch.data());
+      }
+
+    // musher: same as backward(c, fct) with a caller-provided work buffer of
+    // length elements.
+    template<typename T> void backward(T c[], T0 fct, T *ch)
       {
       if (length==1) { c[0]*=fct; return; }
       size_t n=length;
       size_t l1=1, nf=fact.size();
-      arr<T> ch(n);
-      T *p1=c, *p2=ch.data();
+      T *p1=c, *p2=ch;
 
       for(size_t k=0; k<nf; k++)
         {
@@ -2333,6 +2349,25 @@ template<typename T0> class pocketfft_r
                : blueplan->forward_r(c,fct);
       }
 
+    // musher: forward transform with a caller-provided work buffer of length
+    // elements. Only the packed plan uses it, Bluestein plans (lengths with
+    // large prime factors) still allocate.
+    template<typename T> POCKETFFT_NOINLINE void forward(T c[], T0 fct, T *scratch) const
+      {
+      packplan ? packplan->forward(c,fct,scratch)
+               : blueplan->forward_r(c,fct);
+      }
+
+    // musher: backward transform with a caller-provided work buffer, see
+    // forward(c, fct, scratch).
+    template<typename T> POCKETFFT_NOINLINE void backward(T c[], T0 fct, T *scratch) const
+      {
+      packplan ? packplan->backward(c,fct,scratch)
+               : blueplan->backward_r(c,fct);
+      }
+
+    bool uses_packed_plan() const { return packplan != nullptr; }
+
     size_t length() const { return len; }
   };
 
@@ -0,0 +1,24 @@
+import os
+
+import musher
+
+
+def test_bpm_over_window(test_data_dir: str):
+    audio_file_path = os.path.join(test_data_dir, "audio_files", "126bpm.mp3")
+
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    assert musher.bpm_over_window(normalized_samples, sample_rate) == 125.
+    assert musher.bpm_over_window(normalized_samples, sample_rate, 3., num_threads=1) == 125.
+
+
+def test_bpm_detection(test_data_dir: str):
+    audio_file_path = os.path.join(test_data_dir, "audio_files", "CantinaBand3sec.wav")
+
+    wav_decoded = musher.decode_wav_from_file(audio_file_path)
+    samples = musher.mono_mixer(wav_decoded["normalized_samples"])
+
+    assert round(musher.bpm_detection(samples, wav_decoded["sample_rate"])) == 114.
+    assert musher.bpm_detection([0.] * 44100 * 3, 44100.) == 0.
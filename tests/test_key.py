@@ -1,4 +1,5 @@
 import os
+import json
 import math
 
 import musher
@@ -78,3 +79,353 @@ def test_estimate_key(test_data_dir: str):
                         expected_key_output['strength'], rel_tol=1e-6)
     assert math.isclose(actual_key_output['first_to_second_relative_strength'],
                         expected_key_output['first_to_second_relative_strength'], rel_tol=1e-6)
+
+
+def test_key_tracker(test_data_dir: str):
+    """Stream a decoded file through the key tracker in blocks.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    sample_rate = mp3_decoded["sample_rate"]
+    mixed_audio = musher.mono_mixer(mp3_decoded["normalized_samples"])
+
+    expected_key_output = musher.detect_key(
+        mp3_decoded["normalized_samples"], sample_rate, "Temperley")
+
+    key_tracker = musher.KeyTracker(sample_rate, "Temperley")
+    block_size = 44100
+    for start in range(0, len(mixed_audio), block_size):
+        key_tracker.add_samples(mixed_audio[start:start + block_size])
+    key_tracker.flush()
+
+    actual_key_output = key_tracker.estimate()
+
+    assert actual_key_output['key'] == expected_key_output['key']
+    assert actual_key_output['scale'] == expected_key_output['scale']
+    assert math.isclose(actual_key_output['strength'],
+                        expected_key_output['strength'], rel_tol=1e-9)
+
+
+def test_detect_key_adaptive(test_data_dir: str):
+    """Stop the key detection early once the estimate has converged.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    full_key_output = musher.detect_key(
+        normalized_samples, sample_rate, "Temperley")
+    adaptive_key_output = musher.detect_key(
+        normalized_samples, sample_rate, "Temperley", convergence_frames=500)
+
+    assert full_key_output['analyzed_ratio'] == 1.0
+    assert adaptive_key_output['key'] == 'C'
+    assert adaptive_key_output['scale'] == 'major'
+    assert adaptive_key_output['analyzed_ratio'] < 1.0
+    assert adaptive_key_output['frames_analyzed'] < full_key_output['frames_analyzed']
+
+
+def test_detect_key_energy_gate(test_data_dir: str):
+    """Silent frames are skipped by the energy gate.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    sample_rate = mp3_decoded["sample_rate"]
+    mixed_audio = list(musher.mono_mixer(mp3_decoded["normalized_samples"]))
+    silence = [0.0] * int(5 * sample_rate)
+
+    key_output = musher.detect_key(
+        [silence + mixed_audio + silence], sample_rate, "Temperley", rms_threshold=1e-4)
+
+    assert key_output['key'] == 'C'
+    assert key_output['scale'] == 'major'
+    assert key_output['frames_skipped'] > 0
+
+
+def test_estimate_keys():
+    """Estimate the keys of several PCPs at once.
+    """
+    pcps = [
+        [1., 0., 0.5, 0., 0.8, 0.6, 0., 1., 0., 0.4, 0., 0.2],
+        [0.8, 0., 0.3, 0., 1., 0.4, 0., 0.9, 0., 0.6, 0., 0.4],
+    ]
+
+    key_outputs = musher.estimate_keys(pcps, profile_type="Temperley")
+
+    assert len(key_outputs) == len(pcps)
+    for pcp, key_output in zip(pcps, key_outputs):
+        expected_key_output = musher.estimate_key(pcp, profile_type="Temperley")
+        assert key_output == expected_key_output
+
+
+def test_detect_key_ensemble(test_data_dir: str):
+    """Evaluate several profiles from a single pass over the audio.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    profile_types = ["Temperley", "Krumhansl", "Bgate"]
+    ensemble = musher.detect_key_ensemble(
+        normalized_samples, sample_rate, profile_types, frame_sampling="stride", frame_stride=4)
+
+    assert list(ensemble["key_outputs"].keys()) == profile_types
+    for profile_type in profile_types:
+        expected_key_output = musher.detect_key(
+            normalized_samples, sample_rate, profile_type, frame_sampling="stride", frame_stride=4)
+        actual_key_output = ensemble["key_outputs"][profile_type]
+        assert actual_key_output['key'] == expected_key_output['key']
+        assert actual_key_output['scale'] == expected_key_output['scale']
+    assert ensemble["vote"]["key"] == 'C'
+    assert ensemble["vote"]["scale"] == 'major'
+
+
+def test_analyze_key(test_data_dir: str):
+    """Keep the averaged HPCP and re-estimate the key from it.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    key_analysis = musher.analyze_key(normalized_samples, sample_rate, "Temperley")
+
+    assert key_analysis['key'] == 'C'
+    assert key_analysis['scale'] == 'major'
+    assert len(key_analysis['average_hpcp']) == 36
+    assert len(key_analysis['major_correlations']) == 36
+    assert len(key_analysis['key_scores']) == 24
+
+    key_output = musher.estimate_key(
+        list(key_analysis['average_hpcp']), profile_type="Temperley")
+    assert key_output['key'] == key_analysis['key']
+    assert math.isclose(key_output['strength'], key_analysis['strength'], rel_tol=1e-12)
+
+
+def test_chromagram(test_data_dir: str):
+    """Compute the HPCP of every frame as a 2-D array.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    chromagram = musher.chromagram(normalized_samples, sample_rate)
+    key_analysis = musher.analyze_key(normalized_samples, sample_rate, "Temperley")
+
+    assert chromagram['chromagram'].shape == (key_analysis['frames_analyzed'], 36)
+    assert len(chromagram['timestamps']) == key_analysis['frames_analyzed']
+    for actual, expected in zip(chromagram['chromagram'].mean(axis=0), key_analysis['average_hpcp']):
+        assert math.isclose(actual, expected, rel_tol=1e-9)
+
+    aggregated = musher.chromagram(normalized_samples, sample_rate, aggregation_frames=8)
+    assert aggregated['chromagram'].shape == ((key_analysis['frames_analyzed'] + 7) // 8, 36)
+
+
+def test_constant_q(test_data_dir: str):
+    """The constant-Q front end finds the key of the classical test file.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    chromagram = musher.constant_q_chromagram(normalized_samples, sample_rate)
+    num_frames = (len(normalized_samples[0]) - 1) // 512 + 1
+    assert chromagram['chromagram'].shape == (num_frames, 36)
+    assert chromagram['chromagram'].max() == 1.0
+
+    key_output = musher.detect_key_constant_q(normalized_samples, sample_rate, "Temperley")
+    assert key_output['key'] == 'C'
+    assert key_output['scale'] == 'major'
+    assert key_output['frames_analyzed'] == num_frames
+
+
+def test_detect_key_changes(test_data_dir: str):
+    """Follow the key through a C major piece followed by an Eb major piece.
+    """
+    c_major = musher.decode_mp3_from_file(os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3"))
+    eb_major = musher.decode_mp3_from_file(os.path.join(
+        test_data_dir, "audio_files", "EDM_Eb_major_2min.mp3"))
+    sample_rate = c_major["sample_rate"]
+    samples = list(c_major["normalized_samples"][0]) + \
+        list(eb_major["normalized_samples"][0][:30 * sample_rate])
+
+    key_segments = musher.detect_key_changes([samples], sample_rate, "Temperley")
+
+    assert len(key_segments) >= 2
+    assert key_segments[0]['key'] == 'C'
+    assert key_segments[0]['scale'] == 'major'
+    assert abs(key_segments[0]['end_time'] - 30.) < 1.5
+    assert key_segments[1]['key'] == 'Eb'
+    assert key_segments[0]['start_time'] == 0.
+    assert math.isclose(key_segments[-1]['end_time'], len(samples) / sample_rate)
+
+
+def test_key_detector(test_data_dir: str):
+    """Reuse the same detector for several signals.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    expected_key_output = musher.detect_key(
+        normalized_samples, sample_rate, "Temperley")
+
+    key_detector = musher.KeyDetector(sample_rate, "Temperley")
+    for _ in range(2):
+        actual_key_output = key_detector.detect(normalized_samples)
+        assert actual_key_output['key'] == expected_key_output['key']
+        assert actual_key_output['scale'] == expected_key_output['scale']
+        assert math.isclose(actual_key_output['strength'],
+                            expected_key_output['strength'], rel_tol=1e-9)
+        assert actual_key_output['frames_analyzed'] == expected_key_output['frames_analyzed']
+
+
+def test_simd_levels(test_data_dir: str):
+    """Every instruction set level gives the same key analysis.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    levels = ["scalar", "sse2", "avx2", "avx512"]
+    supported_levels = levels[:levels.index(musher.detected_simd_level()) + 1]
+
+    musher.set_simd_level("scalar")
+    expected_key_analysis = musher.analyze_key(normalized_samples, sample_rate, "Temperley")
+    for level in supported_levels:
+        musher.set_simd_level(level)
+        assert musher.simd_level() == level
+        key_analysis = musher.analyze_key(normalized_samples, sample_rate, "Temperley")
+        assert key_analysis['strength'] == expected_key_analysis['strength']
+        assert list(key_analysis['average_hpcp']) == list(expected_key_analysis['average_hpcp'])
+    musher.reset_simd_level()
+
+
+def test_backends(test_data_dir: str):
+    """The reference backend gives the same key as the optimized one, and cross-check mode reports no deviation.
+    """
+    audio_file_path = os.path.join(test_data_dir, "audio_files", "CantinaBand3sec.wav")
+    wav_decoded = musher.decode_wav_from_file(audio_file_path)
+    normalized_samples = wav_decoded["normalized_samples"]
+    sample_rate = wav_decoded["sample_rate"]
+
+    musher.set_backend("optimized")
+    expected_key_output = musher.detect_key(normalized_samples, sample_rate, "Temperley")
+
+    musher.set_backend("reference")
+    assert musher.backend() == "reference"
+    key_output = musher.detect_key(normalized_samples, sample_rate, "Temperley")
+    assert key_output['key'] == expected_key_output['key']
+    assert key_output['scale'] == expected_key_output['scale']
+    assert math.isclose(key_output['strength'], expected_key_output['strength'], abs_tol=1e-9)
+
+    musher.set_backend("cross_check")
+    musher.reset_cross_check_report()
+    musher.detect_key(normalized_samples, sample_rate, "Temperley")
+    report = musher.cross_check_report()
+    assert report['frames_checked'] == expected_key_output['frames_analyzed']
+    assert report['hpcp_deviation'] < 1e-9
+    assert report['key_correlation_deviation'] < 1e-9
+    musher.reset_backend()
+
+
+def test_pipeline_stats(test_data_dir: str):
+    """The stats of every stage are recorded when enabled, and are all zeros otherwise.
+    """
+    audio_file_path = os.path.join(test_data_dir, "audio_files", "CantinaBand3sec.wav")
+    musher.set_stats_enabled(True)
+    musher.reset_pipeline_stats()
+    wav_decoded = musher.decode_wav_from_file(audio_file_path)
+    key_output = musher.detect_key(wav_decoded["normalized_samples"], wav_decoded["sample_rate"], "Temperley")
+    stats = key_output['stats']
+    assert stats['frames_processed'] == key_output['frames_analyzed']
+    assert stats['peaks_found'] > 0
+    assert stats['fft_seconds'] > 0.
+    assert stats['hpcp_seconds'] > 0.
+    assert musher.pipeline_stats()['bytes_decoded'] == os.path.getsize(audio_file_path)
+    assert musher.pipeline_stats()['peak_file_bytes'] == os.path.getsize(audio_file_path)
+    assert stats['peak_frame_bytes'] > 0
+    assert stats['peak_spectrum_bytes'] > 0
+
+    musher.set_stats_enabled(False)
+    assert not musher.stats_enabled()
+    key_output = musher.detect_key(wav_decoded["normalized_samples"], wav_decoded["sample_rate"], "Temperley")
+    assert key_output['stats']['frames_processed'] == 0
+
+
+def test_detect_key_files(test_data_dir: str, tmp_path):
+    """A batch of files gets the same keys as detect_key, and its trace is valid trace-event JSON.
+    """
+    audio_file_path = os.path.join(test_data_dir, "audio_files", "CantinaBand3sec.wav")
+    wav_decoded = musher.decode_wav_from_file(audio_file_path)
+    expected_key_output = musher.detect_key(wav_decoded["normalized_samples"], wav_decoded["sample_rate"])
+
+    trace_path = str(tmp_path / "trace.json")
+    musher.start_trace(trace_path)
+    assert musher.trace_enabled()
+    key_outputs = musher.detect_key_files([audio_file_path, audio_file_path], num_threads=2)
+    musher.stop_trace()
+    assert not musher.trace_enabled()
+
+    assert len(key_outputs) == 2
+    for key_output in key_outputs:
+        assert key_output['key'] == expected_key_output['key']
+        assert key_output['scale'] == expected_key_output['scale']
+
+    with open(trace_path) as trace_file:
+        trace = json.load(trace_file)
+    names = [event['name'] for event in trace['traceEvents']]
+    assert names.count('DecodeWav') == 2
+    assert 'AnalyzeFrames' in names
+    assert 'WaitForFile' in names
+
+
+def test_detect_key_file(test_data_dir: str):
+    """A file streamed under a memory budget gets the same key as the whole decoding.
+    """
+    audio_file_path = os.path.join(test_data_dir, "audio_files", "700kb.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    expected_key_output = musher.detect_key(mp3_decoded["normalized_samples"], mp3_decoded["sample_rate"])
+
+    for max_memory_bytes in [0, 1]:
+        key_output = musher.detect_key_file(audio_file_path, max_memory_bytes=max_memory_bytes)
+        assert key_output['key'] == expected_key_output['key']
+        assert key_output['scale'] == expected_key_output['scale']
+        assert math.isclose(key_output['strength'], expected_key_output['strength'], abs_tol=1e-9)
+        assert key_output['frames_analyzed'] == expected_key_output['frames_analyzed']
+
+
+def test_detect_key_analysis_sample_rate(test_data_dir: str):
+    """Analyzing the signal resampled to 11025 Hz gets the same key as the full rate.
+    """
+    audio_file_path = os.path.join(
+        test_data_dir, "audio_files", "mozart_c_major_30sec.mp3")
+    mp3_decoded = musher.decode_mp3_from_file(audio_file_path)
+    normalized_samples = mp3_decoded["normalized_samples"]
+    sample_rate = mp3_decoded["sample_rate"]
+
+    expected_key_output = musher.detect_key(normalized_samples, sample_rate, "Temperley")
+    key_output = musher.detect_key(normalized_samples, sample_rate, "Temperley", analysis_sample_rate=11025.)
+
+    assert key_output['key'] == expected_key_output['key']
+    assert key_output['scale'] == expected_key_output['scale']
+    assert math.isclose(key_output['strength'], expected_key_output['strength'], abs_tol=0.05)
+
+    resampled = musher.resample(musher.mono_mixer(normalized_samples), sample_rate, 11025.)
+    assert len(resampled) == math.ceil(len(normalized_samples[0]) * 11025. / sample_rate)